@@ -0,0 +1,30 @@
+﻿// AllocationCounter.cpp : 替换全局的operator new和operator delete，累加AllocationCounter的分配计数。
+// 单独放在一个编译单元中，调用方无法内联这些函数，编译器不会把内联后的free与operator new误报为不匹配。
+
+#include <cstdlib>
+#include <new>
+#include "BenchmarkMetrics.h"
+
+std::atomic<long long> AllocationCounter::count{0};
+std::atomic<long long> AllocationCounter::bytes{0};
+
+void* operator new(const std::size_t size)
+{
+	AllocationCounter::count.fetch_add(1, std::memory_order_relaxed);
+	AllocationCounter::bytes.fetch_add(static_cast<long long>(size), std::memory_order_relaxed);
+	if (void* memory = std::malloc(size > 0 ? size : 1))
+	{
+		return memory;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
@@ -0,0 +1,596 @@
+﻿// Benchmark.cpp : 生成合成数据集，测量两种引擎所有FileEngineBase方法的吞吐量、峰值内存、分配次数和硬件计数器。
+// 不依赖外部数据和网络。Linux上在Source目录下直接编译库源文件：
+//   g++ -std=c++20 -O2 -D'__declspec(x)=' Benchmark/*.cpp FileHelpersCpp/*.cpp -lpthread -o file_helpers_benchmark
+// 用法：file_helpers_benchmark [--rows N] [--columns N] [--precision N] [--delimiter D] [--crlf]
+//                              [--format xyz|delimited] [--iterations N] [--engine mmf|stream] [--dir PATH] [--keep]
+//                              [--json PATH] [--baseline PATH] [--trace PATH]
+// --json将结果写为JSON；--baseline与检入的基线比较，数据集配置默认取自基线，有回归时退出码为3。
+// --trace将整个运行过程的引擎时间线写为chrome://tracing和Perfetto可以打开的JSON。
+// 更新基线：file_helpers_benchmark --baseline Benchmark/baseline.json --json Benchmark/baseline.json
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../FileHelpersCpp/DelimitedFileMMFEngine.h"
+#include "../FileHelpersCpp/DelimitedFileSteamEngine.h"
+#include "../FileHelpersCpp/StringConverter.h"
+#include "BenchmarkMetrics.h"
+#include "BenchmarkReport.h"
+#include "DatasetGenerator.h"
+
+using namespace file_helpers_cpp;
+
+/// <summary>
+/// 表示测试程序的配置。
+/// </summary>
+struct BenchmarkOptions
+{
+	DatasetOptions dataset;
+
+	/// <summary>
+	/// 每个方法的重复次数，取最快的一次。
+	/// </summary>
+	int iterations = 3;
+
+	/// <summary>
+	/// 只测试指定的引擎，为空时测试所有引擎。
+	/// </summary>
+	std::string engine;
+
+	/// <summary>
+	/// 数据集和输出文件所在的目录。
+	/// </summary>
+	std::string directory;
+
+	/// <summary>
+	/// 结束后是否保留生成的文件。
+	/// </summary>
+	bool keep_files = false;
+
+	/// <summary>
+	/// 结果JSON的输出路径，为空时不输出。
+	/// </summary>
+	std::string json_path;
+
+	/// <summary>
+	/// 基线文件路径，为空时不做回归检查。
+	/// </summary>
+	std::string baseline_path;
+
+	/// <summary>
+	/// 时间线跟踪的输出路径，为空时不跟踪。
+	/// </summary>
+	std::string trace_path;
+};
+
+/// <summary>
+/// 表示一次测量的上下文。
+/// </summary>
+struct BenchmarkContext
+{
+	std::string read_path;
+
+	std::string write_path;
+
+	const Dataset& dataset;
+
+	/// <summary>
+	/// BatchModifyFieldValues按行、字段索引的修改。
+	/// </summary>
+	std::map<int, std::map<int, std::string>> field_changes{};
+
+	/// <summary>
+	/// 与field_changes相同的修改，多线程版本使用。
+	/// </summary>
+	std::vector<FieldPatch> field_patches{};
+};
+
+/// <summary>
+/// 表示一次调用的结果。
+/// </summary>
+enum class CaseOutcome
+{
+	Succeeded,
+
+	/// <summary>
+	/// 方法返回失败。
+	/// </summary>
+	Failed,
+
+	/// <summary>
+	/// 方法返回成功，但输出未通过检查。
+	/// </summary>
+	InvalidOutput
+};
+
+/// <summary>
+/// 由方法的返回值和输出检查的结果得到调用结果。
+/// </summary>
+inline CaseOutcome Outcome(const bool succeeded, const bool output_valid = true)
+{
+	return !succeeded ? CaseOutcome::Failed : output_valid ? CaseOutcome::Succeeded : CaseOutcome::InvalidOutput;
+}
+
+/// <summary>
+/// 表示一个被测方法。
+/// </summary>
+struct BenchmarkCase
+{
+	std::string method{};
+
+	/// <summary>
+	/// 是否写入输出文件。吞吐量按输出文件大小计算，否则按输入文件大小计算。
+	/// </summary>
+	bool writes_file = false;
+
+	/// <summary>
+	/// 调用被测方法并检查输出。读取类方法检查文本长度或记录数，写入类方法的输出文件为空时视为输出不符。
+	/// </summary>
+	std::function<CaseOutcome(const FileEngineBase& engine, const BenchmarkContext& context)> run{};
+
+	/// <summary>
+	/// 是否在每次测量前将输入文件复制为输出文件。原地修改类方法修改该副本，复制不计入耗时。
+	/// </summary>
+	bool copies_input = false;
+
+	/// <summary>
+	/// 只适用于指定的引擎，为空时适用于所有引擎。
+	/// </summary>
+	std::string only_engine{};
+
+	/// <summary>
+	/// 一次调用读取输入文件的次数，吞吐量和记录数按该倍数计算。
+	/// </summary>
+	int file_count = 1;
+
+	/// <summary>
+	/// 吞吐量按该字节数计算，为0时按输出或输入文件的大小计算。用于KeepSize等不改变文件大小的预分配。
+	/// </summary>
+	long long counted_bytes = 0;
+
+	/// <summary>
+	/// 吞吐量指标的相对容差，为0时使用基线中的容差。
+	/// </summary>
+	double throughput_tolerance = 0;
+};
+
+/// <summary>
+/// 批量读取测试中同时读取的文件数。
+/// </summary>
+constexpr int kMultiFileCount = 4;
+
+/// <summary>
+/// 获取FileEngineBase所有方法和内存映射引擎专有读写方法的测试用例。
+/// </summary>
+inline std::vector<BenchmarkCase> CreateBenchmarkCases()
+{
+	const std::error_code error;
+	std::vector<BenchmarkCase> cases = {
+		{ "CountLines", false, [error](const FileEngineBase& engine, const BenchmarkContext& context)
+		{
+			const long long count = engine.CountLines(context.read_path, error);
+			return Outcome(count >= 0, count == static_cast<long long>(context.dataset.lines.size()));
+		} },
+		{ "ReadAllText", false, [error](const FileEngineBase& engine, const BenchmarkContext& context)
+		{
+			std::string text;
+			const bool succeeded = engine.ReadAllText(context.read_path, text, error);
+			return Outcome(succeeded, text.size() == context.dataset.text.size());
+		} },
+		{ "ReadAllLines", false, [error](const FileEngineBase& engine, const BenchmarkContext& context)
+		{
+			std::vector<std::string> lines;
+			const bool succeeded = engine.ReadAllLines(context.read_path, lines, error);
+			return Outcome(succeeded, lines.size() == context.dataset.lines.size());
+		} },
+		{ "ReadAllLines(Range)", false, [error](const FileEngineBase& engine, const BenchmarkContext& context)
+		{
+			std::vector<std::string> lines;
+			const bool succeeded = engine.ReadAllLines(context.read_path, lines, error, 1, static_cast<int>(context.dataset.lines.size()));
+			return Outcome(succeeded, !lines.empty());
+		} },
+		{ "ReadFileAsStringVector", false, [error](const FileEngineBase& engine, const BenchmarkContext& context)
+		{
+			std::vector<std::vector<std::string>> records;
+			const bool succeeded = engine.ReadFileAsStringVector(context.read_path, records, error);
+			return Outcome(succeeded, records.size() == context.dataset.lines.size());
+		} },
+		{ "ReadFileAsDoubleVector", false, [error](const FileEngineBase& engine, const BenchmarkContext& context)
+		{
+			std::vector<std::vector<double>> records;
+			const bool succeeded = engine.ReadFileAsDoubleVector(context.read_path, records, error);
+			return Outcome(succeeded, records.size() == context.dataset.lines.size());
+		} },
+		{ "WriteAllText", true, [error](const FileEngineBase& engine, const BenchmarkContext& context)
+		{
+			return Outcome(engine.WriteAllText(context.write_path, context.dataset.text, error));
+		} },
+		{ "WriteAllLines", true, [error](const FileEngineBase& engine, const BenchmarkContext& context)
+		{
+			return Outcome(engine.WriteAllLines(context.write_path, context.dataset.lines, error));
+		} },
+		{ "WriteAllStringVector", true, [error](const FileEngineBase& engine, const BenchmarkContext& context)
+		{
+			return Outcome(engine.WriteAllStringVector(context.write_path, context.dataset.string_records, error));
+		} },
+		{ "WriteAllDoubleVector", true, [error](const FileEngineBase& engine, const BenchmarkContext& context)
+		{
+			return Outcome(engine.WriteAllDoubleVector(context.write_path, context.dataset.double_records, error));
+		} },
+		{ "AppendAllLines", true, [error](const FileEngineBase& engine, const BenchmarkContext& context)
+		{
+			return Outcome(engine.AppendAllLines(context.write_path, context.dataset.lines, error));
+		} },
+		{ "AppendStringVector", true, [error](const FileEngineBase& engine, const BenchmarkContext& context)
+		{
+			return Outcome(engine.AppendStringVector(context.write_path, context.dataset.string_records, error));
+		} },
+		{ "AppendDoubleVector", true, [error](const FileEngineBase& engine, const BenchmarkContext& context)
+		{
+			return Outcome(engine.AppendDoubleVector(context.write_path, context.dataset.double_records, error));
+		} },
+		{ "ReadFilesAsStringVector", false, [error](const FileEngineBase& engine, const BenchmarkContext& context)
+		{
+			const auto* mmf_engine = dynamic_cast<const DelimitedFileMmfEngine*>(&engine);
+			const std::vector<std::string> paths(kMultiFileCount, context.read_path);
+			std::atomic<size_t> record_count{0};
+			const bool succeeded = mmf_engine && mmf_engine->ReadFilesAsStringVector(paths, [&record_count](size_t, std::vector<std::vector<std::string>>& records, const std::error_code&)
+			{
+				record_count += records.size();
+				return true;
+			}, error);
+			return Outcome(succeeded, record_count == context.dataset.lines.size() * kMultiFileCount);
+		}, false, "mmf", kMultiFileCount },
+		{ "ReadFilesAsDoubleVector", false, [error](const FileEngineBase& engine, const BenchmarkContext& context)
+		{
+			const auto* mmf_engine = dynamic_cast<const DelimitedFileMmfEngine*>(&engine);
+			const std::vector<std::string> paths(kMultiFileCount, context.read_path);
+			std::atomic<size_t> record_count{0};
+			const bool succeeded = mmf_engine && mmf_engine->ReadFilesAsDoubleVector(paths, [&record_count](size_t, std::vector<std::vector<double>>& records, const std::error_code&)
+			{
+				record_count += records.size();
+				return true;
+			}, error);
+			return Outcome(succeeded, record_count == context.dataset.lines.size() * kMultiFileCount);
+		}, false, "mmf", kMultiFileCount },
+		{ "BatchModifyFieldValues", true, [error](const FileEngineBase& engine, const BenchmarkContext& context)
+		{
+			const auto* mmf_engine = dynamic_cast<const DelimitedFileMmfEngine*>(&engine);
+			return Outcome(mmf_engine && mmf_engine->BatchModifyFieldValues(context.write_path, context.field_changes, error));
+		}, true, "mmf" },
+		{ "BatchModifyFieldValues(Parallel)", true, [error](const FileEngineBase& engine, const BenchmarkContext& context)
+		{
+			const auto* mmf_engine = dynamic_cast<const DelimitedFileMmfEngine*>(&engine);
+			return Outcome(mmf_engine && mmf_engine->BatchModifyFieldValues(context.write_path, context.field_patches, error));
+		}, true, "mmf" }
+	};
+
+	// 预分配的耗时应与分配大小无关，每种方式测量两个相差16倍的大小。两种引擎共用同一实现，只测一次。
+	// 单次调用只有微秒级，吞吐量允许退化到基线的十分之一，退回写入空字节的实现时仍会判定为回归。
+	const std::pair<PreAllocateMode, const char*> modes[] = {
+		{ PreAllocateMode::Allocate, "Allocate" },
+		{ PreAllocateMode::KeepSize, "KeepSize" },
+		{ PreAllocateMode::Sparse, "Sparse" } };
+	const std::pair<long long, const char*> sizes[] = { { 64LL << 20, "64MB" }, { 1LL << 30, "1GB" } };
+	for (const auto& mode : modes)
+	{
+		for (const auto& size : sizes)
+		{
+			const PreAllocateMode allocate_mode = mode.first;
+			const long long allocate_size = size.first;
+			cases.push_back({ std::string("PreAllocateFile(") + mode.second + "," + size.second + ")", true,
+				[allocate_mode, allocate_size](const FileEngineBase& engine, const BenchmarkContext& context)
+			{
+				engine.PreAllocateFile(context.write_path, allocate_size, allocate_mode);
+				// KeepSize只保留磁盘空间，不改变文件大小。
+				std::error_code size_error;
+				const auto file_size = static_cast<long long>(std::filesystem::file_size(context.write_path, size_error));
+				return Outcome(!size_error, file_size == (allocate_mode == PreAllocateMode::KeepSize ? 0 : allocate_size));
+			}, false, "mmf", 1, allocate_size, 0.9 });
+		}
+	}
+	return cases;
+}
+
+/// <summary>
+/// 生成BatchModifyFieldValues的修改：每64行修改一个字段，新值交替变长和变短，同时覆盖原地写入和移动字节两种情况。
+/// </summary>
+inline void CreateFieldChanges(const Dataset& dataset, BenchmarkContext& context)
+{
+	for (size_t row = 0; row < dataset.string_records.size(); row += 64)
+	{
+		const auto& record = dataset.string_records[row];
+		if (record.empty())
+		{
+			continue;
+		}
+		const int field_index = record.size() > 1 ? 1 : 0;
+		const std::string value = row / 64 % 2 == 0 ? record[field_index] + "1" : "0";
+		context.field_changes[static_cast<int>(row)][field_index] = value;
+		context.field_patches.push_back({ static_cast<int>(row), field_index, value });
+	}
+}
+
+/// <summary>
+/// 测量一个方法，重复多次取最快的一次。写入类方法每次测量前删除输出文件，追加类方法因此也从空文件开始。
+/// </summary>
+inline BenchmarkResult RunBenchmarkCase(const std::string& engine_name, const FileEngineBase& engine, const BenchmarkCase& benchmark_case,
+                                        const BenchmarkContext& context, const int iterations)
+{
+	BenchmarkResult result;
+	result.engine = engine_name;
+	result.method = benchmark_case.method;
+	result.throughput_tolerance = benchmark_case.throughput_tolerance;
+	result.records = static_cast<long long>(context.dataset.lines.size()) * benchmark_case.file_count;
+
+	for (int iteration = 0; iteration < std::max(1, iterations); iteration++)
+	{
+		std::error_code remove_error;
+		std::filesystem::remove(context.write_path, remove_error);
+		if (benchmark_case.copies_input)
+		{
+			std::filesystem::copy_file(context.read_path, context.write_path, std::filesystem::copy_options::overwrite_existing, remove_error);
+		}
+
+		ResetPeakRss();
+		EngineStats stats;
+		OperationProfiler profiler(stats);
+		const MemorySnapshot before = TakeMemorySnapshot();
+		const auto start = std::chrono::steady_clock::now();
+		const CaseOutcome outcome = benchmark_case.run(engine, context);
+		const auto end = std::chrono::steady_clock::now();
+		const MemorySnapshot after = TakeMemorySnapshot();
+		profiler.Finish();
+
+		const double seconds = std::chrono::duration<double>(end - start).count();
+		result.succeeded = result.succeeded && outcome != CaseOutcome::Failed;
+		result.output_valid = result.output_valid && outcome != CaseOutcome::InvalidOutput;
+		result.peak_rss_bytes = std::max(result.peak_rss_bytes, PeakRssBytes());
+		if (iteration == 0 || seconds < result.seconds)
+		{
+			result.seconds = seconds;
+			result.allocation_count = after.allocation_count - before.allocation_count;
+			result.allocated_bytes = after.allocated_bytes - before.allocated_bytes;
+			result.instructions = stats.instructions;
+			result.cycles = stats.cycles;
+			result.branch_misses = stats.branch_misses;
+			result.cache_misses = stats.cache_misses;
+		}
+	}
+
+	std::error_code size_error;
+	const auto size = std::filesystem::file_size(benchmark_case.writes_file ? context.write_path : context.read_path, size_error);
+	result.bytes = size_error ? 0 : static_cast<long long>(size) * benchmark_case.file_count;
+	if (benchmark_case.counted_bytes > 0)
+	{
+		result.bytes = benchmark_case.counted_bytes;
+	}
+	else if (benchmark_case.writes_file && result.bytes == 0)
+	{
+		result.output_valid = false;
+	}
+	return result;
+}
+
+/// <summary>
+/// 解析命令行参数。
+/// </summary>
+/// <returns>参数是否有效。</returns>
+inline bool ParseOptions(const int argc, char* argv[], BenchmarkOptions& options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+		const bool has_value = i + 1 < argc;
+		if (arg == "--rows" && has_value)
+		{
+			options.dataset.rows = std::strtoull(argv[++i], nullptr, 10);
+		}
+		else if (arg == "--columns" && has_value)
+		{
+			options.dataset.columns = std::strtoull(argv[++i], nullptr, 10);
+		}
+		else if (arg == "--precision" && has_value)
+		{
+			options.dataset.precision = std::atoi(argv[++i]);
+		}
+		else if (arg == "--delimiter" && has_value)
+		{
+			options.dataset.delimiter = argv[++i];
+		}
+		else if (arg == "--crlf")
+		{
+			options.dataset.crlf = true;
+		}
+		else if (arg == "--format" && has_value)
+		{
+			const std::string format = argv[++i];
+			if (format != "xyz" && format != "delimited")
+			{
+				return false;
+			}
+			options.dataset.format = format == "xyz" ? DatasetFormat::Xyz : DatasetFormat::Delimited;
+		}
+		else if (arg == "--iterations" && has_value)
+		{
+			options.iterations = std::atoi(argv[++i]);
+		}
+		else if (arg == "--engine" && has_value)
+		{
+			options.engine = argv[++i];
+		}
+		else if (arg == "--dir" && has_value)
+		{
+			options.directory = argv[++i];
+		}
+		else if (arg == "--keep")
+		{
+			options.keep_files = true;
+		}
+		else if (arg == "--json" && has_value)
+		{
+			options.json_path = argv[++i];
+		}
+		else if (arg == "--baseline" && has_value)
+		{
+			options.baseline_path = argv[++i];
+		}
+		else if (arg == "--trace" && has_value)
+		{
+			options.trace_path = argv[++i];
+		}
+		else
+		{
+			return false;
+		}
+	}
+	return !options.dataset.delimiter.empty();
+}
+
+/// <summary>
+/// 输出一个方法的测量结果。
+/// </summary>
+inline void PrintResult(const BenchmarkResult& result)
+{
+	// 硬件计数器不可用时显示为-。
+	const auto per_unit = [](const long long count, const long long units)
+	{
+		return count >= 0 && units > 0 ? StringFormat("%.2f", static_cast<double>(count) / static_cast<double>(units)) : std::string("-");
+	};
+	const std::string output_str = StringFormat("%-8s %-32s %10.3f %10.1f %14.0f %12.1f %12lld %8s %12s %12s %s",
+		result.engine.c_str(), result.method.c_str(), result.seconds * 1000, result.MegabytesPerSecond(),
+		result.RecordsPerSecond(), static_cast<double>(result.peak_rss_bytes) / (1024.0 * 1024.0),
+		result.allocation_count, per_unit(result.instructions, result.bytes).c_str(), per_unit(result.branch_misses, result.records).c_str(),
+		per_unit(result.cache_misses, result.records).c_str(), !result.succeeded ? "失败" : result.output_valid ? "" : "输出不符");
+	std::cout << output_str << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	BenchmarkOptions options;
+
+	// 指定基线时数据集配置和重复次数默认取自基线，命令行参数可以覆盖，但数据集必须与基线一致。
+	BenchmarkReport baseline;
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		if (std::string(argv[i]) == "--baseline")
+		{
+			if (!LoadReport(argv[i + 1], baseline))
+			{
+				std::cout << "无法读取基线：" << argv[i + 1] << std::endl;
+				return 2;
+			}
+			options.dataset = baseline.dataset;
+			options.iterations = baseline.iterations;
+		}
+	}
+
+	if (!ParseOptions(argc, argv, options))
+	{
+		std::cout << "用法：file_helpers_benchmark [--rows N] [--columns N] [--precision N] [--delimiter D] [--crlf] "
+			"[--format xyz|delimited] [--iterations N] [--engine mmf|stream] [--dir PATH] [--keep] [--json PATH] [--baseline PATH] [--trace PATH]" << std::endl;
+		return 2;
+	}
+	if (!options.baseline_path.empty() && !SameDataset(options.dataset, baseline.dataset))
+	{
+		std::cout << "数据集配置与基线不一致，无法比较：" << options.baseline_path << std::endl;
+		return 2;
+	}
+
+	const std::filesystem::path directory = options.directory.empty()
+		? std::filesystem::temp_directory_path() / "FileHelpersCppBenchmark"
+		: std::filesystem::path(options.directory);
+	std::error_code directory_error;
+	std::filesystem::create_directories(directory, directory_error);
+
+	const Dataset dataset = GenerateDataset(options.dataset);
+	BenchmarkContext context{ (directory / "benchmark_input.xyz").string(), (directory / "benchmark_output.xyz").string(), dataset };
+	CreateFieldChanges(dataset, context);
+	if (!WriteDatasetFile(context.read_path, dataset))
+	{
+		std::cout << "无法写入数据集：" << context.read_path << std::endl;
+		return 1;
+	}
+
+	std::cout << StringFormat("数据集：%s   行数：%zu   大小：%.1fMB   重复次数：%d", context.read_path.c_str(), dataset.lines.size(),
+		static_cast<double>(dataset.text.size()) / (1024.0 * 1024.0), options.iterations) << std::endl;
+	std::cout << StringFormat("%-8s %-32s %10s %10s %14s %12s %12s %8s %12s %12s", "engine", "method", "ms", "MB/s", "records/s", "peakRSS(MB)", "allocations",
+		"instr/B", "brmiss/rec", "LLCmiss/rec") << std::endl;
+
+	const DelimitedFileMmfEngine mmf_engine(options.dataset.delimiter);
+	const DelimitedFileSteamEngine stream_engine(options.dataset.delimiter);
+	const std::pair<std::string, const FileEngineBase*> engines[] = { { "mmf", &mmf_engine }, { "stream", &stream_engine } };
+
+	BenchmarkReport report;
+	report.dataset = options.dataset;
+	report.iterations = options.iterations;
+	report.tolerances = options.baseline_path.empty() ? DefaultTolerances() : baseline.tolerances;
+
+	if (!options.trace_path.empty())
+	{
+		EngineTracer::Start();
+	}
+
+	bool all_succeeded = true;
+	for (const auto& engine : engines)
+	{
+		if (!options.engine.empty() && options.engine != engine.first)
+		{
+			continue;
+		}
+		for (const auto& benchmark_case : CreateBenchmarkCases())
+		{
+			if (!benchmark_case.only_engine.empty() && benchmark_case.only_engine != engine.first)
+			{
+				continue;
+			}
+			const BenchmarkResult result = RunBenchmarkCase(engine.first, *engine.second, benchmark_case, context, options.iterations);
+			all_succeeded = all_succeeded && result.succeeded;
+			PrintResult(result);
+			report.results.push_back(result);
+		}
+	}
+
+	if (!options.trace_path.empty())
+	{
+		EngineTracer::Stop();
+		if (!EngineTracer::WriteChromeTrace(options.trace_path, std::error_code()))
+		{
+			std::cout << "无法写入时间线：" << options.trace_path << std::endl;
+		}
+	}
+
+	if (!options.keep_files)
+	{
+		std::error_code remove_error;
+		std::filesystem::remove(context.read_path, remove_error);
+		std::filesystem::remove(context.write_path, remove_error);
+	}
+
+	if (!options.json_path.empty() && !WriteReport(options.json_path, report))
+	{
+		std::cout << "无法写入结果：" << options.json_path << std::endl;
+		return 1;
+	}
+	if (!all_succeeded)
+	{
+		return 1;
+	}
+	if (!options.baseline_path.empty())
+	{
+		const int regressions = CompareWithBaseline(baseline, report.results);
+		std::cout << StringFormat("与基线比较：%d项回归", regressions) << std::endl;
+		if (regressions > 0)
+		{
+			return 3;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,108 @@
+﻿#pragma once
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#elif defined(__linux__)
+#include <sys/resource.h>
+#endif
+
+/// <summary>
+/// 全局的内存分配计数。由AllocationCounter.cpp中替换的operator new累加。
+/// Windows上库以DLL形式链接，DLL内部的分配使用自己的运行库，不计入该计数；Linux上库源文件直接编入测试程序，所有分配都计入。
+/// </summary>
+struct AllocationCounter
+{
+	static std::atomic<long long> count;
+
+	static std::atomic<long long> bytes;
+};
+
+/// <summary>
+/// 表示一次测量开始时的内存快照。
+/// </summary>
+struct MemorySnapshot
+{
+	long long allocation_count = 0;
+
+	long long allocated_bytes = 0;
+};
+
+/// <summary>
+/// 获取当前的分配计数快照。
+/// </summary>
+inline MemorySnapshot TakeMemorySnapshot()
+{
+	MemorySnapshot snapshot;
+	snapshot.allocation_count = AllocationCounter::count.load(std::memory_order_relaxed);
+	snapshot.allocated_bytes = AllocationCounter::bytes.load(std::memory_order_relaxed);
+	return snapshot;
+}
+
+/// <summary>
+/// 重置进程的峰值常驻内存，使下一次读取只反映之后的峰值。
+/// Linux上通过/proc/self/clear_refs重置VmHWM；不支持重置时读取的是进程启动以来的峰值。
+/// </summary>
+/// <returns>是否成功重置。</returns>
+inline bool ResetPeakRss()
+{
+#if defined(__linux__)
+	FILE* file = std::fopen("/proc/self/clear_refs", "w");
+	if (file == nullptr)
+	{
+		return false;
+	}
+	const bool result = std::fputs("5", file) >= 0;
+	return std::fclose(file) == 0 && result;
+#else
+	return false;
+#endif
+}
+
+/// <summary>
+/// 获取进程的峰值常驻内存，单位为字节。获取失败时返回-1。
+/// </summary>
+inline long long PeakRssBytes()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+	{
+		return -1;
+	}
+	return static_cast<long long>(counters.PeakWorkingSetSize);
+#elif defined(__linux__)
+	FILE* file = std::fopen("/proc/self/status", "r");
+	if (file != nullptr)
+	{
+		char line[256];
+		long long peak_kb = -1;
+		while (std::fgets(line, sizeof(line), file) != nullptr)
+		{
+			if (std::strncmp(line, "VmHWM:", 6) == 0)
+			{
+				peak_kb = std::atoll(line + 6);
+				break;
+			}
+		}
+		std::fclose(file);
+		if (peak_kb >= 0)
+		{
+			return peak_kb * 1024;
+		}
+	}
+	rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+	{
+		return -1;
+	}
+	return static_cast<long long>(usage.ru_maxrss) * 1024;
+#else
+	return -1;
+#endif
+}
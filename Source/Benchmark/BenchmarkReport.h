@@ -0,0 +1,640 @@
+﻿#pragma once
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "DatasetGenerator.h"
+
+/// <summary>
+/// 表示一个方法的测量结果。
+/// </summary>
+struct BenchmarkResult
+{
+	std::string engine;
+
+	std::string method;
+
+	bool succeeded = true;
+
+	/// <summary>
+	/// 输出是否通过检查，例如读取的文本长度等于文件大小、读取的记录数等于行数。未通过时测量值没有意义，不参与回归比较。
+	/// </summary>
+	bool output_valid = true;
+
+	/// <summary>
+	/// 大于0时代替基线中的相对容差比较吞吐量指标。耗时只有微秒级的用例受计时噪声影响大，使用更宽的容差，仍能发现数量级的退化。
+	/// </summary>
+	double throughput_tolerance = 0;
+
+	double seconds = 0;
+
+	long long bytes = 0;
+
+	long long records = 0;
+
+	long long peak_rss_bytes = -1;
+
+	long long allocation_count = 0;
+
+	long long allocated_bytes = 0;
+
+	/// <summary>
+	/// 硬件计数器，不可用时为-1。只统计调用线程，不参与回归检查。
+	/// </summary>
+	long long instructions = -1;
+
+	long long cycles = -1;
+
+	long long branch_misses = -1;
+
+	long long cache_misses = -1;
+
+	double MegabytesPerSecond() const
+	{
+		return static_cast<double>(bytes) / (1024.0 * 1024.0) / (seconds > 0 ? seconds : 1e-9);
+	}
+
+	double RecordsPerSecond() const
+	{
+		return static_cast<double>(records) / (seconds > 0 ? seconds : 1e-9);
+	}
+};
+
+/// <summary>
+/// 表示一个指标允许的退化幅度。退化量超过max(relative * 基线值, absolute)时判定为回归。
+/// </summary>
+struct MetricTolerance
+{
+	double relative = 0;
+
+	double absolute = 0;
+};
+
+/// <summary>
+/// 表示回归检查比较的一个指标。
+/// </summary>
+struct RegressionMetric
+{
+	const char* name;
+
+	/// <summary>
+	/// 值越大越好（吞吐量），否则值越小越好（内存和分配）。
+	/// </summary>
+	bool higher_is_better;
+
+	double (*value)(const BenchmarkResult& result);
+
+	/// <summary>
+	/// 没有基线文件时使用的默认容差。
+	/// </summary>
+	MetricTolerance default_tolerance;
+};
+
+/// <summary>
+/// 获取回归检查比较的所有指标。吞吐量受机器负载影响，容差较宽；分配次数在同一平台上是确定的，容差较窄。
+/// </summary>
+inline const std::vector<RegressionMetric>& RegressionMetrics()
+{
+	static const std::vector<RegressionMetric> metrics = {
+		{ "mb_per_second", true, [](const BenchmarkResult& result) { return result.MegabytesPerSecond(); }, { 0.4, 0 } },
+		{ "records_per_second", true, [](const BenchmarkResult& result) { return result.RecordsPerSecond(); }, { 0.4, 0 } },
+		{ "peak_rss_bytes", false, [](const BenchmarkResult& result) { return static_cast<double>(result.peak_rss_bytes); }, { 0.25, 8.0 * 1024 * 1024 } },
+		{ "allocation_count", false, [](const BenchmarkResult& result) { return static_cast<double>(result.allocation_count); }, { 0.05, 16 } },
+		{ "allocated_bytes", false, [](const BenchmarkResult& result) { return static_cast<double>(result.allocated_bytes); }, { 0.1, 64.0 * 1024 } }
+	};
+	return metrics;
+}
+
+/// <summary>
+/// 表示一个JSON值，只支持报告文件用到的部分：\u转义只保留ASCII字符。
+/// </summary>
+struct JsonValue
+{
+	enum class Type
+	{
+		Null,
+		Boolean,
+		Number,
+		String,
+		Array,
+		Object
+	};
+
+	Type type = Type::Null;
+
+	bool boolean = false;
+
+	double number = 0;
+
+	std::string text;
+
+	std::vector<JsonValue> items;
+
+	std::vector<std::pair<std::string, JsonValue>> members;
+
+	/// <summary>
+	/// 查找对象的成员。
+	/// </summary>
+	/// <returns>成员的值，不存在时为nullptr。</returns>
+	const JsonValue* Find(const std::string& name) const
+	{
+		for (const auto& member : members)
+		{
+			if (member.first == name)
+			{
+				return &member.second;
+			}
+		}
+		return nullptr;
+	}
+
+	double NumberOr(const std::string& name, const double fallback) const
+	{
+		const JsonValue* value = Find(name);
+		return value && value->type == Type::Number ? value->number : fallback;
+	}
+
+	std::string TextOr(const std::string& name, const std::string& fallback) const
+	{
+		const JsonValue* value = Find(name);
+		return value && value->type == Type::String ? value->text : fallback;
+	}
+
+	bool BooleanOr(const std::string& name, const bool fallback) const
+	{
+		const JsonValue* value = Find(name);
+		return value && value->type == Type::Boolean ? value->boolean : fallback;
+	}
+};
+
+/// <summary>
+/// 递归下降的JSON解析器。
+/// </summary>
+class JsonParser
+{
+private:
+	const std::string& text;
+
+	size_t pos = 0;
+
+	void SkipSpace()
+	{
+		while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos])))
+		{
+			pos++;
+		}
+	}
+
+	bool Consume(const char c)
+	{
+		SkipSpace();
+		if (pos < text.size() && text[pos] == c)
+		{
+			pos++;
+			return true;
+		}
+		return false;
+	}
+
+	bool ParseString(std::string& out)
+	{
+		if (!Consume('"'))
+		{
+			return false;
+		}
+		out.clear();
+		while (pos < text.size())
+		{
+			const char c = text[pos++];
+			if (c == '"')
+			{
+				return true;
+			}
+			if (c != '\\')
+			{
+				out += c;
+				continue;
+			}
+			if (pos >= text.size())
+			{
+				return false;
+			}
+			const char escaped = text[pos++];
+			switch (escaped)
+			{
+			case 'n': out += '\n'; break;
+			case 'r': out += '\r'; break;
+			case 't': out += '\t'; break;
+			case 'b': out += '\b'; break;
+			case 'f': out += '\f'; break;
+			case 'u':
+			{
+				if (pos + 4 > text.size())
+				{
+					return false;
+				}
+				const long code = std::strtol(text.substr(pos, 4).c_str(), nullptr, 16);
+				out += code < 0x80 ? static_cast<char>(code) : '?';
+				pos += 4;
+				break;
+			}
+			default: out += escaped; break;
+			}
+		}
+		return false;
+	}
+
+	bool ParseValue(JsonValue& out)
+	{
+		SkipSpace();
+		if (pos >= text.size())
+		{
+			return false;
+		}
+
+		const char c = text[pos];
+		if (c == '{')
+		{
+			pos++;
+			out.type = JsonValue::Type::Object;
+			if (Consume('}'))
+			{
+				return true;
+			}
+			do
+			{
+				std::pair<std::string, JsonValue> member;
+				if (!ParseString(member.first) || !Consume(':') || !ParseValue(member.second))
+				{
+					return false;
+				}
+				out.members.push_back(std::move(member));
+			}
+			while (Consume(','));
+			return Consume('}');
+		}
+		if (c == '[')
+		{
+			pos++;
+			out.type = JsonValue::Type::Array;
+			if (Consume(']'))
+			{
+				return true;
+			}
+			do
+			{
+				JsonValue item;
+				if (!ParseValue(item))
+				{
+					return false;
+				}
+				out.items.push_back(std::move(item));
+			}
+			while (Consume(','));
+			return Consume(']');
+		}
+		if (c == '"')
+		{
+			out.type = JsonValue::Type::String;
+			return ParseString(out.text);
+		}
+		for (const char* literal : { "true", "false", "null" })
+		{
+			const std::string word = literal;
+			if (text.compare(pos, word.size(), word) == 0)
+			{
+				pos += word.size();
+				out.type = word == "null" ? JsonValue::Type::Null : JsonValue::Type::Boolean;
+				out.boolean = word == "true";
+				return true;
+			}
+		}
+
+		char* end = nullptr;
+		out.number = std::strtod(text.c_str() + pos, &end);
+		if (end == text.c_str() + pos)
+		{
+			return false;
+		}
+		out.type = JsonValue::Type::Number;
+		pos = static_cast<size_t>(end - text.c_str());
+		return true;
+	}
+
+public:
+	explicit JsonParser(const std::string& text)
+		: text(text)
+	{
+	}
+
+	/// <summary>
+	/// 解析整个文本。
+	/// </summary>
+	/// <param name="out">解析结果。</param>
+	/// <returns>文本是否为一个完整的JSON值。</returns>
+	bool Parse(JsonValue& out)
+	{
+		pos = 0;
+		if (!ParseValue(out))
+		{
+			return false;
+		}
+		SkipSpace();
+		return pos == text.size();
+	}
+};
+
+/// <summary>
+/// 将字符串转义为JSON字符串字面量。
+/// </summary>
+inline std::string JsonQuote(const std::string& value)
+{
+	std::string quoted = "\"";
+	for (const char c : value)
+	{
+		if (c == '"' || c == '\\')
+		{
+			quoted += '\\';
+			quoted += c;
+		}
+		else if (static_cast<unsigned char>(c) < 0x20)
+		{
+			char buffer[8];
+			std::snprintf(buffer, sizeof(buffer), "\\u%04x", static_cast<unsigned int>(static_cast<unsigned char>(c)));
+			quoted += buffer;
+		}
+		else
+		{
+			quoted += c;
+		}
+	}
+	return quoted + "\"";
+}
+
+/// <summary>
+/// 表示一份测试报告，同时也是回归检查的基线。
+/// </summary>
+struct BenchmarkReport
+{
+	DatasetOptions dataset;
+
+	int iterations = 3;
+
+	/// <summary>
+	/// 各指标的容差，按RegressionMetric::name索引。
+	/// </summary>
+	std::map<std::string, MetricTolerance> tolerances;
+
+	std::vector<BenchmarkResult> results;
+};
+
+/// <summary>
+/// 获取所有指标的默认容差。
+/// </summary>
+inline std::map<std::string, MetricTolerance> DefaultTolerances()
+{
+	std::map<std::string, MetricTolerance> tolerances;
+	for (const auto& metric : RegressionMetrics())
+	{
+		tolerances[metric.name] = metric.default_tolerance;
+	}
+	return tolerances;
+}
+
+/// <summary>
+/// 判断两份数据集配置是否生成相同的数据。
+/// </summary>
+inline bool SameDataset(const DatasetOptions& left, const DatasetOptions& right)
+{
+	return left.format == right.format && left.rows == right.rows && left.columns == right.columns && left.precision == right.precision
+		&& left.crlf == right.crlf && left.delimiter == right.delimiter && left.seed == right.seed;
+}
+
+/// <summary>
+/// 将报告格式化为JSON。指标值随结果一起写出，便于其他工具直接读取。
+/// </summary>
+inline std::string FormatReport(const BenchmarkReport& report)
+{
+	std::ostringstream json;
+	json.precision(12);
+	json << "{\n";
+	json << "\t\"version\": 1,\n";
+	json << "\t\"dataset\": {\n";
+	json << "\t\t\"format\": " << JsonQuote(report.dataset.format == DatasetFormat::Xyz ? "xyz" : "delimited") << ",\n";
+	json << "\t\t\"rows\": " << report.dataset.rows << ",\n";
+	json << "\t\t\"columns\": " << report.dataset.columns << ",\n";
+	json << "\t\t\"precision\": " << report.dataset.precision << ",\n";
+	json << "\t\t\"delimiter\": " << JsonQuote(report.dataset.delimiter) << ",\n";
+	json << "\t\t\"crlf\": " << (report.dataset.crlf ? "true" : "false") << ",\n";
+	json << "\t\t\"seed\": " << report.dataset.seed << "\n";
+	json << "\t},\n";
+	json << "\t\"iterations\": " << report.iterations << ",\n";
+
+	json << "\t\"tolerances\": {";
+	size_t index = 0;
+	for (const auto& tolerance : report.tolerances)
+	{
+		json << (index++ == 0 ? "\n" : ",\n");
+		json << "\t\t" << JsonQuote(tolerance.first) << ": { \"relative\": " << tolerance.second.relative << ", \"absolute\": " << tolerance.second.absolute << " }";
+	}
+	json << "\n\t},\n";
+
+	json << "\t\"results\": [";
+	index = 0;
+	for (const auto& result : report.results)
+	{
+		json << (index++ == 0 ? "\n" : ",\n");
+		json << "\t\t{ \"engine\": " << JsonQuote(result.engine) << ", \"method\": " << JsonQuote(result.method)
+			<< ", \"succeeded\": " << (result.succeeded ? "true" : "false") << ", \"output_valid\": " << (result.output_valid ? "true" : "false")
+			<< (result.throughput_tolerance > 0 ? ", \"throughput_tolerance\": " + std::to_string(result.throughput_tolerance) : std::string())
+			<< ", \"seconds\": " << result.seconds
+			<< ", \"bytes\": " << result.bytes << ", \"records\": " << result.records;
+		for (const auto& metric : RegressionMetrics())
+		{
+			json << ", " << JsonQuote(metric.name) << ": " << metric.value(result);
+		}
+		json << ", \"instructions\": " << result.instructions << ", \"cycles\": " << result.cycles
+			<< ", \"branch_misses\": " << result.branch_misses << ", \"cache_misses\": " << result.cache_misses;
+		json << " }";
+	}
+	json << "\n\t]\n";
+	json << "}\n";
+	return json.str();
+}
+
+/// <summary>
+/// 将报告写入文件。
+/// </summary>
+/// <returns>是否写入成功。</returns>
+inline bool WriteReport(const std::string& path, const BenchmarkReport& report)
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file << FormatReport(report);
+	return static_cast<bool>(file);
+}
+
+/// <summary>
+/// 读取报告文件，通常是检入的基线。缺少的容差使用默认值。
+/// </summary>
+/// <param name="path">文件路径。</param>
+/// <param name="out_report">读取的报告。</param>
+/// <returns>文件是否存在且格式有效。</returns>
+inline bool LoadReport(const std::string& path, BenchmarkReport& out_report)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		return false;
+	}
+	std::stringstream buffer;
+	buffer << file.rdbuf();
+	std::string text = buffer.str();
+	if (text.compare(0, 3, "\xef\xbb\xbf") == 0)
+	{
+		text.erase(0, 3);
+	}
+
+	JsonValue root;
+	if (!JsonParser(text).Parse(root) || root.type != JsonValue::Type::Object)
+	{
+		return false;
+	}
+
+	out_report = BenchmarkReport();
+	if (const JsonValue* dataset = root.Find("dataset"))
+	{
+		out_report.dataset.format = dataset->TextOr("format", "xyz") == "delimited" ? DatasetFormat::Delimited : DatasetFormat::Xyz;
+		out_report.dataset.rows = static_cast<size_t>(dataset->NumberOr("rows", static_cast<double>(out_report.dataset.rows)));
+		out_report.dataset.columns = static_cast<size_t>(dataset->NumberOr("columns", static_cast<double>(out_report.dataset.columns)));
+		out_report.dataset.precision = static_cast<int>(dataset->NumberOr("precision", out_report.dataset.precision));
+		out_report.dataset.delimiter = dataset->TextOr("delimiter", out_report.dataset.delimiter);
+		out_report.dataset.crlf = dataset->BooleanOr("crlf", out_report.dataset.crlf);
+		out_report.dataset.seed = static_cast<unsigned int>(dataset->NumberOr("seed", out_report.dataset.seed));
+	}
+	out_report.iterations = static_cast<int>(root.NumberOr("iterations", out_report.iterations));
+
+	out_report.tolerances = DefaultTolerances();
+	if (const JsonValue* tolerances = root.Find("tolerances"))
+	{
+		for (const auto& member : tolerances->members)
+		{
+			MetricTolerance& tolerance = out_report.tolerances[member.first];
+			tolerance.relative = member.second.NumberOr("relative", tolerance.relative);
+			tolerance.absolute = member.second.NumberOr("absolute", tolerance.absolute);
+		}
+	}
+
+	if (const JsonValue* results = root.Find("results"))
+	{
+		for (const auto& item : results->items)
+		{
+			BenchmarkResult result;
+			result.engine = item.TextOr("engine", "");
+			result.method = item.TextOr("method", "");
+			result.succeeded = item.BooleanOr("succeeded", true);
+			result.output_valid = item.BooleanOr("output_valid", true);
+			result.throughput_tolerance = item.NumberOr("throughput_tolerance", 0);
+			result.seconds = item.NumberOr("seconds", 0);
+			result.bytes = static_cast<long long>(item.NumberOr("bytes", 0));
+			result.records = static_cast<long long>(item.NumberOr("records", 0));
+			result.peak_rss_bytes = static_cast<long long>(item.NumberOr("peak_rss_bytes", -1));
+			result.allocation_count = static_cast<long long>(item.NumberOr("allocation_count", 0));
+			result.allocated_bytes = static_cast<long long>(item.NumberOr("allocated_bytes", 0));
+			result.instructions = static_cast<long long>(item.NumberOr("instructions", -1));
+			result.cycles = static_cast<long long>(item.NumberOr("cycles", -1));
+			result.branch_misses = static_cast<long long>(item.NumberOr("branch_misses", -1));
+			result.cache_misses = static_cast<long long>(item.NumberOr("cache_misses", -1));
+			out_report.results.push_back(std::move(result));
+		}
+	}
+	return true;
+}
+
+/// <summary>
+/// 将测量结果与基线逐方法、逐指标比较，输出每一项回归。基线中没有的方法只提示，不算回归；
+/// 没有运行的方法（例如用--engine只测试一种引擎）不比较。内存指标任一侧无法测量时跳过。
+/// 基线中输出未通过检查的方法只提示，不比较指标；本次输出未通过检查而基线通过时算一项回归。
+/// </summary>
+/// <param name="baseline">基线。</param>
+/// <param name="results">本次的测量结果。</param>
+/// <returns>回归的项数。</returns>
+inline int CompareWithBaseline(const BenchmarkReport& baseline, const std::vector<BenchmarkResult>& results)
+{
+	int regressions = 0;
+	for (const auto& result : results)
+	{
+		const BenchmarkResult* expected = nullptr;
+		for (const auto& candidate : baseline.results)
+		{
+			if (candidate.engine == result.engine && candidate.method == result.method)
+			{
+				expected = &candidate;
+				break;
+			}
+		}
+		if (!expected)
+		{
+			std::cout << "基线中没有：" << result.engine << " " << result.method << std::endl;
+			continue;
+		}
+		if (expected->succeeded && !result.succeeded)
+		{
+			std::cout << "回归：" << result.engine << " " << result.method << " 执行失败" << std::endl;
+			regressions++;
+			continue;
+		}
+		if (!result.output_valid)
+		{
+			if (expected->output_valid)
+			{
+				std::cout << "回归：" << result.engine << " " << result.method << " 输出不符" << std::endl;
+				regressions++;
+			}
+			else
+			{
+				std::cout << "跳过：" << result.engine << " " << result.method << " 输出不符，测量值无意义" << std::endl;
+			}
+			continue;
+		}
+		if (!expected->output_valid)
+		{
+			std::cout << "基线输出不符，未比较：" << result.engine << " " << result.method << std::endl;
+			continue;
+		}
+
+		for (const auto& metric : RegressionMetrics())
+		{
+			const double expected_value = metric.value(*expected);
+			const double actual_value = metric.value(result);
+			if (std::string(metric.name) == "peak_rss_bytes" && (expected->peak_rss_bytes < 0 || result.peak_rss_bytes < 0))
+			{
+				continue;
+			}
+
+			const auto found = baseline.tolerances.find(metric.name);
+			MetricTolerance tolerance = found != baseline.tolerances.end() ? found->second : metric.default_tolerance;
+			if (metric.higher_is_better && expected->throughput_tolerance > 0)
+			{
+				tolerance.relative = expected->throughput_tolerance;
+			}
+			const double allowed = std::max(tolerance.relative * expected_value, tolerance.absolute);
+			const double worsening = metric.higher_is_better ? expected_value - actual_value : actual_value - expected_value;
+			if (worsening > allowed)
+			{
+				char buffer[256];
+				std::snprintf(buffer, sizeof(buffer), "回归：%-8s %-32s %-20s 基线 %.6g  本次 %.6g  允许退化 %.6g",
+					result.engine.c_str(), result.method.c_str(), metric.name, expected_value, actual_value, allowed);
+				std::cout << buffer << std::endl;
+				regressions++;
+			}
+		}
+	}
+	return regressions;
+}
@@ -0,0 +1,153 @@
+﻿#pragma once
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// 表示合成数据集的格式。
+/// </summary>
+enum class DatasetFormat
+{
+	/// <summary>
+	/// 点云格式，每行为x y z坐标，列数固定为3。
+	/// </summary>
+	Xyz,
+
+	/// <summary>
+	/// 通用分隔格式，依次循环整数编号列、浮点列和文本列。
+	/// </summary>
+	Delimited
+};
+
+/// <summary>
+/// 表示合成数据集的配置。
+/// </summary>
+struct DatasetOptions
+{
+	DatasetFormat format = DatasetFormat::Xyz;
+
+	/// <summary>
+	/// 行数。
+	/// </summary>
+	size_t rows = 1000000;
+
+	/// <summary>
+	/// 列数。Xyz格式忽略该值。
+	/// </summary>
+	size_t columns = 3;
+
+	/// <summary>
+	/// 浮点列的小数位数。
+	/// </summary>
+	int precision = 6;
+
+	/// <summary>
+	/// 是否使用\r\n换行。
+	/// </summary>
+	bool crlf = false;
+
+	/// <summary>
+	/// 分隔符。
+	/// </summary>
+	std::string delimiter = " ";
+
+	/// <summary>
+	/// 随机数种子，相同配置生成的数据集逐字节一致。
+	/// </summary>
+	unsigned int seed = 20200601;
+};
+
+/// <summary>
+/// 表示生成的数据集，同时保存文件和内存中的各种表示形式，写入测试直接使用内存中的数据。
+/// </summary>
+struct Dataset
+{
+	std::string text;
+
+	std::vector<std::string> lines;
+
+	std::vector<std::vector<std::string>> string_records;
+
+	std::vector<std::vector<double>> double_records;
+};
+
+/// <summary>
+/// 生成一个字段的文本。
+/// </summary>
+inline std::string GenerateField(const DatasetOptions& options, const size_t row, const size_t column, std::mt19937_64& random)
+{
+	char buffer[64];
+	const size_t kind = options.format == DatasetFormat::Xyz ? 1 : column % 3;
+	if (kind == 0)
+	{
+		std::snprintf(buffer, sizeof(buffer), "%zu", row);
+	}
+	else if (kind == 1)
+	{
+		std::uniform_real_distribution<double> distribution(-100000.0, 100000.0);
+		std::snprintf(buffer, sizeof(buffer), "%.*f", options.precision, distribution(random));
+	}
+	else
+	{
+		std::snprintf(buffer, sizeof(buffer), "name%llu", static_cast<unsigned long long>(random() % 1000000));
+	}
+	return buffer;
+}
+
+/// <summary>
+/// 按配置生成数据集。
+/// </summary>
+/// <param name="options">数据集的配置。</param>
+/// <returns>生成的数据集。</returns>
+inline Dataset GenerateDataset(const DatasetOptions& options)
+{
+	Dataset dataset;
+	std::mt19937_64 random(options.seed);
+	const size_t columns = options.format == DatasetFormat::Xyz ? 3 : (options.columns > 0 ? options.columns : 1);
+	const char* line_ending = options.crlf ? "\r\n" : "\n";
+
+	dataset.lines.reserve(options.rows);
+	dataset.string_records.reserve(options.rows);
+	dataset.double_records.reserve(options.rows);
+	for (size_t row = 0; row < options.rows; row++)
+	{
+		std::string line;
+		std::vector<std::string> string_record;
+		std::vector<double> double_record;
+		string_record.reserve(columns);
+		double_record.reserve(columns);
+		for (size_t column = 0; column < columns; column++)
+		{
+			std::string field = GenerateField(options, row, column, random);
+			if (column > 0)
+			{
+				line += options.delimiter;
+			}
+			line += field;
+			double_record.push_back(atof(field.c_str()));
+			string_record.push_back(std::move(field));
+		}
+		dataset.text += line;
+		dataset.text += line_ending;
+		dataset.lines.push_back(std::move(line));
+		dataset.string_records.push_back(std::move(string_record));
+		dataset.double_records.push_back(std::move(double_record));
+	}
+	return dataset;
+}
+
+/// <summary>
+/// 将数据集的文本写入文件。
+/// </summary>
+/// <param name="path">文件路径。</param>
+/// <param name="dataset">数据集。</param>
+/// <returns>是否写入成功。</returns>
+inline bool WriteDatasetFile(const std::string& path, const Dataset& dataset)
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file.write(dataset.text.data(), static_cast<std::streamsize>(dataset.text.size()));
+	return static_cast<bool>(file);
+}
@@ -0,0 +1,55 @@
+﻿#include "pch.h"
+#include "BufferedFileWriter.h"
+
+using namespace file_helpers_cpp;
+
+/// <summary>
+/// 以覆盖模式创建文件并打开。如果目标文件已存在，则清空该文件。
+/// </summary>
+/// <param name="path">文件路径。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否成功打开文件。</returns>
+bool BufferedFileWriter::Create(const std::string& path, std::error_code& error)
+{
+	if (!file.Create(path, error))
+	{
+		return false;
+	}
+	buffer.resize(buffer_size);
+	buffered = 0;
+	offset = 0;
+	return true;
+}
+
+/// <summary>
+/// 将缓冲区中的数据写入文件。
+/// </summary>
+/// <param name="error">错误信息。</param>
+/// <returns>是否完成写入操作。</returns>
+bool BufferedFileWriter::Flush(std::error_code& error)
+{
+	if (buffered == 0)
+	{
+		return true;
+	}
+	if (!file.WriteAt(offset, buffer.data(), buffered, error))
+	{
+		return false;
+	}
+	offset += static_cast<long long>(buffered);
+	buffered = 0;
+	return true;
+}
+
+/// <summary>
+/// 写入剩余的数据并关闭文件。
+/// </summary>
+/// <param name="error">错误信息。</param>
+/// <returns>是否成功关闭。</returns>
+bool BufferedFileWriter::Close(std::error_code& error)
+{
+	const bool flushed = Flush(error);
+	file.Close();
+	std::vector<char>().swap(buffer);
+	return flushed;
+}
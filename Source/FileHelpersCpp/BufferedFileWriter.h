@@ -0,0 +1,135 @@
+﻿#pragma once
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+#include "NativeFile.h"
+
+namespace file_helpers_cpp
+{
+	/// <summary>
+	/// 带缓冲区的顺序写入器。数据先复制到缓冲区，缓冲区满时一次写入文件，适合逐行输出大量短记录。
+	/// </summary>
+	class BufferedFileWriter
+	{
+	private:
+		NativeFile file;
+
+		/// <summary>
+		/// 缓冲区大小。
+		/// </summary>
+		size_t buffer_size;
+
+		std::vector<char> buffer;
+
+		/// <summary>
+		/// 缓冲区中尚未写入文件的字节数。
+		/// </summary>
+		size_t buffered = 0;
+
+		/// <summary>
+		/// 已写入文件的字节数，即下一次写入的偏移量。
+		/// </summary>
+		long long offset = 0;
+
+	public:
+		/// <summary>
+		/// 默认的缓冲区大小。
+		/// </summary>
+		static constexpr size_t kDefaultBufferSize = 4 * 1024 * 1024;
+
+		/// <summary>
+		/// 创建写入器。同时打开多个文件时可使用较小的缓冲区。
+		/// </summary>
+		/// <param name="buffer_size">缓冲区大小。</param>
+		explicit BufferedFileWriter(const size_t buffer_size = kDefaultBufferSize)
+			: buffer_size(buffer_size)
+		{
+		}
+
+		BufferedFileWriter(const BufferedFileWriter&) = delete;
+
+		BufferedFileWriter& operator=(const BufferedFileWriter&) = delete;
+
+		/// <summary>
+		/// 以覆盖模式创建文件并打开。如果目标文件已存在，则清空该文件。
+		/// </summary>
+		/// <param name="path">文件路径。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否成功打开文件。</returns>
+		bool Create(const std::string& path, std::error_code& error);
+
+		/// <summary>
+		/// 写入数据。
+		/// </summary>
+		/// <param name="data">要写入的数据。</param>
+		/// <param name="size">要写入的字节数。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否完成写入操作。</returns>
+		bool Write(const char* data, const size_t size, std::error_code& error)
+		{
+			if (buffered + size > buffer.size())
+			{
+				if (!Flush(error))
+				{
+					return false;
+				}
+				// 大于缓冲区的数据直接写入文件。
+				if (size > buffer.size())
+				{
+					if (!file.WriteAt(offset, data, size, error))
+					{
+						return false;
+					}
+					offset += static_cast<long long>(size);
+					return true;
+				}
+			}
+			std::memcpy(buffer.data() + buffered, data, size);
+			buffered += size;
+			return true;
+		}
+
+		/// <summary>
+		/// 写入一行及其后的换行符。
+		/// </summary>
+		/// <param name="line">不含换行符的行。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否完成写入操作。</returns>
+		bool WriteLine(const std::string_view line, std::error_code& error)
+		{
+			if (buffered + line.size() + 1 <= buffer.size())
+			{
+				std::memcpy(buffer.data() + buffered, line.data(), line.size());
+				buffered += line.size();
+				buffer[buffered++] = '\n';
+				return true;
+			}
+			return Write(line.data(), line.size(), error) && Write("\n", 1, error);
+		}
+
+		/// <summary>
+		/// 将缓冲区中的数据写入文件。
+		/// </summary>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否完成写入操作。</returns>
+		bool Flush(std::error_code& error);
+
+		/// <summary>
+		/// 写入剩余的数据并关闭文件。
+		/// </summary>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否成功关闭。</returns>
+		bool Close(std::error_code& error);
+
+		/// <summary>
+		/// 获取已写入的总字节数，包括缓冲区中的数据。
+		/// </summary>
+		/// <returns>已写入的字节数。</returns>
+		long long BytesWritten() const
+		{
+			return offset + static_cast<long long>(buffered);
+		}
+	};
+}
@@ -0,0 +1,94 @@
+﻿#include "pch.h"
+#include <filesystem>
+#include "mio.hpp"
+#include "ColumnStatsScanner.h"
+#include "ThreadPool.h"
+#include "TraceRecorder.h"
+
+using namespace file_helpers_cpp;
+
+namespace
+{
+	/// <summary>
+	/// 每个统计任务处理的字节数。
+	/// </summary>
+	constexpr size_t kColumnStatsChunkSize = 8 * 1024 * 1024;
+}
+
+/// <summary>
+/// 将文件按字节划分为对齐到行首的块，在共享线程池中并行统计各块，最后按块顺序合并。不保存任何行。
+/// </summary>
+/// <param name="path">文件路径。</param>
+/// <param name="delimiter">分隔符。</param>
+/// <param name="thread_count">线程数。小于等于0表示使用线程池的默认并行度。</param>
+/// <param name="out_stats">各列的统计信息。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否完成统计。</returns>
+bool file_helpers_cpp::ParallelComputeColumnStats(const std::string& path, const std::string& delimiter, int thread_count, TableStats& out_stats, std::error_code& error)
+{
+	if (delimiter.empty())
+	{
+		error = std::make_error_code(std::errc::invalid_argument);
+		return false;
+	}
+	const std::shared_ptr<ThreadPool> pool = ThreadPool::Shared();
+	thread_count = pool->Parallelism(thread_count);
+
+	mio::mmap_source read_mmap = mio::make_mmap_source(path, error);
+	if (error)
+	{
+		// 空文件无法映射，统计结果为空。
+		std::error_code size_error;
+		if (std::filesystem::exists(path, size_error) && std::filesystem::file_size(path, size_error) == 0 && !size_error)
+		{
+			error.clear();
+			out_stats = TableStats();
+			return true;
+		}
+		return false;
+	}
+	const char* data = read_mmap.data();
+	const size_t size = read_mmap.size();
+
+	// 块边界对齐到行首。
+	const size_t chunk_count = std::max<size_t>(1, (size + kColumnStatsChunkSize - 1) / kColumnStatsChunkSize);
+	std::vector<size_t> chunk_begins(chunk_count + 1, size);
+	chunk_begins[0] = 0;
+	for (size_t i = 1; i < chunk_count; i++)
+	{
+		const size_t split = std::max(chunk_begins[i - 1], kColumnStatsChunkSize * i);
+		chunk_begins[i] = split == 0 || data[split - 1] == '\n' ? split : std::min(size, FindLineEnd(data, split, size) + 1);
+	}
+
+	std::vector<ColumnStatsAccumulator> accumulators(chunk_count, ColumnStatsAccumulator(delimiter));
+	std::vector<std::error_code> errors(chunk_count);
+	pool->ParallelFor(chunk_count, thread_count, [&](const size_t i)
+	{
+		TraceSpan span("scan", "ComputeColumnStats", "bytes", static_cast<long long>(chunk_begins[i + 1] - chunk_begins[i]));
+		try
+		{
+			accumulators[i].AddText(data, chunk_begins[i], chunk_begins[i + 1]);
+		}
+		catch (std::bad_alloc&)
+		{
+			errors[i] = std::make_error_code(std::errc::not_enough_memory);
+		}
+	});
+	read_mmap.unmap();
+
+	for (const auto& worker_error : errors)
+	{
+		if (worker_error)
+		{
+			error = worker_error;
+			return false;
+		}
+	}
+
+	for (size_t i = 1; i < chunk_count; i++)
+	{
+		accumulators[0].Merge(accumulators[i]);
+	}
+	out_stats = accumulators[0].Finish();
+	return true;
+}
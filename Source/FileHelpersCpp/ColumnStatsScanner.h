@@ -0,0 +1,275 @@
+﻿#pragma once
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+#include "FileEngineBase.h"
+#include "LineScanner.h"
+
+namespace file_helpers_cpp
+{
+	/// <summary>
+	/// 将字段解析为double。忽略首尾的空格和制表符，允许前导+号，其余规则与std::from_chars一致。
+	/// </summary>
+	/// <param name="field">字段。</param>
+	/// <param name="value">解析的数值。</param>
+	/// <returns>整个字段是否为有效数值。nan视为无效。</returns>
+	inline bool ParseNumericField(std::string_view field, double& value)
+	{
+		while (!field.empty() && (field.front() == ' ' || field.front() == '\t'))
+		{
+			field.remove_prefix(1);
+		}
+		while (!field.empty() && (field.back() == ' ' || field.back() == '\t'))
+		{
+			field.remove_suffix(1);
+		}
+		if (field.size() > 1 && field.front() == '+' && field[1] != '-')
+		{
+			field.remove_prefix(1);
+		}
+		if (field.empty())
+		{
+			return false;
+		}
+		const auto result = std::from_chars(field.data(), field.data() + field.size(), value);
+		return result.ec == std::errc() && result.ptr == field.data() + field.size() && !std::isnan(value);
+	}
+
+	/// <summary>
+	/// 对一组数值求最小值、最大值与和，结果合并到传入的值中。SSE2下每次处理两个数值。
+	/// </summary>
+	/// <param name="values">数值。</param>
+	/// <param name="count">数值个数。</param>
+	/// <param name="min">最小值。</param>
+	/// <param name="max">最大值。</param>
+	/// <param name="sum">和。</param>
+	inline void ReduceMinMaxSum(const double* values, const size_t count, double& min, double& max, double& sum)
+	{
+		size_t i = 0;
+#ifdef FILE_HELPERS_CPP_SSE2
+		__m128d min_lanes = _mm_set1_pd(min);
+		__m128d max_lanes = _mm_set1_pd(max);
+		__m128d sum_lanes = _mm_setzero_pd();
+		for (; i + 2 <= count; i += 2)
+		{
+			const __m128d lanes = _mm_loadu_pd(values + i);
+			min_lanes = _mm_min_pd(min_lanes, lanes);
+			max_lanes = _mm_max_pd(max_lanes, lanes);
+			sum_lanes = _mm_add_pd(sum_lanes, lanes);
+		}
+		double min_values[2];
+		double max_values[2];
+		double sum_values[2];
+		_mm_storeu_pd(min_values, min_lanes);
+		_mm_storeu_pd(max_values, max_lanes);
+		_mm_storeu_pd(sum_values, sum_lanes);
+		min = std::min(min_values[0], min_values[1]);
+		max = std::max(max_values[0], max_values[1]);
+		sum += sum_values[0] + sum_values[1];
+#endif
+		for (; i < count; i++)
+		{
+			min = std::min(min, values[i]);
+			max = std::max(max, values[i]);
+			sum += values[i];
+		}
+	}
+
+	/// <summary>
+	/// 按分隔符遍历一行中的非空字段，连续的分隔符视为一个，与Split(line, delimiter, true)的结果一致。
+	/// </summary>
+	/// <param name="line">不含换行符的行。</param>
+	/// <param name="delimiter">分隔符。</param>
+	/// <param name="visitor">对每个字段的处理，参数为字段索引和字段。</param>
+	/// <returns>非空字段数。</returns>
+	template <typename Visitor>
+	size_t ForEachField(const std::string_view line, const std::string_view delimiter, const Visitor& visitor)
+	{
+		size_t column = 0;
+		size_t pos = 0;
+		while (true)
+		{
+			size_t end = line.find(delimiter, pos);
+			if (end == std::string_view::npos)
+			{
+				end = line.size();
+			}
+			if (end > pos)
+			{
+				visitor(column++, line.substr(pos, end - pos));
+			}
+			if (end == line.size())
+			{
+				return column;
+			}
+			pos = end + delimiter.size();
+		}
+	}
+
+	/// <summary>
+	/// 逐行累计各列的统计信息，不保存任何行。解析出的数值先缓存在每列的小批次中，批次满时用SIMD归约。
+	/// </summary>
+	class ColumnStatsAccumulator
+	{
+	private:
+		/// <summary>
+		/// 每列缓存的数值个数。
+		/// </summary>
+		static constexpr size_t kBatchSize = 256;
+
+		struct Column
+		{
+			ColumnStats stats;
+
+			std::vector<double> pending;
+		};
+
+		std::string delimiter;
+
+		std::vector<Column> columns;
+
+		long long row_count = 0;
+
+		void FlushColumn(Column& column)
+		{
+			ReduceMinMaxSum(column.pending.data(), column.pending.size(), column.stats.min, column.stats.max, column.stats.sum);
+			column.stats.count += static_cast<long long>(column.pending.size());
+			column.pending.clear();
+		}
+
+	public:
+		explicit ColumnStatsAccumulator(const std::string& delimiter)
+			: delimiter(delimiter)
+		{
+		}
+
+		/// <summary>
+		/// 累计一行。忽略行尾的\r，空行不计入。
+		/// </summary>
+		/// <param name="line">不含换行符的行。</param>
+		void AddLine(std::string_view line)
+		{
+			if (!line.empty() && line.back() == '\r')
+			{
+				line.remove_suffix(1);
+			}
+			if (line.empty())
+			{
+				return;
+			}
+
+			row_count++;
+			ForEachField(line, delimiter, [this](const size_t column_index, const std::string_view field)
+			{
+				if (column_index >= columns.size())
+				{
+					columns.resize(column_index + 1);
+				}
+				Column& column = columns[column_index];
+				double value = 0;
+				if (!ParseNumericField(field, value))
+				{
+					column.stats.invalid_count++;
+					return;
+				}
+				if (column.pending.capacity() == 0)
+				{
+					column.pending.reserve(kBatchSize);
+				}
+				column.pending.push_back(value);
+				if (column.pending.size() == kBatchSize)
+				{
+					FlushColumn(column);
+				}
+			});
+		}
+
+		/// <summary>
+		/// 累计文本中[begin, end)范围内的所有行。
+		/// </summary>
+		/// <param name="data">文本数据。</param>
+		/// <param name="begin">起始位置，必须为行首。</param>
+		/// <param name="end">结束位置。</param>
+		void AddText(const char* data, size_t begin, const size_t end)
+		{
+			while (begin < end)
+			{
+				const size_t line_end = FindLineEnd(data, begin, end);
+				AddLine(std::string_view(data + begin, line_end - begin));
+				begin = line_end + 1;
+			}
+		}
+
+		/// <summary>
+		/// 合并另一个累计器的结果。
+		/// </summary>
+		/// <param name="other">另一个累计器。</param>
+		void Merge(ColumnStatsAccumulator& other)
+		{
+			row_count += other.row_count;
+			if (other.columns.size() > columns.size())
+			{
+				columns.resize(other.columns.size());
+			}
+			for (size_t i = 0; i < other.columns.size(); i++)
+			{
+				other.FlushColumn(other.columns[i]);
+				ColumnStats& stats = columns[i].stats;
+				const ColumnStats& other_stats = other.columns[i].stats;
+				stats.count += other_stats.count;
+				stats.invalid_count += other_stats.invalid_count;
+				stats.min = std::min(stats.min, other_stats.min);
+				stats.max = std::max(stats.max, other_stats.max);
+				stats.sum += other_stats.sum;
+			}
+		}
+
+		/// <summary>
+		/// 清空已累计的结果，保留列缓存的容量。
+		/// </summary>
+		void Reset()
+		{
+			for (auto& column : columns)
+			{
+				column.stats = ColumnStats();
+				column.pending.clear();
+			}
+			columns.clear();
+			row_count = 0;
+		}
+
+		/// <summary>
+		/// 归约剩余的缓存并输出统计信息。缺失字段数为行数减去有效和无效字段数。
+		/// </summary>
+		/// <returns>各列的统计信息。</returns>
+		TableStats Finish()
+		{
+			TableStats table;
+			table.row_count = row_count;
+			table.columns.reserve(columns.size());
+			for (auto& column : columns)
+			{
+				FlushColumn(column);
+				ColumnStats stats = column.stats;
+				stats.null_count = row_count - stats.count - stats.invalid_count;
+				table.columns.push_back(stats);
+			}
+			return table;
+		}
+	};
+
+	/// <summary>
+	/// 将文件按字节划分为对齐到行首的块，在共享线程池中并行统计各块，最后按块顺序合并。不保存任何行。
+	/// </summary>
+	/// <param name="path">文件路径。</param>
+	/// <param name="delimiter">分隔符。</param>
+	/// <param name="thread_count">线程数。小于等于0表示使用线程池的默认并行度。</param>
+	/// <param name="out_stats">各列的统计信息。</param>
+	/// <param name="error">错误信息。</param>
+	/// <returns>是否完成统计。</returns>
+	bool ParallelComputeColumnStats(const std::string& path, const std::string& delimiter, int thread_count, TableStats& out_stats, std::error_code& error);
+}
@@ -1,12 +1,126 @@
 #include "pch.h"
+#include <algorithm>
+#include <cstring>
 #include <map>
 #include <queue>
 #include "mio.hpp"
+#include "ColumnStatsScanner.h"
 #include "DelimitedFileMMFEngine.h"
+#include "ExternalSorter.h"
+#include "FieldPatcher.h"
+#include "HashAggregator.h"
+#include "HashJoiner.h"
+#include "LineDiffer.h"
+#include "LineScanner.h"
+#include "MappedFileAppender.h"
+#include "MmapFlusher.h"
+#include "MultiFileReader.h"
+#include "NativeFile.h"
+#include "RecordPipeline.h"
+#include "ParallelRecordWriter.h"
+#include "ProgressTracker.h"
+#include "RecordParser.h"
 #include "StringUtils.h"
+#include "TraceRecorder.h"
+#include "ZoneMap.h"
 
 using namespace file_helpers_cpp;
 
+namespace
+{
+	/// <summary>
+	/// ͨڴӳȡļем¼kStatsΪfalseʱʵİ汾κͳƴ롣
+	/// </summary>
+	/// <param name="path">ļ·</param>
+	/// <param name="delimiter">ָ</param>
+	/// <param name="out_records">ȡʱղͷڴ档</param>
+	/// <param name="error">Ϣ</param>
+	/// <param name="control">ȻصȡƺͳϢ</param>
+	/// <returns>Ƿɶȡȡʱfalse</returns>
+	template <bool kStats, typename T>
+	bool ReadRecordsByMmf(const std::string& path, const std::string& delimiter, std::vector<std::vector<T>>& out_records, std::error_code& error, const OperationControl& control)
+	{
+		StatsCollector<kStats> collector(control.stats);
+		mio::mmap_source read_mmap = mio::make_mmap_source(path, error);
+		if (error)
+		{
+			collector.Finish();
+			return false;
+		}
+
+		const char* data = read_mmap.data();
+		const size_t size = read_mmap.size();
+		ProgressTracker tracker(control, static_cast<long long>(size));
+		collector.Lap(EnginePhase::Map);
+
+		// ͳÿһȡơ
+		TraceSpan scan_span("scan", "DelimitedFileMmfEngine", "bytes", static_cast<long long>(size));
+		size_t line_count = 0;
+		for (size_t pos = 0; pos < size; pos += ProgressTracker::kCheckpointInterval)
+		{
+			if (tracker.IsCancelled())
+			{
+				collector.Finish();
+				error = std::make_error_code(std::errc::operation_canceled);
+				return false;
+			}
+			line_count += CountLineEnds(data, pos, std::min(pos + static_cast<size_t>(ProgressTracker::kCheckpointInterval), size));
+		}
+		collector.Lap(EnginePhase::Scan);
+		scan_span.End();
+
+		const size_t capacity = out_records.capacity();
+		out_records.reserve(out_records.size() + line_count);
+		collector.AddAllocations(out_records.capacity() != capacity ? 1 : 0);
+		collector.Lap(EnginePhase::Store);
+
+		std::string str_line;
+		long long record_count = 0;
+		TraceSpan parse_span("parse", "DelimitedFileMmfEngine", "bytes", static_cast<long long>(size));
+
+		for (size_t i = 0; i < size; i++)
+		{
+			const char c = data[i];
+			if (c == '\r')
+			{
+				continue;
+			}
+			if (c == '\n')
+			{
+				if (!tracker.Checkpoint(static_cast<long long>(i) + 1, record_count))
+				{
+					// ȡʱͷѶȡļ¼
+					std::vector<std::vector<T>>().swap(out_records);
+					collector.Finish();
+					error = std::make_error_code(std::errc::operation_canceled);
+					return false;
+				}
+
+				// ж
+				if (std::strlen(str_line.c_str()) == 0)
+				{
+					str_line.clear();
+					continue;
+				}
+
+				collector.Lap(EnginePhase::Scan);
+				ParseRecord(str_line, delimiter, out_records, collector);
+				record_count++;
+				str_line.clear();
+				continue;
+			}
+			str_line += c;
+		}
+
+		read_mmap.unmap();
+		collector.Lap(EnginePhase::Map);
+		tracker.Finish(static_cast<long long>(size), record_count);
+		collector.AddBytes(static_cast<long long>(size));
+		collector.Finish();
+		return true;
+	}
+}
+
 /// <summary>
 /// вι캯
 /// </summary>
@@ -25,42 +139,24 @@ DelimitedFileMmfEngine::DelimitedFileMmfEngine(const std::string& delimiter)
 /// <returns>Ƿɶȡ</returns>
 bool DelimitedFileMmfEngine::ReadFileAsStringVector(const std::string& path, std::vector<std::vector<std::string>>& out_string_vector, std::error_code error) const
 {
-	const int line_count = FileMmfEngineBase::CountLines(path, error);
-	out_string_vector.reserve(line_count);
-
-	mio::mmap_source read_mmap = mio::make_mmap_source(path, error);
-	if (error)
-	{
-		return false;
-	}
-
-	std::string str_line;
+	return ReadFileAsStringVector(path, out_string_vector, error, OperationControl());
+}
 
-	for (const auto& c : read_mmap)
+/// <summary>
+/// һıļļеıȡһַ͵ĶάȻرմļÿһݿ鱨һνȲȡƣָͳϢʱ¼׶εĺʱ
+/// </summary>
+/// <param name="path">ļ·</param>
+/// <param name="out_string_vector">ļеַ͵Ķάȡʱղͷڴ档</param>
+/// <param name="error">ϢȡʱΪoperation_canceled÷ݴȡʧܡ</param>
+/// <param name="control">ȻصȡƺͳϢ</param>
+/// <returns>Ƿɶȡȡʱfalse</returns>
+bool DelimitedFileMmfEngine::ReadFileAsStringVector(const std::string& path, std::vector<std::vector<std::string>>& out_string_vector, std::error_code& error, const OperationControl& control) const
+{
+	if (control.stats)
 	{
-		if (c == '\r')
-		{
-			continue;
-		}
-		if (c == '\n')
-		{
-			// ж
-			if (std::strlen(str_line.c_str()) == 0)
-			{
-				str_line.clear();
-				continue;
-			}
-
-			std::vector<std::string> str_fields = Split(str_line, this->delimiter, true);
-			out_string_vector.push_back(str_fields);
-			str_line.clear();
-			continue;
-		}
-		str_line += c;
+		return ReadRecordsByMmf<true>(path, this->delimiter, out_string_vector, error, control);
 	}
-
-	read_mmap.unmap();
-	return true;
+	return ReadRecordsByMmf<false>(path, this->delimiter, out_string_vector, error, control);
 }
 
 /// <summary>
@@ -72,42 +168,98 @@ bool DelimitedFileMmfEngine::ReadFileAsStringVector(const std::string& path, std
 /// <returns>Ƿɶȡ</returns>
 bool DelimitedFileMmfEngine::ReadFileAsDoubleVector(const std::string& path, std::vector<std::vector<double>>& out_double_vector, std::error_code error) const
 {
-	const int line_count = FileMmfEngineBase::CountLines(path, error);
-	out_double_vector.reserve(line_count);
+	return ReadFileAsDoubleVector(path, out_double_vector, error, OperationControl());
+}
 
-	mio::mmap_source read_mmap = mio::make_mmap_source(path, error);
-	if (error)
+/// <summary>
+/// һıļļеıȡһַ͵ĶάȻرմļÿһݿ鱨һνȲȡƣָͳϢʱ¼׶εĺʱ
+/// </summary>
+/// <param name="path">ļ·</param>
+/// <param name="out_double_vector">ļеdouble͵Ķάȡʱղͷڴ档</param>
+/// <param name="error">ϢȡʱΪoperation_canceled÷ݴȡʧܡ</param>
+/// <param name="control">ȻصȡƺͳϢ</param>
+/// <returns>Ƿɶȡȡʱfalse</returns>
+bool DelimitedFileMmfEngine::ReadFileAsDoubleVector(const std::string& path, std::vector<std::vector<double>>& out_double_vector, std::error_code& error, const OperationControl& control) const
+{
+	if (control.stats)
 	{
-		return false;
+		return ReadRecordsByMmf<true>(path, this->delimiter, out_double_vector, error, control);
 	}
+	return ReadRecordsByMmf<false>(path, this->delimiter, out_double_vector, error, control);
+}
 
-	std::string str_line;
-
-	for (const auto& c : read_mmap)
+/// <summary>
+/// ڹ̳߳вжȡıļÿļȡһַ͵Ķά󽻸ص;ļռõڴ治õޡ
+/// </summary>
+/// <param name="paths">ļ·б</param>
+/// <param name="callback">ÿļȡĴ</param>
+/// <param name="error">Ϣ</param>
+/// <param name="options">ȡá</param>
+/// <returns>ǷļѶȡصļȡʧܻصڻļδʱֹͣȡʱfalse</returns>
+bool DelimitedFileMmfEngine::ReadFilesAsStringVector(const std::vector<std::string>& paths, const StringFileCallback& callback, std::error_code error, const MultiFileReadOptions& options) const
+{
+	try
 	{
-		if (c == '\r')
-		{
-			continue;
-		}
-		if (c == '\n')
+		const MultiFileReader<std::string>::ReadFunction read = [this](const std::string& path, std::vector<std::vector<std::string>>& records)
 		{
-			// ж
-			if (std::strlen(str_line.c_str()) == 0)
-			{
-				str_line.clear();
-				continue;
-			}
+			return ReadFileAsStringVector(path, records, std::error_code());
+		};
+		MultiFileReader<std::string> reader(paths, read, options);
+		return reader.Run(callback, error);
+	}
+	catch (std::exception& ex)
+	{
+		auto msg = ex.what();
+		return false;
+	}
+}
 
-			std::vector<double> double_fields = SplitIntoDouble(str_line, this->delimiter, true);
-			out_double_vector.push_back(double_fields);
-			str_line.clear();
-			continue;
-		}
-		str_line += c;
+/// <summary>
+/// ڹ̳߳вжȡıļÿļȡһdouble͵Ķά󽻸ص;ļռõڴ治õޡ
+/// </summary>
+/// <param name="paths">ļ·б</param>
+/// <param name="callback">ÿļȡĴ</param>
+/// <param name="error">Ϣ</param>
+/// <param name="options">ȡá</param>
+/// <returns>ǷļѶȡصļȡʧܻصڻļδʱֹͣȡʱfalse</returns>
+bool DelimitedFileMmfEngine::ReadFilesAsDoubleVector(const std::vector<std::string>& paths, const DoubleFileCallback& callback, std::error_code error, const MultiFileReadOptions& options) const
+{
+	try
+	{
+		const MultiFileReader<double>::ReadFunction read = [this](const std::string& path, std::vector<std::vector<double>>& records)
+		{
+			return ReadFileAsDoubleVector(path, records, std::error_code());
+		};
+		MultiFileReader<double> reader(paths, read, options);
+		return reader.Run(callback, error);
 	}
+	catch (std::exception& ex)
+	{
+		auto msg = ex.what();
+		return false;
+	}
+}
 
-	read_mmap.unmap();
-	return true;
+/// <summary>
+/// 첽ȡַͼ¼ÿco_await Next()̳߳жȡһ¼ڴռļС޹ء
+/// </summary>
+/// <param name="path">ļ·</param>
+/// <param name="batch_size">ÿȡļ¼</param>
+/// <returns>¼</returns>
+RecordStream<std::string> DelimitedFileMmfEngine::ReadStringRecordsAsync(const std::string& path, const size_t batch_size) const
+{
+	return RecordStream<std::string>(path, delimiter, batch_size);
+}
+
+/// <summary>
+/// 첽ȡdoubleͼ¼ÿco_await Next()̳߳жȡһ¼ڴռļС޹ء
+/// </summary>
+/// <param name="path">ļ·</param>
+/// <param name="batch_size">ÿȡļ¼</param>
+/// <returns>¼</returns>
+RecordStream<double> DelimitedFileMmfEngine::ReadDoubleRecordsAsync(const std::string& path, const size_t batch_size) const
+{
+	return RecordStream<double>(path, delimiter, batch_size);
 }
 
 /// <summary>
@@ -153,11 +305,10 @@ bool DelimitedFileMmfEngine::WriteAllStringVector(const std::string& path, const
 			return false;
 		}
 
+		MmapFlusher flusher(rw_mmap, flush_policy);
 		int char_index = 0;
-		int line_index = 0;
 		for (const auto& line_vector : contents)
 		{
-			line_index++;
 			int field_index = 0;
 			for (const auto& field : line_vector)
 			{
@@ -181,17 +332,14 @@ bool DelimitedFileMmfEngine::WriteAllStringVector(const std::string& path, const
 			rw_mmap[char_index] = '\n';
 			char_index++;
 
-			// ע⣺ԣÿ80wͬһܺڴռѡ
-			if (line_index >= 800000)
-			{
-				rw_mmap.sync(error);
-				line_index = 0;
-			}
+			// ˢ²ˢдݡ
+			flusher.Advance(char_index);
 		}
 
-		rw_mmap.sync(error);
+		flusher.Finish(error);
 		rw_mmap.unmap();
-		return true;
+		// длرǰˢʧʱݿûд̡
+		return !error;
 	}
 	catch (std::exception& ex)
 	{
@@ -244,11 +392,10 @@ bool DelimitedFileMmfEngine::WriteAllDoubleVector(const std::string& path, const
 			return false;
 		}
 
+		MmapFlusher flusher(rw_mmap, flush_policy);
 		int char_index = 0;
-		int line_index = 0;
 		for (const auto& line_vector : contents)
 		{
-			line_index++;
 			int field_index = 0;
 			for (const auto& field : line_vector)
 			{
@@ -275,17 +422,14 @@ bool DelimitedFileMmfEngine::WriteAllDoubleVector(const std::string& path, const
 			rw_mmap[char_index] = '\n';
 			char_index++;
 
-			// ע⣺ԣÿ80wͬһܺڴռѡ
-			if (line_index >= 800000)
-			{
-				rw_mmap.sync(error);
-				line_index = 0;
-			}
+			// ˢ²ˢдݡ
+			flusher.Advance(char_index);
 		}
 
-		rw_mmap.sync(error);
+		flusher.Finish(error);
 		rw_mmap.unmap();
-		return true;
+		// длرǰˢʧʱݿûд̡
+		return !error;
 	}
 	catch (std::exception& ex)
 	{
@@ -295,7 +439,108 @@ bool DelimitedFileMmfEngine::WriteAllDoubleVector(const std::string& path, const
 }
 
 /// <summary>
-/// ָļ޸ֶָεֵȻرոļֵ;ֵһ£ڴӳļ쳣
+/// һļĩβ׷һַ͵ĶάļϣȻرոļļ򴴽ļ
+/// </summary>
+/// <param name="path">Ҫ׷ӵļ</param>
+/// <param name="contents">Ҫ׷ӵļеַ͵Ķά</param>
+/// <param name="error">Ϣ</param>
+/// <returns>Ƿ׷Ӳ</returns>
+bool DelimitedFileMmfEngine::AppendStringVector(const std::string& path, const std::vector<std::vector<std::string>>& contents, std::error_code error) const
+{
+	MappedFileAppender appender;
+	if (!appender.Open(path, error))
+	{
+		return false;
+	}
+
+	// ֿʽ׷ӵļĩβзڴӳ׷ӷһ(\r\n)
+	std::string buffer;
+	for (size_t begin = 0; begin < contents.size(); begin += kRecordFormatChunkRows)
+	{
+		const size_t end = std::min(begin + kRecordFormatChunkRows, contents.size());
+		FormatRecordRange(contents, begin, end, delimiter, "\r\n", buffer);
+		if (!appender.Append(buffer.data(), buffer.size(), error))
+		{
+			return false;
+		}
+	}
+	return appender.Close(error);
+}
+
+/// <summary>
+/// һļĩβ׷һdouble͵ĶάļϣȻرոļļ򴴽ļ
+/// </summary>
+/// <param name="path">Ҫ׷ӵļ</param>
+/// <param name="contents">Ҫ׷ӵļеdouble͵Ķά</param>
+/// <param name="error">Ϣ</param>
+/// <returns>Ƿ׷Ӳ</returns>
+bool DelimitedFileMmfEngine::AppendDoubleVector(const std::string& path, const std::vector<std::vector<double>>& contents, std::error_code error) const
+{
+	MappedFileAppender appender;
+	if (!appender.Open(path, error))
+	{
+		return false;
+	}
+
+	// ֿʽ׷ӵļĩβзWriteAllDoubleVectorһ(\r\n)
+	std::string buffer;
+	for (size_t begin = 0; begin < contents.size(); begin += kRecordFormatChunkRows)
+	{
+		const size_t end = std::min(begin + kRecordFormatChunkRows, contents.size());
+		FormatRecordRange(contents, begin, end, delimiter, "\r\n", buffer);
+		if (!appender.Append(buffer.data(), buffer.size(), error))
+		{
+			return false;
+		}
+	}
+	return appender.Close(error);
+}
+
+/// <summary>
+/// һļԶ̲߳иʽķʽдһַ͵ĶάļϣȻرոļ뵥߳дֽһ¡
+/// </summary>
+/// <param name="path">Ҫдļ</param>
+/// <param name="contents">Ҫдļַ͵Ķά</param>
+/// <param name="error">Ϣ</param>
+/// <param name="thread_count">иʽ߳Сڵ0ʾʹ̳߳صĬϲжȡ</param>
+/// <returns>Ƿд</returns>
+bool DelimitedFileMmfEngine::WriteAllStringVector(const std::string& path, const std::vector<std::vector<std::string>>& contents, std::error_code error, const int thread_count) const
+{
+	// з뵥߳д뱣һ(\n)
+	return ParallelWriteRecords(path, contents, delimiter, "\n", thread_count, error);
+}
+
+/// <summary>
+/// һļԶ̲߳иʽķʽдһdouble͵ĶάļϣȻرոļ뵥߳дֽһ¡
+/// </summary>
+/// <param name="path">Ҫдļ</param>
+/// <param name="contents">Ҫдļdouble͵Ķά</param>
+/// <param name="error">Ϣ</param>
+/// <param name="thread_count">иʽ߳Сڵ0ʾʹ̳߳صĬϲжȡ</param>
+/// <returns>Ƿд</returns>
+bool DelimitedFileMmfEngine::WriteAllDoubleVector(const std::string& path, const std::vector<std::vector<double>>& contents, std::error_code error, const int thread_count) const
+{
+	// з뵥߳д뱣һ(\r\n)
+	return ParallelWriteRecords(path, contents, delimiter, "\r\n", thread_count, error);
+}
+
+/// <summary>
+/// ˮ߷ʽȡһıļתдһļֿȡ̲߳תԭ˳дڴռļС޹ء
+/// </summary>
+/// <param name="read_path">Ҫȡļ</param>
+/// <param name="write_path">ҪдļҪȡļͬĿļѴڣ򸲸Ǹļ</param>
+/// <param name="transform">ÿм¼ת</param>
+/// <param name="error">Ϣ</param>
+/// <param name="thread_count">ת߳Сڵ0ʾʹ̳߳صĬϲжȡ</param>
+/// <returns>Ƿת</returns>
+bool DelimitedFileMmfEngine::TransformFile(const std::string& read_path, const std::string& write_path, const RecordTransform& transform, std::error_code error, const int thread_count) const
+{
+	RecordPipeline pipeline(delimiter, transform, thread_count);
+	return pipeline.Run(read_path, write_path, error);
+}
+
+/// <summary>
+/// ָļ޸ֶָεֵȻرոļֵ;ֵȿԲͬ
 /// </summary>
 /// <param name="path">Ҫ޸ĵļ</param>
 /// <param name="contents">Ҫ޸ļַ͵Ķάݶԡ<0ʼ<ֶ0ʼԷָָµֵֶ>></param>
@@ -305,103 +550,257 @@ bool DelimitedFileMmfEngine::BatchModifyFieldValues(const std::string& path, con
 {
 	try
 	{
-		mio::mmap_sink rw_mmap = mio::make_mmap_sink(path, error);
+		NativeFile file;
+		if (!file.Open(path, error))
+		{
+			return false;
+		}
+		const long long old_size = file.Size(error);
 		if (error)
 		{
 			return false;
 		}
+		if (old_size == 0)
+		{
+			return true;
+		}
 
-		// ȡַ
-		int char_index = 0;
-		// ȡ
-		int line_index = 0;
-		// ȡı
-		std::string str_line;
+		mio::mmap_sink rw_mmap;
+		rw_mmap.map(file.NativeHandle(), 0, static_cast<size_t>(old_size), error);
+		if (error)
+		{
+			return false;
+		}
 
-		// пʼַ
-		int new_line_char_index = 0;
+		// ȶλд޸ֶΣͳһļСֻһΡ
+		std::vector<LocatedFieldPatch> patches;
+		LocateFieldPatches(rw_mmap.data(), rw_mmap.size(), delimiter, contents, patches);
+		if (patches.empty())
+		{
+			return true;
+		}
+		if (!CommitFieldPatches(file, rw_mmap, old_size, patches, error))
+		{
+			return false;
+		}
+		// ޸ĳɹӳ䲻Ч
+		RemoveZoneMapSidecar(path);
+		return true;
+	}
+	catch (std::exception& ex)
+	{
+		auto msg = ex.what();
+		return false;
+	}
+}
 
-		// ʾһеĴ޸ֶε¼<ڼֶ,ֶοʼַ>
-		std::map<int, int> last_line_field_index_record;
+/// <summary>
+/// ָļ߳޸ֶָεֵȻرոļ
+/// </summary>
+/// <param name="path">Ҫ޸ĵļ</param>
+/// <param name="patches">ֶе޸ġ</param>
+/// <param name="error">Ϣ</param>
+/// <param name="thread_count">߳Сڵ0ʾʹ̳߳صĬϲжȡ</param>
+/// <returns>Ƿ޸Ĳ</returns>
+bool DelimitedFileMmfEngine::BatchModifyFieldValues(const std::string& path, const std::vector<FieldPatch>& patches, std::error_code error, const int thread_count) const
+{
+	try
+	{
+		return ParallelModifyFieldValues(path, delimiter, patches, thread_count, error);
+	}
+	catch (std::exception& ex)
+	{
+		auto msg = ex.what();
+		return false;
+	}
+}
 
-		for (const auto& c : rw_mmap)
-		{
-			if (contents.empty())
-			{
-				return true;
-			}
-			if (c == '\r')
-			{
-				char_index++;
-				continue;
-			}
-			if (c == '\n')
-			{
-				// ж
-				if (std::strlen(str_line.c_str()) == 0)
-				{
-					char_index++;
-					// һжȡϺۼƶַΪѾ +1
-					new_line_char_index = char_index;
-					continue;
-				}
+/// <summary>
+/// ɨһıļͳƸֵСֵֵƽֵȱʧЧֶԼκС
+/// </summary>
+/// <param name="path">ļ·</param>
+/// <param name="out_stats">еͳϢ</param>
+/// <param name="error">Ϣ</param>
+/// <param name="thread_count">߳Сڵ0ʾʹ̳߳صĬϲжȡ</param>
+/// <returns>Ƿͳơ</returns>
+bool DelimitedFileMmfEngine::ComputeColumnStats(const std::string& path, TableStats& out_stats, std::error_code error, const int thread_count) const
+{
+	try
+	{
+		return ParallelComputeColumnStats(path, delimiter, thread_count, out_stats, error);
+	}
+	catch (std::exception& ex)
+	{
+		auto msg = ex.what();
+		return false;
+	}
+}
 
-				// Ӵ޸вҪ޸ĵС
-				auto iter = contents.find(line_index);
-				// ҵ޸С
-				if (iter != contents.end())
-				{
-					std::vector<std::string> str_fields = Split(str_line, this->delimiter, true);
+/// <summary>
+/// Ϊһıļӳ·ļpath.zonemapļֻĩβ׷ʱ£ͷؽ
+/// </summary>
+/// <param name="path">ļ·</param>
+/// <param name="error">Ϣ</param>
+/// <param name="block_size">СλΪֽڡ0ʾ1MB</param>
+/// <param name="thread_count">߳Сڵ0ʾʹ̳߳صĬϲжȡ</param>
+/// <returns>Ƿɽ</returns>
+bool DelimitedFileMmfEngine::BuildZoneMap(const std::string& path, std::error_code error, const size_t block_size, const int thread_count) const
+{
+	try
+	{
+		return BuildZoneMapSidecar(path, delimiter, block_size == 0 ? 1024 * 1024 : block_size, thread_count, error);
+	}
+	catch (std::exception& ex)
+	{
+		auto msg = ex.what();
+		return false;
+	}
+}
 
-					int field_index = 0;
-					// Ҫ޸ĵдǰиֶεchar洢޸ʹá
-					for (const auto& field : str_fields)
-					{
-						if (last_line_field_index_record.empty())
-						{
-							last_line_field_index_record.insert(std::pair<int, int>(field_index, new_line_char_index));
-						}
-						else
-						{
-							// ӵڶֶοʼҪۼǰһֶεsizeͷָsize
-							const auto end_iter = last_line_field_index_record.rbegin();
-							const int last_field_index = end_iter->second;
-							const int last_field_size = static_cast<int>(str_fields[end_iter->first].size());
-							const int delimiter_size = static_cast<int>(delimiter.size());
-							const int field_start_index = last_field_index + last_field_size + delimiter_size;
-							last_line_field_index_record.insert(std::pair<int, int>(field_index, field_start_index));
-						}
-						field_index++;
-					}
+/// <summary>
+/// һıļзΧжȡһdouble͵ĶάȻرմļ
+/// </summary>
+/// <param name="path">ļ·</param>
+/// <param name="ranges">Χ</param>
+/// <param name="out_double_vector">С</param>
+/// <param name="error">Ϣ</param>
+/// <param name="thread_count">߳Сڵ0ʾʹ̳߳صĬϲжȡ</param>
+/// <returns>Ƿɶȡ</returns>
+bool DelimitedFileMmfEngine::ReadFilteredAsDoubleVector(const std::string& path, const std::vector<ColumnRange>& ranges, std::vector<std::vector<double>>& out_double_vector, std::error_code error, const int thread_count) const
+{
+	try
+	{
+		return ParallelReadFilteredRecords(path, delimiter, ranges, thread_count, out_double_vector, error);
+	}
+	catch (std::exception& ex)
+	{
+		auto msg = ex.what();
+		return false;
+	}
+}
 
-					// ݶӦֶεʼһַ޸ġ
-					std::map<int, std::string> modified_fields = iter->second;
-					for (const auto& modified_field : modified_fields)
-					{
-						int modify_index = last_line_field_index_record[modified_field.first];
-						for (const auto& cha : modified_field.second)
-						{
-							rw_mmap[modify_index] = cha;
-							modify_index++;
-						}
-					}
-				}
-				last_line_field_index_record.clear();
-				str_line.clear();
+/// <summary>
+/// һıļзΧжȡһַ͵ĶάȻرմļ
+/// </summary>
+/// <param name="path">ļ·</param>
+/// <param name="ranges">Χ</param>
+/// <param name="out_string_vector">С</param>
+/// <param name="error">Ϣ</param>
+/// <param name="thread_count">߳Сڵ0ʾʹ̳߳صĬϲжȡ</param>
+/// <returns>Ƿɶȡ</returns>
+bool DelimitedFileMmfEngine::ReadFilteredAsStringVector(const std::string& path, const std::vector<ColumnRange>& ranges, std::vector<std::vector<std::string>>& out_string_vector, std::error_code error, const int thread_count) const
+{
+	try
+	{
+		return ParallelReadFilteredRecords(path, delimiter, ranges, thread_count, out_string_vector, error);
+	}
+	catch (std::exception& ex)
+	{
+		auto msg = ex.what();
+		return false;
+	}
+}
 
-				char_index++;
-				line_index++;
-				// һжȡϺۼƶַΪѾ +1
-				new_line_char_index = char_index;
-				continue;
-			}
-			char_index++;
-			str_line += c;
-		}
+/// <summary>
+/// һıļзǿадһļ
+/// </summary>
+/// <param name="path">Ҫļ</param>
+/// <param name="out_path">ļҪļͬ</param>
+/// <param name="options">ѡ</param>
+/// <param name="error">Ϣ</param>
+/// <returns>Ƿ</returns>
+bool DelimitedFileMmfEngine::SortFile(const std::string& path, const std::string& out_path, const SortOptions& options, std::error_code error) const
+{
+	try
+	{
+		return SortFileByMmap(path, out_path, delimiter, options, error);
+	}
+	catch (std::exception& ex)
+	{
+		auto msg = ex.what();
+		return false;
+	}
+}
 
-		rw_mmap.sync(error);
-		rw_mmap.unmap();
-		return true;
+/// <summary>
+/// Ѱıļ鲢Ϊһļ
+/// </summary>
+/// <param name="paths">Ѱͬļͷļ</param>
+/// <param name="out_path">ļκļͬ</param>
+/// <param name="options">ѡ</param>
+/// <param name="error">Ϣ</param>
+/// <returns>Ƿɹ鲢</returns>
+bool DelimitedFileMmfEngine::MergeSortedFiles(const std::vector<std::string>& paths, const std::string& out_path, const SortOptions& options, std::error_code error) const
+{
+	try
+	{
+		return MergeSortedFilesByMmap(paths, out_path, delimiter, options, error);
+	}
+	catch (std::exception& ex)
+	{
+		auto msg = ex.what();
+		return false;
+	}
+}
+
+/// <summary>
+/// ɨһıļзͳƸָеĺֽͣ˳дļ
+/// </summary>
+/// <param name="path">ҪͳƵļ</param>
+/// <param name="out_path">ļҪͳƵļͬ</param>
+/// <param name="options">ѡ</param>
+/// <param name="error">Ϣ</param>
+/// <returns>ǷͳƲ</returns>
+bool DelimitedFileMmfEngine::GroupBy(const std::string& path, const std::string& out_path, const GroupByOptions& options, std::error_code error) const
+{
+	try
+	{
+		return ParallelGroupBy(path, out_path, delimiter, options, error);
+	}
+	catch (std::exception& ex)
+	{
+		auto msg = ex.what();
+		return false;
+	}
+}
+
+/// <summary>
+/// ıļÿƥһУļУļгֶΡ
+/// </summary>
+/// <param name="left_path">ļ</param>
+/// <param name="right_path">ļ</param>
+/// <param name="out_path">ļļͬ</param>
+/// <param name="options">ѡ</param>
+/// <param name="error">Ϣ</param>
+/// <returns>ǷӲ</returns>
+bool DelimitedFileMmfEngine::JoinFiles(const std::string& left_path, const std::string& right_path, const std::string& out_path, const JoinOptions& options, std::error_code error) const
+{
+	try
+	{
+		return ParallelHashJoin(left_path, right_path, out_path, delimiter, options, error);
+	}
+	catch (std::exception& ex)
+	{
+		auto msg = ex.what();
+		return false;
+	}
+}
+
+/// <summary>
+/// бȽıļдļԡ+ ͷɾԡ- ͷ޸ĵԡ< ͷľУԡ> ͷС
+/// </summary>
+/// <param name="old_path">ļ</param>
+/// <param name="new_path">ļ</param>
+/// <param name="out_path">ļļͬ</param>
+/// <param name="options">Ƚѡ</param>
+/// <param name="out_summary">ͳơ</param>
+/// <param name="error">Ϣ</param>
+/// <returns>ǷɱȽϲ</returns>
+bool DelimitedFileMmfEngine::DiffFiles(const std::string& old_path, const std::string& new_path, const std::string& out_path, const DiffOptions& options, DiffSummary& out_summary, std::error_code error) const
+{
+	try
+	{
+		return ParallelDiffFiles(old_path, new_path, out_path, delimiter, options, out_summary, error);
 	}
 	catch (std::exception& ex)
 	{
@@ -1,8 +1,200 @@
 #pragma once
+#include <functional>
+#include <string_view>
 #include "FileMMFEngineBase.h"
 
 namespace file_helpers_cpp
 {
+	/// <summary>
+	/// ʾʽתжһм¼תfieldsΪеֶͼָӳļݣֻڵڼЧ
+	/// תļ¼ıз׷ӵout_recordfalseʾСܱ߳ͬʱá
+	/// </summary>
+	using RecordTransform = std::function<bool(const std::vector<std::string_view>& fields, std::string& out_record)>;
+
+	/// <summary>
+	/// ʾȡļʱһļȡĴfile_indexΪļ·беrecordsΪȡļ¼ߣ
+	/// errorΪļĴϢȡʧʱrecordsΪաڵȡ߳εãfalseʾֹͣȡʣļ
+	/// </summary>
+	using StringFileCallback = std::function<bool(size_t file_index, std::vector<std::vector<std::string>>& records, const std::error_code& error)>;
+
+	/// <summary>
+	/// ʾȡļʱһļȡĴμStringFileCallback
+	/// </summary>
+	using DoubleFileCallback = std::function<bool(size_t file_index, std::vector<std::vector<double>>& records, const std::error_code& error)>;
+
+	/// <summary>
+	/// ʾȡļá
+	/// </summary>
+	struct MultiFileReadOptions
+	{
+		/// <summary>
+		/// ;ļڶȡѶȡδصռڴޣλΪֽڡ0ʾ1GB
+		/// ﵽʱͣȡļֱصѶȡļļʱȡ
+		/// </summary>
+		size_t memory_budget = 0;
+
+		/// <summary>
+		/// ͬʱȡļСڵ0ʾʹ̳߳صĬϲжȡ
+		/// </summary>
+		int thread_count = 0;
+
+		/// <summary>
+		/// Ƿ·б˳ûصΪfalseʱȡɵ˳ãļļĴ
+		/// </summary>
+		bool ordered = true;
+	};
+
+	/// <summary>
+	/// ʾһֶε޸ġ
+	/// </summary>
+	struct FieldPatch
+	{
+		/// <summary>
+		/// 0ʼв룩
+		/// </summary>
+		int line_index;
+
+		/// <summary>
+		/// ֶ0ʼԷָָ
+		/// </summary>
+		int field_index;
+
+		/// <summary>
+		/// µֵֶ
+		/// </summary>
+		std::string value;
+	};
+
+	/// <summary>
+	/// ʾһֵķΧ˶ڡ
+	/// </summary>
+	struct ColumnRange
+	{
+		/// <summary>
+		/// ֶ0ʼԷָָ
+		/// </summary>
+		int column_index;
+
+		/// <summary>
+		/// Сֵ
+		/// </summary>
+		double min;
+
+		/// <summary>
+		/// ֵ
+		/// </summary>
+		double max;
+	};
+
+	/// <summary>
+	/// ʾзܵѡ
+	/// </summary>
+	struct GroupByOptions
+	{
+		/// <summary>
+		/// еֶ0ʼԷָָķָΪһ
+		/// </summary>
+		int key_column = 0;
+
+		/// <summary>
+		/// Ҫ͵еֶֶȱʧ޷Ϊֵʱ0롣
+		/// </summary>
+		std::vector<int> value_columns;
+
+		/// <summary>
+		/// ϣڴԤ㣨ֽڣСڵ0ʾ256MBɸ߳ƽ̵֡߳ĹϣԤʱдʱļ鲢ܡ
+		/// </summary>
+		long long memory_budget = 0;
+
+		/// <summary>
+		/// ʱļڵĿ¼ΪʱʹļڵĿ¼
+		/// </summary>
+		std::string temp_directory;
+
+		/// <summary>
+		/// ߳Сڵ0ʾʹ̳߳صĬϲжȡ
+		/// </summary>
+		int thread_count = 0;
+	};
+
+	/// <summary>
+	/// ʾļѡ
+	/// </summary>
+	struct JoinOptions
+	{
+		/// <summary>
+		/// ļеֶ0ʼԷָָķָΪһ
+		/// </summary>
+		int left_key_column = 0;
+
+		/// <summary>
+		/// ļеֶ
+		/// </summary>
+		int right_key_column = 0;
+
+		/// <summary>
+		/// ǷûƥļУӣԭΪfalseʱΪӡ
+		/// </summary>
+		bool keep_unmatched_left = false;
+
+		/// <summary>
+		/// ڴԤ㣨ֽڣСڵ0ʾ256MBһļϣԤʱļĹϣֵдʱļӡ
+		/// </summary>
+		long long memory_budget = 0;
+
+		/// <summary>
+		/// ʱļڵĿ¼ΪʱʹļڵĿ¼
+		/// </summary>
+		std::string temp_directory;
+
+		/// <summary>
+		/// ߳Сڵ0ʾʹ̳߳صĬϲжȡ
+		/// </summary>
+		int thread_count = 0;
+	};
+
+	/// <summary>
+	/// ʾȽļѡ
+	/// </summary>
+	struct DiffOptions
+	{
+		/// <summary>
+		/// еֶ0ʼԷָָķָΪһС0ʾλö룺¾ļĵiǿ໥Ƚϡ
+		/// </summary>
+		int key_column = -1;
+
+		/// <summary>
+		/// ߳Сڵ0ʾʹ̳߳صĬϲжȡ
+		/// </summary>
+		int thread_count = 0;
+	};
+
+	/// <summary>
+	/// ʾȽļĽͳơ
+	/// </summary>
+	struct DiffSummary
+	{
+		/// <summary>
+		/// ֻļдڵ
+		/// </summary>
+		long long added = 0;
+
+		/// <summary>
+		/// ֻھļдڵ
+		/// </summary>
+		long long removed = 0;
+
+		/// <summary>
+		/// ݲͬ
+		/// </summary>
+		long long changed = 0;
+
+		/// <summary>
+		/// ͬ
+		/// </summary>
+		long long unchanged = 0;
+	};
+
 	/// <summary>
 	/// ڴӳļڶȡָıм¼档
 	/// </summary>
@@ -35,6 +227,16 @@ namespace file_helpers_cpp
 		/// <returns>Ƿɶȡ</returns>
 		bool ReadFileAsStringVector(const std::string& path, std::vector<std::vector<std::string>>& out_string_vector, std::error_code error) const override;
 
+		/// <summary>
+		/// һıļļеıȡһַ͵ĶάȻرմļÿһݿ鱨һνȲȡƣָͳϢʱ¼׶εĺʱ
+		/// </summary>
+		/// <param name="path">ļ·</param>
+		/// <param name="out_string_vector">ļеַ͵Ķάȡʱղͷڴ档</param>
+		/// <param name="error">ϢȡʱΪoperation_canceled÷ݴȡʧܡ</param>
+		/// <param name="control">ȻصȡƺͳϢ</param>
+		/// <returns>Ƿɶȡȡʱfalse</returns>
+		bool ReadFileAsStringVector(const std::string& path, std::vector<std::vector<std::string>>& out_string_vector, std::error_code& error, const OperationControl& control) const;
+
 		/// <summary>
 		/// һıļļеıȡһַ͵ĶάȻرմļ
 		/// </summary>
@@ -44,6 +246,52 @@ namespace file_helpers_cpp
 		/// <returns>Ƿɶȡ</returns>
 		bool ReadFileAsDoubleVector(const std::string& path, std::vector<std::vector<double>>& out_double_vector, std::error_code error) const override;
 
+		/// <summary>
+		/// һıļļеıȡһַ͵ĶάȻرմļÿһݿ鱨һνȲȡƣָͳϢʱ¼׶εĺʱ
+		/// </summary>
+		/// <param name="path">ļ·</param>
+		/// <param name="out_double_vector">ļеdouble͵Ķάȡʱղͷڴ档</param>
+		/// <param name="error">ϢȡʱΪoperation_canceled÷ݴȡʧܡ</param>
+		/// <param name="control">ȻصȡƺͳϢ</param>
+		/// <returns>Ƿɶȡȡʱfalse</returns>
+		bool ReadFileAsDoubleVector(const std::string& path, std::vector<std::vector<double>>& out_double_vector, std::error_code& error, const OperationControl& control) const;
+
+		/// <summary>
+		/// ڹ̳߳вжȡıļÿļȡһַ͵Ķά󽻸ص;ļռõڴ治õޡ
+		/// </summary>
+		/// <param name="paths">ļ·б</param>
+		/// <param name="callback">ÿļȡĴ</param>
+		/// <param name="error">Ϣ</param>
+		/// <param name="options">ȡá</param>
+		/// <returns>ǷļѶȡصļȡʧܻصڻļδʱֹͣȡʱfalse</returns>
+		bool ReadFilesAsStringVector(const std::vector<std::string>& paths, const StringFileCallback& callback, std::error_code error, const MultiFileReadOptions& options = MultiFileReadOptions()) const;
+
+		/// <summary>
+		/// ڹ̳߳вжȡıļÿļȡһdouble͵Ķά󽻸ص;ļռõڴ治õޡ
+		/// </summary>
+		/// <param name="paths">ļ·б</param>
+		/// <param name="callback">ÿļȡĴ</param>
+		/// <param name="error">Ϣ</param>
+		/// <param name="options">ȡá</param>
+		/// <returns>ǷļѶȡصļȡʧܻصڻļδʱֹͣȡʱfalse</returns>
+		bool ReadFilesAsDoubleVector(const std::vector<std::string>& paths, const DoubleFileCallback& callback, std::error_code error, const MultiFileReadOptions& options = MultiFileReadOptions()) const;
+
+		/// <summary>
+		/// 첽ȡַͼ¼ÿco_await Next()̳߳жȡһ¼ڴռļС޹ء
+		/// </summary>
+		/// <param name="path">ļ·</param>
+		/// <param name="batch_size">ÿȡļ¼</param>
+		/// <returns>¼</returns>
+		RecordStream<std::string> ReadStringRecordsAsync(const std::string& path, size_t batch_size = 4096) const;
+
+		/// <summary>
+		/// 첽ȡdoubleͼ¼ÿco_await Next()̳߳жȡһ¼ڴռļС޹ء
+		/// </summary>
+		/// <param name="path">ļ·</param>
+		/// <param name="batch_size">ÿȡļ¼</param>
+		/// <returns>¼</returns>
+		RecordStream<double> ReadDoubleRecordsAsync(const std::string& path, size_t batch_size = 4096) const;
+
 		/// <summary>
 		/// һļдһַ͵ĶάļϣȻرոļ
 		/// </summary>
@@ -63,12 +311,178 @@ namespace file_helpers_cpp
 		bool WriteAllDoubleVector(const std::string& path, const std::vector<std::vector<double>>& contents, std::error_code error) const override;
 
 		/// <summary>
-		/// ָļ޸ֶָεֵȻرոļֵ;ֵһ£ڴӳļ쳣
+		/// һļĩβ׷һַ͵ĶάļϣȻرոļļ򴴽ļ
+		/// </summary>
+		/// <param name="path">Ҫ׷ӵļ</param>
+		/// <param name="contents">Ҫ׷ӵļеַ͵Ķά</param>
+		/// <param name="error">Ϣ</param>
+		/// <returns>Ƿ׷Ӳ</returns>
+		bool AppendStringVector(const std::string& path, const std::vector<std::vector<std::string>>& contents, std::error_code error) const override;
+
+		/// <summary>
+		/// һļĩβ׷һdouble͵ĶάļϣȻرոļļ򴴽ļ
+		/// </summary>
+		/// <param name="path">Ҫ׷ӵļ</param>
+		/// <param name="contents">Ҫ׷ӵļеdouble͵Ķά</param>
+		/// <param name="error">Ϣ</param>
+		/// <returns>Ƿ׷Ӳ</returns>
+		bool AppendDoubleVector(const std::string& path, const std::vector<std::vector<double>>& contents, std::error_code error) const override;
+
+		/// <summary>
+		/// һļԶ̲߳иʽķʽдһַ͵ĶάļϣȻرոļ뵥߳дֽһ¡
+		/// </summary>
+		/// <param name="path">Ҫдļ</param>
+		/// <param name="contents">Ҫдļַ͵Ķά</param>
+		/// <param name="error">Ϣ</param>
+		/// <param name="thread_count">иʽ߳Сڵ0ʾʹ̳߳صĬϲжȡ</param>
+		/// <returns>Ƿд</returns>
+		bool WriteAllStringVector(const std::string& path, const std::vector<std::vector<std::string>>& contents, std::error_code error, int thread_count) const;
+
+		/// <summary>
+		/// һļԶ̲߳иʽķʽдһdouble͵ĶάļϣȻرոļ뵥߳дֽһ¡
+		/// </summary>
+		/// <param name="path">Ҫдļ</param>
+		/// <param name="contents">Ҫдļdouble͵Ķά</param>
+		/// <param name="error">Ϣ</param>
+		/// <param name="thread_count">иʽ߳Сڵ0ʾʹ̳߳صĬϲжȡ</param>
+		/// <returns>Ƿд</returns>
+		bool WriteAllDoubleVector(const std::string& path, const std::vector<std::vector<double>>& contents, std::error_code error, int thread_count) const;
+
+		/// <summary>
+		/// ˮ߷ʽȡһıļתдһļֿȡ̲߳תԭ˳дڴռļС޹ء
+		/// </summary>
+		/// <param name="read_path">Ҫȡļ</param>
+		/// <param name="write_path">ҪдļҪȡļͬĿļѴڣ򸲸Ǹļ</param>
+		/// <param name="transform">ÿм¼ת</param>
+		/// <param name="error">Ϣ</param>
+		/// <param name="thread_count">ת߳Сڵ0ʾʹ̳߳صĬϲжȡ</param>
+		/// <returns>Ƿת</returns>
+		bool TransformFile(const std::string& read_path, const std::string& write_path, const RecordTransform& transform, std::error_code error, int thread_count = 0) const;
+
+		/// <summary>
+		/// ָļ޸ֶָεֵȻرոļֵ;ֵȿԲͬļСֻһΣֻƶһȱ仯ֶֽ֮ڡ
 		/// </summary>
 		/// <param name="path">Ҫ޸ĵļ</param>
 		/// <param name="contents">Ҫ޸ļַ͵Ķάݶԡ<0ʼ<ֶ0ʼԷָָµֵֶ>></param>
 		/// <param name="error">Ϣ</param>
 		/// <returns>Ƿ޸Ĳ</returns>
 		bool BatchModifyFieldValues(const std::string& path, const std::map<int, std::map<int, std::string>>& contents, std::error_code error) const override;
+
+		/// <summary>
+		/// ָļ߳޸ֶָεֵȻرոļļ仮ָ̣߳Ȳ޸ɸֱ߳д빲ӳ
+		/// ȱ仯޸ͳһƶļֻͬһΡ
+		/// </summary>
+		/// <param name="path">Ҫ޸ĵļ</param>
+		/// <param name="patches">ֶе޸ģδʱfalse</param>
+		/// <param name="error">Ϣ</param>
+		/// <param name="thread_count">߳Сڵ0ʾʹ̳߳صĬϲжȡ</param>
+		/// <returns>Ƿ޸Ĳ</returns>
+		bool BatchModifyFieldValues(const std::string& path, const std::vector<FieldPatch>& patches, std::error_code error, int thread_count = 0) const;
+
+		/// <summary>
+		/// ɨһıļͳƸֵСֵֵƽֵȱʧЧֶԼκСļ̳߳вͳơ
+		/// </summary>
+		/// <param name="path">ļ·</param>
+		/// <param name="out_stats">еͳϢ</param>
+		/// <param name="error">Ϣ</param>
+		/// <param name="thread_count">߳Сڵ0ʾʹ̳߳صĬϲжȡ</param>
+		/// <returns>Ƿͳơ</returns>
+		bool ComputeColumnStats(const std::string& path, TableStats& out_stats, std::error_code error, int thread_count = 0) const;
+
+		/// <summary>
+		/// Ϊһıļӳ·ļpath.zonemap¼ÿֽڷΧ͸ֵСֵֵ
+		/// ļֻĩβ׷ʱһĿ鿪ʼ£ݱдʱͷؽ
+		/// </summary>
+		/// <param name="path">ļ·</param>
+		/// <param name="error">Ϣ</param>
+		/// <param name="block_size">СλΪֽڡ0ʾ1MBʱԭС</param>
+		/// <param name="thread_count">߳Сڵ0ʾʹ̳߳صĬϲжȡ</param>
+		/// <returns>Ƿɽ</returns>
+		bool BuildZoneMap(const std::string& path, std::error_code error, size_t block_size = 0, int thread_count = 0) const;
+
+		/// <summary>
+		/// һıļзΧжȡһdouble͵ĶάȻرմļ
+		/// ЧӳʱƥĿ飬ļ
+		/// </summary>
+		/// <param name="path">ļ·</param>
+		/// <param name="ranges">Χֶȱʧ޷Ϊֵв</param>
+		/// <param name="out_double_vector">Уļ˳С</param>
+		/// <param name="error">Ϣ</param>
+		/// <param name="thread_count">߳Сڵ0ʾʹ̳߳صĬϲжȡ</param>
+		/// <returns>Ƿɶȡ</returns>
+		bool ReadFilteredAsDoubleVector(const std::string& path, const std::vector<ColumnRange>& ranges, std::vector<std::vector<double>>& out_double_vector, std::error_code error, int thread_count = 0) const;
+
+		/// <summary>
+		/// һıļзΧжȡһַ͵ĶάȻرմļ
+		/// ЧӳʱƥĿ飬ļ
+		/// </summary>
+		/// <param name="path">ļ·</param>
+		/// <param name="ranges">Χֶȱʧ޷Ϊֵв</param>
+		/// <param name="out_string_vector">Уļ˳С</param>
+		/// <param name="error">Ϣ</param>
+		/// <param name="thread_count">߳Сڵ0ʾʹ̳߳صĬϲжȡ</param>
+		/// <returns>Ƿɶȡ</returns>
+		bool ReadFilteredAsStringVector(const std::string& path, const std::vector<ColumnRange>& ranges, std::vector<std::vector<std::string>>& out_string_vector, std::error_code error, int thread_count = 0) const;
+
+		/// <summary>
+		/// һıļзǿадһļļڴԤֶΣÿ̳߳вֵû򣩣
+		/// һʱдʱļð鲢ȶģֱӴӳȡ
+		/// </summary>
+		/// <param name="path">Ҫļ</param>
+		/// <param name="out_path">ļҪļͬ</param>
+		/// <param name="options">ѡ</param>
+		/// <param name="error">Ϣ</param>
+		/// <returns>Ƿ</returns>
+		bool SortFile(const std::string& path, const std::string& out_path, const SortOptions& options, std::error_code error) const;
+
+		/// <summary>
+		/// Ѱıļ鲢Ϊһļļͨڴӳ䴰˳ȡڴռֻļйأ
+		/// ʱļбе˳Сδʱ˳δ塣
+		/// </summary>
+		/// <param name="paths">Ѱͬļͷļ</param>
+		/// <param name="out_path">ļκļͬ</param>
+		/// <param name="options">ѡʹеļСȽϷʽڴԤ㡣</param>
+		/// <param name="error">Ϣ</param>
+		/// <returns>Ƿɹ鲢</returns>
+		bool MergeSortedFiles(const std::vector<std::string>& paths, const std::string& out_path, const SortOptions& options, std::error_code error) const;
+
+		/// <summary>
+		/// ɨһıļзͳƸָеĺֽͣ˳дļÿΪеĺ͡Էָӡ
+		/// ߳ʹöĿѰַϣֱӳеֽڣΪÿзڴ棻ϣڴԤʱдʱļ鲢ܡ
+		/// ȱټев롣
+		/// </summary>
+		/// <param name="path">ҪͳƵļ</param>
+		/// <param name="out_path">ļҪͳƵļͬ</param>
+		/// <param name="options">ѡ</param>
+		/// <param name="error">Ϣ</param>
+		/// <returns>ǷͳƲ</returns>
+		bool GroupBy(const std::string& path, const std::string& out_path, const GroupByOptions& options, std::error_code error) const;
+
+		/// <summary>
+		/// ıļÿƥһУļУļгֶΣԷָӡ
+		/// ýСļʱļļнյĹϣӳеУٲɨһļֱдӽ
+		/// ʱ˳ɨļ˳һ£ͬһеĶƥ䰴ļ˳ʱ
+		/// </summary>
+		/// <param name="left_path">ļ</param>
+		/// <param name="right_path">ļ</param>
+		/// <param name="out_path">ļļͬ</param>
+		/// <param name="options">ѡ</param>
+		/// <param name="error">Ϣ</param>
+		/// <returns>ǷӲ</returns>
+		bool JoinFiles(const std::string& left_path, const std::string& right_path, const std::string& out_path, const JoinOptions& options, std::error_code error) const;
+
+		/// <summary>
+		/// бȽıļдļԡ+ ͷɾԡ- ͷ޸ĵԡ< ͷľУԡ> ͷС
+		/// λöʱк˳жʱͬа˳ԣȰļ˳޸ĵУٰļ˳ɾС
+		/// ļͨڴӳ̳߳взֿ鴦ȡΪַ
+		/// </summary>
+		/// <param name="old_path">ļ</param>
+		/// <param name="new_path">ļ</param>
+		/// <param name="out_path">ļļͬ</param>
+		/// <param name="options">Ƚѡ</param>
+		/// <param name="out_summary">ͳơ</param>
+		/// <param name="error">Ϣ</param>
+		/// <returns>ǷɱȽϲ</returns>
+		bool DiffFiles(const std::string& old_path, const std::string& new_path, const std::string& out_path, const DiffOptions& options, DiffSummary& out_summary, std::error_code error) const;
 	};
 }
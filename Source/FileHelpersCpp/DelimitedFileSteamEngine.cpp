@@ -1,10 +1,91 @@
 #include "pch.h"
+#include <cstring>
+#include <filesystem>
 #include <fstream>
+#include "ColumnStatsScanner.h"
 #include "DelimitedFileSteamEngine.h"
+#include "ExternalSorter.h"
+#include "ProgressTracker.h"
+#include "RecordParser.h"
 #include "StringUtils.h"
+#include "TraceRecorder.h"
 
 using namespace file_helpers_cpp;
 
+namespace
+{
+	/// <summary>
+	/// ͨļжȡļем¼kStatsΪfalseʱʵİ汾κͳƴ롣
+	/// </summary>
+	/// <param name="path">ļ·</param>
+	/// <param name="delimiter">ָ</param>
+	/// <param name="out_records">ȡʱղͷڴ档</param>
+	/// <param name="error">Ϣ</param>
+	/// <param name="control">ȻصȡƺͳϢ</param>
+	/// <returns>Ƿɶȡȡʱfalse</returns>
+	template <bool kStats, typename T>
+	bool ReadRecordsByStream(const std::string& path, const std::string& delimiter, std::vector<std::vector<T>>& out_records, std::error_code& error, const OperationControl& control)
+	{
+		StatsCollector<kStats> collector(control.stats);
+		std::ifstream infile;
+		infile.open(path, std::ios::in);
+		if (!infile.is_open())
+		{
+			collector.Finish();
+			error = std::make_error_code(std::errc::bad_file_descriptor);
+			return false;
+		}
+
+		std::error_code size_error;
+		const auto file_size = std::filesystem::file_size(path, size_error);
+		ProgressTracker tracker(control, size_error ? -1 : static_cast<long long>(file_size));
+		collector.Lap(EnginePhase::Map);
+		// ڴӳһ£ʼǰȡʱȡСһݿļҲȡ
+		if (tracker.IsCancelled())
+		{
+			collector.Finish();
+			error = std::make_error_code(std::errc::operation_canceled);
+			return false;
+		}
+
+		std::string str_line;
+		long long bytes_processed = 0;
+		long long record_count = 0;
+		TraceSpan parse_span("parse", "DelimitedFileSteamEngine", "bytes", size_error ? -1 : static_cast<long long>(file_size));
+		while (std::getline(infile, str_line))
+		{
+			bytes_processed += static_cast<long long>(str_line.size()) + 1;
+			if (!tracker.Checkpoint(bytes_processed, record_count))
+			{
+				// ȡʱͷѶȡļ¼
+				std::vector<std::vector<T>>().swap(out_records);
+				collector.Finish();
+				error = std::make_error_code(std::errc::operation_canceled);
+				return false;
+			}
+
+			// ж
+			if (std::strlen(str_line.c_str()) == 0)
+			{
+				str_line.clear();
+				continue;
+			}
+
+			collector.Lap(EnginePhase::Scan);
+			ParseRecord(str_line, delimiter, out_records, collector);
+			record_count++;
+			str_line.clear();
+		}
+
+		infile.close();
+		collector.Lap(EnginePhase::Map);
+		tracker.Finish(bytes_processed, record_count);
+		collector.AddBytes(bytes_processed);
+		collector.Finish();
+		return true;
+	}
+}
+
 /// <summary>
 /// вι캯
 /// </summary>
@@ -23,32 +104,24 @@ DelimitedFileSteamEngine::DelimitedFileSteamEngine(const std::string& delimiter)
 /// <returns>Ƿɶȡ</returns>
 bool DelimitedFileSteamEngine::ReadFileAsStringVector(const std::string& path, std::vector<std::vector<std::string>>& out_string_vector, std::error_code error) const
 {
-	//const int line_count = FileSteamEngineBase::CountLines(path, error);
-	//out_string_vector.reserve(line_count);
+	return ReadFileAsStringVector(path, out_string_vector, error, OperationControl());
+}
 
-	std::ifstream infile;
-	infile.open(path, std::ios::in);
-	if (!infile.is_open())
+/// <summary>
+/// һıļļеıȡһַ͵ĶάȻرմļÿһݿ鱨һνȲȡƣָͳϢʱ¼׶εĺʱ
+/// </summary>
+/// <param name="path">ļ·</param>
+/// <param name="out_string_vector">ļеַ͵Ķάȡʱղͷڴ档</param>
+/// <param name="error">ϢȡʱΪoperation_canceled÷ݴȡʧܡ</param>
+/// <param name="control">ȻصȡƺͳϢ</param>
+/// <returns>Ƿɶȡȡʱfalse</returns>
+bool DelimitedFileSteamEngine::ReadFileAsStringVector(const std::string& path, std::vector<std::vector<std::string>>& out_string_vector, std::error_code& error, const OperationControl& control) const
+{
+	if (control.stats)
 	{
-		error = std::make_error_code(std::errc::bad_file_descriptor);
-		return false;
+		return ReadRecordsByStream<true>(path, this->delimiter, out_string_vector, error, control);
 	}
-	std::string str_line;
-	while (std::getline(infile, str_line))
-	{
-		// ж
-		if (std::strlen(str_line.c_str()) == 0)
-		{
-			str_line.clear();
-			continue;
-		}
-
-		std::vector<std::string> str_fields = Split(str_line, this->delimiter, true);
-		out_string_vector.push_back(str_fields);
-		str_line.clear();
-	}
-
-	return true;
+	return ReadRecordsByStream<false>(path, this->delimiter, out_string_vector, error, control);
 }
 
 /// <summary>
@@ -60,32 +133,24 @@ bool DelimitedFileSteamEngine::ReadFileAsStringVector(const std::string& path, s
 /// <returns>Ƿɶȡ</returns>
 bool DelimitedFileSteamEngine::ReadFileAsDoubleVector(const std::string& path, std::vector<std::vector<double>>& out_double_vector, std::error_code error) const
 {
-	//const int line_count = FileSteamEngineBase::CountLines(path, error);
-	//out_double_vector.reserve(line_count);
+	return ReadFileAsDoubleVector(path, out_double_vector, error, OperationControl());
+}
 
-	std::ifstream infile;
-	infile.open(path, std::ios::in);
-	if (!infile.is_open())
-	{
-		error = std::make_error_code(std::errc::bad_file_descriptor);
-		return false;
-	}
-	std::string str_line;
-	while (std::getline(infile, str_line))
+/// <summary>
+/// һıļļеıȡһַ͵ĶάȻرմļÿһݿ鱨һνȲȡƣָͳϢʱ¼׶εĺʱ
+/// </summary>
+/// <param name="path">ļ·</param>
+/// <param name="out_double_vector">ļеdouble͵Ķάȡʱղͷڴ档</param>
+/// <param name="error">ϢȡʱΪoperation_canceled÷ݴȡʧܡ</param>
+/// <param name="control">ȻصȡƺͳϢ</param>
+/// <returns>Ƿɶȡȡʱfalse</returns>
+bool DelimitedFileSteamEngine::ReadFileAsDoubleVector(const std::string& path, std::vector<std::vector<double>>& out_double_vector, std::error_code& error, const OperationControl& control) const
+{
+	if (control.stats)
 	{
-		// ж
-		if (std::strlen(str_line.c_str()) == 0)
-		{
-			str_line.clear();
-			continue;
-		}
-
-		std::vector<double> double_fields = SplitIntoDouble(str_line, this->delimiter, true);
-		out_double_vector.push_back(double_fields);
-		str_line.clear();
+		return ReadRecordsByStream<true>(path, this->delimiter, out_double_vector, error, control);
 	}
-
-	return true;
+	return ReadRecordsByStream<false>(path, this->delimiter, out_double_vector, error, control);
 }
 
 /// <summary>
@@ -114,6 +179,12 @@ bool DelimitedFileSteamEngine::WriteAllStringVector(const std::string& path, con
 		outfile << "\n";
 	}
 	outfile.close();
+	if (outfile.fail())
+	{
+		// 򿪻дʧʱʧ״̬
+		error = std::make_error_code(std::errc::io_error);
+		return false;
+	}
 	return true;
 }
 
@@ -143,5 +214,155 @@ bool DelimitedFileSteamEngine::WriteAllDoubleVector(const std::string& path, con
 		outfile << "\n";
 	}
 	outfile.close();
+	if (outfile.fail())
+	{
+		// 򿪻дʧʱʧ״̬
+		error = std::make_error_code(std::errc::io_error);
+		return false;
+	}
+	return true;
+}
+
+/// <summary>
+/// һļĩβ׷һַ͵ĶάļϣȻرոļļ򴴽ļ
+/// </summary>
+/// <param name="path">Ҫ׷ӵļ</param>
+/// <param name="contents">Ҫ׷ӵļеַ͵Ķά</param>
+/// <param name="error">Ϣ</param>
+/// <returns>Ƿ׷Ӳ</returns>
+bool DelimitedFileSteamEngine::AppendStringVector(const std::string& path, const std::vector<std::vector<std::string>>& contents, std::error_code error) const
+{
+	// ׷ģʽ򿪣ʹýϴĻдϵͳô
+	std::vector<char> stream_buffer(kAppendStreamBufferSize);
+	std::ofstream outfile;
+	outfile.rdbuf()->pubsetbuf(stream_buffer.data(), stream_buffer.size());
+	outfile.open(path, std::ios::app);
+	if (!outfile.is_open())
+	{
+		error = std::make_error_code(std::errc::bad_file_descriptor);
+		return false;
+	}
+	for (const auto& line_vector : contents)
+	{
+		int index = 0;
+		for (const auto& field : line_vector)
+		{
+			index++;
+			outfile << field;
+			if (index < line_vector.size())
+				outfile << delimiter;
+		}
+		outfile << "\n";
+	}
+	outfile.close();
+	if (outfile.fail())
+	{
+		// 򿪻дʧʱʧ״̬
+		error = std::make_error_code(std::errc::io_error);
+		return false;
+	}
+	return true;
+}
+
+/// <summary>
+/// һļĩβ׷һdouble͵ĶάļϣȻرոļļ򴴽ļ
+/// </summary>
+/// <param name="path">Ҫ׷ӵļ</param>
+/// <param name="contents">Ҫ׷ӵļеdouble͵Ķά</param>
+/// <param name="error">Ϣ</param>
+/// <returns>Ƿ׷Ӳ</returns>
+bool DelimitedFileSteamEngine::AppendDoubleVector(const std::string& path, const std::vector<std::vector<double>>& contents, std::error_code error) const
+{
+	// ׷ģʽ򿪣ʹýϴĻдϵͳô
+	std::vector<char> stream_buffer(kAppendStreamBufferSize);
+	std::ofstream outfile;
+	outfile.rdbuf()->pubsetbuf(stream_buffer.data(), stream_buffer.size());
+	outfile.open(path, std::ios::app);
+	if (!outfile.is_open())
+	{
+		error = std::make_error_code(std::errc::bad_file_descriptor);
+		return false;
+	}
+	for (const auto& line_vector : contents)
+	{
+		int index = 0;
+		for (const auto& field : line_vector)
+		{
+			index++;
+			outfile << std::to_string(field);
+			if (index < line_vector.size())
+				outfile << delimiter;
+		}
+		outfile << "\n";
+	}
+	outfile.close();
+	if (outfile.fail())
+	{
+		// 򿪻дʧʱʧ״̬
+		error = std::make_error_code(std::errc::io_error);
+		return false;
+	}
 	return true;
 }
+
+/// <summary>
+/// ɨһıļͳƸֵСֵֵƽֵȱʧЧֶԼκС
+/// </summary>
+/// <param name="path">ļ·</param>
+/// <param name="out_stats">еͳϢ</param>
+/// <param name="error">Ϣ</param>
+/// <returns>Ƿͳơ</returns>
+bool DelimitedFileSteamEngine::ComputeColumnStats(const std::string& path, TableStats& out_stats, std::error_code error) const
+{
+	try
+	{
+		if (delimiter.empty())
+		{
+			error = std::make_error_code(std::errc::invalid_argument);
+			return false;
+		}
+
+		std::ifstream infile;
+		infile.open(path, std::ios::in);
+		if (!infile.is_open())
+		{
+			error = std::make_error_code(std::errc::bad_file_descriptor);
+			return false;
+		}
+
+		ColumnStatsAccumulator accumulator(delimiter);
+		std::string str_line;
+		while (std::getline(infile, str_line))
+		{
+			accumulator.AddLine(str_line);
+		}
+		out_stats = accumulator.Finish();
+		return true;
+	}
+	catch (std::exception& ex)
+	{
+		auto msg = ex.what();
+		return false;
+	}
+}
+
+/// <summary>
+/// һıļзǿадһļ
+/// </summary>
+/// <param name="path">Ҫļ</param>
+/// <param name="out_path">ļҪļͬ</param>
+/// <param name="options">ѡ</param>
+/// <param name="error">Ϣ</param>
+/// <returns>Ƿ</returns>
+bool DelimitedFileSteamEngine::SortFile(const std::string& path, const std::string& out_path, const SortOptions& options, std::error_code error) const
+{
+	try
+	{
+		return SortFileByStream(path, out_path, delimiter, options, error);
+	}
+	catch (std::exception& ex)
+	{
+		auto msg = ex.what();
+		return false;
+	}
+}
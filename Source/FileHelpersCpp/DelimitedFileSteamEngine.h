@@ -35,6 +35,16 @@ namespace file_helpers_cpp
 		/// <returns>Ƿɶȡ</returns>
 		bool ReadFileAsStringVector(const std::string& path, std::vector<std::vector<std::string>>& out_string_vector, std::error_code error) const override;
 
+		/// <summary>
+		/// һıļļеıȡһַ͵ĶάȻرմļÿһݿ鱨һνȲȡƣָͳϢʱ¼׶εĺʱ
+		/// </summary>
+		/// <param name="path">ļ·</param>
+		/// <param name="out_string_vector">ļеַ͵Ķάȡʱղͷڴ档</param>
+		/// <param name="error">ϢȡʱΪoperation_canceled÷ݴȡʧܡ</param>
+		/// <param name="control">ȻصȡƺͳϢ</param>
+		/// <returns>Ƿɶȡȡʱfalse</returns>
+		bool ReadFileAsStringVector(const std::string& path, std::vector<std::vector<std::string>>& out_string_vector, std::error_code& error, const OperationControl& control) const;
+
 		/// <summary>
 		/// һıļļеıȡһַ͵ĶάȻرմļ
 		/// </summary>
@@ -44,6 +54,16 @@ namespace file_helpers_cpp
 		/// <returns>Ƿɶȡ</returns>
 		bool ReadFileAsDoubleVector(const std::string& path, std::vector<std::vector<double>>& out_double_vector, std::error_code error) const override;
 
+		/// <summary>
+		/// һıļļеıȡһַ͵ĶάȻرմļÿһݿ鱨һνȲȡƣָͳϢʱ¼׶εĺʱ
+		/// </summary>
+		/// <param name="path">ļ·</param>
+		/// <param name="out_double_vector">ļеdouble͵Ķάȡʱղͷڴ档</param>
+		/// <param name="error">ϢȡʱΪoperation_canceled÷ݴȡʧܡ</param>
+		/// <param name="control">ȻصȡƺͳϢ</param>
+		/// <returns>Ƿɶȡȡʱfalse</returns>
+		bool ReadFileAsDoubleVector(const std::string& path, std::vector<std::vector<double>>& out_double_vector, std::error_code& error, const OperationControl& control) const;
+
 		/// <summary>
 		/// һļдһַ͵ĶάļϣȻرոļ
 		/// </summary>
@@ -61,5 +81,43 @@ namespace file_helpers_cpp
 		/// <param name="error">Ϣ</param>
 		/// <returns>Ƿд</returns>
 		bool WriteAllDoubleVector(const std::string& path, const std::vector<std::vector<double>>& contents, std::error_code error) const override;
+
+		/// <summary>
+		/// һļĩβ׷һַ͵ĶάļϣȻرոļļ򴴽ļ
+		/// </summary>
+		/// <param name="path">Ҫ׷ӵļ</param>
+		/// <param name="contents">Ҫ׷ӵļеַ͵Ķά</param>
+		/// <param name="error">Ϣ</param>
+		/// <returns>Ƿ׷Ӳ</returns>
+		bool AppendStringVector(const std::string& path, const std::vector<std::vector<std::string>>& contents, std::error_code error) const override;
+
+		/// <summary>
+		/// һļĩβ׷һdouble͵ĶάļϣȻرոļļ򴴽ļ
+		/// </summary>
+		/// <param name="path">Ҫ׷ӵļ</param>
+		/// <param name="contents">Ҫ׷ӵļеdouble͵Ķά</param>
+		/// <param name="error">Ϣ</param>
+		/// <returns>Ƿ׷Ӳ</returns>
+		bool AppendDoubleVector(const std::string& path, const std::vector<std::vector<double>>& contents, std::error_code error) const override;
+
+		/// <summary>
+		/// ɨһıļͳƸֵСֵֵƽֵȱʧЧֶԼκС
+		/// </summary>
+		/// <param name="path">ļ·</param>
+		/// <param name="out_stats">еͳϢ</param>
+		/// <param name="error">Ϣ</param>
+		/// <returns>Ƿͳơ</returns>
+		bool ComputeColumnStats(const std::string& path, TableStats& out_stats, std::error_code error) const;
+
+		/// <summary>
+		/// һıļзǿадһļļڴԤֶζ뻺ÿ̳߳в
+		/// һʱдʱļð鲢ȶġ
+		/// </summary>
+		/// <param name="path">Ҫļ</param>
+		/// <param name="out_path">ļҪļͬ</param>
+		/// <param name="options">ѡ</param>
+		/// <param name="error">Ϣ</param>
+		/// <returns>Ƿ</returns>
+		bool SortFile(const std::string& path, const std::string& out_path, const SortOptions& options, std::error_code error) const;
 	};
 }
@@ -0,0 +1,517 @@
+﻿#include "pch.h"
+#include <filesystem>
+#include <fstream>
+#include "mio.hpp"
+#include "ExternalSorter.h"
+#include "LineScanner.h"
+#include "LoserTree.h"
+#include "MappedLineReader.h"
+#include "ThreadPool.h"
+#include "TraceRecorder.h"
+
+using namespace file_helpers_cpp;
+
+namespace
+{
+	/// <summary>
+	/// 默认的内存预算。
+	/// </summary>
+	constexpr long long kDefaultMemoryBudget = 256LL * 1024 * 1024;
+
+	/// <summary>
+	/// 并行排序时每个子块的最小字节数，过小的子块不值得单独调度。
+	/// </summary>
+	constexpr size_t kMinSortChunkSize = 1024 * 1024;
+
+	/// <summary>
+	/// 归并临时文件时每个文件映射窗口的最小和最大字节数。
+	/// </summary>
+	constexpr size_t kMinRunWindowSize = 64 * 1024;
+
+	constexpr size_t kMaxRunWindowSize = 4 * 1024 * 1024;
+
+	/// <summary>
+	/// 表示待排序的一行：排序键前缀、行在文本中的位置，以及字节键在行中的位置。
+	/// </summary>
+	struct SortEntry
+	{
+		uint64_t prefix;
+
+		uint64_t offset;
+
+		uint32_t length;
+
+		uint32_t key_offset;
+
+		uint32_t key_length;
+	};
+
+	/// <summary>
+	/// 每行占用的排序项内存：排序项本身和基数排序的缓冲区。
+	/// </summary>
+	constexpr size_t kEntryCost = 2 * sizeof(SortEntry);
+
+	SortKey EntryKey(const char* data, const SortEntry& entry)
+	{
+		SortKey key;
+		key.prefix = entry.prefix;
+		key.bytes = std::string_view(data + entry.offset + entry.key_offset, entry.key_length);
+		return key;
+	}
+
+	/// <summary>
+	/// 收集文本中[begin, end)范围内所有非空行的排序项。
+	/// </summary>
+	void CollectEntries(const char* data, size_t begin, const size_t end, const SortKeyExtractor& extractor, std::vector<SortEntry>& entries)
+	{
+		while (begin < end)
+		{
+			const size_t line_end = FindLineEnd(data, begin, end);
+			const std::string_view line(data + begin, line_end - begin);
+			if (!line.empty() && line != "\r")
+			{
+				const SortKey key = extractor.Extract(line);
+				SortEntry entry;
+				entry.prefix = key.prefix;
+				entry.offset = begin;
+				entry.length = static_cast<uint32_t>(line.size());
+				entry.key_offset = key.bytes.empty() ? 0 : static_cast<uint32_t>(key.bytes.data() - line.data());
+				entry.key_length = static_cast<uint32_t>(key.bytes.size());
+				entries.push_back(entry);
+			}
+			begin = line_end + 1;
+		}
+	}
+
+	/// <summary>
+	/// 按前缀对排序项做LSD基数排序，每轮8位。一次遍历统计所有轮的直方图，所有项该字节相同的轮直接跳过。排序是稳定的。
+	/// </summary>
+	void RadixSortEntries(std::vector<SortEntry>& entries)
+	{
+		if (entries.size() < 2)
+		{
+			return;
+		}
+		std::vector<size_t> counts(8 * 256);
+		for (const auto& entry : entries)
+		{
+			for (size_t pass = 0; pass < 8; pass++)
+			{
+				counts[pass * 256 + (entry.prefix >> (pass * 8) & 0xFF)]++;
+			}
+		}
+
+		std::vector<SortEntry> buffer(entries.size());
+		for (size_t pass = 0; pass < 8; pass++)
+		{
+			size_t* pass_counts = counts.data() + pass * 256;
+			if (pass_counts[entries[0].prefix >> (pass * 8) & 0xFF] == entries.size())
+			{
+				continue;
+			}
+			size_t offset = 0;
+			for (size_t digit = 0; digit < 256; digit++)
+			{
+				const size_t count = pass_counts[digit];
+				pass_counts[digit] = offset;
+				offset += count;
+			}
+			for (const auto& entry : entries)
+			{
+				buffer[pass_counts[entry.prefix >> (pass * 8) & 0xFF]++] = entry;
+			}
+			entries.swap(buffer);
+		}
+	}
+
+	void SortEntries(const char* data, std::vector<SortEntry>& entries, const SortKeyExtractor& extractor)
+	{
+		if (extractor.IsNumeric())
+		{
+			RadixSortEntries(entries);
+			return;
+		}
+		std::stable_sort(entries.begin(), entries.end(), [data, &extractor](const SortEntry& a, const SortEntry& b)
+		{
+			return extractor.Compare(EntryKey(data, a), EntryKey(data, b)) < 0;
+		});
+	}
+
+	/// <summary>
+	/// 将文本中[begin, end)范围内的行排序后写入输出。范围划分为对齐到行首的子块在线程池中并行排序，再用败者树归并。
+	/// </summary>
+	void SortTextToWriter(const char* data, const size_t begin, const size_t end, const SortKeyExtractor& extractor, const int thread_count,
+	                      BufferedFileWriter& writer, std::error_code& error)
+	{
+		const std::shared_ptr<ThreadPool> pool = ThreadPool::Shared();
+		const int parallelism = pool->Parallelism(thread_count);
+		const size_t size = end - begin;
+		const size_t chunk_count = std::max<size_t>(1, std::min(static_cast<size_t>(parallelism), size / kMinSortChunkSize));
+		const size_t chunk_size = (size + chunk_count - 1) / std::max<size_t>(1, chunk_count);
+
+		// 子块边界对齐到行首。
+		std::vector<size_t> chunk_begins(chunk_count + 1, end);
+		chunk_begins[0] = begin;
+		for (size_t i = 1; i < chunk_count; i++)
+		{
+			const size_t split = std::max(chunk_begins[i - 1], begin + chunk_size * i);
+			chunk_begins[i] = split == 0 || data[split - 1] == '\n' ? split : std::min(end, FindLineEnd(data, split, end) + 1);
+		}
+
+		std::vector<std::vector<SortEntry>> chunks(chunk_count);
+		pool->ParallelFor(chunk_count, parallelism, [&](const size_t i)
+		{
+			TraceSpan span("sort", "SortFile", "bytes", static_cast<long long>(chunk_begins[i + 1] - chunk_begins[i]));
+			// 按行数预留，避免逐个追加时容量翻倍超出内存预算。
+			chunks[i].reserve(CountNonEmptyRecords(data, chunk_begins[i], chunk_begins[i + 1], end));
+			CollectEntries(data, chunk_begins[i], chunk_begins[i + 1], extractor, chunks[i]);
+			SortEntries(data, chunks[i], extractor);
+		});
+
+		TraceSpan span("merge", "SortFile", "runs", static_cast<long long>(chunk_count));
+		std::vector<size_t> positions(chunk_count);
+		const auto less = [&](const size_t a, const size_t b)
+		{
+			if (positions[a] == chunks[a].size())
+			{
+				return false;
+			}
+			if (positions[b] == chunks[b].size())
+			{
+				return true;
+			}
+			const int result = extractor.Compare(EntryKey(data, chunks[a][positions[a]]), EntryKey(data, chunks[b][positions[b]]));
+			return result < 0 || (result == 0 && a < b);
+		};
+		LoserTree<decltype(less)> tree(chunk_count, less);
+		while (true)
+		{
+			const size_t winner = tree.Winner();
+			if (positions[winner] == chunks[winner].size())
+			{
+				break;
+			}
+			const SortEntry& entry = chunks[winner][positions[winner]++];
+			if (!writer.WriteLine(std::string_view(data + entry.offset, entry.length), error))
+			{
+				return;
+			}
+			tree.ReplayWinner();
+		}
+	}
+
+	/// <summary>
+	/// 检查排序参数。
+	/// </summary>
+	bool ValidateSortArguments(const std::string& path, const std::string& out_path, const std::string& delimiter, const SortOptions& options, std::error_code& error)
+	{
+		if (delimiter.empty() || options.key_column < 0)
+		{
+			error = std::make_error_code(std::errc::invalid_argument);
+			return false;
+		}
+		std::error_code equivalent_error;
+		if (std::filesystem::exists(out_path, equivalent_error) && std::filesystem::equivalent(path, out_path, equivalent_error))
+		{
+			error = std::make_error_code(std::errc::invalid_argument);
+			return false;
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// 获取每个分段的最大字节数：内存预算的一半，另一半留给排序项。
+	/// </summary>
+	size_t SegmentSize(const SortOptions& options)
+	{
+		const long long budget = options.memory_budget > 0 ? options.memory_budget : kDefaultMemoryBudget;
+		return std::max(kMinSortChunkSize, static_cast<size_t>(budget / 2));
+	}
+
+	/// <summary>
+	/// 获取从begin开始的分段的结束位置：分段不超过SegmentSize字节，其中各行的排序项也不超过SegmentSize字节，短行较多时按行数提前结束。
+	/// limit必须是行首或文本末尾。返回的位置对齐到行首或等于limit，分段至少包含一行。
+	/// </summary>
+	size_t SegmentEnd(const char* data, const size_t begin, const size_t limit, const SortOptions& options)
+	{
+		const size_t segment_size = SegmentSize(options);
+		const size_t split = std::min(limit, begin + segment_size);
+		const size_t byte_end = split == limit || data[split - 1] == '\n' ? split : std::min(limit, FindLineEnd(data, split, limit) + 1);
+		return SkipNonEmptyLines(data, begin, byte_end, std::max<size_t>(1, segment_size / kEntryCost));
+	}
+
+	/// <summary>
+	/// 将文本中[begin, end)范围内的行排序后写入一个新的临时文件。
+	/// </summary>
+	bool WriteSortedRun(const char* data, const size_t begin, const size_t end, const std::string& out_path, const SortOptions& options,
+	                    const SortKeyExtractor& extractor, TemporaryFiles& runs, std::error_code& error)
+	{
+		const std::string run_path = TemporaryFilePath(out_path, options.temp_directory, "run" + std::to_string(runs.Paths().size()));
+		runs.Add(run_path);
+		BufferedFileWriter run_writer;
+		if (!run_writer.Create(run_path, error))
+		{
+			return false;
+		}
+		SortTextToWriter(data, begin, end, extractor, options.thread_count, run_writer, error);
+		const bool closed = run_writer.Close(error);
+		return !error && closed;
+	}
+
+	/// <summary>
+	/// 将已排序的文件归并写入输出文件。每个文件的映射窗口按内存预算平均分配。
+	/// </summary>
+	bool MergeFilesToOutput(const std::vector<std::string>& paths, const std::string& out_path, const SortOptions& options, const SortKeyExtractor& extractor, std::error_code& error)
+	{
+		const long long budget = options.memory_budget > 0 ? options.memory_budget : kDefaultMemoryBudget;
+		const size_t window_size = std::clamp(static_cast<size_t>(budget) / std::max<size_t>(1, paths.size()), kMinRunWindowSize, kMaxRunWindowSize);
+		BufferedFileWriter writer;
+		if (!writer.Create(out_path, error))
+		{
+			return false;
+		}
+		const bool merged = MergeSortedRuns(paths, extractor, window_size, writer, error);
+		const bool closed = writer.Close(error);
+		return merged && closed;
+	}
+}
+
+bool file_helpers_cpp::MergeSortedRuns(const std::vector<std::string>& paths, const SortKeyExtractor& extractor, const size_t window_size, BufferedFileWriter& writer, std::error_code& error)
+{
+	const size_t source_count = paths.size();
+	if (source_count == 0)
+	{
+		return true;
+	}
+
+	std::vector<MappedLineReader> readers(source_count);
+	std::vector<std::string_view> lines(source_count);
+	std::vector<SortKey> keys(source_count);
+	std::vector<char> exhausted(source_count);
+	const auto advance = [&](const size_t i)
+	{
+		while (true)
+		{
+			if (!readers[i].Next(lines[i], error))
+			{
+				exhausted[i] = 1;
+				return !error;
+			}
+			if (!lines[i].empty() && lines[i] != "\r")
+			{
+				keys[i] = extractor.Extract(lines[i]);
+				return true;
+			}
+		}
+	};
+	for (size_t i = 0; i < source_count; i++)
+	{
+		if (!readers[i].Open(paths[i], window_size, error) || !advance(i))
+		{
+			return false;
+		}
+	}
+
+	TraceSpan span("merge", "MergeSortedRuns", "files", static_cast<long long>(source_count));
+	const auto less = [&](const size_t a, const size_t b)
+	{
+		if (exhausted[a])
+		{
+			return false;
+		}
+		if (exhausted[b])
+		{
+			return true;
+		}
+		const int result = extractor.Compare(keys[a], keys[b]);
+		return result < 0 || (result == 0 && a < b);
+	};
+	LoserTree<decltype(less)> tree(source_count, less);
+	while (true)
+	{
+		const size_t winner = tree.Winner();
+		if (exhausted[winner])
+		{
+			return true;
+		}
+		if (!writer.WriteLine(lines[winner], error) || !advance(winner))
+		{
+			return false;
+		}
+		tree.ReplayWinner();
+	}
+}
+
+bool file_helpers_cpp::SortFileByMmap(const std::string& path, const std::string& out_path, const std::string& delimiter, const SortOptions& options, std::error_code& error)
+{
+	if (!ValidateSortArguments(path, out_path, delimiter, options, error))
+	{
+		return false;
+	}
+	const SortKeyExtractor extractor(delimiter, options);
+
+	const uintmax_t size = std::filesystem::file_size(path, error);
+	if (error)
+	{
+		return false;
+	}
+	if (size == 0)
+	{
+		// 空文件无法映射，输出空文件。
+		BufferedFileWriter writer;
+		return writer.Create(out_path, error) && writer.Close(error);
+	}
+
+	// 每次只映射一个分段大小的窗口，已排序的分段解除映射，驻留的文件页不超过一个窗口。窗口中没有换行符时加倍。
+	TemporaryFiles runs;
+	size_t window_size = SegmentSize(options);
+	for (uintmax_t begin = 0; begin < size;)
+	{
+		const size_t length = static_cast<size_t>(std::min<uintmax_t>(size - begin, window_size));
+		mio::mmap_source window_mmap;
+		window_mmap.map(path, static_cast<size_t>(begin), length, error);
+		if (error)
+		{
+			return false;
+		}
+		const char* data = window_mmap.data();
+		size_t limit = length;
+		if (begin + length < size)
+		{
+			while (limit > 0 && data[limit - 1] != '\n')
+			{
+				limit--;
+			}
+			if (limit == 0)
+			{
+				window_size *= 2;
+				continue;
+			}
+		}
+
+		const size_t end = SegmentEnd(data, 0, limit, options);
+		if (begin == 0 && end == size)
+		{
+			// 整个文件只有一个分段，直接写入输出。
+			BufferedFileWriter writer;
+			if (!writer.Create(out_path, error))
+			{
+				return false;
+			}
+			SortTextToWriter(data, 0, end, extractor, options.thread_count, writer, error);
+			const bool closed = writer.Close(error);
+			return !error && closed;
+		}
+		if (!WriteSortedRun(data, 0, end, out_path, options, extractor, runs, error))
+		{
+			return false;
+		}
+		begin += end;
+	}
+
+	return MergeFilesToOutput(runs.Paths(), out_path, options, extractor, error);
+}
+
+bool file_helpers_cpp::SortFileByStream(const std::string& path, const std::string& out_path, const std::string& delimiter, const SortOptions& options, std::error_code& error)
+{
+	if (!ValidateSortArguments(path, out_path, delimiter, options, error))
+	{
+		return false;
+	}
+	const SortKeyExtractor extractor(delimiter, options);
+
+	std::ifstream infile(path, std::ios::in | std::ios::binary);
+	if (!infile.is_open())
+	{
+		error = std::make_error_code(std::errc::bad_file_descriptor);
+		return false;
+	}
+
+	// 每次读入一个缓冲区，不完整的最后一行留到下一次读取。缓冲区中没有换行符时加倍。短行较多时一个缓冲区分为多个分段。
+	TemporaryFiles runs;
+	std::vector<char> buffer(SegmentSize(options));
+	size_t carried = 0;
+	while (true)
+	{
+		TraceSpan read_span("read", "SortFile", "bytes", static_cast<long long>(buffer.size() - carried));
+		infile.read(buffer.data() + carried, static_cast<std::streamsize>(buffer.size() - carried));
+		const size_t filled = carried + static_cast<size_t>(infile.gcount());
+		read_span.End();
+		if (infile.bad())
+		{
+			error = std::make_error_code(std::errc::io_error);
+			return false;
+		}
+		const bool end_of_file = infile.eof();
+
+		if (end_of_file && runs.Paths().empty() && SegmentEnd(buffer.data(), 0, filled, options) == filled)
+		{
+			// 整个文件只有一个分段，直接写入输出。
+			BufferedFileWriter writer;
+			if (!writer.Create(out_path, error))
+			{
+				return false;
+			}
+			SortTextToWriter(buffer.data(), 0, filled, extractor, options.thread_count, writer, error);
+			const bool closed = writer.Close(error);
+			return !error && closed;
+		}
+
+		size_t end = filled;
+		if (!end_of_file)
+		{
+			while (end > 0 && buffer[end - 1] != '\n')
+			{
+				end--;
+			}
+			if (end == 0)
+			{
+				carried = filled;
+				buffer.resize(buffer.size() * 2);
+				continue;
+			}
+		}
+		for (size_t begin = 0; begin < end;)
+		{
+			const size_t segment_end = SegmentEnd(buffer.data(), begin, end, options);
+			if (!WriteSortedRun(buffer.data(), begin, segment_end, out_path, options, extractor, runs, error))
+			{
+				return false;
+			}
+			begin = segment_end;
+		}
+		carried = filled - end;
+		std::memmove(buffer.data(), buffer.data() + end, carried);
+		if (end_of_file)
+		{
+			break;
+		}
+	}
+	std::vector<char>().swap(buffer);
+
+	return MergeFilesToOutput(runs.Paths(), out_path, options, extractor, error);
+}
+
+bool file_helpers_cpp::MergeSortedFilesByMmap(const std::vector<std::string>& paths, const std::string& out_path, const std::string& delimiter, const SortOptions& options, std::error_code& error)
+{
+	if (delimiter.empty() || options.key_column < 0)
+	{
+		error = std::make_error_code(std::errc::invalid_argument);
+		return false;
+	}
+	for (const auto& path : paths)
+	{
+		if (!ValidateSortArguments(path, out_path, delimiter, options, error))
+		{
+			return false;
+		}
+	}
+	return MergeFilesToOutput(paths, out_path, options, SortKeyExtractor(delimiter, options), error);
+}
+
+std::string file_helpers_cpp::TemporaryFilePath(const std::string& out_path, const std::string& temp_directory, const std::string& tag)
+{
+	const std::filesystem::path output(out_path);
+	const std::filesystem::path directory = temp_directory.empty() ? output.parent_path() : std::filesystem::path(temp_directory);
+	return (directory / (output.filename().string() + "." + tag + ".tmp")).string();
+}
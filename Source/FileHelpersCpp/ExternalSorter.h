@@ -0,0 +1,246 @@
+﻿#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+#include "BufferedFileWriter.h"
+#include "ColumnStatsScanner.h"
+#include "FileEngineBase.h"
+
+namespace file_helpers_cpp
+{
+	/// <summary>
+	/// 查找一行中指定索引的非空字段，连续的分隔符视为一个，与ForEachField的字段索引一致。
+	/// </summary>
+	/// <param name="line">不含换行符的行。</param>
+	/// <param name="delimiter">分隔符。</param>
+	/// <param name="column">字段索引。</param>
+	/// <param name="field">找到的字段。</param>
+	/// <returns>是否存在该字段。</returns>
+	inline bool FindField(const std::string_view line, const std::string_view delimiter, size_t column, std::string_view& field)
+	{
+		size_t pos = 0;
+		while (true)
+		{
+			size_t end = line.find(delimiter, pos);
+			if (end == std::string_view::npos)
+			{
+				end = line.size();
+			}
+			if (end > pos)
+			{
+				if (column == 0)
+				{
+					field = line.substr(pos, end - pos);
+					return true;
+				}
+				column--;
+			}
+			if (end == line.size())
+			{
+				return false;
+			}
+			pos = end + delimiter.size();
+		}
+	}
+
+	/// <summary>
+	/// 表示一行的排序键。数值键编码为按无符号整数比较即有序的64位值；字节键保存前8个字节的大端编码和完整的字节切片。
+	/// </summary>
+	struct SortKey
+	{
+		uint64_t prefix = 0;
+
+		std::string_view bytes;
+	};
+
+	/// <summary>
+	/// 从行中提取排序键并比较，直接作用于映射区或缓冲区中的字节，不分配内存。
+	/// </summary>
+	class SortKeyExtractor
+	{
+	private:
+		std::string delimiter;
+
+		size_t column;
+
+		bool numeric;
+
+		bool descending;
+
+	public:
+		SortKeyExtractor(const std::string& delimiter, const SortOptions& options)
+			: delimiter(delimiter), column(static_cast<size_t>(options.key_column)), numeric(options.numeric_key), descending(options.descending)
+		{
+		}
+
+		bool IsNumeric() const
+		{
+			return numeric;
+		}
+
+		/// <summary>
+		/// 将数值编码为按无符号整数比较即有序的64位值。降序时取反，无效值编码为最大值以排在最后。
+		/// </summary>
+		/// <param name="value">数值。</param>
+		/// <param name="valid">数值是否有效。</param>
+		/// <param name="descending">是否降序。</param>
+		/// <returns>编码后的值。</returns>
+		static uint64_t EncodeNumber(double value, const bool valid, const bool descending)
+		{
+			if (!valid)
+			{
+				return UINT64_MAX;
+			}
+			if (value == 0)
+			{
+				// -0与0视为相等。
+				value = 0;
+			}
+			uint64_t bits = 0;
+			std::memcpy(&bits, &value, sizeof(bits));
+			bits = (bits & 0x8000000000000000ull) != 0 ? ~bits : bits | 0x8000000000000000ull;
+			return descending ? ~bits : bits;
+		}
+
+		/// <summary>
+		/// 提取一行的排序键。
+		/// </summary>
+		/// <param name="line">不含换行符的行，忽略行尾的\r。</param>
+		/// <returns>排序键，字节切片指向line中的字节。</returns>
+		SortKey Extract(std::string_view line) const
+		{
+			if (!line.empty() && line.back() == '\r')
+			{
+				line.remove_suffix(1);
+			}
+			SortKey key;
+			std::string_view field;
+			const bool found = FindField(line, delimiter, column, field);
+			if (numeric)
+			{
+				double value = 0;
+				key.prefix = EncodeNumber(value, found && ParseNumericField(field, value), descending);
+				return key;
+			}
+			if (found)
+			{
+				key.bytes = field;
+				for (size_t i = 0; i < 8; i++)
+				{
+					key.prefix = key.prefix << 8 | (i < field.size() ? static_cast<unsigned char>(field[i]) : 0);
+				}
+			}
+			return key;
+		}
+
+		/// <summary>
+		/// 比较两个排序键，已考虑升序或降序。
+		/// </summary>
+		/// <returns>a排在b之前时小于0，相等时为0，否则大于0。</returns>
+		int Compare(const SortKey& a, const SortKey& b) const
+		{
+			if (a.prefix != b.prefix || numeric)
+			{
+				const int result = a.prefix < b.prefix ? -1 : a.prefix > b.prefix ? 1 : 0;
+				return descending && !numeric ? -result : result;
+			}
+			const int result = a.bytes.compare(b.bytes);
+			return descending ? (result > 0 ? -1 : result < 0 ? 1 : 0) : result;
+		}
+	};
+
+	/// <summary>
+	/// 在离开作用域时删除登记的临时文件。
+	/// </summary>
+	class TemporaryFiles
+	{
+	private:
+		std::vector<std::string> paths;
+
+	public:
+		TemporaryFiles() = default;
+
+		TemporaryFiles(const TemporaryFiles&) = delete;
+
+		TemporaryFiles& operator=(const TemporaryFiles&) = delete;
+
+		~TemporaryFiles()
+		{
+			for (const auto& path : paths)
+			{
+				std::error_code remove_error;
+				std::filesystem::remove(path, remove_error);
+			}
+		}
+
+		void Add(const std::string& path)
+		{
+			paths.push_back(path);
+		}
+
+		const std::vector<std::string>& Paths() const
+		{
+			return paths;
+		}
+	};
+
+	/// <summary>
+	/// 获取输出文件对应的临时文件路径。
+	/// </summary>
+	/// <param name="out_path">输出文件路径。</param>
+	/// <param name="temp_directory">临时文件所在的目录，为空时使用输出文件所在的目录。</param>
+	/// <param name="tag">区分同一输出的多个临时文件的标记。</param>
+	/// <returns>临时文件路径：目录/输出文件名.标记.tmp。</returns>
+	std::string TemporaryFilePath(const std::string& out_path, const std::string& temp_directory, const std::string& tag);
+
+	/// <summary>
+	/// 按键将多个已排序的文本文件归并写入输出。各文件通过滑动的内存映射窗口读取，内存占用只与文件数有关。
+	/// 键相等时按文件顺序输出，跳过空行。
+	/// </summary>
+	/// <param name="paths">已排序的文件。</param>
+	/// <param name="extractor">排序键提取器。</param>
+	/// <param name="window_size">每个文件的映射窗口字节数。</param>
+	/// <param name="writer">输出写入器。</param>
+	/// <param name="error">错误信息。</param>
+	/// <returns>是否完成归并。</returns>
+	bool MergeSortedRuns(const std::vector<std::string>& paths, const SortKeyExtractor& extractor, size_t window_size, BufferedFileWriter& writer, std::error_code& error);
+
+	/// <summary>
+	/// 检查参数后按键将多个已排序的文件归并写入输出文件，各文件的映射窗口按内存预算平均分配（每个64KB到4MB）。
+	/// </summary>
+	/// <param name="paths">已按相同的键和方向排序的文件。</param>
+	/// <param name="out_path">输出文件，不能与任何输入文件相同。</param>
+	/// <param name="delimiter">分隔符。</param>
+	/// <param name="options">排序选项，使用其中的键列、比较方式、排序方向和内存预算。</param>
+	/// <param name="error">错误信息。</param>
+	/// <returns>是否完成归并。</returns>
+	bool MergeSortedFilesByMmap(const std::vector<std::string>& paths, const std::string& out_path, const std::string& delimiter, const SortOptions& options, std::error_code& error);
+
+	/// <summary>
+	/// 逐个窗口映射文件，按内存预算将其划分为对齐到行首的分段，分段的字节数和排序项各占预算的一半，短行较多时按行数提前结束。每个分段再划分为多个子块在线程池中并行排序（数值键用基数排序），
+	/// 用败者树归并为一个有序段。只有一个分段时直接写入输出，否则写入临时文件后归并。排序是稳定的，跳过空行。
+	/// </summary>
+	/// <param name="path">输入文件。</param>
+	/// <param name="out_path">输出文件，不能与输入文件相同。</param>
+	/// <param name="delimiter">分隔符。</param>
+	/// <param name="options">排序选项。</param>
+	/// <param name="error">错误信息。</param>
+	/// <returns>是否完成排序。</returns>
+	bool SortFileByMmap(const std::string& path, const std::string& out_path, const std::string& delimiter, const SortOptions& options, std::error_code& error);
+
+	/// <summary>
+	/// 与SortFileByMmap相同，但通过文件流将各分段读入缓冲区后排序。
+	/// </summary>
+	/// <param name="path">输入文件。</param>
+	/// <param name="out_path">输出文件，不能与输入文件相同。</param>
+	/// <param name="delimiter">分隔符。</param>
+	/// <param name="options">排序选项。</param>
+	/// <param name="error">错误信息。</param>
+	/// <returns>是否完成排序。</returns>
+	bool SortFileByStream(const std::string& path, const std::string& out_path, const std::string& delimiter, const SortOptions& options, std::error_code& error);
+}
@@ -0,0 +1,316 @@
+﻿#include "pch.h"
+#include <cstring>
+#include "FieldPatcher.h"
+#include "LineScanner.h"
+#include "ThreadPool.h"
+#include "TraceRecorder.h"
+#include "ZoneMap.h"
+
+using namespace file_helpers_cpp;
+
+size_t file_helpers_cpp::SeekLine(const char* data, const size_t size, const int target_line, size_t& line_begin, int& line_index, size_t& line_end)
+{
+	// 跳过目标行之前的非空行，中间的行不做任何解析。
+	line_begin = SkipNonEmptyLines(data, line_begin, size, static_cast<size_t>(target_line - line_index));
+	line_index = target_line;
+
+	// 目标行之前可能还有空行。
+	line_end = FindLineEnd(data, line_begin, size);
+	size_t content_end = line_end > line_begin && data[line_end - 1] == '\r' ? line_end - 1 : line_end;
+	while (content_end == line_begin && line_end < size)
+	{
+		line_begin = line_end + 1;
+		line_end = FindLineEnd(data, line_begin, size);
+		content_end = line_end > line_begin && data[line_end - 1] == '\r' ? line_end - 1 : line_end;
+	}
+	return content_end;
+}
+
+void file_helpers_cpp::LocateFieldPatches(const char* data, const size_t size, const std::string& delimiter, const std::map<int, std::map<int, std::string>>& contents, std::vector<LocatedFieldPatch>& patches)
+{
+	patches.clear();
+
+	size_t line_begin = 0;
+	int line_index = 0;
+	for (auto line_iter = contents.lower_bound(0); line_iter != contents.end() && line_begin < size; ++line_iter)
+	{
+		size_t line_end = 0;
+		const size_t content_end = SeekLine(data, size, line_iter->first, line_begin, line_index, line_end);
+		if (content_end == line_begin)
+		{
+			break;
+		}
+		LocateLineFields(data, line_begin, content_end, delimiter, line_iter->second.begin(), line_iter->second.end(), patches);
+
+		line_begin = line_end + 1;
+		line_index++;
+	}
+}
+
+long long file_helpers_cpp::FieldPatchSizeDelta(const std::vector<LocatedFieldPatch>& patches)
+{
+	long long delta = 0;
+	for (const auto& patch : patches)
+	{
+		delta += static_cast<long long>(patch.value->size()) - static_cast<long long>(patch.old_size);
+	}
+	return delta;
+}
+
+void file_helpers_cpp::ApplyFieldPatches(char* data, const size_t old_size, const std::vector<LocatedFieldPatch>& patches)
+{
+	/// <summary>
+	/// 需要整段移动的原文件区间。
+	/// </summary>
+	struct ShiftSegment
+	{
+		size_t begin;
+		size_t end;
+		long long shift;
+	};
+
+	// 每个长度变化的修改之后直到下一个长度变化的修改之前为一段，段内所有字节的移动距离相同。
+	// 段内长度不变的旧字段随整段移动，稍后再被新值覆盖。
+	std::vector<ShiftSegment> segments;
+	long long shift = 0;
+	for (const auto& patch : patches)
+	{
+		if (patch.value->size() == patch.old_size)
+		{
+			continue;
+		}
+		const size_t old_end = patch.offset + patch.old_size;
+		if (!segments.empty())
+		{
+			segments.back().end = patch.offset;
+		}
+		shift += static_cast<long long>(patch.value->size()) - static_cast<long long>(patch.old_size);
+		segments.push_back({ old_end, old_size, shift });
+	}
+
+	// 各段的目标区间互不重叠且保持原顺序。左移的段从前往后移动，右移的段从后往前移动，
+	// 这样任何一段在移动前都不会被其他段覆盖。
+	for (const auto& segment : segments)
+	{
+		if (segment.shift < 0 && segment.end > segment.begin)
+		{
+			std::memmove(data + segment.begin + segment.shift, data + segment.begin, segment.end - segment.begin);
+		}
+	}
+	for (auto iter = segments.rbegin(); iter != segments.rend(); ++iter)
+	{
+		if (iter->shift > 0 && iter->end > iter->begin)
+		{
+			std::memmove(data + iter->begin + iter->shift, data + iter->begin, iter->end - iter->begin);
+		}
+	}
+
+	// 所有字节移动完成后再写入新值。
+	shift = 0;
+	for (const auto& patch : patches)
+	{
+		std::memcpy(data + patch.offset + shift, patch.value->data(), patch.value->size());
+		shift += static_cast<long long>(patch.value->size()) - static_cast<long long>(patch.old_size);
+	}
+}
+
+bool file_helpers_cpp::CommitFieldPatches(const NativeFile& file, mio::mmap_sink& rw_mmap, const long long old_size, const std::vector<LocatedFieldPatch>& patches, std::error_code& error)
+{
+	const long long new_size = old_size + FieldPatchSizeDelta(patches);
+
+	// 文件变大时先扩展文件并重新映射，保证移动后的字节都在映射区内。
+	if (new_size > old_size)
+	{
+		rw_mmap.unmap();
+		if (!file.Resize(new_size, error))
+		{
+			return false;
+		}
+		rw_mmap.map(file.NativeHandle(), 0, static_cast<size_t>(new_size), error);
+		if (error)
+		{
+			return false;
+		}
+	}
+
+	ApplyFieldPatches(rw_mmap.data(), static_cast<size_t>(old_size), patches);
+
+	rw_mmap.sync(error);
+	rw_mmap.unmap();
+	if (error)
+	{
+		return false;
+	}
+
+	// 文件变小时在移动完成并解除映射后截断。
+	if (new_size < old_size)
+	{
+		return file.Resize(new_size, error);
+	}
+	return true;
+}
+
+bool file_helpers_cpp::ParallelModifyFieldValues(const std::string& path, const std::string& delimiter, const std::vector<FieldPatch>& patches, int thread_count, std::error_code& error)
+{
+	const auto patch_less = [](const FieldPatch& left, const FieldPatch& right)
+	{
+		return left.line_index < right.line_index || (left.line_index == right.line_index && left.field_index < right.field_index);
+	};
+	if (!std::is_sorted(patches.begin(), patches.end(), patch_less))
+	{
+		error = std::make_error_code(std::errc::invalid_argument);
+		return false;
+	}
+	const std::shared_ptr<ThreadPool> pool = ThreadPool::Shared();
+	thread_count = pool->Parallelism(thread_count);
+
+	NativeFile file;
+	if (!file.Open(path, error))
+	{
+		return false;
+	}
+	const long long file_size = file.Size(error);
+	if (error)
+	{
+		return false;
+	}
+	if (file_size == 0 || patches.empty())
+	{
+		return true;
+	}
+
+	mio::mmap_sink rw_mmap;
+	rw_mmap.map(file.NativeHandle(), 0, static_cast<size_t>(file_size), error);
+	if (error)
+	{
+		return false;
+	}
+	char* data = rw_mmap.data();
+	const size_t size = rw_mmap.size();
+
+	// 按字节均分为若干区间，区间边界对齐到行首。
+	std::vector<size_t> chunk_begins(thread_count + 1, size);
+	chunk_begins[0] = 0;
+	for (int i = 1; i < thread_count; i++)
+	{
+		const size_t split = std::max(chunk_begins[i - 1], size / thread_count * i);
+		chunk_begins[i] = split == 0 || data[split - 1] == '\n' ? split : std::min(size, FindLineEnd(data, split, size) + 1);
+	}
+
+	std::vector<std::vector<LocatedFieldPatch>> resized_patches(thread_count);
+	std::vector<std::error_code> errors(thread_count);
+	std::vector<int> first_lines(thread_count + 1, 0);
+
+	// 第一遍：并行统计各区间的非空行数，前缀和即为各区间起始行的行索引。文件末尾没有换行符的最后一行也要计入，
+	// 否则该行的修改会被分给之后的空区间而丢失。
+	if (thread_count > 1)
+	{
+		std::vector<size_t> line_counts(thread_count);
+		pool->ParallelFor(thread_count, thread_count, [&](const size_t i)
+		{
+			TraceSpan span("scan", "ParallelModifyFieldValues", "bytes", static_cast<long long>(chunk_begins[i + 1] - chunk_begins[i]));
+			line_counts[i] = CountNonEmptyRecords(data, chunk_begins[i], chunk_begins[i + 1], size);
+		});
+
+		for (int i = 0; i < thread_count; i++)
+		{
+			first_lines[i + 1] = first_lines[i] + static_cast<int>(line_counts[i]);
+		}
+	}
+
+	// 第二遍：各任务处理行索引落在本区间内的修改。长度不变的直接写入映射区，长度变化的留待最后统一移动。
+	pool->ParallelFor(thread_count, thread_count, [&](const size_t i)
+	{
+		const auto first = i == 0 ? patches.begin() : std::lower_bound(patches.begin(), patches.end(), FieldPatch{ first_lines[i], 0, std::string() }, patch_less);
+		const auto last = i == static_cast<size_t>(thread_count) - 1 ? patches.end() : std::lower_bound(patches.begin(), patches.end(), FieldPatch{ first_lines[i + 1], 0, std::string() }, patch_less);
+		if (first == last)
+		{
+			return;
+		}
+		TraceSpan span("patch", "ParallelModifyFieldValues", "patches", static_cast<long long>(last - first));
+		try
+		{
+			// 只在本区间内扫描，不读取其他任务正在写入的字节。本区间的目标行都以区间内的换行符结尾，或是文件末尾的最后一行。
+			const size_t chunk_end = chunk_begins[i + 1];
+			std::vector<LocatedFieldPatch> located;
+			size_t line_begin = chunk_begins[i];
+			int line_index = first_lines[i];
+			auto line_first = first;
+			while (line_first != last && line_begin < chunk_end)
+			{
+				auto line_last = line_first;
+				while (line_last != last && line_last->line_index == line_first->line_index)
+				{
+					++line_last;
+				}
+				if (line_first->line_index >= line_index)
+				{
+					size_t line_end = 0;
+					const size_t content_end = SeekLine(data, chunk_end, line_first->line_index, line_begin, line_index, line_end);
+					if (content_end == line_begin)
+					{
+						break;
+					}
+
+					located.clear();
+					LocateLineFields(data, line_begin, content_end, delimiter, line_first, line_last, located);
+					for (const auto& patch : located)
+					{
+						if (patch.value->size() == patch.old_size)
+						{
+							std::memcpy(data + patch.offset, patch.value->data(), patch.old_size);
+						}
+						else
+						{
+							resized_patches[i].push_back(patch);
+						}
+					}
+
+					line_begin = line_end + 1;
+					line_index++;
+				}
+				line_first = line_last;
+			}
+		}
+		catch (std::bad_alloc&)
+		{
+			errors[i] = std::make_error_code(std::errc::not_enough_memory);
+		}
+	});
+
+	for (const auto& worker_error : errors)
+	{
+		if (worker_error)
+		{
+			error = worker_error;
+			return false;
+		}
+	}
+
+	// 长度不变的修改已写入，只需将长度变化的修改按偏移量顺序合并后统一移动。
+	std::vector<LocatedFieldPatch> all_resized;
+	for (auto& thread_patches : resized_patches)
+	{
+		all_resized.insert(all_resized.end(), thread_patches.begin(), thread_patches.end());
+	}
+	bool committed = false;
+	if (all_resized.empty())
+	{
+		TraceSpan span("write", "ParallelModifyFieldValues");
+		rw_mmap.sync(error);
+		rw_mmap.unmap();
+		committed = !error;
+	}
+	else
+	{
+		TraceSpan span("write", "ParallelModifyFieldValues", "patches", static_cast<long long>(all_resized.size()));
+		committed = CommitFieldPatches(file, rw_mmap, file_size, all_resized, error);
+	}
+	if (!committed)
+	{
+		return false;
+	}
+	// 修改成功后区域映射不再有效。
+	RemoveZoneMapSidecar(path);
+	return true;
+}
@@ -0,0 +1,156 @@
+﻿#pragma once
+#include <algorithm>
+#include <map>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+#include "mio.hpp"
+#include "DelimitedFileMMFEngine.h"
+#include "NativeFile.h"
+
+namespace file_helpers_cpp
+{
+	/// <summary>
+	/// 表示已定位到文件字节偏移量的字段修改。
+	/// </summary>
+	struct LocatedFieldPatch
+	{
+		/// <summary>
+		/// 旧字段值在原文件中的起始字节偏移量。
+		/// </summary>
+		size_t offset;
+
+		/// <summary>
+		/// 旧字段值的字节长度。
+		/// </summary>
+		size_t old_size;
+
+		/// <summary>
+		/// 新的字段值。
+		/// </summary>
+		const std::string* value;
+	};
+
+	inline int PatchFieldIndex(const std::pair<const int, std::string>& field)
+	{
+		return field.first;
+	}
+
+	inline const std::string& PatchFieldValue(const std::pair<const int, std::string>& field)
+	{
+		return field.second;
+	}
+
+	inline int PatchFieldIndex(const FieldPatch& field)
+	{
+		return field.field_index;
+	}
+
+	inline const std::string& PatchFieldValue(const FieldPatch& field)
+	{
+		return field.value;
+	}
+
+	/// <summary>
+	/// 从当前行向后定位到目标行，只跳过中间的行而不解析。空行不计入行索引。
+	/// </summary>
+	/// <param name="data">文本数据。</param>
+	/// <param name="size">文本数据的长度。</param>
+	/// <param name="target_line">目标行索引，不能小于当前行索引。</param>
+	/// <param name="line_begin">当前行的行首位置。返回时为目标行的行首位置。</param>
+	/// <param name="line_index">当前行的行索引。返回时为目标行的行索引。</param>
+	/// <param name="line_end">返回目标行的换行符位置。</param>
+	/// <returns>目标行内容（不含\r\n）的结束位置。目标行不存在时返回line_begin。</returns>
+	size_t SeekLine(const char* data, size_t size, int target_line, size_t& line_begin, int& line_index, size_t& line_end);
+
+	/// <summary>
+	/// 在一行内逐个定位待修改字段的起止位置，不分配内存。空字段不计入字段索引，与Split一致。
+	/// </summary>
+	/// <param name="data">文本数据。</param>
+	/// <param name="line_begin">行首位置。</param>
+	/// <param name="content_end">行内容的结束位置。</param>
+	/// <param name="delimiter">字段分隔符。</param>
+	/// <param name="first">按字段索引升序排列的待修改字段的起始迭代器。</param>
+	/// <param name="last">待修改字段的结束迭代器。</param>
+	/// <param name="patches">已定位的修改将追加到该向量。</param>
+	template <typename FieldIterator>
+	void LocateLineFields(const char* data, const size_t line_begin, const size_t content_end, const std::string& delimiter, FieldIterator first, const FieldIterator last, std::vector<LocatedFieldPatch>& patches)
+	{
+		const std::string_view line(data + line_begin, content_end - line_begin);
+		int field_index = 0;
+		size_t field_begin = 0;
+		while (first != last && field_begin <= line.size())
+		{
+			size_t field_end = line.find(delimiter, field_begin);
+			if (field_end == std::string_view::npos || delimiter.empty())
+			{
+				field_end = line.size();
+			}
+			if (field_end > field_begin)
+			{
+				// 跳过负数和重复的字段索引。
+				while (first != last && PatchFieldIndex(*first) < field_index)
+				{
+					++first;
+				}
+				if (first != last && PatchFieldIndex(*first) == field_index)
+				{
+					patches.push_back({ line_begin + field_begin, field_end - field_begin, &PatchFieldValue(*first) });
+					++first;
+				}
+				field_index++;
+			}
+			field_begin = field_end + std::max<size_t>(delimiter.size(), 1);
+		}
+	}
+
+	/// <summary>
+	/// 在文本数据中定位待修改字段的位置。只解析目标行，定位完最后一个目标行即结束。
+	/// 空行不计入行索引，空字段不计入字段索引。超出范围的行或字段被忽略。
+	/// </summary>
+	/// <param name="data">文本数据。</param>
+	/// <param name="size">文本数据的长度。</param>
+	/// <param name="delimiter">字段分隔符。</param>
+	/// <param name="contents">待修改的数据。<行索引（从0开始），<字段索引（从0开始），新的字段值>></param>
+	/// <param name="patches">按偏移量升序排列的已定位修改。</param>
+	void LocateFieldPatches(const char* data, size_t size, const std::string& delimiter, const std::map<int, std::map<int, std::string>>& contents, std::vector<LocatedFieldPatch>& patches);
+
+	/// <summary>
+	/// 计算应用全部修改后文件大小的变化量。
+	/// </summary>
+	/// <param name="patches">已定位的修改。</param>
+	/// <returns>新文件大小减去原文件大小。</returns>
+	long long FieldPatchSizeDelta(const std::vector<LocatedFieldPatch>& patches);
+
+	/// <summary>
+	/// 在内存中应用全部修改。长度变化的修改之后的字节按累计长度差整段移动，不变的部分不做任何复制。
+	/// </summary>
+	/// <param name="data">文本数据，长度不能小于原大小和新大小中的较大值。</param>
+	/// <param name="old_size">原文本数据的长度。</param>
+	/// <param name="patches">按偏移量升序排列的已定位修改。</param>
+	void ApplyFieldPatches(char* data, size_t old_size, const std::vector<LocatedFieldPatch>& patches);
+
+	/// <summary>
+	/// 将已定位的修改应用到映射的文件并同步到磁盘。文件大小需要变化时只调整一次：变大时先扩展再重新映射，变小时解除映射后再截断。
+	/// </summary>
+	/// <param name="file">已打开的文件。</param>
+	/// <param name="rw_mmap">映射整个文件的内存映射，返回时已解除映射。</param>
+	/// <param name="old_size">原文件大小。</param>
+	/// <param name="patches">按偏移量升序排列的已定位修改。</param>
+	/// <param name="error">错误信息。</param>
+	/// <returns>是否完成修改操作。</returns>
+	bool CommitFieldPatches(const NativeFile& file, mio::mmap_sink& rw_mmap, long long old_size, const std::vector<LocatedFieldPatch>& patches, std::error_code& error);
+
+	/// <summary>
+	/// 多线程批量修改文件中的字段值。文件按字节均分为若干行区间，各线程先并行统计行数确定各区间的起始行索引，
+	/// 再各自定位区间内的修改，长度不变的直接写入共享的映射区，长度变化的最后统一移动，整个文件只同步一次。
+	/// </summary>
+	/// <param name="path">要修改的文件。</param>
+	/// <param name="delimiter">字段分隔符。</param>
+	/// <param name="patches">按行索引、字段索引升序排列的修改。</param>
+	/// <param name="thread_count">线程数。小于等于0表示使用线程池的默认并行度。</param>
+	/// <param name="error">错误信息。</param>
+	/// <returns>是否完成修改操作。</returns>
+	bool ParallelModifyFieldValues(const std::string& path, const std::string& delimiter, const std::vector<FieldPatch>& patches, int thread_count, std::error_code& error);
+}
@@ -0,0 +1,473 @@
+﻿#include "pch.h"
+#include <algorithm>
+#include <filesystem>
+#include "FileEditLog.h"
+#include "LineScanner.h"
+#include "ZoneMap.h"
+
+using namespace file_helpers_cpp;
+
+/// <summary>
+/// 获取原文件映射的数据。原文件为空时返回nullptr。
+/// </summary>
+/// <returns>原文件映射的数据。</returns>
+const char* FileEditLog::SourceData() const
+{
+	return source_mmap.is_mapped() ? source_mmap.data() : nullptr;
+}
+
+/// <summary>
+/// 获取原文件的大小。
+/// </summary>
+/// <returns>原文件的字节数。</returns>
+size_t FileEditLog::SourceSize() const
+{
+	return source_mmap.is_mapped() ? source_mmap.size() : 0;
+}
+
+/// <summary>
+/// 通过稀疏行索引获取原文件指定行的行首偏移量。
+/// </summary>
+/// <param name="line">原文件的行索引，等于行数时返回文件大小。</param>
+/// <returns>行首偏移量。</returns>
+size_t FileEditLog::SourceLineOffset(const size_t line) const
+{
+	if (line >= source_line_count)
+	{
+		return SourceSize();
+	}
+	// 从最近的索引点开始跳过不足一个间隔的行。
+	return SkipLines(SourceData(), line_offsets[line / kLineIndexStride], SourceSize(), line % kLineIndexStride);
+}
+
+/// <summary>
+/// 在编辑后内容的指定行处切分片段，保证该行是某个片段的第一行。
+/// </summary>
+/// <param name="line_index">编辑后内容的行索引。</param>
+/// <returns>以该行开始的片段的索引。行索引等于行数时返回片段数。</returns>
+size_t FileEditLog::SplitAt(const size_t line_index)
+{
+	size_t piece_begin = 0;
+	for (size_t i = 0; i < pieces.size(); i++)
+	{
+		if (line_index == piece_begin)
+		{
+			return i;
+		}
+		if (line_index < piece_begin + pieces[i].count)
+		{
+			const size_t head_count = line_index - piece_begin;
+			Piece tail = pieces[i];
+			tail.first += head_count;
+			tail.count -= head_count;
+			pieces[i].count = head_count;
+			pieces.insert(pieces.begin() + static_cast<std::ptrdiff_t>(i) + 1, tail);
+			return i + 1;
+		}
+		piece_begin += pieces[i].count;
+	}
+	return pieces.size();
+}
+
+/// <summary>
+/// 将编辑后的内容写入新文件。原文件的行整段复制，插入的行经缓冲区批量写入。
+/// </summary>
+/// <param name="write_path">要写入的文件。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否完成写入操作。</returns>
+bool FileEditLog::WriteTo(const std::string& write_path, std::error_code& error) const
+{
+	NativeFile target_file;
+	if (!target_file.Create(write_path, error))
+	{
+		return false;
+	}
+
+	const char* data = SourceData();
+	const size_t size = SourceSize();
+	long long offset = 0;
+	std::string buffer;
+	const auto flush = [&]
+	{
+		if (buffer.empty())
+		{
+			return true;
+		}
+		if (!target_file.WriteAt(offset, buffer.data(), buffer.size(), error))
+		{
+			return false;
+		}
+		offset += static_cast<long long>(buffer.size());
+		buffer.clear();
+		return true;
+	};
+
+	for (size_t i = 0; i < pieces.size(); i++)
+	{
+		const Piece& piece = pieces[i];
+		if (piece.inserted)
+		{
+			for (size_t k = 0; k < piece.count; k++)
+			{
+				if (buffer.size() >= kWriteBufferSize && !flush())
+				{
+					return false;
+				}
+				buffer += inserted_lines[piece.first + k];
+				buffer += line_ending;
+			}
+			continue;
+		}
+
+		// 原文件的连续行整段复制，不经过用户态缓冲区。
+		if (!flush())
+		{
+			return false;
+		}
+		const size_t begin = SourceLineOffset(piece.first);
+		size_t end = SourceLineOffset(piece.first + piece.count);
+
+		// 原文件不以换行符结尾时，编辑后的最后一行也不带换行符。
+		const bool is_last_piece = i + 1 == pieces.size();
+		if (is_last_piece && !source_ends_with_newline && end < size)
+		{
+			end -= end - 1 > begin && data[end - 2] == '\r' ? 2 : 1;
+		}
+		if (!target_file.CopyRangeFrom(source_file, static_cast<long long>(begin), offset, static_cast<long long>(end - begin), error))
+		{
+			return false;
+		}
+		offset += static_cast<long long>(end - begin);
+
+		// 原文件最后一行没有换行符且后面还有其他行时补上换行符。
+		if (end == size && !source_ends_with_newline && !is_last_piece)
+		{
+			buffer += line_ending;
+		}
+	}
+
+	// 以插入的行结尾时同样去掉最后的换行符。
+	if (!source_ends_with_newline && !pieces.empty() && pieces.back().inserted)
+	{
+		buffer.resize(buffer.size() - line_ending.size());
+	}
+	return flush();
+}
+
+/// <summary>
+/// 打开文件并建立稀疏行索引，清空编辑日志。
+/// </summary>
+/// <param name="path">文件路径。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否成功打开文件。</returns>
+bool FileEditLog::Open(const std::string& path, std::error_code& error)
+{
+	Close();
+	if (!source_file.OpenRead(path, error))
+	{
+		return false;
+	}
+	const long long file_size = source_file.Size(error);
+	if (file_size < 0)
+	{
+		return false;
+	}
+	if (file_size > 0)
+	{
+		source_mmap.map(source_file.NativeHandle(), 0, static_cast<size_t>(file_size), error);
+		if (error)
+		{
+			return false;
+		}
+	}
+	this->path = path;
+
+	const char* data = SourceData();
+	const size_t size = SourceSize();
+
+	// 一次扫描建立稀疏行索引并统计行数。
+	size_t pos = 0;
+	while (pos < size)
+	{
+		line_offsets.push_back(pos);
+		const size_t next = SkipLines(data, pos, size, kLineIndexStride);
+		if (next < size)
+		{
+			source_line_count += kLineIndexStride;
+			pos = next;
+			continue;
+		}
+		// 最后不足一个间隔的部分，没有换行符的最后一行也算一行。
+		source_line_count += CountLineEnds(data, pos, size) + (data[size - 1] != '\n' ? 1 : 0);
+		break;
+	}
+
+	if (size > 0)
+	{
+		source_ends_with_newline = data[size - 1] == '\n';
+		const size_t first_line_end = FindLineEnd(data, 0, size);
+		if (first_line_end < size && first_line_end > 0 && data[first_line_end - 1] == '\r')
+		{
+			line_ending = "\r\n";
+		}
+	}
+	if (source_line_count > 0)
+	{
+		pieces.push_back({ false, 0, source_line_count });
+	}
+	line_count = source_line_count;
+	return true;
+}
+
+/// <summary>
+/// 放弃未提交的编辑并关闭文件。
+/// </summary>
+void FileEditLog::Close()
+{
+	source_mmap.unmap();
+	source_file.Close();
+	path.clear();
+	line_offsets.clear();
+	source_line_count = 0;
+	source_ends_with_newline = true;
+	line_ending = "\n";
+	inserted_lines.clear();
+	pieces.clear();
+	line_count = 0;
+	modified = false;
+}
+
+/// <summary>
+/// 获取原文件路径。
+/// </summary>
+/// <returns>原文件路径。</returns>
+const std::string& FileEditLog::Path() const
+{
+	return path;
+}
+
+/// <summary>
+/// 获取编辑后的行数。
+/// </summary>
+/// <returns>编辑后的行数。</returns>
+size_t FileEditLog::LineCount() const
+{
+	return line_count;
+}
+
+/// <summary>
+/// 判断是否有未提交的编辑。
+/// </summary>
+/// <returns>是否有未提交的编辑。</returns>
+bool FileEditLog::IsModified() const
+{
+	return modified;
+}
+
+/// <summary>
+/// 在指定行之前插入若干行。
+/// </summary>
+/// <param name="line_index">插入位置的行索引，等于行数时追加到末尾。</param>
+/// <param name="lines">要插入的行（不含换行符）。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否完成插入操作。</returns>
+bool FileEditLog::InsertLines(const size_t line_index, const std::vector<std::string>& lines, std::error_code& error)
+{
+	if (line_index > line_count)
+	{
+		error = std::make_error_code(std::errc::invalid_argument);
+		return false;
+	}
+	if (lines.empty())
+	{
+		return true;
+	}
+
+	const size_t piece_index = SplitAt(line_index);
+	const size_t first = inserted_lines.size();
+	inserted_lines.insert(inserted_lines.end(), lines.begin(), lines.end());
+
+	// 紧接在上一次插入之后的连续插入合并到同一个片段。
+	if (piece_index > 0 && pieces[piece_index - 1].inserted && pieces[piece_index - 1].first + pieces[piece_index - 1].count == first)
+	{
+		pieces[piece_index - 1].count += lines.size();
+	}
+	else
+	{
+		pieces.insert(pieces.begin() + static_cast<std::ptrdiff_t>(piece_index), Piece{ true, first, lines.size() });
+	}
+	line_count += lines.size();
+	modified = true;
+	return true;
+}
+
+/// <summary>
+/// 从指定行开始删除若干行。
+/// </summary>
+/// <param name="line_index">要删除的第一行的行索引。</param>
+/// <param name="count">要删除的行数。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否完成删除操作。</returns>
+bool FileEditLog::DeleteLines(const size_t line_index, const size_t count, std::error_code& error)
+{
+	if (line_index > line_count || count > line_count - line_index)
+	{
+		error = std::make_error_code(std::errc::invalid_argument);
+		return false;
+	}
+	if (count == 0)
+	{
+		return true;
+	}
+
+	const size_t first_piece = SplitAt(line_index);
+	const size_t last_piece = SplitAt(line_index + count);
+	pieces.erase(pieces.begin() + static_cast<std::ptrdiff_t>(first_piece), pieces.begin() + static_cast<std::ptrdiff_t>(last_piece));
+	line_count -= count;
+	modified = true;
+	return true;
+}
+
+/// <summary>
+/// 通过编辑日志读取编辑后内容的若干行。
+/// </summary>
+/// <param name="line_index">要读取的第一行的行索引。</param>
+/// <param name="count">要读取的最大行数。</param>
+/// <param name="out_lines">读取的行（不含换行符）将追加到该向量。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否完成读取操作。</returns>
+bool FileEditLog::ReadLines(size_t line_index, size_t count, std::vector<std::string>& out_lines, std::error_code& error) const
+{
+	if (line_index > line_count)
+	{
+		error = std::make_error_code(std::errc::invalid_argument);
+		return false;
+	}
+
+	const char* data = SourceData();
+	const size_t size = SourceSize();
+	size_t piece_begin = 0;
+	for (const auto& piece : pieces)
+	{
+		if (count == 0)
+		{
+			break;
+		}
+		const size_t piece_end = piece_begin + piece.count;
+		if (line_index < piece_end)
+		{
+			const size_t skip_count = line_index - piece_begin;
+			const size_t take_count = std::min(count, piece.count - skip_count);
+			if (piece.inserted)
+			{
+				const auto first = inserted_lines.begin() + static_cast<std::ptrdiff_t>(piece.first + skip_count);
+				out_lines.insert(out_lines.end(), first, first + static_cast<std::ptrdiff_t>(take_count));
+			}
+			else
+			{
+				// 只定位片段内的第一行，之后顺序读取。
+				size_t pos = SourceLineOffset(piece.first + skip_count);
+				for (size_t i = 0; i < take_count; i++)
+				{
+					const size_t line_end = FindLineEnd(data, pos, size);
+					const size_t content_end = line_end > pos && data[line_end - 1] == '\r' ? line_end - 1 : line_end;
+					out_lines.emplace_back(data + pos, content_end - pos);
+					pos = line_end + 1;
+				}
+			}
+			line_index += take_count;
+			count -= take_count;
+		}
+		piece_begin = piece_end;
+	}
+	return true;
+}
+
+/// <summary>
+/// 判断写入的文件是否就是原文件。
+/// </summary>
+/// <param name="write_path">要写入的文件。</param>
+/// <returns>是否就是原文件。</returns>
+bool FileEditLog::IsSourcePath(const std::string& write_path) const
+{
+	std::error_code equivalent_error;
+	return std::filesystem::equivalent(write_path, path, equivalent_error);
+}
+
+/// <summary>
+/// 获取提交到原文件时写入的临时文件路径。
+/// </summary>
+/// <returns>临时文件路径。</returns>
+std::string FileEditLog::CommitPath() const
+{
+	return path + ".commit";
+}
+
+/// <summary>
+/// 将编辑后的内容压缩写入新文件。写入的文件与原文件相同时写入临时文件，由ReplaceSource替换原文件。
+/// 只读取编辑日志和原文件，可以与ReadLines并发执行。
+/// </summary>
+/// <param name="write_path">要写入的文件。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否完成写入操作。</returns>
+bool FileEditLog::Compact(const std::string& write_path, std::error_code& error) const
+{
+	const bool in_place = IsSourcePath(write_path);
+	if (!WriteTo(in_place ? CommitPath() : write_path, error))
+	{
+		return false;
+	}
+	// 写入的文件内容已被替换，其区域映射不再有效。写入原文件时由ReplaceSource在替换成功后删除。
+	if (!in_place)
+	{
+		RemoveZoneMapSidecar(write_path);
+	}
+	return true;
+}
+
+/// <summary>
+/// 用Compact写入的临时文件替换原文件并重新打开，清空编辑日志。替换失败时原文件和编辑日志保持不变。
+/// </summary>
+/// <param name="error">错误信息。</param>
+/// <returns>是否完成替换操作。</returns>
+bool FileEditLog::ReplaceSource(std::error_code& error)
+{
+	const std::string source_path = path;
+	const std::string temp_path = CommitPath();
+
+	// 替换前先解除映射并关闭原文件，Windows上被映射的文件不能被替换。
+	const size_t source_size = SourceSize();
+	source_mmap.unmap();
+	source_file.Close();
+	std::filesystem::rename(temp_path, source_path, error);
+	if (error)
+	{
+		// 替换失败时原文件未变，重新映射原文件，编辑日志保留。
+		std::error_code reopen_error;
+		if (source_file.OpenRead(source_path, reopen_error) && source_size > 0)
+		{
+			source_mmap.map(source_file.NativeHandle(), 0, source_size, reopen_error);
+		}
+		std::filesystem::remove(temp_path, reopen_error);
+		return false;
+	}
+	RemoveZoneMapSidecar(source_path);
+	return Open(source_path, error);
+}
+
+/// <summary>
+/// 将编辑后的内容压缩写入新文件。写入的文件与原文件相同时，先写入临时文件，再替换原文件并重新打开。
+/// </summary>
+/// <param name="write_path">要写入的文件。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否完成提交操作。</returns>
+bool FileEditLog::Commit(const std::string& write_path, std::error_code& error)
+{
+	const bool in_place = IsSourcePath(write_path);
+	if (!Compact(write_path, error))
+	{
+		return false;
+	}
+	// 写入其他文件时原文件不变，编辑日志保留。
+	return !in_place || ReplaceSource(error);
+}
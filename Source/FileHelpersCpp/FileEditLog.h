@@ -0,0 +1,241 @@
+﻿#pragma once
+#include <string>
+#include <system_error>
+#include <vector>
+#include "mio.hpp"
+#include "NativeFile.h"
+
+namespace file_helpers_cpp
+{
+	/// <summary>
+	/// 记录对一个文本文件的行插入和删除操作的编辑日志。
+	/// 编辑后的内容表示为一组片段，每个片段引用原文件的一段连续行或一段插入的行，原文件本身在提交前不做任何修改。
+	/// 行索引按物理行计算（包含空行），最后一行没有换行符时也算一行。
+	/// </summary>
+	class FileEditLog
+	{
+	private:
+		/// <summary>
+		/// 稀疏行索引的间隔行数，每隔该行数记录一次行首偏移量。
+		/// </summary>
+		static constexpr size_t kLineIndexStride = 4096;
+
+		/// <summary>
+		/// 提交时插入行的写入缓冲区大小。
+		/// </summary>
+		static constexpr size_t kWriteBufferSize = 4 * 1024 * 1024;
+
+		/// <summary>
+		/// 表示编辑后内容中的一个片段。
+		/// </summary>
+		struct Piece
+		{
+			/// <summary>
+			/// 是否引用插入的行。否则引用原文件的行。
+			/// </summary>
+			bool inserted;
+
+			/// <summary>
+			/// 起始行在原文件或插入行中的索引。
+			/// </summary>
+			size_t first;
+
+			/// <summary>
+			/// 行数。
+			/// </summary>
+			size_t count;
+		};
+
+		/// <summary>
+		/// 原文件路径。
+		/// </summary>
+		std::string path;
+
+		/// <summary>
+		/// 原文件，提交时作为复制的源。
+		/// </summary>
+		NativeFile source_file;
+
+		/// <summary>
+		/// 原文件的只读映射，用于定位行和读取行。
+		/// </summary>
+		mio::mmap_source source_mmap;
+
+		/// <summary>
+		/// 稀疏行索引。第i项为原文件第i * kLineIndexStride行的行首偏移量。
+		/// </summary>
+		std::vector<size_t> line_offsets;
+
+		/// <summary>
+		/// 原文件的行数。
+		/// </summary>
+		size_t source_line_count = 0;
+
+		/// <summary>
+		/// 原文件是否以换行符结尾。空文件视为以换行符结尾。
+		/// </summary>
+		bool source_ends_with_newline = true;
+
+		/// <summary>
+		/// 插入行使用的换行符，与原文件第一行一致。
+		/// </summary>
+		std::string line_ending = "\n";
+
+		/// <summary>
+		/// 所有插入过的行（不含换行符），只追加不删除。
+		/// </summary>
+		std::vector<std::string> inserted_lines;
+
+		/// <summary>
+		/// 按顺序组成编辑后内容的片段。
+		/// </summary>
+		std::vector<Piece> pieces;
+
+		/// <summary>
+		/// 编辑后的行数。
+		/// </summary>
+		size_t line_count = 0;
+
+		/// <summary>
+		/// 是否有未提交的编辑。
+		/// </summary>
+		bool modified = false;
+
+		/// <summary>
+		/// 获取原文件映射的数据。原文件为空时返回nullptr。
+		/// </summary>
+		/// <returns>原文件映射的数据。</returns>
+		const char* SourceData() const;
+
+		/// <summary>
+		/// 获取原文件的大小。
+		/// </summary>
+		/// <returns>原文件的字节数。</returns>
+		size_t SourceSize() const;
+
+		/// <summary>
+		/// 通过稀疏行索引获取原文件指定行的行首偏移量。
+		/// </summary>
+		/// <param name="line">原文件的行索引，等于行数时返回文件大小。</param>
+		/// <returns>行首偏移量。</returns>
+		size_t SourceLineOffset(size_t line) const;
+
+		/// <summary>
+		/// 在编辑后内容的指定行处切分片段，保证该行是某个片段的第一行。
+		/// </summary>
+		/// <param name="line_index">编辑后内容的行索引。</param>
+		/// <returns>以该行开始的片段的索引。行索引等于行数时返回片段数。</returns>
+		size_t SplitAt(size_t line_index);
+
+		/// <summary>
+		/// 将编辑后的内容写入新文件。原文件的行整段复制，插入的行经缓冲区批量写入。
+		/// </summary>
+		/// <param name="write_path">要写入的文件。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否完成写入操作。</returns>
+		bool WriteTo(const std::string& write_path, std::error_code& error) const;
+
+		/// <summary>
+		/// 判断写入的文件是否就是原文件。
+		/// </summary>
+		/// <param name="write_path">要写入的文件。</param>
+		/// <returns>是否就是原文件。</returns>
+		bool IsSourcePath(const std::string& write_path) const;
+
+		/// <summary>
+		/// 获取提交到原文件时写入的临时文件路径。
+		/// </summary>
+		/// <returns>临时文件路径。</returns>
+		std::string CommitPath() const;
+
+	public:
+		FileEditLog() = default;
+
+		FileEditLog(const FileEditLog&) = delete;
+
+		FileEditLog& operator=(const FileEditLog&) = delete;
+
+		/// <summary>
+		/// 打开文件并建立稀疏行索引，清空编辑日志。
+		/// </summary>
+		/// <param name="path">文件路径。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否成功打开文件。</returns>
+		bool Open(const std::string& path, std::error_code& error);
+
+		/// <summary>
+		/// 放弃未提交的编辑并关闭文件。
+		/// </summary>
+		void Close();
+
+		/// <summary>
+		/// 获取原文件路径。
+		/// </summary>
+		/// <returns>原文件路径。</returns>
+		const std::string& Path() const;
+
+		/// <summary>
+		/// 获取编辑后的行数。
+		/// </summary>
+		/// <returns>编辑后的行数。</returns>
+		size_t LineCount() const;
+
+		/// <summary>
+		/// 判断是否有未提交的编辑。
+		/// </summary>
+		/// <returns>是否有未提交的编辑。</returns>
+		bool IsModified() const;
+
+		/// <summary>
+		/// 在指定行之前插入若干行。
+		/// </summary>
+		/// <param name="line_index">插入位置的行索引，等于行数时追加到末尾。</param>
+		/// <param name="lines">要插入的行（不含换行符）。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否完成插入操作。</returns>
+		bool InsertLines(size_t line_index, const std::vector<std::string>& lines, std::error_code& error);
+
+		/// <summary>
+		/// 从指定行开始删除若干行。
+		/// </summary>
+		/// <param name="line_index">要删除的第一行的行索引。</param>
+		/// <param name="count">要删除的行数。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否完成删除操作。</returns>
+		bool DeleteLines(size_t line_index, size_t count, std::error_code& error);
+
+		/// <summary>
+		/// 通过编辑日志读取编辑后内容的若干行。
+		/// </summary>
+		/// <param name="line_index">要读取的第一行的行索引。</param>
+		/// <param name="count">要读取的最大行数。</param>
+		/// <param name="out_lines">读取的行（不含换行符）将追加到该向量。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否完成读取操作。</returns>
+		bool ReadLines(size_t line_index, size_t count, std::vector<std::string>& out_lines, std::error_code& error) const;
+
+		/// <summary>
+		/// 将编辑后的内容压缩写入新文件。写入的文件与原文件相同时写入临时文件，由ReplaceSource替换原文件。
+		/// 只读取编辑日志和原文件，可以与ReadLines并发执行。
+		/// </summary>
+		/// <param name="write_path">要写入的文件。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否完成写入操作。</returns>
+		bool Compact(const std::string& write_path, std::error_code& error) const;
+
+		/// <summary>
+		/// 用Compact写入的临时文件替换原文件并重新打开，清空编辑日志。替换失败时原文件和编辑日志保持不变。
+		/// </summary>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否完成替换操作。</returns>
+		bool ReplaceSource(std::error_code& error);
+
+		/// <summary>
+		/// 将编辑后的内容压缩写入新文件。写入的文件与原文件相同时，先写入临时文件，再替换原文件并重新打开。
+		/// </summary>
+		/// <param name="write_path">要写入的文件。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否完成提交操作。</returns>
+		bool Commit(const std::string& write_path, std::error_code& error);
+	};
+}
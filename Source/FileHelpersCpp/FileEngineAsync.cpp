@@ -0,0 +1,216 @@
+﻿#include "pch.h"
+#include <cstdlib>
+#include <string_view>
+#include "FileEngineAsync.h"
+#include "NativeFile.h"
+#include "StringUtils.h"
+#include "ThreadPool.h"
+
+using namespace file_helpers_cpp;
+
+namespace
+{
+	/// <summary>
+	/// 每次从文件读取的字节数。
+	/// </summary>
+	constexpr size_t kReadBlockSize = 1024 * 1024;
+}
+
+/// <summary>
+/// 将任务提交到引擎共享的线程池执行。
+/// </summary>
+/// <param name="task">要执行的任务。</param>
+void AsyncFileExecutor::Post(std::function<void()> task)
+{
+	ThreadPool::Shared()->Submit(std::move(task));
+}
+
+DelimitedRecordReader::DelimitedRecordReader()
+	: file(new NativeFile())
+{
+}
+
+/// <summary>
+/// 析构函数。
+/// </summary>
+DelimitedRecordReader::~DelimitedRecordReader() = default;
+
+/// <summary>
+/// 打开要读取的文件。
+/// </summary>
+/// <param name="path">文件路径。</param>
+/// <param name="delimiter">分隔符。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否成功打开文件。</returns>
+bool DelimitedRecordReader::Open(const std::string& path, const std::string& delimiter, std::error_code error)
+{
+	try
+	{
+		Close();
+		this->delimiter = delimiter;
+		return file->OpenRead(path, error);
+	}
+	catch (std::exception& ex)
+	{
+		auto msg = ex.what();
+		return false;
+	}
+}
+
+/// <summary>
+/// 关闭文件。
+/// </summary>
+void DelimitedRecordReader::Close()
+{
+	file->Close();
+	std::string().swap(buffer);
+	buffer_begin = 0;
+	file_offset = 0;
+	end_of_file = false;
+}
+
+/// <summary>
+/// 判断是否已读取完所有记录。
+/// </summary>
+/// <returns>是否已读取完所有记录。</returns>
+bool DelimitedRecordReader::IsEnd() const
+{
+	return end_of_file && buffer_begin >= buffer.size();
+}
+
+/// <summary>
+/// 读取下一行的内容，不含换行符。
+/// </summary>
+/// <param name="line_begin">行在buffer中的起始位置。</param>
+/// <param name="line_size">行的长度。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否读取到一行。</returns>
+bool DelimitedRecordReader::NextLine(size_t& line_begin, size_t& line_size, std::error_code& error)
+{
+	size_t search_begin = buffer_begin;
+	while (true)
+	{
+		const size_t line_end = buffer.find('\n', search_begin);
+		if (line_end != std::string::npos)
+		{
+			line_begin = buffer_begin;
+			line_size = line_end - buffer_begin;
+			buffer_begin = line_end + 1;
+			return true;
+		}
+
+		if (end_of_file)
+		{
+			// 最后一行没有换行符。
+			if (buffer_begin >= buffer.size())
+			{
+				return false;
+			}
+			line_begin = buffer_begin;
+			line_size = buffer.size() - buffer_begin;
+			buffer_begin = buffer.size();
+			return true;
+		}
+
+		// 丢弃已解析的内容，把未读完的行移到缓冲区开头后继续读取。
+		buffer.erase(0, buffer_begin);
+		search_begin = buffer.size();
+		buffer_begin = 0;
+
+		const size_t old_size = buffer.size();
+		buffer.resize(old_size + kReadBlockSize);
+		const long long read_size = file->ReadAt(file_offset, &buffer[old_size], kReadBlockSize, error);
+		if (read_size < 0)
+		{
+			buffer.resize(old_size);
+			return false;
+		}
+		buffer.resize(old_size + static_cast<size_t>(read_size));
+		file_offset += read_size;
+		end_of_file = read_size == 0;
+	}
+}
+
+/// <summary>
+/// 按批读取记录，将每行的字段视图转换为记录。
+/// </summary>
+template <typename T, typename Convert>
+bool DelimitedRecordReader::ReadRecords(std::vector<std::vector<T>>& out_records, const size_t max_records, Convert convert, std::error_code& error)
+{
+	out_records.clear();
+	std::vector<std::string_view> fields;
+	size_t line_begin = 0;
+	size_t line_size = 0;
+	while (out_records.size() < max_records && NextLine(line_begin, line_size, error))
+	{
+		std::string_view line(buffer.data() + line_begin, line_size);
+		if (!line.empty() && line.back() == '\r')
+		{
+			line.remove_suffix(1);
+		}
+		// 空行判断
+		if (line.empty())
+		{
+			continue;
+		}
+
+		SplitViews(line, delimiter, fields, true);
+		std::vector<T> record;
+		record.reserve(fields.size());
+		for (const auto& field : fields)
+		{
+			record.push_back(convert(field));
+		}
+		out_records.push_back(std::move(record));
+	}
+	return !error && !out_records.empty();
+}
+
+/// <summary>
+/// 读取下一批记录到一个字符串类型的二维向量。
+/// </summary>
+/// <param name="out_records">读取的记录，读取前清空。</param>
+/// <param name="max_records">最多读取的记录数。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否读取到记录。已读取完或读取失败时返回false，通过IsEnd区分。</returns>
+bool DelimitedRecordReader::ReadBatch(std::vector<std::vector<std::string>>& out_records, const size_t max_records, std::error_code error)
+{
+	try
+	{
+		return ReadRecords(out_records, max_records, [](const std::string_view field)
+		{
+			return std::string(field);
+		}, error);
+	}
+	catch (std::exception& ex)
+	{
+		auto msg = ex.what();
+		return false;
+	}
+}
+
+/// <summary>
+/// 读取下一批记录到一个double类型的二维向量。
+/// </summary>
+/// <param name="out_records">读取的记录，读取前清空。</param>
+/// <param name="max_records">最多读取的记录数。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否读取到记录。已读取完或读取失败时返回false，通过IsEnd区分。</returns>
+bool DelimitedRecordReader::ReadBatch(std::vector<std::vector<double>>& out_records, const size_t max_records, std::error_code error)
+{
+	try
+	{
+		// 与SplitIntoDouble一致，按atof的规则转换。
+		std::string text;
+		return ReadRecords(out_records, max_records, [&text](const std::string_view field)
+		{
+			text.assign(field.data(), field.size());
+			return atof(text.c_str());
+		}, error);
+	}
+	catch (std::exception& ex)
+	{
+		auto msg = ex.what();
+		return false;
+	}
+}
@@ -0,0 +1,308 @@
+﻿#pragma once
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace file_helpers_cpp
+{
+	class NativeFile;
+
+	/// <summary>
+	/// 表示异步文件操作的执行器。任务在引擎共享的线程池中执行。
+	/// </summary>
+	class __declspec(dllexport) AsyncFileExecutor
+	{
+	public:
+		/// <summary>
+		/// 将任务提交到引擎共享的线程池执行。
+		/// </summary>
+		/// <param name="task">要执行的任务。</param>
+		static void Post(std::function<void()> task);
+	};
+
+	/// <summary>
+	/// 表示异步读取操作的结果。
+	/// </summary>
+	template <typename T>
+	struct AsyncResult
+	{
+		/// <summary>
+		/// 是否完成读取操作。
+		/// </summary>
+		bool succeeded = false;
+
+		/// <summary>
+		/// 读取的内容。
+		/// </summary>
+		T value;
+	};
+
+	/// <summary>
+	/// 表示可以co_await的异步文件操作。co_await时才将操作提交到线程池，操作完成后协程在线程池的线程上恢复执行，
+	/// 等待期间不占用调用协程的执行器线程。操作引用的引擎在co_await完成前必须保持有效，写入内容由操作持有。
+	/// </summary>
+	template <typename T>
+	class FileOperation
+	{
+	private:
+		/// <summary>
+		/// 在线程池中执行的同步操作。
+		/// </summary>
+		std::function<T()> work;
+
+		/// <summary>
+		/// 操作的结果。
+		/// </summary>
+		std::optional<T> result;
+
+		/// <summary>
+		/// 操作抛出的异常，在co_await处重新抛出。
+		/// </summary>
+		std::exception_ptr exception;
+
+	public:
+		/// <summary>
+		/// 有参构造函数。
+		/// </summary>
+		/// <param name="work">在线程池中执行的同步操作。</param>
+		explicit FileOperation(std::function<T()> work)
+			: work(std::move(work))
+		{
+		}
+
+		bool await_ready() const noexcept
+		{
+			return false;
+		}
+
+		void await_suspend(const std::coroutine_handle<> handle)
+		{
+			AsyncFileExecutor::Post([this, handle]
+			{
+				try
+				{
+					result.emplace(work());
+				}
+				catch (...)
+				{
+					exception = std::current_exception();
+				}
+				handle.resume();
+			});
+		}
+
+		T await_resume()
+		{
+			if (exception)
+			{
+				std::rethrow_exception(exception);
+			}
+			return std::move(*result);
+		}
+	};
+
+	/// <summary>
+	/// 表示按批读取带分隔符的文本行记录的读取器。每次读取固定大小的文件块，只保留未读完的行，内存占用与文件大小无关。
+	/// 空行不计入记录，最后一行没有换行符时也作为一条记录。
+	/// </summary>
+	class __declspec(dllexport) DelimitedRecordReader
+	{
+	private:
+		/// <summary>
+		/// 要读取的文件。
+		/// </summary>
+		std::unique_ptr<NativeFile> file;
+
+		/// <summary>
+		/// 分隔符。
+		/// </summary>
+		std::string delimiter;
+
+		/// <summary>
+		/// 已从文件读取、尚未解析的内容从buffer_begin开始。
+		/// </summary>
+		std::string buffer;
+
+		/// <summary>
+		/// buffer中未解析内容的起始位置。
+		/// </summary>
+		size_t buffer_begin = 0;
+
+		/// <summary>
+		/// 下一次从文件读取的偏移量。
+		/// </summary>
+		long long file_offset = 0;
+
+		/// <summary>
+		/// 是否已读取到文件末尾。
+		/// </summary>
+		bool end_of_file = false;
+
+		/// <summary>
+		/// 读取下一行的内容，不含换行符。
+		/// </summary>
+		/// <param name="line_begin">行在buffer中的起始位置。</param>
+		/// <param name="line_size">行的长度。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否读取到一行。</returns>
+		bool NextLine(size_t& line_begin, size_t& line_size, std::error_code& error);
+
+		/// <summary>
+		/// 按批读取记录，将每行的字段视图转换为记录。
+		/// </summary>
+		template <typename T, typename Convert>
+		bool ReadRecords(std::vector<std::vector<T>>& out_records, size_t max_records, Convert convert, std::error_code& error);
+
+	public:
+		DelimitedRecordReader();
+
+		/// <summary>
+		/// 析构函数。
+		/// </summary>
+		~DelimitedRecordReader();
+
+		DelimitedRecordReader(const DelimitedRecordReader&) = delete;
+
+		DelimitedRecordReader& operator=(const DelimitedRecordReader&) = delete;
+
+		/// <summary>
+		/// 打开要读取的文件。
+		/// </summary>
+		/// <param name="path">文件路径。</param>
+		/// <param name="delimiter">分隔符。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否成功打开文件。</returns>
+		bool Open(const std::string& path, const std::string& delimiter, std::error_code error);
+
+		/// <summary>
+		/// 关闭文件。
+		/// </summary>
+		void Close();
+
+		/// <summary>
+		/// 判断是否已读取完所有记录。
+		/// </summary>
+		/// <returns>是否已读取完所有记录。</returns>
+		bool IsEnd() const;
+
+		/// <summary>
+		/// 读取下一批记录到一个字符串类型的二维向量。
+		/// </summary>
+		/// <param name="out_records">读取的记录，读取前清空。</param>
+		/// <param name="max_records">最多读取的记录数。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否读取到记录。已读取完或读取失败时返回false，通过IsEnd区分。</returns>
+		bool ReadBatch(std::vector<std::vector<std::string>>& out_records, size_t max_records, std::error_code error);
+
+		/// <summary>
+		/// 读取下一批记录到一个double类型的二维向量。
+		/// </summary>
+		/// <param name="out_records">读取的记录，读取前清空。</param>
+		/// <param name="max_records">最多读取的记录数。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否读取到记录。已读取完或读取失败时返回false，通过IsEnd区分。</returns>
+		bool ReadBatch(std::vector<std::vector<double>>& out_records, size_t max_records, std::error_code error);
+	};
+
+	/// <summary>
+	/// 表示异步的记录生成器，每次co_await Next()在线程池中读取下一批记录。
+	/// <code>
+	/// auto stream = engine.ReadDoubleRecordsAsync(path);
+	/// while (co_await stream.Next())
+	/// {
+	///     for (auto&amp; record : stream.Batch()) { ... }
+	/// }
+	/// </code>
+	/// </summary>
+	template <typename T>
+	class RecordStream
+	{
+	private:
+		/// <summary>
+		/// 生成器的状态，由进行中的操作共同持有。
+		/// </summary>
+		struct State
+		{
+			DelimitedRecordReader reader;
+
+			std::string path;
+
+			std::string delimiter;
+
+			size_t batch_size = 0;
+
+			bool opened = false;
+
+			bool failed = false;
+
+			std::vector<std::vector<T>> batch;
+		};
+
+		std::shared_ptr<State> state;
+
+	public:
+		/// <summary>
+		/// 有参构造函数。文件在第一次co_await Next()时打开。
+		/// </summary>
+		/// <param name="path">文件路径。</param>
+		/// <param name="delimiter">分隔符。</param>
+		/// <param name="batch_size">每批读取的记录数。</param>
+		RecordStream(const std::string& path, const std::string& delimiter, const size_t batch_size)
+			: state(std::make_shared<State>())
+		{
+			state->path = path;
+			state->delimiter = delimiter;
+			state->batch_size = batch_size > 0 ? batch_size : 1;
+		}
+
+		/// <summary>
+		/// 读取下一批记录。
+		/// </summary>
+		/// <returns>可以co_await的操作，结果为是否读取到记录。已读取完或读取失败时为false，通过Failed区分。</returns>
+		FileOperation<bool> Next()
+		{
+			return FileOperation<bool>([state = state]
+			{
+				if (!state->opened)
+				{
+					state->opened = true;
+					if (!state->reader.Open(state->path, state->delimiter, std::error_code()))
+					{
+						state->failed = true;
+						return false;
+					}
+				}
+				const bool result = state->reader.ReadBatch(state->batch, state->batch_size, std::error_code());
+				if (!result && !state->reader.IsEnd())
+				{
+					state->failed = true;
+				}
+				return result;
+			});
+		}
+
+		/// <summary>
+		/// 获取最近一次读取的记录，可以移走。
+		/// </summary>
+		/// <returns>最近一次读取的记录。</returns>
+		std::vector<std::vector<T>>& Batch()
+		{
+			return state->batch;
+		}
+
+		/// <summary>
+		/// 判断读取是否失败。
+		/// </summary>
+		/// <returns>读取是否失败。</returns>
+		bool Failed() const
+		{
+			return state->failed;
+		}
+	};
+}
@@ -1,10 +1,42 @@
 #include "pch.h"
-#include <fstream>
+#include <sys/stat.h>
 #include "FileEngineBase.h"
+#include "NativeFile.h"
+#include "StatsCollector.h"
 #include "StringConverter.h"
+#include "ThreadPool.h"
 
 using namespace file_helpers_cpp;
 
+/// <summary>
+/// ͳϢʼ
+/// </summary>
+/// <param name="stats">ͳϢĶڲǰ뱣Ч</param>
+OperationProfiler::OperationProfiler(EngineStats& stats)
+	: collector(new StatsCollector<true>(&stats))
+{
+}
+
+/// <summary>
+/// δʱ
+/// </summary>
+OperationProfiler::~OperationProfiler()
+{
+	Finish();
+}
+
+/// <summary>
+/// дͳϢظʱֻеһЧ
+/// </summary>
+void OperationProfiler::Finish()
+{
+	if (collector)
+	{
+		collector->Finish();
+		collector.reset();
+	}
+}
+
 /// <summary>
 /// жļǷڡ
 /// </summary>
@@ -17,35 +49,43 @@ bool FileEngineBase::FileExists(const std::string& file_name) const
 }
 
 /// <summary>
-/// ָСԸģʽռ䣬ļʼļ
+/// ָСԸģʽռ䣬ļʼļʱС޹ء
 /// </summary>
 /// <param name="path">ļ·</param>
 /// <param name="size">ļС</param>
-void FileEngineBase::PreAllocateFile(const std::string& path, const long size) const
+/// <param name="mode">Ԥռķʽ</param>
+void FileEngineBase::PreAllocateFile(const std::string& path, const long long size, const PreAllocateMode mode) const
 {
-	std::ofstream outfile(path);
-	if (size > 0)
+	NativeFile file;
+	std::error_code error;
+	if (!file.Create(path, error))
 	{
-		const std::string s(size, '\0');
-		outfile << s;
+		return;
 	}
-	outfile.close();
+	file.PreAllocate(0, size, mode, error);
+	file.Close();
 }
 
 /// <summary>
-/// ָС׷ģʽռ䣬ļʼļ
+/// ָС׷ģʽļĩβռ䣬ļʼļʱС޹ء
 /// </summary>
 /// <param name="path">ļ·</param>
 /// <param name="size">ļС</param>
-void FileEngineBase::PreAllocateFileAppend(const std::string& path, const long size) const
+/// <param name="mode">ԤռķʽKeepSizeʾֻΪ׷ӱ̿ռ䣬ıļС</param>
+void FileEngineBase::PreAllocateFileAppend(const std::string& path, const long long size, const PreAllocateMode mode) const
 {
-	std::ofstream outfile(path, ios::app | ios::out);
-	if (size > 0)
+	NativeFile file;
+	std::error_code error;
+	if (!file.Open(path, error))
 	{
-		const std::string s(size, '\0');
-		outfile << s;
+		return;
 	}
-	outfile.close();
+	const long long current_size = file.Size(error);
+	if (current_size >= 0)
+	{
+		file.PreAllocate(current_size, size, mode, error);
+	}
+	file.Close();
 }
 
 /// <summary>
@@ -55,39 +95,154 @@ void FileEngineBase::PreAllocateFileAppend(const std::string& path, const long s
 /// <param name="error">Ϣ</param>
 /// <param name="size">ԤļС</param>
 /// <returns>ԤļǷɹ</returns>
-bool FileEngineBase::PreAllocateFileByMMF(const std::string& path, std::string& error, const long size) const
+bool FileEngineBase::PreAllocateFileByMMF(const std::string& path, std::string& error, const long long size) const
 {
 	if (path.empty())
 	{
 		return false;
 	}
-	const std::wstring wstr_path = ToWString(path);
-	const LPCWSTR file_path = wstr_path.c_str();
-	// create file
-	const HANDLE file_handle = CreateFile(file_path, GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
-	if (INVALID_HANDLE_VALUE == file_handle)
+
+	// ʼոǴļ
+	NativeFile file;
+	std::error_code native_error;
+	if (!file.Create(path, native_error))
 	{
-		error = StringFormat("error CreateFile( %s ) failed. gle = %u", ToString(file_path).c_str(), GetLastError());
+		error = StringFormat("error Create( %s ) failed. %s", path.c_str(), native_error.message().c_str());
 		return false;
 	}
 
-	LARGE_INTEGER file_size = {0};
-	//file_size.LowPart = 0;
-	//file_size.HighPart = 1;
-	file_size.QuadPart = size;
-
-	if (!SetFilePointerEx(file_handle, file_size, nullptr, FILE_BEGIN))
+	// ӳдǰô̿飬дӳʱ̿ռ䲻ʧܡ
+	if (!file.PreAllocate(0, size, PreAllocateMode::Allocate, native_error))
 	{
-		error = StringFormat("error SetFilePointerEx() failed. gle = %u", GetLastError());
-		CloseHandle(file_handle);
+		error = StringFormat("error PreAllocate() failed. %s", native_error.message().c_str());
 		return false;
 	}
 
-	SetEndOfFile(file_handle);
-	CloseHandle(file_handle);
+	file.Close();
 	return true;
+}
+
+/// <summary>
+/// 湲̳߳ءڽеĲеüʹԭ̳߳أ֮ĵʹ̳߳ء
+/// </summary>
+/// <param name="options">̳߳á</param>
+void FileEngineBase::ConfigureThreadPool(const ThreadPoolOptions& options)
+{
+	ThreadPool::Configure(options);
+}
 
-	//SetFilePointer(file_handle , size, nullptr, FILE_BEGIN);
-	//SetEndOfFile(file_handle );
-	//CloseHandle(file_handle );
+/// <summary>
+/// һıļȡļеıִ̳߳е첽汾co_awaitĽΪȡǷɺͶȡݡ
+/// </summary>
+/// <param name="path">ļ·</param>
+/// <returns>co_awaitĶȡco_awaitǰ뱣Ч</returns>
+FileOperation<AsyncResult<std::string>> FileEngineBase::ReadAllTextAsync(const std::string& path) const
+{
+	return FileOperation<AsyncResult<std::string>>([this, path]
+	{
+		AsyncResult<std::string> result;
+		result.succeeded = ReadAllText(path, result.value, std::error_code());
+		return result;
+	});
+}
+
+/// <summary>
+/// һıļȡļУִ̳߳е첽汾co_awaitĽΪȡǷɺͶȡݡ
+/// </summary>
+/// <param name="path">ļ·</param>
+/// <returns>co_awaitĶȡco_awaitǰ뱣Ч</returns>
+FileOperation<AsyncResult<std::vector<std::string>>> FileEngineBase::ReadAllLinesAsync(const std::string& path) const
+{
+	return FileOperation<AsyncResult<std::vector<std::string>>>([this, path]
+	{
+		AsyncResult<std::vector<std::string>> result;
+		result.succeeded = ReadAllLines(path, result.value, std::error_code());
+		return result;
+	});
+}
+
+/// <summary>
+/// һıļȡΪַ͵Ķάִ̳߳е첽汾co_awaitĽΪȡǷɺͶȡݡ
+/// </summary>
+/// <param name="path">ļ·</param>
+/// <returns>co_awaitĶȡco_awaitǰ뱣Ч</returns>
+FileOperation<AsyncResult<std::vector<std::vector<std::string>>>> FileEngineBase::ReadFileAsStringVectorAsync(const std::string& path) const
+{
+	return FileOperation<AsyncResult<std::vector<std::vector<std::string>>>>([this, path]
+	{
+		AsyncResult<std::vector<std::vector<std::string>>> result;
+		result.succeeded = ReadFileAsStringVector(path, result.value, std::error_code());
+		return result;
+	});
+}
+
+/// <summary>
+/// һıļȡΪdouble͵Ķάִ̳߳е첽汾co_awaitĽΪȡǷɺͶȡݡ
+/// </summary>
+/// <param name="path">ļ·</param>
+/// <returns>co_awaitĶȡco_awaitǰ뱣Ч</returns>
+FileOperation<AsyncResult<std::vector<std::vector<double>>>> FileEngineBase::ReadFileAsDoubleVectorAsync(const std::string& path) const
+{
+	return FileOperation<AsyncResult<std::vector<std::vector<double>>>>([this, path]
+	{
+		AsyncResult<std::vector<std::vector<double>>> result;
+		result.succeeded = ReadFileAsDoubleVector(path, result.value, std::error_code());
+		return result;
+	});
+}
+
+/// <summary>
+/// һļдִַָ̳߳е첽汾co_awaitĽΪǷд
+/// </summary>
+/// <param name="path">Ҫдļ</param>
+/// <param name="contents">Ҫдļַд÷ԴֵԱ⸴ơ</param>
+/// <returns>co_awaitдco_awaitǰ뱣Ч</returns>
+FileOperation<bool> FileEngineBase::WriteAllTextAsync(const std::string& path, std::string contents) const
+{
+	return FileOperation<bool>([this, path, contents = std::move(contents)]
+	{
+		return WriteAllText(path, contents, std::error_code());
+	});
+}
+
+/// <summary>
+/// һļдһַϣִ̳߳е첽汾co_awaitĽΪǷд
+/// </summary>
+/// <param name="path">Ҫдļ</param>
+/// <param name="contents">ҪдļСд÷ԴֵԱ⸴ơ</param>
+/// <returns>co_awaitдco_awaitǰ뱣Ч</returns>
+FileOperation<bool> FileEngineBase::WriteAllLinesAsync(const std::string& path, std::vector<std::string> contents) const
+{
+	return FileOperation<bool>([this, path, contents = std::move(contents)]
+	{
+		return WriteAllLines(path, contents, std::error_code());
+	});
+}
+
+/// <summary>
+/// һļдһַ͵Ķάļϣִ̳߳е첽汾co_awaitĽΪǷд
+/// </summary>
+/// <param name="path">Ҫдļ</param>
+/// <param name="contents">Ҫдļַ͵Ķάд÷ԴֵԱ⸴ơ</param>
+/// <returns>co_awaitдco_awaitǰ뱣Ч</returns>
+FileOperation<bool> FileEngineBase::WriteAllStringVectorAsync(const std::string& path, std::vector<std::vector<std::string>> contents) const
+{
+	return FileOperation<bool>([this, path, contents = std::move(contents)]
+	{
+		return WriteAllStringVector(path, contents, std::error_code());
+	});
+}
+
+/// <summary>
+/// һļдһdouble͵Ķάļϣִ̳߳е첽汾co_awaitĽΪǷд
+/// </summary>
+/// <param name="path">Ҫдļ</param>
+/// <param name="contents">Ҫдļdouble͵Ķάд÷ԴֵԱ⸴ơ</param>
+/// <returns>co_awaitдco_awaitǰ뱣Ч</returns>
+FileOperation<bool> FileEngineBase::WriteAllDoubleVectorAsync(const std::string& path, std::vector<std::vector<double>> contents) const
+{
+	return FileOperation<bool>([this, path, contents = std::move(contents)]
+	{
+		return WriteAllDoubleVector(path, contents, std::error_code());
+	});
 }
@@ -1,10 +1,409 @@
 ﻿#pragma once
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <memory>
 #include <string>
 #include <system_error>
 #include <vector>
+#include "FileEngineAsync.h"
+#include "FileEngineTrace.h"
 
 namespace file_helpers_cpp
 {
+	/// <summary>
+	/// 表示为文件预分配空间的方式。
+	/// </summary>
+	enum class PreAllocateMode
+	{
+		/// <summary>
+		/// 分配磁盘空间并扩展文件大小。Linux上使用fallocate，文件系统不支持时退化为posix_fallocate。
+		/// </summary>
+		Allocate,
+
+		/// <summary>
+		/// 只分配磁盘空间，不改变文件大小，适用于后续追加写入。文件系统不支持时不做任何操作。
+		/// </summary>
+		KeepSize,
+
+		/// <summary>
+		/// 只扩展文件大小，不分配磁盘空间（稀疏文件），扩展部分读取时为0。
+		/// </summary>
+		Sparse
+	};
+
+	/// <summary>
+	/// 表示引擎共享线程池的配置。所有并行模式（统计、解析、格式化、修改）共用同一个线程池，多个引擎调用同时进行时不会超额占用CPU核心。
+	/// </summary>
+	struct ThreadPoolOptions
+	{
+		/// <summary>
+		/// 工作线程数。小于等于0表示使用硬件并发数。
+		/// </summary>
+		int worker_count = 0;
+
+		/// <summary>
+		/// 单次调用的最大并行度。调用时未指定线程数（小于等于0）时使用该值，指定的线程数也不超过该值。小于等于0表示不限制，未指定线程数时等于工作线程数。
+		/// </summary>
+		int max_parallelism_per_call = 0;
+
+		/// <summary>
+		/// 是否将工作线程绑定到CPU核心。
+		/// </summary>
+		bool pin_workers = false;
+
+		/// <summary>
+		/// 工作线程依次绑定的CPU核心编号，为空时第i个工作线程绑定到第i个核心。只在pin_workers为true时生效。
+		/// </summary>
+		std::vector<int> cpu_ids;
+	};
+
+	/// <summary>
+	/// 表示长时间操作的进度。
+	/// </summary>
+	struct OperationProgress
+	{
+		/// <summary>
+		/// 已处理的字节数。
+		/// </summary>
+		long long bytes_processed = 0;
+
+		/// <summary>
+		/// 要处理的总字节数，未知时为-1。
+		/// </summary>
+		long long total_bytes = -1;
+
+		/// <summary>
+		/// 已处理的记录数。
+		/// </summary>
+		long long records_processed = 0;
+
+		/// <summary>
+		/// 已耗时，单位为秒。
+		/// </summary>
+		double elapsed_seconds = 0;
+
+		/// <summary>
+		/// 平均吞吐量，单位为字节每秒。
+		/// </summary>
+		double bytes_per_second = 0;
+	};
+
+	/// <summary>
+	/// 表示接收操作进度的回调。在执行操作的线程上调用，每处理一个数据块调用一次，完成时再调用一次。
+	/// </summary>
+	using ProgressSink = std::function<void(const OperationProgress& progress)>;
+
+	/// <summary>
+	/// 表示协作式取消的令牌。复制的令牌共享同一个取消状态，可以在任意线程调用Cancel，操作在处理下一个数据块前检查并尽快停止。
+	/// </summary>
+	class CancellationToken
+	{
+	private:
+		std::shared_ptr<std::atomic<bool>> cancelled;
+
+	public:
+		CancellationToken()
+			: cancelled(std::make_shared<std::atomic<bool>>(false))
+		{
+		}
+
+		/// <summary>
+		/// 请求取消。
+		/// </summary>
+		void Cancel() const
+		{
+			cancelled->store(true, std::memory_order_relaxed);
+		}
+
+		/// <summary>
+		/// 判断是否已请求取消。
+		/// </summary>
+		/// <returns>是否已请求取消。</returns>
+		bool IsCancelled() const
+		{
+			return cancelled->load(std::memory_order_relaxed);
+		}
+	};
+
+	/// <summary>
+	/// 表示读取操作的阶段。
+	/// </summary>
+	enum class EnginePhase
+	{
+		/// <summary>
+		/// 打开和映射文件。
+		/// </summary>
+		Map,
+
+		/// <summary>
+		/// 扫描换行符，切分出行。
+		/// </summary>
+		Scan,
+
+		/// <summary>
+		/// 按分隔符切分字段。
+		/// </summary>
+		Tokenize,
+
+		/// <summary>
+		/// 将字段文本转换为数值。
+		/// </summary>
+		Convert,
+
+		/// <summary>
+		/// 将记录存入结果向量，包括向量扩容。
+		/// </summary>
+		Store,
+
+		/// <summary>
+		/// 阶段数。
+		/// </summary>
+		Count
+	};
+
+	/// <summary>
+	/// 表示一次引擎调用的统计信息。每次调用开始时清零，按阶段记录耗时和处理量。
+	/// </summary>
+	struct EngineStats
+	{
+		/// <summary>
+		/// 各阶段的耗时，单位为纳秒，按EnginePhase索引。
+		/// </summary>
+		long long phase_nanoseconds[static_cast<size_t>(EnginePhase::Count)] = {};
+
+		/// <summary>
+		/// 调用的总耗时，单位为纳秒。
+		/// </summary>
+		long long total_nanoseconds = 0;
+
+		/// <summary>
+		/// 处理的字节数。
+		/// </summary>
+		long long bytes = 0;
+
+		/// <summary>
+		/// 处理的记录数。
+		/// </summary>
+		long long records = 0;
+
+		/// <summary>
+		/// 处理的字段数。
+		/// </summary>
+		long long fields = 0;
+
+		/// <summary>
+		/// 为结果分配的堆内存块数：记录向量、超出短字符串容量的字段和结果向量的每次扩容。
+		/// </summary>
+		long long allocations = 0;
+
+		/// <summary>
+		/// 调用期间的缺页次数。Linux上为当前线程的次缺页和主缺页之和，Windows上为进程的缺页次数。
+		/// </summary>
+		long long page_faults = 0;
+
+		/// <summary>
+		/// 调用期间需要读取磁盘的主缺页次数，只在Linux上统计。
+		/// </summary>
+		long long major_page_faults = 0;
+
+		/// <summary>
+		/// 硬件计数器是否可用。只在Linux上通过perf_event_open统计用户态和调用线程，内核不支持或perf_event_paranoid禁止时为false。
+		/// </summary>
+		bool hardware_counters = false;
+
+		/// <summary>
+		/// 执行的指令数，不可用时为-1。
+		/// </summary>
+		long long instructions = -1;
+
+		/// <summary>
+		/// CPU周期数，不可用时为-1。
+		/// </summary>
+		long long cycles = -1;
+
+		/// <summary>
+		/// 分支预测失败数，不可用时为-1。
+		/// </summary>
+		long long branch_misses = -1;
+
+		/// <summary>
+		/// 末级缓存未命中数，不可用时为-1。
+		/// </summary>
+		long long cache_misses = -1;
+
+		/// <summary>
+		/// 获取一个阶段的耗时。
+		/// </summary>
+		/// <param name="phase">阶段。</param>
+		/// <returns>耗时，单位为纳秒。</returns>
+		long long PhaseNanoseconds(const EnginePhase phase) const
+		{
+			return phase_nanoseconds[static_cast<size_t>(phase)];
+		}
+
+		/// <summary>
+		/// 获取每字节的指令数。
+		/// </summary>
+		/// <returns>每字节的指令数，指令数不可用或没有处理字节时为-1。</returns>
+		double InstructionsPerByte() const
+		{
+			return instructions >= 0 && bytes > 0 ? static_cast<double>(instructions) / static_cast<double>(bytes) : -1;
+		}
+	};
+
+	/// <summary>
+	/// 表示一列数值的统计信息。字段按分隔符切分，连续的分隔符视为一个，与读取为double类型二维向量时的列一致。
+	/// </summary>
+	struct ColumnStats
+	{
+		/// <summary>
+		/// 有效数值的个数。
+		/// </summary>
+		long long count = 0;
+
+		/// <summary>
+		/// 缺失的字段数：该行的字段数不足本列。
+		/// </summary>
+		long long null_count = 0;
+
+		/// <summary>
+		/// 无法完整解析为数值的字段数，包括nan。
+		/// </summary>
+		long long invalid_count = 0;
+
+		/// <summary>
+		/// 最小值，没有有效数值时为正无穷。
+		/// </summary>
+		double min = std::numeric_limits<double>::infinity();
+
+		/// <summary>
+		/// 最大值，没有有效数值时为负无穷。
+		/// </summary>
+		double max = -std::numeric_limits<double>::infinity();
+
+		/// <summary>
+		/// 有效数值的和。
+		/// </summary>
+		double sum = 0;
+
+		/// <summary>
+		/// 获取平均值。
+		/// </summary>
+		/// <returns>平均值，没有有效数值时为NaN。</returns>
+		double Mean() const
+		{
+			return count > 0 ? sum / static_cast<double>(count) : std::numeric_limits<double>::quiet_NaN();
+		}
+	};
+
+	/// <summary>
+	/// 表示一个文件各列的统计信息。
+	/// </summary>
+	struct TableStats
+	{
+		/// <summary>
+		/// 非空行数。
+		/// </summary>
+		long long row_count = 0;
+
+		/// <summary>
+		/// 各列的统计信息，列数为字段最多的行的字段数。
+		/// </summary>
+		std::vector<ColumnStats> columns;
+	};
+
+	/// <summary>
+	/// 表示按键列排序文件的选项。
+	/// </summary>
+	struct SortOptions
+	{
+		/// <summary>
+		/// 键列的字段索引（从0开始，以分隔符分割，连续的分隔符视为一个）。
+		/// </summary>
+		int key_column = 0;
+
+		/// <summary>
+		/// 是否将键解析为数值比较。为false时按字节比较。数值比较时无法解析或缺失的键总是排在最后，字节比较时缺失的键视为空串。
+		/// </summary>
+		bool numeric_key = true;
+
+		/// <summary>
+		/// 是否降序排列。
+		/// </summary>
+		bool descending = false;
+
+		/// <summary>
+		/// 内存预算（字节），小于等于0表示256MB。文件超过预算的一半，或每行32字节的排序项及同样大小的排序缓冲区超过预算的另一半时，分段排序并将各段写入临时文件，最后归并。
+		/// </summary>
+		long long memory_budget = 0;
+
+		/// <summary>
+		/// 临时文件所在的目录，为空时使用输出文件所在的目录。
+		/// </summary>
+		std::string temp_directory;
+
+		/// <summary>
+		/// 线程数。小于等于0表示使用线程池的默认并行度。
+		/// </summary>
+		int thread_count = 0;
+	};
+
+	template <bool kEnabled>
+	class StatsCollector;
+
+	/// <summary>
+	/// 测量任意引擎调用的总耗时、缺页次数和硬件计数器。对象存在期间调用线程上的操作计入统计，析构或调用Finish时写入结果。
+	/// 用于没有OperationControl参数的方法，例如在写入方法前后各构造和析构一次。
+	/// </summary>
+	class __declspec(dllexport) OperationProfiler
+	{
+	private:
+		std::unique_ptr<StatsCollector<true>> collector;
+
+	public:
+		/// <summary>
+		/// 清零统计信息并开始测量。
+		/// </summary>
+		/// <param name="stats">接收统计信息的对象，在测量结束前必须保持有效。</param>
+		explicit OperationProfiler(EngineStats& stats);
+
+		/// <summary>
+		/// 析构函数。尚未结束时结束测量。
+		/// </summary>
+		~OperationProfiler();
+
+		OperationProfiler(const OperationProfiler&) = delete;
+
+		OperationProfiler& operator=(const OperationProfiler&) = delete;
+
+		/// <summary>
+		/// 结束测量并写入统计信息。重复调用时只有第一次有效。
+		/// </summary>
+		void Finish();
+	};
+
+	/// <summary>
+	/// 表示对长时间操作的控制：可选的进度回调、取消令牌和统计信息。
+	/// </summary>
+	struct OperationControl
+	{
+		/// <summary>
+		/// 接收进度的回调，为空时不报告进度。
+		/// </summary>
+		ProgressSink progress;
+
+		/// <summary>
+		/// 取消令牌。
+		/// </summary>
+		CancellationToken cancellation;
+
+		/// <summary>
+		/// 接收统计信息的对象，为空时不统计。不统计时走没有计时代码的实现，没有额外开销。
+		/// </summary>
+		EngineStats* stats = nullptr;
+	};
+
 	/// <summary>
 	/// 表示读取文本行记录的引擎。内存映射文件的方式读取。
 	/// </summary>
@@ -24,18 +423,20 @@ namespace file_helpers_cpp
 		bool FileExists(const std::string& file_name) const;
 
 		/// <summary>
-		/// 按指定大小以覆盖模式分配空间，文件不存在则初始化文件。
+		/// 按指定大小以覆盖模式分配空间，文件不存在则初始化文件。耗时与分配大小无关。
 		/// </summary>
 		/// <param name="path">文件路径。</param>
 		/// <param name="size">分配的文件大小。</param>
-		void PreAllocateFile(const std::string& path, long size = 0) const;
+		/// <param name="mode">预分配空间的方式。</param>
+		void PreAllocateFile(const std::string& path, long long size = 0, PreAllocateMode mode = PreAllocateMode::Allocate) const;
 
 		/// <summary>
-		/// 按指定大小以追加模式分配空间，文件不存在则初始化文件。
+		/// 按指定大小以追加模式在文件末尾分配空间，文件不存在则初始化文件。耗时与分配大小无关。
 		/// </summary>
 		/// <param name="path">文件路径。</param>
 		/// <param name="size">分配的文件大小。</param>
-		void PreAllocateFileAppend(const std::string& path, long size) const;
+		/// <param name="mode">预分配空间的方式。KeepSize表示只为后续追加保留磁盘空间，不改变文件大小。</param>
+		void PreAllocateFileAppend(const std::string& path, long long size, PreAllocateMode mode = PreAllocateMode::Allocate) const;
 
 		/// <summary>
 		/// 按指定大小为文件预分配磁盘空间。内存映射文件时建议使用。
@@ -44,7 +445,13 @@ namespace file_helpers_cpp
 		/// <param name="error">错误信息。</param>
 		/// <param name="size">预分配的文件大小。</param>
 		/// <returns>预分配文件是否成功。</returns>
-		bool PreAllocateFileByMMF(const std::string& path, std::string& error, long size = 0) const;
+		bool PreAllocateFileByMMF(const std::string& path, std::string& error, long long size = 0) const;
+
+		/// <summary>
+		/// 配置所有引擎共享的线程池。正在进行的并行调用继续使用原线程池，之后的调用使用新线程池。
+		/// </summary>
+		/// <param name="options">线程池配置。</param>
+		static void ConfigureThreadPool(const ThreadPoolOptions& options);
 
 		/// <summary>
 		/// 统计一个文件的行数。
@@ -136,5 +543,92 @@ namespace file_helpers_cpp
 		/// <param name="error">错误信息。</param>
 		/// <returns>是否完成写入操作。</returns>
 		virtual bool WriteAllDoubleVector(const std::string& path, const std::vector<std::vector<double>>& contents, std::error_code error) const = 0;
+
+		/// <summary>
+		/// 打开一个文件，向其末尾追加一个字符串集合，然后关闭该文件。文件不存在则创建文件。
+		/// </summary>
+		/// <param name="path">要追加的文件。</param>
+		/// <param name="contents">要追加到文件中的行。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否完成追加操作。</returns>
+		virtual bool AppendAllLines(const std::string& path, const std::vector<std::string>& contents, std::error_code error) const = 0;
+
+		/// <summary>
+		/// 打开一个文件，向其末尾追加一个字符串类型的二维向量的集合，然后关闭该文件。文件不存在则创建文件。
+		/// </summary>
+		/// <param name="path">要追加的文件。</param>
+		/// <param name="contents">要追加到文件中的字符串类型的二维向量。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否完成追加操作。</returns>
+		virtual bool AppendStringVector(const std::string& path, const std::vector<std::vector<std::string>>& contents, std::error_code error) const = 0;
+
+		/// <summary>
+		/// 打开一个文件，向其末尾追加一个double类型的二维向量的集合，然后关闭该文件。文件不存在则创建文件。
+		/// </summary>
+		/// <param name="path">要追加的文件。</param>
+		/// <param name="contents">要追加到文件中的double类型的二维向量。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否完成追加操作。</returns>
+		virtual bool AppendDoubleVector(const std::string& path, const std::vector<std::vector<double>>& contents, std::error_code error) const = 0;
+
+		/// <summary>
+		/// 打开一个文本文件，读取文件中的所有文本，在线程池中执行的异步版本。co_await的结果为读取操作是否完成和读取的内容。
+		/// </summary>
+		/// <param name="path">文件路径。</param>
+		/// <returns>可以co_await的读取操作。co_await完成前引擎必须保持有效。</returns>
+		FileOperation<AsyncResult<std::string>> ReadAllTextAsync(const std::string& path) const;
+
+		/// <summary>
+		/// 打开一个文本文件，读取文件的所有行，在线程池中执行的异步版本。co_await的结果为读取操作是否完成和读取的内容。
+		/// </summary>
+		/// <param name="path">文件路径。</param>
+		/// <returns>可以co_await的读取操作。co_await完成前引擎必须保持有效。</returns>
+		FileOperation<AsyncResult<std::vector<std::string>>> ReadAllLinesAsync(const std::string& path) const;
+
+		/// <summary>
+		/// 打开一个文本文件，读取为字符串类型的二维向量，在线程池中执行的异步版本。co_await的结果为读取操作是否完成和读取的内容。
+		/// </summary>
+		/// <param name="path">文件路径。</param>
+		/// <returns>可以co_await的读取操作。co_await完成前引擎必须保持有效。</returns>
+		FileOperation<AsyncResult<std::vector<std::vector<std::string>>>> ReadFileAsStringVectorAsync(const std::string& path) const;
+
+		/// <summary>
+		/// 打开一个文本文件，读取为double类型的二维向量，在线程池中执行的异步版本。co_await的结果为读取操作是否完成和读取的内容。
+		/// </summary>
+		/// <param name="path">文件路径。</param>
+		/// <returns>可以co_await的读取操作。co_await完成前引擎必须保持有效。</returns>
+		FileOperation<AsyncResult<std::vector<std::vector<double>>>> ReadFileAsDoubleVectorAsync(const std::string& path) const;
+
+		/// <summary>
+		/// 创建一个新文件，写入指定的字符串，在线程池中执行的异步版本。co_await的结果为是否完成写入操作。
+		/// </summary>
+		/// <param name="path">要写入的文件。</param>
+		/// <param name="contents">要写入文件的字符串。移入写入操作，调用方可以传入右值以避免复制。</param>
+		/// <returns>可以co_await的写入操作。co_await完成前引擎必须保持有效。</returns>
+		FileOperation<bool> WriteAllTextAsync(const std::string& path, std::string contents) const;
+
+		/// <summary>
+		/// 创建一个新文件，写入一个字符串集合，在线程池中执行的异步版本。co_await的结果为是否完成写入操作。
+		/// </summary>
+		/// <param name="path">要写入的文件。</param>
+		/// <param name="contents">要写入文件的行。移入写入操作，调用方可以传入右值以避免复制。</param>
+		/// <returns>可以co_await的写入操作。co_await完成前引擎必须保持有效。</returns>
+		FileOperation<bool> WriteAllLinesAsync(const std::string& path, std::vector<std::string> contents) const;
+
+		/// <summary>
+		/// 创建一个新文件，写入一个字符串类型的二维向量的集合，在线程池中执行的异步版本。co_await的结果为是否完成写入操作。
+		/// </summary>
+		/// <param name="path">要写入的文件。</param>
+		/// <param name="contents">要写入文件的字符串类型的二维向量。移入写入操作，调用方可以传入右值以避免复制。</param>
+		/// <returns>可以co_await的写入操作。co_await完成前引擎必须保持有效。</returns>
+		FileOperation<bool> WriteAllStringVectorAsync(const std::string& path, std::vector<std::vector<std::string>> contents) const;
+
+		/// <summary>
+		/// 创建一个新文件，写入一个double类型的二维向量的集合，在线程池中执行的异步版本。co_await的结果为是否完成写入操作。
+		/// </summary>
+		/// <param name="path">要写入的文件。</param>
+		/// <param name="contents">要写入文件的double类型的二维向量。移入写入操作，调用方可以传入右值以避免复制。</param>
+		/// <returns>可以co_await的写入操作。co_await完成前引擎必须保持有效。</returns>
+		FileOperation<bool> WriteAllDoubleVectorAsync(const std::string& path, std::vector<std::vector<double>> contents) const;
 	};
 }
@@ -0,0 +1,320 @@
+﻿#include "pch.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include "FileEngineTrace.h"
+#include "TraceRecorder.h"
+
+using namespace file_helpers_cpp;
+
+namespace
+{
+	/// <summary>
+	/// 表示一块固定容量的事件存储。写满后由所属线程分配下一块并链接在后面。
+	/// </summary>
+	struct TraceBlock
+	{
+		static constexpr size_t kCapacity = 4096;
+
+		TraceEvent events[kCapacity];
+
+		/// <summary>
+		/// 已发布的事件数。所属线程以release写入，读取方以acquire读取。
+		/// </summary>
+		std::atomic<size_t> count{ 0 };
+
+		std::atomic<TraceBlock*> next{ nullptr };
+	};
+
+	/// <summary>
+	/// 表示一个线程的事件缓冲区。
+	/// </summary>
+	struct TraceBuffer
+	{
+		TraceBlock first_block;
+
+		/// <summary>
+		/// 当前写入的块，只由所属线程访问。
+		/// </summary>
+		TraceBlock* tail = &first_block;
+
+		/// <summary>
+		/// 缓冲区中事件所属的跟踪序号。
+		/// </summary>
+		std::atomic<unsigned long long> session{ 0 };
+
+		/// <summary>
+		/// 输出时使用的线程编号。
+		/// </summary>
+		unsigned int thread_index = 0;
+
+		/// <summary>
+		/// 全局链表中的下一个缓冲区，加入链表后不再修改。
+		/// </summary>
+		TraceBuffer* next_buffer = nullptr;
+	};
+
+	/// <summary>
+	/// 所有线程缓冲区组成的链表。
+	/// </summary>
+	std::atomic<TraceBuffer*> trace_buffers{ nullptr };
+
+	/// <summary>
+	/// 当前的跟踪序号，每次Start加一。
+	/// </summary>
+	std::atomic<unsigned long long> trace_session{ 0 };
+
+	/// <summary>
+	/// 当前跟踪开始的时间，单位为纳秒。
+	/// </summary>
+	std::atomic<long long> trace_start_nanoseconds{ 0 };
+
+	std::atomic<unsigned int> trace_thread_count{ 0 };
+
+	long long SteadyNanoseconds()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	/// <summary>
+	/// 获取当前线程的缓冲区，第一次调用时分配并加入链表。
+	/// </summary>
+	TraceBuffer& CurrentThreadBuffer()
+	{
+		thread_local TraceBuffer* buffer = nullptr;
+		if (!buffer)
+		{
+			buffer = new TraceBuffer();
+			buffer->thread_index = ++trace_thread_count;
+			buffer->next_buffer = trace_buffers.load(std::memory_order_relaxed);
+			while (!trace_buffers.compare_exchange_weak(buffer->next_buffer, buffer, std::memory_order_release, std::memory_order_relaxed))
+			{
+			}
+		}
+		return *buffer;
+	}
+
+	/// <summary>
+	/// 遍历属于当前跟踪的所有事件。
+	/// </summary>
+	template <typename Visitor>
+	void ForEachEvent(const Visitor& visitor)
+	{
+		const unsigned long long session = trace_session.load(std::memory_order_acquire);
+		for (const TraceBuffer* buffer = trace_buffers.load(std::memory_order_acquire); buffer; buffer = buffer->next_buffer)
+		{
+			if (buffer->session.load(std::memory_order_acquire) != session)
+			{
+				continue;
+			}
+			for (const TraceBlock* block = &buffer->first_block; block; block = block->next.load(std::memory_order_acquire))
+			{
+				const size_t count = block->count.load(std::memory_order_acquire);
+				for (size_t i = 0; i < count; i++)
+				{
+					visitor(buffer->thread_index, block->events[i]);
+				}
+			}
+		}
+	}
+
+	/// <summary>
+	/// 将纳秒格式化为Chrome Trace Event格式使用的微秒。
+	/// </summary>
+	std::string FormatMicroseconds(const long long nanoseconds)
+	{
+		char buffer[32];
+		std::snprintf(buffer, sizeof(buffer), "%lld.%03lld", nanoseconds / 1000, nanoseconds % 1000);
+		return buffer;
+	}
+}
+
+std::atomic<bool> TraceRecorder::enabled{ false };
+
+/// <summary>
+/// 获取相对于跟踪开始的当前时间。
+/// </summary>
+/// <returns>时间，单位为纳秒。</returns>
+long long TraceRecorder::Now()
+{
+	return SteadyNanoseconds() - trace_start_nanoseconds.load(std::memory_order_relaxed);
+}
+
+/// <summary>
+/// 记录当前线程上一个已结束的区间。缓冲区属于之前的跟踪时先清空。
+/// </summary>
+/// <param name="event">区间。</param>
+void TraceRecorder::Record(const TraceEvent& event)
+{
+	TraceBuffer& buffer = CurrentThreadBuffer();
+	const unsigned long long session = trace_session.load(std::memory_order_acquire);
+	if (buffer.session.load(std::memory_order_relaxed) != session)
+	{
+		for (TraceBlock* block = &buffer.first_block; block; block = block->next.load(std::memory_order_relaxed))
+		{
+			block->count.store(0, std::memory_order_relaxed);
+		}
+		buffer.tail = &buffer.first_block;
+		buffer.session.store(session, std::memory_order_release);
+	}
+
+	TraceBlock* block = buffer.tail;
+	size_t count = block->count.load(std::memory_order_relaxed);
+	if (count == TraceBlock::kCapacity)
+	{
+		TraceBlock* next = block->next.load(std::memory_order_relaxed);
+		if (!next)
+		{
+			next = new TraceBlock();
+			block->next.store(next, std::memory_order_release);
+		}
+		buffer.tail = next;
+		block = next;
+		count = 0;
+	}
+	block->events[count] = event;
+	block->count.store(count + 1, std::memory_order_release);
+}
+
+/// <summary>
+/// 开始新的跟踪。
+/// </summary>
+void TraceRecorder::Start()
+{
+	trace_start_nanoseconds.store(SteadyNanoseconds(), std::memory_order_relaxed);
+	trace_session.fetch_add(1, std::memory_order_acq_rel);
+	enabled.store(true, std::memory_order_release);
+}
+
+/// <summary>
+/// 停止跟踪。
+/// </summary>
+void TraceRecorder::Stop()
+{
+	enabled.store(false, std::memory_order_release);
+}
+
+/// <summary>
+/// 获取本次跟踪已记录的事件数。
+/// </summary>
+size_t TraceRecorder::EventCount()
+{
+	size_t count = 0;
+	ForEachEvent([&count](unsigned int, const TraceEvent&) { count++; });
+	return count;
+}
+
+/// <summary>
+/// 将本次跟踪的事件格式化为Chrome Trace Event格式的JSON。每个区间输出为一个完整事件（ph为X），每个线程输出一个线程名称。
+/// </summary>
+std::string TraceRecorder::ToChromeTraceJson()
+{
+	std::string json = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+	bool first = true;
+	unsigned int named_threads = 0;
+	ForEachEvent([&](const unsigned int thread_index, const TraceEvent& event)
+	{
+		json += first ? "\n" : ",\n";
+		first = false;
+		json += "{\"name\":\"";
+		json += event.name;
+		json += "\",\"cat\":\"";
+		json += event.category;
+		json += "\",\"ph\":\"X\",\"pid\":1,\"tid\":";
+		json += std::to_string(thread_index);
+		json += ",\"ts\":";
+		json += FormatMicroseconds(event.begin_nanoseconds);
+		json += ",\"dur\":";
+		json += FormatMicroseconds(event.end_nanoseconds - event.begin_nanoseconds);
+		if (event.arg_name)
+		{
+			json += ",\"args\":{\"";
+			json += event.arg_name;
+			json += "\":";
+			json += std::to_string(event.arg_value);
+			json += "}";
+		}
+		json += "}";
+		named_threads = std::max(named_threads, thread_index);
+	});
+
+	for (unsigned int thread_index = 1; thread_index <= named_threads; thread_index++)
+	{
+		json += first ? "\n" : ",\n";
+		first = false;
+		json += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(thread_index)
+			+ ",\"args\":{\"name\":\"thread " + std::to_string(thread_index) + "\"}}";
+	}
+	json += "\n]}\n";
+	return json;
+}
+
+/// <summary>
+/// 开始新的跟踪，之前记录的事件被丢弃。
+/// </summary>
+void EngineTracer::Start()
+{
+	TraceRecorder::Start();
+}
+
+/// <summary>
+/// 停止跟踪。已记录的事件保留到下一次Start。
+/// </summary>
+void EngineTracer::Stop()
+{
+	TraceRecorder::Stop();
+}
+
+/// <summary>
+/// 获取是否正在跟踪。
+/// </summary>
+/// <returns>是否正在跟踪。</returns>
+bool EngineTracer::IsEnabled()
+{
+	return TraceRecorder::Enabled();
+}
+
+/// <summary>
+/// 获取本次跟踪已记录的事件数。
+/// </summary>
+/// <returns>事件数。</returns>
+size_t EngineTracer::EventCount()
+{
+	return TraceRecorder::EventCount();
+}
+
+/// <summary>
+/// 将本次跟踪的事件格式化为Chrome Trace Event格式的JSON。
+/// </summary>
+/// <returns>JSON文本。</returns>
+std::string EngineTracer::ToChromeTraceJson()
+{
+	return TraceRecorder::ToChromeTraceJson();
+}
+
+/// <summary>
+/// 将本次跟踪的事件写入文件。
+/// </summary>
+/// <param name="path">要写入的文件。如果目标文件已存在，则覆盖该文件。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否完成写入操作。</returns>
+bool EngineTracer::WriteChromeTrace(const std::string& path, std::error_code error)
+{
+	try
+	{
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			error = std::make_error_code(std::errc::bad_file_descriptor);
+			return false;
+		}
+		file << TraceRecorder::ToChromeTraceJson();
+		return static_cast<bool>(file);
+	}
+	catch (std::exception& ex)
+	{
+		auto msg = ex.what();
+		return false;
+	}
+}
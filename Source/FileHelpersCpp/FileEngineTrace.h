@@ -0,0 +1,51 @@
+﻿#pragma once
+#include <string>
+#include <system_error>
+
+namespace file_helpers_cpp
+{
+	/// <summary>
+	/// 表示引擎内部各阶段的时间线跟踪器：记录块扫描、解析、格式化、写入和等待区间的开始与结束，
+	/// 导出为chrome://tracing和Perfetto可以打开的JSON。默认关闭，关闭时每个区间只有一次原子读取的开销。
+	/// 每个线程把事件写入自己的缓冲区，记录事件不加锁。
+	/// </summary>
+	class __declspec(dllexport) EngineTracer
+	{
+	public:
+		/// <summary>
+		/// 开始新的跟踪，之前记录的事件被丢弃。
+		/// </summary>
+		static void Start();
+
+		/// <summary>
+		/// 停止跟踪。已记录的事件保留到下一次Start。
+		/// </summary>
+		static void Stop();
+
+		/// <summary>
+		/// 获取是否正在跟踪。
+		/// </summary>
+		/// <returns>是否正在跟踪。</returns>
+		static bool IsEnabled();
+
+		/// <summary>
+		/// 获取本次跟踪已记录的事件数。
+		/// </summary>
+		/// <returns>事件数。</returns>
+		static size_t EventCount();
+
+		/// <summary>
+		/// 将本次跟踪的事件格式化为Chrome Trace Event格式的JSON。应在Stop之后、被跟踪的操作都结束时调用。
+		/// </summary>
+		/// <returns>JSON文本。</returns>
+		static std::string ToChromeTraceJson();
+
+		/// <summary>
+		/// 将本次跟踪的事件写入文件，可以直接在chrome://tracing或ui.perfetto.dev中打开。应在Stop之后、被跟踪的操作都结束时调用。
+		/// </summary>
+		/// <param name="path">要写入的文件。如果目标文件已存在，则覆盖该文件。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否完成写入操作。</returns>
+		static bool WriteChromeTrace(const std::string& path, std::error_code error);
+	};
+}
@@ -1,11 +1,34 @@
 ﻿#include "pch.h"
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <system_error>
 #include "mio.hpp"
 #include "FileMMFEngineBase.h"
+#include "MappedFileAppender.h"
+#include "MmapFlusher.h"
+#include "RecordFormatter.h"
 
 using namespace file_helpers_cpp;
 
+/// <summary>
+/// 设置内存映射写入的刷新策略。
+/// </summary>
+/// <param name="policy">刷新策略。</param>
+void FileMmfEngineBase::SetFlushPolicy(const MmapFlushPolicy& policy)
+{
+	flush_policy = policy;
+}
+
+/// <summary>
+/// 获取内存映射写入的刷新策略。
+/// </summary>
+/// <returns>刷新策略。</returns>
+const MmapFlushPolicy& FileMmfEngineBase::GetFlushPolicy() const
+{
+	return flush_policy;
+}
+
 /// <summary>
 /// 统计一个文件的行数。
 /// </summary>
@@ -200,6 +223,7 @@ bool FileMmfEngineBase::WriteAllLines(const std::string& path, const std::vector
 	{
 		return false;
 	}
+	MmapFlusher flusher(rw_mmap, flush_policy);
 	int index = 0;
 	for (const auto& line : contents)
 	{
@@ -212,8 +236,41 @@ bool FileMmfEngineBase::WriteAllLines(const std::string& path, const std::vector
 		index++;
 		rw_mmap[index] = '\n';
 		index++;
+
+		// 按刷新策略刷新已写入的脏数据。
+		flusher.Advance(index);
 	}
-	rw_mmap.sync(error);
+	flusher.Finish(error);
 	rw_mmap.unmap();
-	return true;
+	// 写入过程中或关闭前的刷新失败时，数据可能没有写入磁盘。
+	return !error;
 }
+
+/// <summary>
+/// 打开一个文件，向其末尾追加一个字符串集合，然后关闭该文件。文件不存在则创建文件。
+/// </summary>
+/// <param name="path">要追加的文件。</param>
+/// <param name="contents">要追加到文件中的行。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否完成追加操作。</returns>
+bool FileMmfEngineBase::AppendAllLines(const std::string& path, const std::vector<std::string>& contents, std::error_code error) const
+{
+	MappedFileAppender appender;
+	if (!appender.Open(path, error))
+	{
+		return false;
+	}
+
+	// 分块格式化后追加到文件末尾，换行符与WriteAllLines保持一致(\r\n)。
+	std::string buffer;
+	for (size_t begin = 0; begin < contents.size(); begin += kRecordFormatChunkRows)
+	{
+		const size_t end = std::min(begin + kRecordFormatChunkRows, contents.size());
+		FormatLineRange(contents, begin, end, "\r\n", buffer);
+		if (!appender.Append(buffer.data(), buffer.size(), error))
+		{
+			return false;
+		}
+	}
+	return appender.Close(error);
+}
\ No newline at end of file
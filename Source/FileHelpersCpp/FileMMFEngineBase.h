@@ -1,5 +1,8 @@
 ﻿#pragma once
+#include <future>
 #include <map>
+#include <memory>
+#include <shared_mutex>
 #include <string>
 #include <system_error>
 #include <vector>
@@ -7,6 +10,60 @@
 
 namespace file_helpers_cpp
 {
+	class FileEditLog;
+
+	/// <summary>
+	/// 表示内存映射写入时触发刷新（msync）的条件。
+	/// </summary>
+	enum class MmapFlushMode
+	{
+		/// <summary>
+		/// 每写入指定字节数的脏数据刷新一次。
+		/// </summary>
+		Bytes,
+
+		/// <summary>
+		/// 每隔指定时间刷新一次。
+		/// </summary>
+		Interval,
+
+		/// <summary>
+		/// 写入过程中不刷新，关闭前统一刷新。
+		/// </summary>
+		OnClose
+	};
+
+	/// <summary>
+	/// 表示内存映射写入的刷新策略。
+	/// </summary>
+	struct MmapFlushPolicy
+	{
+		/// <summary>
+		/// 触发刷新的条件。
+		/// </summary>
+		MmapFlushMode mode = MmapFlushMode::Bytes;
+
+		/// <summary>
+		/// 按字节数刷新时，每次刷新的脏数据字节数。
+		/// </summary>
+		size_t flush_bytes = 32 * 1024 * 1024;
+
+		/// <summary>
+		/// 按时间刷新时，两次刷新的间隔（毫秒）。
+		/// </summary>
+		int flush_interval_ms = 1000;
+
+		/// <summary>
+		/// 是否异步刷新（MS_ASYNC），只发起回写而不等待完成。关闭前的最终刷新始终是同步的。
+		/// </summary>
+		bool async = false;
+
+		/// <summary>
+		/// 是否由后台线程执行刷新，使脏页回写与格式化写入重叠进行。
+		/// </summary>
+		bool background = false;
+	};
+
 	/// <summary>
 	/// 表示读取文本行记录的引擎。内存映射文件的方式读取。
 	/// </summary>
@@ -17,7 +74,24 @@ namespace file_helpers_cpp
 
 		~FileMmfEngineBase() = default;
 
+		/// <summary>
+		/// 内存映射写入的刷新策略。
+		/// </summary>
+		MmapFlushPolicy flush_policy;
+
 	public:
+		/// <summary>
+		/// 设置内存映射写入的刷新策略。
+		/// </summary>
+		/// <param name="policy">刷新策略。</param>
+		void SetFlushPolicy(const MmapFlushPolicy& policy);
+
+		/// <summary>
+		/// 获取内存映射写入的刷新策略。
+		/// </summary>
+		/// <returns>刷新策略。</returns>
+		const MmapFlushPolicy& GetFlushPolicy() const;
+
 		/// <summary>
 		/// 统计一个文件的行数。
 		/// </summary>
@@ -74,7 +148,16 @@ namespace file_helpers_cpp
 		bool WriteAllLines(const std::string& path, const std::vector<std::string>& contents, std::error_code error) const override;
 
 		/// <summary>
-		/// 打开指定文件，批量修改指定行列字段的值，然后关闭该文件。新值和旧值长度一致，否则报内存映射文件异常。
+		/// 打开一个文件，向其末尾追加一个字符串集合，然后关闭该文件。文件不存在则创建文件。
+		/// </summary>
+		/// <param name="path">要追加的文件。</param>
+		/// <param name="contents">要追加到文件中的行。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否完成追加操作。</returns>
+		bool AppendAllLines(const std::string& path, const std::vector<std::string>& contents, std::error_code error) const override;
+
+		/// <summary>
+		/// 打开指定文件，批量修改指定行列字段的值，然后关闭该文件。新值和旧值长度可以不同。
 		/// </summary>
 		/// <param name="path">要修改的文件。</param>
 		/// <param name="contents">要修改文件的字符串类型的二维数据对。<行索引（从0开始），<字段索引（从0开始，以分隔符分割），新的字段值>></param>
@@ -82,4 +165,120 @@ namespace file_helpers_cpp
 		/// <returns>是否完成修改操作。</returns>
 		virtual bool BatchModifyFieldValues(const std::string& path, const std::map<int, std::map<int, std::string>>& contents, std::error_code error) const = 0;
 	};
+
+	/// <summary>
+	/// 表示对一个文本文件的行编辑会话。插入和删除操作只记录在编辑日志中，读取时通过日志得到编辑后的内容，
+	/// 提交时将未修改的行整段复制到新文件，不需要通过WriteAllLines重写整个文件。
+	/// 行索引从0开始，按物理行计算（包含空行）。
+	/// </summary>
+	class __declspec(dllexport) FileMmfEditSession
+	{
+	private:
+		/// <summary>
+		/// 编辑日志。
+		/// </summary>
+		std::unique_ptr<FileEditLog> edit_log;
+
+		/// <summary>
+		/// 保护编辑日志。后台压缩写入期间持有共享锁，替换原文件时持有独占锁，读取操作持有共享锁。
+		/// </summary>
+		mutable std::shared_mutex log_mutex;
+
+		/// <summary>
+		/// 正在后台执行的提交，没有时无效。
+		/// </summary>
+		std::shared_future<bool> pending_commit;
+
+		/// <summary>
+		/// 等待正在后台执行的提交完成。修改编辑日志的操作在此之后执行。
+		/// </summary>
+		void WaitForCommit() const;
+
+	public:
+		FileMmfEditSession();
+
+		/// <summary>
+		/// 析构函数。等待后台提交完成，放弃未提交的编辑。
+		/// </summary>
+		~FileMmfEditSession();
+
+		FileMmfEditSession(const FileMmfEditSession&) = delete;
+
+		FileMmfEditSession& operator=(const FileMmfEditSession&) = delete;
+
+		/// <summary>
+		/// 打开要编辑的文件。
+		/// </summary>
+		/// <param name="path">文件路径。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否成功打开文件。</returns>
+		bool Open(const std::string& path, std::error_code error);
+
+		/// <summary>
+		/// 放弃未提交的编辑并关闭文件。
+		/// </summary>
+		void Close();
+
+		/// <summary>
+		/// 获取编辑后的行数。
+		/// </summary>
+		/// <returns>编辑后的行数。</returns>
+		size_t LineCount() const;
+
+		/// <summary>
+		/// 判断是否有未提交的编辑。
+		/// </summary>
+		/// <returns>是否有未提交的编辑。</returns>
+		bool IsModified() const;
+
+		/// <summary>
+		/// 在指定行之前插入若干行。
+		/// </summary>
+		/// <param name="line_index">插入位置的行索引，等于行数时追加到末尾。</param>
+		/// <param name="lines">要插入的行（不含换行符）。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否完成插入操作。</returns>
+		bool InsertLines(size_t line_index, const std::vector<std::string>& lines, std::error_code error);
+
+		/// <summary>
+		/// 从指定行开始删除若干行。
+		/// </summary>
+		/// <param name="line_index">要删除的第一行的行索引。</param>
+		/// <param name="count">要删除的行数。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否完成删除操作。</returns>
+		bool DeleteLines(size_t line_index, size_t count, std::error_code error);
+
+		/// <summary>
+		/// 读取编辑后内容的若干行。
+		/// </summary>
+		/// <param name="line_index">要读取的第一行的行索引。</param>
+		/// <param name="count">要读取的最大行数。</param>
+		/// <param name="out_lines">读取的行（不含换行符）。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否完成读取操作。</returns>
+		bool ReadLines(size_t line_index, size_t count, std::vector<std::string>& out_lines, std::error_code error) const;
+
+		/// <summary>
+		/// 提交编辑，用编辑后的内容替换原文件，然后在新文件上开始新的编辑。
+		/// </summary>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否完成提交操作。</returns>
+		bool Commit(std::error_code error);
+
+		/// <summary>
+		/// 在共享线程池中后台提交编辑：压缩写入临时文件后替换原文件，然后在新文件上开始新的编辑。
+		/// 写入期间仍可以读取编辑后的内容；插入、删除和其他提交操作等待后台提交完成后再执行，不会被新文件覆盖。
+		/// </summary>
+		/// <returns>提交结果，为是否完成提交操作。</returns>
+		std::shared_future<bool> CommitAsync();
+
+		/// <summary>
+		/// 将编辑后的内容写入指定文件，原文件和编辑日志保持不变。写入的文件就是原文件时等同于Commit。
+		/// </summary>
+		/// <param name="write_path">要写入的文件。如果目标文件已存在，则覆盖该文件。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否完成写入操作。</returns>
+		bool CommitTo(const std::string& write_path, std::error_code error);
+	};
 }
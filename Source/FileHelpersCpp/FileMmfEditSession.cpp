@@ -0,0 +1,219 @@
+﻿#include "pch.h"
+#include "FileMMFEngineBase.h"
+#include "FileEditLog.h"
+#include "ThreadPool.h"
+
+using namespace file_helpers_cpp;
+
+FileMmfEditSession::FileMmfEditSession()
+	: edit_log(new FileEditLog())
+{
+}
+
+/// <summary>
+/// 析构函数。等待后台提交完成，放弃未提交的编辑。
+/// </summary>
+FileMmfEditSession::~FileMmfEditSession()
+{
+	WaitForCommit();
+}
+
+/// <summary>
+/// 等待正在后台执行的提交完成。修改编辑日志的操作在此之后执行。
+/// </summary>
+void FileMmfEditSession::WaitForCommit() const
+{
+	if (pending_commit.valid())
+	{
+		pending_commit.wait();
+	}
+}
+
+/// <summary>
+/// 打开要编辑的文件。
+/// </summary>
+/// <param name="path">文件路径。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否成功打开文件。</returns>
+bool FileMmfEditSession::Open(const std::string& path, std::error_code error)
+{
+	try
+	{
+		WaitForCommit();
+		return edit_log->Open(path, error);
+	}
+	catch (std::exception& ex)
+	{
+		auto msg = ex.what();
+		return false;
+	}
+}
+
+/// <summary>
+/// 放弃未提交的编辑并关闭文件。
+/// </summary>
+void FileMmfEditSession::Close()
+{
+	WaitForCommit();
+	edit_log->Close();
+}
+
+/// <summary>
+/// 获取编辑后的行数。
+/// </summary>
+/// <returns>编辑后的行数。</returns>
+size_t FileMmfEditSession::LineCount() const
+{
+	std::shared_lock<std::shared_mutex> lock(log_mutex);
+	return edit_log->LineCount();
+}
+
+/// <summary>
+/// 判断是否有未提交的编辑。
+/// </summary>
+/// <returns>是否有未提交的编辑。</returns>
+bool FileMmfEditSession::IsModified() const
+{
+	std::shared_lock<std::shared_mutex> lock(log_mutex);
+	return edit_log->IsModified();
+}
+
+/// <summary>
+/// 在指定行之前插入若干行。
+/// </summary>
+/// <param name="line_index">插入位置的行索引，等于行数时追加到末尾。</param>
+/// <param name="lines">要插入的行（不含换行符）。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否完成插入操作。</returns>
+bool FileMmfEditSession::InsertLines(const size_t line_index, const std::vector<std::string>& lines, std::error_code error)
+{
+	try
+	{
+		WaitForCommit();
+		return edit_log->InsertLines(line_index, lines, error);
+	}
+	catch (std::exception& ex)
+	{
+		auto msg = ex.what();
+		return false;
+	}
+}
+
+/// <summary>
+/// 从指定行开始删除若干行。
+/// </summary>
+/// <param name="line_index">要删除的第一行的行索引。</param>
+/// <param name="count">要删除的行数。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否完成删除操作。</returns>
+bool FileMmfEditSession::DeleteLines(const size_t line_index, const size_t count, std::error_code error)
+{
+	try
+	{
+		WaitForCommit();
+		return edit_log->DeleteLines(line_index, count, error);
+	}
+	catch (std::exception& ex)
+	{
+		auto msg = ex.what();
+		return false;
+	}
+}
+
+/// <summary>
+/// 读取编辑后内容的若干行。
+/// </summary>
+/// <param name="line_index">要读取的第一行的行索引。</param>
+/// <param name="count">要读取的最大行数。</param>
+/// <param name="out_lines">读取的行（不含换行符）。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否完成读取操作。</returns>
+bool FileMmfEditSession::ReadLines(const size_t line_index, const size_t count, std::vector<std::string>& out_lines, std::error_code error) const
+{
+	try
+	{
+		std::shared_lock<std::shared_mutex> lock(log_mutex);
+		return edit_log->ReadLines(line_index, count, out_lines, error);
+	}
+	catch (std::exception& ex)
+	{
+		auto msg = ex.what();
+		return false;
+	}
+}
+
+/// <summary>
+/// 提交编辑，用编辑后的内容替换原文件，然后在新文件上开始新的编辑。
+/// </summary>
+/// <param name="error">错误信息。</param>
+/// <returns>是否完成提交操作。</returns>
+bool FileMmfEditSession::Commit(std::error_code error)
+{
+	try
+	{
+		WaitForCommit();
+		return edit_log->Commit(edit_log->Path(), error);
+	}
+	catch (std::exception& ex)
+	{
+		auto msg = ex.what();
+		return false;
+	}
+}
+
+/// <summary>
+/// 在共享线程池中后台提交编辑：压缩写入临时文件后替换原文件，然后在新文件上开始新的编辑。
+/// 写入期间仍可以读取编辑后的内容；插入、删除和其他提交操作等待后台提交完成后再执行，不会被新文件覆盖。
+/// </summary>
+/// <returns>提交结果，为是否完成提交操作。</returns>
+std::shared_future<bool> FileMmfEditSession::CommitAsync()
+{
+	WaitForCommit();
+	const auto promise = std::make_shared<std::promise<bool>>();
+	pending_commit = promise->get_future().share();
+	ThreadPool::Shared()->Submit([this, promise]
+	{
+		bool result = false;
+		try
+		{
+			std::error_code error;
+			{
+				// 压缩写入只读取编辑日志，与读取操作并发执行。
+				std::shared_lock<std::shared_mutex> lock(log_mutex);
+				result = edit_log->Compact(edit_log->Path(), error);
+			}
+			if (result)
+			{
+				std::unique_lock<std::shared_mutex> lock(log_mutex);
+				result = edit_log->ReplaceSource(error);
+			}
+		}
+		catch (std::exception& ex)
+		{
+			auto msg = ex.what();
+			result = false;
+		}
+		promise->set_value(result);
+	});
+	return pending_commit;
+}
+
+/// <summary>
+/// 将编辑后的内容写入指定文件，原文件和编辑日志保持不变。写入的文件就是原文件时等同于Commit。
+/// </summary>
+/// <param name="write_path">要写入的文件。如果目标文件已存在，则覆盖该文件。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否完成写入操作。</returns>
+bool FileMmfEditSession::CommitTo(const std::string& write_path, std::error_code error)
+{
+	try
+	{
+		WaitForCommit();
+		return edit_log->Commit(write_path, error);
+	}
+	catch (std::exception& ex)
+	{
+		auto msg = ex.what();
+		return false;
+	}
+}
@@ -142,6 +142,12 @@ bool FileSteamEngineBase::WriteAllText(const std::string& path, const std::strin
 	std::ofstream outfile(path);
 	outfile << contents << std::endl;
 	outfile.close();
+	if (outfile.fail())
+	{
+		// 򿪻дʧʱʧ״̬
+		error = std::make_error_code(std::errc::io_error);
+		return false;
+	}
 	return true;
 }
 
@@ -163,5 +169,44 @@ bool FileSteamEngineBase::WriteAllLines(const std::string& path, const std::vect
 		outfile << line << std::endl;
 	}
 	outfile.close();
+	if (outfile.fail())
+	{
+		// 򿪻дʧʱʧ״̬
+		error = std::make_error_code(std::errc::io_error);
+		return false;
+	}
+	return true;
+}
+
+/// <summary>
+/// һļĩβ׷һַϣȻرոļļ򴴽ļ
+/// </summary>
+/// <param name="path">Ҫ׷ӵļ</param>
+/// <param name="contents">Ҫ׷ӵļеС</param>
+/// <param name="error">Ϣ</param>
+/// <returns>Ƿ׷Ӳ</returns>
+bool FileSteamEngineBase::AppendAllLines(const std::string& path, const std::vector<std::string>& contents, std::error_code error) const
+{
+	// ׷ģʽ򿪣ʹýϴĻдϵͳô
+	std::vector<char> stream_buffer(kAppendStreamBufferSize);
+	std::ofstream outfile;
+	outfile.rdbuf()->pubsetbuf(stream_buffer.data(), stream_buffer.size());
+	outfile.open(path, std::ios::app);
+	if (!outfile.is_open())
+	{
+		error = std::make_error_code(std::errc::bad_file_descriptor);
+		return false;
+	}
+	for (const auto& line : contents)
+	{
+		outfile << line << '\n';
+	}
+	outfile.close();
+	if (outfile.fail())
+	{
+		// 򿪻дʧʱʧ״̬
+		error = std::make_error_code(std::errc::io_error);
+		return false;
+	}
 	return true;
 }
\ No newline at end of file
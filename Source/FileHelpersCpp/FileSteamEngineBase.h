@@ -16,6 +16,11 @@ namespace file_helpers_cpp
 
 		~FileSteamEngineBase() = default;
 
+		/// <summary>
+		/// ׷дʱļĴС
+		/// </summary>
+		static constexpr size_t kAppendStreamBufferSize = 1024 * 1024;
+
 	public:
 		//int CountLines(const std::string& path, std::error_code error) const override;
 		//std::string ReadAllText(const std::string path, std::error_code error) const override;
@@ -78,5 +83,14 @@ namespace file_helpers_cpp
 		/// <param name="error">Ϣ</param>
 		/// <returns>Ƿд</returns>
 		bool WriteAllLines(const std::string& path, const std::vector<std::string>& contents, std::error_code error) const override;
+
+		/// <summary>
+		/// һļĩβ׷һַϣȻرոļļ򴴽ļ
+		/// </summary>
+		/// <param name="path">Ҫ׷ӵļ</param>
+		/// <param name="contents">Ҫ׷ӵļеС</param>
+		/// <param name="error">Ϣ</param>
+		/// <returns>Ƿ׷Ӳ</returns>
+		bool AppendAllLines(const std::string& path, const std::vector<std::string>& contents, std::error_code error) const override;
 	};
 }
@@ -0,0 +1,167 @@
+﻿#pragma once
+#include "FileEngineBase.h"
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace file_helpers_cpp
+{
+	/// <summary>
+	/// 表示当前线程上的一组硬件计数器：指令数、周期数、分支预测失败数和末级缓存未命中数。
+	/// 每个线程第一次使用时通过perf_event_open打开，之后每次测量只重置和读取。
+	/// 只统计用户态和当前线程，线程池中其他线程的工作不计入。非Linux平台、内核不支持或perf_event_paranoid禁止时不可用。
+	/// </summary>
+	class HardwareCounters
+	{
+	private:
+		/// <summary>
+		/// 计数器数。
+		/// </summary>
+		static constexpr int kCounterCount = 4;
+
+		/// <summary>
+		/// 各计数器的文件描述符，打开失败的为-1。
+		/// </summary>
+		int descriptors[kCounterCount] = { -1, -1, -1, -1 };
+
+		/// <summary>
+		/// 是否至少打开了一个计数器。
+		/// </summary>
+		bool available = false;
+
+#ifdef __linux__
+		/// <summary>
+		/// 打开一个用户态的硬件计数器，初始为停止状态。
+		/// </summary>
+		/// <param name="config">PERF_COUNT_HW_*。</param>
+		/// <returns>文件描述符，失败时为-1。</returns>
+		static int Open(const unsigned long long config)
+		{
+			perf_event_attr attr;
+			std::memset(&attr, 0, sizeof(attr));
+			attr.size = sizeof(attr);
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.config = config;
+			attr.disabled = 1;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+			return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+		}
+
+		/// <summary>
+		/// 读取一个计数器。计数器与其他事件分时复用时按实际运行时间的比例换算。
+		/// </summary>
+		/// <returns>计数值，计数器不可用时为-1。</returns>
+		static long long Read(const int descriptor)
+		{
+			if (descriptor < 0)
+			{
+				return -1;
+			}
+			unsigned long long values[3] = {};
+			if (read(descriptor, values, sizeof(values)) != static_cast<ssize_t>(sizeof(values)))
+			{
+				return -1;
+			}
+			if (values[2] == 0)
+			{
+				return 0;
+			}
+			if (values[2] < values[1])
+			{
+				return static_cast<long long>(static_cast<double>(values[0]) * static_cast<double>(values[1]) / static_cast<double>(values[2]));
+			}
+			return static_cast<long long>(values[0]);
+		}
+#endif
+
+		HardwareCounters()
+		{
+#ifdef __linux__
+			const unsigned long long configs[kCounterCount] = {
+				PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_HW_CACHE_MISSES
+			};
+			for (int i = 0; i < kCounterCount; i++)
+			{
+				descriptors[i] = Open(configs[i]);
+				available = available || descriptors[i] >= 0;
+			}
+#endif
+		}
+
+	public:
+		HardwareCounters(const HardwareCounters&) = delete;
+
+		HardwareCounters& operator=(const HardwareCounters&) = delete;
+
+		~HardwareCounters()
+		{
+#ifdef __linux__
+			for (const int descriptor : descriptors)
+			{
+				if (descriptor >= 0)
+				{
+					close(descriptor);
+				}
+			}
+#endif
+		}
+
+		/// <summary>
+		/// 获取当前线程的计数器，第一次调用时打开。
+		/// </summary>
+		static HardwareCounters& ForCurrentThread()
+		{
+			thread_local HardwareCounters counters;
+			return counters;
+		}
+
+		/// <summary>
+		/// 清零并开始计数。
+		/// </summary>
+		void Start()
+		{
+#ifdef __linux__
+			for (const int descriptor : descriptors)
+			{
+				if (descriptor >= 0)
+				{
+					ioctl(descriptor, PERF_EVENT_IOC_RESET, 0);
+					ioctl(descriptor, PERF_EVENT_IOC_ENABLE, 0);
+				}
+			}
+#endif
+		}
+
+		/// <summary>
+		/// 停止计数并写入统计信息。不可用的计数器写入-1。
+		/// </summary>
+		/// <param name="stats">统计信息。</param>
+		void Stop(EngineStats& stats)
+		{
+			stats.hardware_counters = available;
+			if (!available)
+			{
+				return;
+			}
+#ifdef __linux__
+			for (const int descriptor : descriptors)
+			{
+				if (descriptor >= 0)
+				{
+					ioctl(descriptor, PERF_EVENT_IOC_DISABLE, 0);
+				}
+			}
+			stats.instructions = Read(descriptors[0]);
+			stats.cycles = Read(descriptors[1]);
+			stats.branch_misses = Read(descriptors[2]);
+			stats.cache_misses = Read(descriptors[3]);
+#endif
+		}
+	};
+}
@@ -0,0 +1,425 @@
+﻿#include "pch.h"
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
+#include "mio.hpp"
+#include "ColumnStatsScanner.h"
+#include "ExternalSorter.h"
+#include "HashAggregator.h"
+#include "LineScanner.h"
+#include "LoserTree.h"
+#include "MappedLineReader.h"
+#include "StringUtils.h"
+#include "ThreadPool.h"
+#include "TraceRecorder.h"
+
+using namespace file_helpers_cpp;
+
+namespace
+{
+	/// <summary>
+	/// 默认的内存预算。
+	/// </summary>
+	constexpr long long kDefaultMemoryBudget = 256LL * 1024 * 1024;
+
+	/// <summary>
+	/// 每个汇总任务一次处理的字节数。
+	/// </summary>
+	constexpr size_t kGroupChunkSize = 8 * 1024 * 1024;
+
+	/// <summary>
+	/// 哈希表的初始槽数。
+	/// </summary>
+	constexpr size_t kInitialCapacity = 1024;
+
+	/// <summary>
+	/// 归并临时文件时每个文件映射窗口的最小和最大字节数。
+	/// </summary>
+	constexpr size_t kMinRunWindowSize = 64 * 1024;
+
+	constexpr size_t kMaxRunWindowSize = 4 * 1024 * 1024;
+
+	/// <summary>
+	/// 写入一组的汇总结果：键、行数和各列的和。和以最短的可往返格式输出。
+	/// </summary>
+	bool WriteGroup(BufferedFileWriter& writer, const std::string& delimiter, const std::string_view key, const long long count, const double* sums,
+	                const size_t value_count, std::error_code& error)
+	{
+		char text[64];
+		if (!writer.Write(key.data(), key.size(), error))
+		{
+			return false;
+		}
+		const auto count_result = std::to_chars(text, text + sizeof(text), count);
+		if (!writer.Write(delimiter.data(), delimiter.size(), error) || !writer.Write(text, count_result.ptr - text, error))
+		{
+			return false;
+		}
+		for (size_t i = 0; i < value_count; i++)
+		{
+			const auto sum_result = std::to_chars(text, text + sizeof(text), sums[i]);
+			if (!writer.Write(delimiter.data(), delimiter.size(), error) || !writer.Write(text, sum_result.ptr - text, error))
+			{
+				return false;
+			}
+		}
+		return writer.Write("\n", 1, error);
+	}
+
+	/// <summary>
+	/// 将哈希表按键排序写入文件。
+	/// </summary>
+	bool WriteTable(const GroupHashTable& table, const std::string& path, const std::string& delimiter, const size_t value_count, std::error_code& error)
+	{
+		TraceSpan span("write", "GroupBy", "groups", static_cast<long long>(table.Size()));
+		BufferedFileWriter writer;
+		if (!writer.Create(path, error))
+		{
+			return false;
+		}
+		for (const size_t slot : table.SortedSlots())
+		{
+			if (!WriteGroup(writer, delimiter, table.Key(slot), table.Count(slot), table.Sums(slot), value_count, error))
+			{
+				writer.Close(error);
+				return false;
+			}
+		}
+		return writer.Close(error);
+	}
+
+	/// <summary>
+	/// 归并按键排序的临时文件，合并相同键的行数和各列的和后写入输出文件。
+	/// </summary>
+	bool MergeGroupRuns(const std::vector<std::string>& paths, const std::string& out_path, const std::string& delimiter, const size_t value_count,
+	                    const long long budget, std::error_code& error)
+	{
+		const size_t source_count = paths.size();
+		const size_t window_size = std::clamp(static_cast<size_t>(budget) / std::max<size_t>(1, source_count), kMinRunWindowSize, kMaxRunWindowSize);
+		std::vector<MappedLineReader> readers(source_count);
+		std::vector<std::string_view> lines(source_count);
+		std::vector<std::string_view> keys(source_count);
+		std::vector<char> exhausted(source_count);
+		const auto advance = [&](const size_t i)
+		{
+			if (!readers[i].Next(lines[i], error))
+			{
+				exhausted[i] = 1;
+				return !error;
+			}
+			keys[i] = lines[i].substr(0, lines[i].find(delimiter));
+			return true;
+		};
+		for (size_t i = 0; i < source_count; i++)
+		{
+			if (!readers[i].Open(paths[i], window_size, error) || !advance(i))
+			{
+				return false;
+			}
+		}
+
+		BufferedFileWriter writer;
+		if (!writer.Create(out_path, error))
+		{
+			return false;
+		}
+
+		TraceSpan span("merge", "GroupBy", "files", static_cast<long long>(source_count));
+		const auto less = [&](const size_t a, const size_t b)
+		{
+			if (exhausted[a])
+			{
+				return false;
+			}
+			if (exhausted[b])
+			{
+				return true;
+			}
+			const int result = keys[a].compare(keys[b]);
+			return result < 0 || (result == 0 && a < b);
+		};
+		LoserTree<decltype(less)> tree(source_count, less);
+		std::string group_key;
+		long long group_count = 0;
+		std::vector<double> group_sums(value_count);
+		std::vector<std::string_view> fields;
+		while (true)
+		{
+			const size_t winner = tree.Winner();
+			if (exhausted[winner] || keys[winner] != group_key)
+			{
+				if (group_count > 0 && !WriteGroup(writer, delimiter, group_key, group_count, group_sums.data(), value_count, error))
+				{
+					writer.Close(error);
+					return false;
+				}
+				if (exhausted[winner])
+				{
+					break;
+				}
+				group_key.assign(keys[winner]);
+				group_count = 0;
+				std::fill(group_sums.begin(), group_sums.end(), 0.0);
+			}
+
+			// 临时文件中的每行为：键、行数、各列的和。
+			SplitViews(lines[winner], delimiter, fields);
+			long long count = 0;
+			std::from_chars(fields[1].data(), fields[1].data() + fields[1].size(), count);
+			group_count += count;
+			for (size_t i = 0; i < value_count; i++)
+			{
+				double sum = 0;
+				std::from_chars(fields[i + 2].data(), fields[i + 2].data() + fields[i + 2].size(), sum);
+				group_sums[i] += sum;
+			}
+
+			if (!advance(winner))
+			{
+				writer.Close(error);
+				return false;
+			}
+			tree.ReplayWinner();
+		}
+		return writer.Close(error);
+	}
+}
+
+/// <summary>
+/// 将槽数加倍并重新插入所有组。
+/// </summary>
+void GroupHashTable::Grow()
+{
+	GroupHashTable grown(value_count, slots.size() * 2);
+	for (size_t i = 0; i < slots.size(); i++)
+	{
+		if (slots[i].count != 0)
+		{
+			const size_t index = grown.Probe(slots[i].key, slots[i].hash);
+			grown.slots[index] = slots[i];
+			std::copy_n(Sums(i), value_count, grown.sums.data() + index * value_count);
+		}
+	}
+	grown.group_count = group_count;
+	*this = std::move(grown);
+}
+
+/// <summary>
+/// 将另一个哈希表的所有组合并到本表，必要时扩容。
+/// </summary>
+/// <param name="other">另一个哈希表。</param>
+void GroupHashTable::Merge(const GroupHashTable& other)
+{
+	for (size_t i = 0; i < other.slots.size(); i++)
+	{
+		const Slot& other_slot = other.slots[i];
+		if (other_slot.count == 0)
+		{
+			continue;
+		}
+		size_t slot = Add(other_slot.key, other_slot.hash, other_slot.count);
+		while (slot == kFull)
+		{
+			Grow();
+			slot = Add(other_slot.key, other_slot.hash, other_slot.count);
+		}
+		double* target = Sums(slot);
+		const double* other_sums = other.Sums(i);
+		for (size_t v = 0; v < value_count; v++)
+		{
+			target[v] += other_sums[v];
+		}
+	}
+}
+
+/// <summary>
+/// 清空所有组，保留槽数。
+/// </summary>
+void GroupHashTable::Clear()
+{
+	std::fill(slots.begin(), slots.end(), Slot());
+	std::fill(sums.begin(), sums.end(), 0.0);
+	group_count = 0;
+}
+
+/// <summary>
+/// 获取所有非空槽的序号，按键的字节顺序排列。
+/// </summary>
+/// <returns>槽序号。</returns>
+std::vector<size_t> GroupHashTable::SortedSlots() const
+{
+	std::vector<size_t> occupied;
+	occupied.reserve(group_count);
+	for (size_t i = 0; i < slots.size(); i++)
+	{
+		if (slots[i].count != 0)
+		{
+			occupied.push_back(i);
+		}
+	}
+	std::sort(occupied.begin(), occupied.end(), [this](const size_t a, const size_t b)
+	{
+		return slots[a].key < slots[b].key;
+	});
+	return occupied;
+}
+
+bool file_helpers_cpp::ParallelGroupBy(const std::string& path, const std::string& out_path, const std::string& delimiter, const GroupByOptions& options, std::error_code& error)
+{
+	if (delimiter.empty() || options.key_column < 0
+		|| std::any_of(options.value_columns.begin(), options.value_columns.end(), [](const int column) { return column < 0; }))
+	{
+		error = std::make_error_code(std::errc::invalid_argument);
+		return false;
+	}
+	std::error_code equivalent_error;
+	if (std::filesystem::exists(out_path, equivalent_error) && std::filesystem::equivalent(path, out_path, equivalent_error))
+	{
+		error = std::make_error_code(std::errc::invalid_argument);
+		return false;
+	}
+
+	mio::mmap_source read_mmap = mio::make_mmap_source(path, error);
+	if (error)
+	{
+		// 空文件无法映射，输出空文件。
+		std::error_code size_error;
+		if (std::filesystem::exists(path, size_error) && std::filesystem::file_size(path, size_error) == 0 && !size_error)
+		{
+			error.clear();
+			BufferedFileWriter writer;
+			return writer.Create(out_path, error) && writer.Close(error);
+		}
+		return false;
+	}
+	const char* data = read_mmap.data();
+	const size_t size = read_mmap.size();
+
+	const std::shared_ptr<ThreadPool> pool = ThreadPool::Shared();
+	const size_t chunk_count = std::max<size_t>(1, (size + kGroupChunkSize - 1) / kGroupChunkSize);
+	const size_t task_count = std::min(chunk_count, static_cast<size_t>(pool->Parallelism(options.thread_count)));
+	const long long budget = options.memory_budget > 0 ? options.memory_budget : kDefaultMemoryBudget;
+	const size_t task_budget = static_cast<size_t>(budget) / task_count;
+	const size_t value_count = options.value_columns.size();
+	const size_t key_column = static_cast<size_t>(options.key_column);
+
+	// 块边界对齐到行首。
+	std::vector<size_t> chunk_begins(chunk_count + 1, size);
+	chunk_begins[0] = 0;
+	for (size_t i = 1; i < chunk_count; i++)
+	{
+		const size_t split = std::max(chunk_begins[i - 1], kGroupChunkSize * i);
+		chunk_begins[i] = split == 0 || data[split - 1] == '\n' ? split : std::min(size, FindLineEnd(data, split, size) + 1);
+	}
+
+	// 任务t依次处理块t、t + task_count、...，每个任务使用独立的哈希表。
+	std::vector<GroupHashTable> tables(task_count, GroupHashTable(value_count, kInitialCapacity));
+	std::vector<TemporaryFiles> task_runs(task_count);
+	std::vector<std::error_code> errors(task_count);
+	pool->ParallelFor(task_count, static_cast<int>(task_count), [&](const size_t task)
+	{
+		GroupHashTable& table = tables[task];
+		std::vector<std::string_view> fields;
+		std::vector<double> values(value_count);
+		for (size_t chunk = task; chunk < chunk_count && !errors[task]; chunk += task_count)
+		{
+			TraceSpan span("aggregate", "GroupBy", "bytes", static_cast<long long>(chunk_begins[chunk + 1] - chunk_begins[chunk]));
+			size_t begin = chunk_begins[chunk];
+			const size_t end = chunk_begins[chunk + 1];
+			while (begin < end)
+			{
+				const size_t line_end = FindLineEnd(data, begin, end);
+				std::string_view line(data + begin, line_end - begin);
+				begin = line_end + 1;
+				if (!line.empty() && line.back() == '\r')
+				{
+					line.remove_suffix(1);
+				}
+				SplitViews(line, delimiter, fields, true);
+				if (key_column >= fields.size())
+				{
+					continue;
+				}
+				for (size_t v = 0; v < value_count; v++)
+				{
+					const size_t column = static_cast<size_t>(options.value_columns[v]);
+					if (column >= fields.size() || !ParseNumericField(fields[column], values[v]))
+					{
+						values[v] = 0;
+					}
+				}
+
+				const std::string_view key = fields[key_column];
+				const uint64_t hash = HashKeyBytes(key);
+				size_t slot = table.Add(key, hash);
+				if (slot == GroupHashTable::kFull)
+				{
+					// 哈希表已满：预算允许时扩容，否则按键排序写入临时文件后清空。
+					if (GroupHashTable::MemoryBytes(table.Capacity() * 2, value_count) <= task_budget)
+					{
+						table.Grow();
+					}
+					else
+					{
+						const std::string run_path = TemporaryFilePath(out_path, options.temp_directory,
+						                                               "group" + std::to_string(task) + "_" + std::to_string(task_runs[task].Paths().size()));
+						task_runs[task].Add(run_path);
+						if (!WriteTable(table, run_path, delimiter, value_count, errors[task]))
+						{
+							return;
+						}
+						table.Clear();
+					}
+					slot = table.Add(key, hash);
+				}
+				double* sums = table.Sums(slot);
+				for (size_t v = 0; v < value_count; v++)
+				{
+					sums[v] += values[v];
+				}
+			}
+		}
+	});
+
+	for (const auto& task_error : errors)
+	{
+		if (task_error)
+		{
+			error = task_error;
+			return false;
+		}
+	}
+
+	const bool spilled = std::any_of(task_runs.begin(), task_runs.end(), [](const TemporaryFiles& runs) { return !runs.Paths().empty(); });
+	if (!spilled)
+	{
+		// 所有哈希表都在预算内，在内存中合并。
+		TraceSpan span("merge", "GroupBy", "tables", static_cast<long long>(task_count));
+		for (size_t task = 1; task < task_count; task++)
+		{
+			tables[0].Merge(tables[task]);
+			tables[task] = GroupHashTable(value_count, 1);
+		}
+		return WriteTable(tables[0], out_path, delimiter, value_count, error);
+	}
+
+	// 剩余的组也写入临时文件，映射区在归并前即可释放。
+	std::vector<std::string> run_paths;
+	for (size_t task = 0; task < task_count; task++)
+	{
+		if (tables[task].Size() > 0)
+		{
+			const std::string run_path = TemporaryFilePath(out_path, options.temp_directory, "group" + std::to_string(task) + "_last");
+			task_runs[task].Add(run_path);
+			if (!WriteTable(tables[task], run_path, delimiter, value_count, error))
+			{
+				return false;
+			}
+		}
+		tables[task] = GroupHashTable(value_count, 1);
+		run_paths.insert(run_paths.end(), task_runs[task].Paths().begin(), task_runs[task].Paths().end());
+	}
+	read_mmap.unmap();
+
+	return MergeGroupRuns(run_paths, out_path, delimiter, value_count, budget, error);
+}
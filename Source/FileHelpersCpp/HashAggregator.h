@@ -0,0 +1,192 @@
+﻿#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+#include "DelimitedFileMMFEngine.h"
+
+namespace file_helpers_cpp
+{
+	/// <summary>
+	/// 计算字节串的64位哈希值。每次处理8个字节，最后做一次雪崩混合。
+	/// </summary>
+	/// <param name="bytes">字节串。</param>
+	/// <returns>哈希值。</returns>
+	inline uint64_t HashKeyBytes(const std::string_view bytes)
+	{
+		uint64_t hash = 0x9E3779B97F4A7C15ull ^ bytes.size();
+		size_t i = 0;
+		for (; i + 8 <= bytes.size(); i += 8)
+		{
+			uint64_t word = 0;
+			std::memcpy(&word, bytes.data() + i, sizeof(word));
+			hash = (hash ^ word) * 0xFF51AFD7ED558CCDull;
+			hash ^= hash >> 32;
+		}
+		uint64_t tail = 0;
+		std::memcpy(&tail, bytes.data() + i, bytes.size() - i);
+		hash = (hash ^ tail) * 0xC4CEB9FE1A85EC53ull;
+		hash ^= hash >> 29;
+		hash *= 0xFF51AFD7ED558CCDull;
+		return hash ^ hash >> 32;
+	}
+
+	/// <summary>
+	/// 按键汇总行数和若干列之和的开放寻址哈希表（线性探测）。键只保存字节切片，引用的字节必须在哈希表使用期间有效。
+	/// </summary>
+	class GroupHashTable
+	{
+	private:
+		struct Slot
+		{
+			std::string_view key;
+
+			uint64_t hash = 0;
+
+			/// <summary>
+			/// 组的行数，为0表示空槽。
+			/// </summary>
+			long long count = 0;
+		};
+
+		size_t value_count;
+
+		std::vector<Slot> slots;
+
+		/// <summary>
+		/// 各槽的和，槽i的和位于[i * value_count, (i + 1) * value_count)。
+		/// </summary>
+		std::vector<double> sums;
+
+		size_t group_count = 0;
+
+		/// <summary>
+		/// 查找键所在的槽或应插入的空槽。
+		/// </summary>
+		size_t Probe(const std::string_view key, const uint64_t hash) const
+		{
+			const size_t mask = slots.size() - 1;
+			size_t index = static_cast<size_t>(hash) & mask;
+			while (slots[index].count != 0 && (slots[index].hash != hash || slots[index].key != key))
+			{
+				index = (index + 1) & mask;
+			}
+			return index;
+		}
+
+	public:
+		/// <summary>
+		/// 创建哈希表。
+		/// </summary>
+		/// <param name="value_count">每组求和的列数。</param>
+		/// <param name="capacity">初始槽数，必须为2的幂。</param>
+		GroupHashTable(const size_t value_count, const size_t capacity)
+			: value_count(value_count), slots(capacity), sums(capacity * value_count)
+		{
+		}
+
+		/// <summary>
+		/// 获取指定槽数的哈希表占用的字节数。
+		/// </summary>
+		static size_t MemoryBytes(const size_t capacity, const size_t value_count)
+		{
+			return capacity * (sizeof(Slot) + value_count * sizeof(double));
+		}
+
+		size_t Capacity() const
+		{
+			return slots.size();
+		}
+
+		size_t Size() const
+		{
+			return group_count;
+		}
+
+		/// <summary>
+		/// 表示哈希表已满、没有插入的槽序号。
+		/// </summary>
+		static constexpr size_t kFull = static_cast<size_t>(-1);
+
+		/// <summary>
+		/// 将若干行计入键所在的组，需要新建组时超过75%的装载率则不插入。
+		/// </summary>
+		/// <param name="key">键。</param>
+		/// <param name="hash">键的哈希值。</param>
+		/// <param name="rows">计入的行数。</param>
+		/// <returns>组所在的槽序号，用于累加各列的值。哈希表已满时返回kFull，扩容或清空后重试。</returns>
+		size_t Add(const std::string_view key, const uint64_t hash, const long long rows = 1)
+		{
+			const size_t index = Probe(key, hash);
+			Slot& slot = slots[index];
+			if (slot.count == 0)
+			{
+				if ((group_count + 1) * 4 > slots.size() * 3)
+				{
+					return kFull;
+				}
+				slot.key = key;
+				slot.hash = hash;
+				group_count++;
+			}
+			slot.count += rows;
+			return index;
+		}
+
+		/// <summary>
+		/// 将槽数加倍并重新插入所有组。
+		/// </summary>
+		void Grow();
+
+		/// <summary>
+		/// 将另一个哈希表的所有组合并到本表，必要时扩容。
+		/// </summary>
+		/// <param name="other">另一个哈希表。</param>
+		void Merge(const GroupHashTable& other);
+
+		/// <summary>
+		/// 清空所有组，保留槽数。
+		/// </summary>
+		void Clear();
+
+		/// <summary>
+		/// 获取所有非空槽的序号，按键的字节顺序排列。
+		/// </summary>
+		/// <returns>槽序号。</returns>
+		std::vector<size_t> SortedSlots() const;
+
+		std::string_view Key(const size_t slot) const
+		{
+			return slots[slot].key;
+		}
+
+		long long Count(const size_t slot) const
+		{
+			return slots[slot].count;
+		}
+
+		const double* Sums(const size_t slot) const
+		{
+			return sums.data() + slot * value_count;
+		}
+
+		double* Sums(const size_t slot)
+		{
+			return sums.data() + slot * value_count;
+		}
+	};
+
+	/// <summary>
+	/// 映射文件，按对齐到行首的块在线程池中并行分组汇总，每个任务使用独立的哈希表。没有溢出时在内存中合并各哈希表；
+	/// 任一哈希表超过其内存预算时，各哈希表按键排序写入临时文件，最后用败者树归并并合并相同的键。输出按键的字节顺序排列。
+	/// </summary>
+	/// <param name="path">输入文件。</param>
+	/// <param name="out_path">输出文件，不能与输入文件相同。</param>
+	/// <param name="delimiter">分隔符。</param>
+	/// <param name="options">分组选项。</param>
+	/// <param name="error">错误信息。</param>
+	/// <returns>是否完成统计。</returns>
+	bool ParallelGroupBy(const std::string& path, const std::string& out_path, const std::string& delimiter, const GroupByOptions& options, std::error_code& error);
+}
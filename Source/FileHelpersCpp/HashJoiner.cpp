@@ -0,0 +1,426 @@
+﻿#include "pch.h"
+#include <algorithm>
+#include <filesystem>
+#include <memory>
+#include "mio.hpp"
+#include "BufferedFileWriter.h"
+#include "ColumnStatsScanner.h"
+#include "ExternalSorter.h"
+#include "HashAggregator.h"
+#include "HashJoiner.h"
+#include "LineScanner.h"
+#include "ThreadPool.h"
+#include "TraceRecorder.h"
+
+using namespace file_helpers_cpp;
+
+namespace
+{
+	/// <summary>
+	/// 默认的内存预算。
+	/// </summary>
+	constexpr long long kDefaultMemoryBudget = 256LL * 1024 * 1024;
+
+	/// <summary>
+	/// 扫描时每个连接任务处理的字节数。
+	/// </summary>
+	constexpr size_t kProbeChunkSize = 4 * 1024 * 1024;
+
+	/// <summary>
+	/// 分区数的上限。
+	/// </summary>
+	constexpr size_t kMaxPartitionCount = 256;
+
+	/// <summary>
+	/// 分区时每个分区写入器缓冲区的最小和最大字节数。
+	/// </summary>
+	constexpr size_t kMinPartitionBufferSize = 64 * 1024;
+
+	constexpr size_t kMaxPartitionBufferSize = 4 * 1024 * 1024;
+
+	/// <summary>
+	/// 表示一次连接的参数：建表文件和扫描文件各自的键列，以及哪一侧是左文件。
+	/// </summary>
+	struct JoinPlan
+	{
+		std::string delimiter;
+
+		size_t build_key_column;
+
+		size_t probe_key_column;
+
+		size_t right_key_column;
+
+		bool build_is_left;
+
+		bool keep_unmatched_left;
+
+		int thread_count;
+	};
+
+	/// <summary>
+	/// 映射文件。空文件无法映射，视为成功且不映射。
+	/// </summary>
+	bool MapFile(const std::string& path, mio::mmap_source& mmap, std::error_code& error)
+	{
+		mmap = mio::make_mmap_source(path, error);
+		if (error)
+		{
+			std::error_code size_error;
+			if (std::filesystem::exists(path, size_error) && std::filesystem::file_size(path, size_error) == 0 && !size_error)
+			{
+				error.clear();
+				return true;
+			}
+			return false;
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// 追加一个匹配：左文件的行，后接右文件行中除键列以外的字段。
+	/// </summary>
+	void AppendJoined(std::string& out, const std::string_view left_line, const std::string_view right_line, const size_t right_key_column, const std::string& delimiter)
+	{
+		out.append(left_line);
+		ForEachField(right_line, delimiter, [&](const size_t column, const std::string_view field)
+		{
+			if (column != right_key_column)
+			{
+				out.append(delimiter);
+				out.append(field);
+			}
+		});
+		out.push_back('\n');
+	}
+
+	/// <summary>
+	/// 连接扫描文件中[begin, end)范围内的行，结果追加到out。
+	/// </summary>
+	void ProbeChunk(const JoinHashTable& table, const char* data, size_t begin, const size_t end, const JoinPlan& plan, std::string& out)
+	{
+		while (begin < end)
+		{
+			const size_t line_end = FindLineEnd(data, begin, end);
+			std::string_view line(data + begin, line_end - begin);
+			begin = line_end + 1;
+			if (!line.empty() && line.back() == '\r')
+			{
+				line.remove_suffix(1);
+			}
+			if (line.empty())
+			{
+				continue;
+			}
+
+			std::string_view key;
+			uint32_t row = JoinHashTable::kNone;
+			if (FindField(line, plan.delimiter, plan.probe_key_column, key))
+			{
+				row = table.Find(key, HashKeyBytes(key));
+			}
+			if (row == JoinHashTable::kNone)
+			{
+				// 左外连接时扫描文件总是左文件。
+				if (plan.keep_unmatched_left)
+				{
+					out.append(line);
+					out.push_back('\n');
+				}
+				continue;
+			}
+			for (; row != JoinHashTable::kNone; row = table.Next(row))
+			{
+				if (plan.build_is_left)
+				{
+					AppendJoined(out, table.Line(row), line, plan.right_key_column, plan.delimiter);
+				}
+				else
+				{
+					AppendJoined(out, line, table.Line(row), plan.right_key_column, plan.delimiter);
+				}
+			}
+		}
+	}
+
+	/// <summary>
+	/// 扫描文件按对齐到行首的块分批并行连接，每批的块数等于并行度，各块的结果按块顺序写入输出。
+	/// </summary>
+	bool ProbeAndWrite(const JoinHashTable& table, const char* data, const size_t size, const JoinPlan& plan, BufferedFileWriter& writer, std::error_code& error)
+	{
+		const std::shared_ptr<ThreadPool> pool = ThreadPool::Shared();
+		const size_t parallelism = static_cast<size_t>(pool->Parallelism(plan.thread_count));
+		std::vector<std::string> outputs(parallelism);
+		std::vector<std::pair<size_t, size_t>> chunks(parallelism);
+		for (size_t begin = 0; begin < size;)
+		{
+			size_t chunk_count = 0;
+			for (; chunk_count < parallelism && begin < size; chunk_count++)
+			{
+				const size_t split = std::min(size, begin + kProbeChunkSize);
+				const size_t end = split == size || data[split - 1] == '\n' ? split : std::min(size, FindLineEnd(data, split, size) + 1);
+				chunks[chunk_count] = std::make_pair(begin, end);
+				begin = end;
+			}
+
+			pool->ParallelFor(chunk_count, static_cast<int>(parallelism), [&](const size_t i)
+			{
+				TraceSpan span("probe", "JoinFiles", "bytes", static_cast<long long>(chunks[i].second - chunks[i].first));
+				outputs[i].clear();
+				ProbeChunk(table, data, chunks[i].first, chunks[i].second, plan, outputs[i]);
+			});
+
+			for (size_t i = 0; i < chunk_count; i++)
+			{
+				if (!writer.Write(outputs[i].data(), outputs[i].size(), error))
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// 将文件中的行按键的哈希值写入各分区文件。缺少键列的行在keep_keyless为true时写入分区0，否则丢弃。
+	/// </summary>
+	bool PartitionFile(const char* data, const size_t size, const std::string& delimiter, const size_t key_column, const bool keep_keyless,
+	                   const std::vector<std::string>& paths, const size_t buffer_size, std::error_code& error)
+	{
+		TraceSpan span("partition", "JoinFiles", "bytes", static_cast<long long>(size));
+		std::vector<std::unique_ptr<BufferedFileWriter>> writers;
+		for (const auto& path : paths)
+		{
+			writers.push_back(std::make_unique<BufferedFileWriter>(buffer_size));
+			if (!writers.back()->Create(path, error))
+			{
+				return false;
+			}
+		}
+
+		for (size_t begin = 0; begin < size;)
+		{
+			const size_t line_end = FindLineEnd(data, begin, size);
+			std::string_view line(data + begin, line_end - begin);
+			begin = line_end + 1;
+			std::string_view content = line;
+			if (!content.empty() && content.back() == '\r')
+			{
+				content.remove_suffix(1);
+			}
+			if (content.empty())
+			{
+				continue;
+			}
+			std::string_view key;
+			size_t partition = 0;
+			if (FindField(content, delimiter, key_column, key))
+			{
+				// 用哈希值的高位分区，与哈希表使用的低位无关。
+				partition = static_cast<size_t>((HashKeyBytes(key) >> 32) % paths.size());
+			}
+			else if (!keep_keyless)
+			{
+				continue;
+			}
+			if (!writers[partition]->WriteLine(line, error))
+			{
+				return false;
+			}
+		}
+
+		for (auto& writer : writers)
+		{
+			if (!writer->Close(error))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+/// <summary>
+/// 以文本中所有含键列的非空行建表，替换已有内容。
+/// </summary>
+/// <param name="data">文本数据。</param>
+/// <param name="size">文本数据的长度。</param>
+/// <param name="delimiter">分隔符。</param>
+/// <param name="key_column">键列的字段索引。</param>
+void JoinHashTable::Build(const char* data, const size_t size, const std::string& delimiter, const size_t key_column)
+{
+	this->data = data;
+	const size_t line_count = size == 0 ? 0 : CountLineEnds(data, 0, size) + 1;
+	rows.clear();
+	rows.reserve(line_count);
+	size_t capacity = 16;
+	while (capacity < line_count * 2)
+	{
+		capacity *= 2;
+	}
+	slots.assign(capacity, Slot());
+
+	for (size_t begin = 0; begin < size;)
+	{
+		const size_t line_end = FindLineEnd(data, begin, size);
+		std::string_view line(data + begin, line_end - begin);
+		const size_t offset = begin;
+		begin = line_end + 1;
+		if (!line.empty() && line.back() == '\r')
+		{
+			line.remove_suffix(1);
+		}
+		std::string_view key;
+		if (line.empty() || !FindField(line, delimiter, key_column, key))
+		{
+			continue;
+		}
+
+		const uint32_t row = static_cast<uint32_t>(rows.size());
+		rows.push_back(Row{ offset, static_cast<uint32_t>(line.size()), kNone, static_cast<uint32_t>(key.data() - line.data()), static_cast<uint32_t>(key.size()) });
+		const uint64_t hash = HashKeyBytes(key);
+		Slot& slot = slots[Probe(key, hash)];
+		if (slot.first == kNone)
+		{
+			slot.hash = hash;
+			slot.first = row;
+		}
+		else
+		{
+			rows[slot.last].next = row;
+		}
+		slot.last = row;
+	}
+}
+
+bool file_helpers_cpp::ParallelHashJoin(const std::string& left_path, const std::string& right_path, const std::string& out_path, const std::string& delimiter,
+                                        const JoinOptions& options, std::error_code& error)
+{
+	if (delimiter.empty() || options.left_key_column < 0 || options.right_key_column < 0)
+	{
+		error = std::make_error_code(std::errc::invalid_argument);
+		return false;
+	}
+	for (const auto& path : { left_path, right_path })
+	{
+		std::error_code equivalent_error;
+		if (std::filesystem::exists(out_path, equivalent_error) && std::filesystem::equivalent(path, out_path, equivalent_error))
+		{
+			error = std::make_error_code(std::errc::invalid_argument);
+			return false;
+		}
+	}
+	const uintmax_t left_size = std::filesystem::file_size(left_path, error);
+	if (error)
+	{
+		return false;
+	}
+	const uintmax_t right_size = std::filesystem::file_size(right_path, error);
+	if (error)
+	{
+		return false;
+	}
+
+	// 左外连接必须扫描左文件，因此总是用右文件建表。
+	JoinPlan plan;
+	plan.delimiter = delimiter;
+	plan.build_is_left = !options.keep_unmatched_left && left_size < right_size;
+	plan.build_key_column = static_cast<size_t>(plan.build_is_left ? options.left_key_column : options.right_key_column);
+	plan.probe_key_column = static_cast<size_t>(plan.build_is_left ? options.right_key_column : options.left_key_column);
+	plan.right_key_column = static_cast<size_t>(options.right_key_column);
+	plan.keep_unmatched_left = options.keep_unmatched_left;
+	plan.thread_count = options.thread_count;
+	const std::string& build_path = plan.build_is_left ? left_path : right_path;
+	const std::string& probe_path = plan.build_is_left ? right_path : left_path;
+	const long long budget = options.memory_budget > 0 ? options.memory_budget : kDefaultMemoryBudget;
+
+	mio::mmap_source build_mmap;
+	if (!MapFile(build_path, build_mmap, error))
+	{
+		return false;
+	}
+	const char* build_data = build_mmap.is_mapped() ? build_mmap.data() : nullptr;
+	const size_t build_size = build_mmap.is_mapped() ? build_mmap.size() : 0;
+	const size_t build_lines = build_size == 0 ? 0 : CountLineEnds(build_data, 0, build_size) + 1;
+	const size_t estimate = build_size + build_lines * JoinHashTable::BytesPerRow();
+
+	BufferedFileWriter writer;
+	if (!writer.Create(out_path, error))
+	{
+		return false;
+	}
+
+	JoinHashTable table;
+	if (estimate <= static_cast<size_t>(budget))
+	{
+		TraceSpan build_span("build", "JoinFiles", "bytes", static_cast<long long>(build_size));
+		table.Build(build_data, build_size, delimiter, plan.build_key_column);
+		build_span.End();
+
+		mio::mmap_source probe_mmap;
+		if (!MapFile(probe_path, probe_mmap, error)
+			|| (probe_mmap.is_mapped() && !ProbeAndWrite(table, probe_mmap.data(), probe_mmap.size(), plan, writer, error)))
+		{
+			writer.Close(error);
+			return false;
+		}
+		return writer.Close(error);
+	}
+
+	// 建表文件放不下时，两个文件按键的哈希值分区，使每个分区的建表文件约为预算的一半。
+	const size_t partition_count = std::clamp<size_t>((estimate * 2 + static_cast<size_t>(budget) - 1) / static_cast<size_t>(budget), 2, kMaxPartitionCount);
+	const size_t buffer_size = std::clamp(static_cast<size_t>(budget) / (partition_count * 2), kMinPartitionBufferSize, kMaxPartitionBufferSize);
+	TemporaryFiles partitions;
+	std::vector<std::string> build_paths;
+	std::vector<std::string> probe_paths;
+	for (size_t i = 0; i < partition_count; i++)
+	{
+		build_paths.push_back(TemporaryFilePath(out_path, options.temp_directory, "join_build" + std::to_string(i)));
+		probe_paths.push_back(TemporaryFilePath(out_path, options.temp_directory, "join_probe" + std::to_string(i)));
+		partitions.Add(build_paths.back());
+		partitions.Add(probe_paths.back());
+	}
+
+	if (!PartitionFile(build_data, build_size, delimiter, plan.build_key_column, false, build_paths, buffer_size, error))
+	{
+		writer.Close(error);
+		return false;
+	}
+	build_mmap.unmap();
+	{
+		mio::mmap_source probe_mmap;
+		if (!MapFile(probe_path, probe_mmap, error)
+			|| !PartitionFile(probe_mmap.is_mapped() ? probe_mmap.data() : nullptr, probe_mmap.is_mapped() ? probe_mmap.size() : 0, delimiter,
+			                  plan.probe_key_column, plan.keep_unmatched_left, probe_paths, buffer_size, error))
+		{
+			writer.Close(error);
+			return false;
+		}
+	}
+
+	for (size_t i = 0; i < partition_count; i++)
+	{
+		mio::mmap_source partition_build;
+		mio::mmap_source partition_probe;
+		if (!MapFile(build_paths[i], partition_build, error) || !MapFile(probe_paths[i], partition_probe, error))
+		{
+			writer.Close(error);
+			return false;
+		}
+		if (!partition_probe.is_mapped())
+		{
+			continue;
+		}
+
+		TraceSpan build_span("build", "JoinFiles", "bytes", static_cast<long long>(partition_build.is_mapped() ? partition_build.size() : 0));
+		table.Build(partition_build.is_mapped() ? partition_build.data() : nullptr, partition_build.is_mapped() ? partition_build.size() : 0, delimiter,
+		            plan.build_key_column);
+		build_span.End();
+		if (!ProbeAndWrite(table, partition_probe.data(), partition_probe.size(), plan, writer, error))
+		{
+			writer.Close(error);
+			return false;
+		}
+	}
+	return writer.Close(error);
+}
@@ -0,0 +1,138 @@
+﻿#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+#include "DelimitedFileMMFEngine.h"
+
+namespace file_helpers_cpp
+{
+	/// <summary>
+	/// 连接时建表一侧的紧凑哈希表。行只保存在文本中的位置，键相同的行按文本顺序串成链表；槽为开放寻址（线性探测），
+	/// 每行约占用56字节，文本必须在哈希表使用期间有效。
+	/// </summary>
+	class JoinHashTable
+	{
+	public:
+		/// <summary>
+		/// 表示没有行的序号。
+		/// </summary>
+		static constexpr uint32_t kNone = UINT32_MAX;
+
+	private:
+		struct Row
+		{
+			uint64_t offset;
+
+			uint32_t length;
+
+			/// <summary>
+			/// 键相同的下一行的序号。
+			/// </summary>
+			uint32_t next;
+
+			uint32_t key_offset;
+
+			uint32_t key_length;
+		};
+
+		struct Slot
+		{
+			uint64_t hash = 0;
+
+			/// <summary>
+			/// 键相同的第一行和最后一行的序号，为kNone表示空槽。
+			/// </summary>
+			uint32_t first = kNone;
+
+			uint32_t last = kNone;
+		};
+
+		const char* data = nullptr;
+
+		std::vector<Row> rows;
+
+		std::vector<Slot> slots;
+
+		std::string_view Key(const uint32_t row) const
+		{
+			return std::string_view(data + rows[row].offset + rows[row].key_offset, rows[row].key_length);
+		}
+
+		/// <summary>
+		/// 查找键所在的槽或应插入的空槽。
+		/// </summary>
+		size_t Probe(const std::string_view key, const uint64_t hash) const
+		{
+			const size_t mask = slots.size() - 1;
+			size_t index = static_cast<size_t>(hash) & mask;
+			while (slots[index].first != kNone && (slots[index].hash != hash || Key(slots[index].first) != key))
+			{
+				index = (index + 1) & mask;
+			}
+			return index;
+		}
+
+	public:
+		/// <summary>
+		/// 估算每行占用的字节数（行信息和两倍行数的槽），不含文本本身。
+		/// </summary>
+		static size_t BytesPerRow()
+		{
+			return sizeof(Row) + 2 * sizeof(Slot);
+		}
+
+		/// <summary>
+		/// 以文本中所有含键列的非空行建表，替换已有内容。
+		/// </summary>
+		/// <param name="data">文本数据。</param>
+		/// <param name="size">文本数据的长度。</param>
+		/// <param name="delimiter">分隔符。</param>
+		/// <param name="key_column">键列的字段索引。</param>
+		void Build(const char* data, size_t size, const std::string& delimiter, size_t key_column);
+
+		/// <summary>
+		/// 查找键相同的第一行。
+		/// </summary>
+		/// <param name="key">键。</param>
+		/// <param name="hash">键的哈希值。</param>
+		/// <returns>行序号，不存在时为kNone。</returns>
+		uint32_t Find(const std::string_view key, const uint64_t hash) const
+		{
+			return slots.empty() ? kNone : slots[Probe(key, hash)].first;
+		}
+
+		/// <summary>
+		/// 获取键相同的下一行。
+		/// </summary>
+		/// <param name="row">行序号。</param>
+		/// <returns>行序号，没有下一行时为kNone。</returns>
+		uint32_t Next(const uint32_t row) const
+		{
+			return rows[row].next;
+		}
+
+		/// <summary>
+		/// 获取行的内容，不含行尾的\r和换行符。
+		/// </summary>
+		std::string_view Line(const uint32_t row) const
+		{
+			return std::string_view(data + rows[row].offset, rows[row].length);
+		}
+	};
+
+	/// <summary>
+	/// 按键连接两个文件。较小的文件（左外连接时总是右文件）建表；建表文件及其哈希表超过内存预算时，两个文件按键的哈希值分区写入临时文件，
+	/// 逐个分区建表和扫描。扫描文件按对齐到行首的块在线程池中并行连接，各块的结果按块顺序写入输出。
+	/// </summary>
+	/// <param name="left_path">左文件。</param>
+	/// <param name="right_path">右文件。</param>
+	/// <param name="out_path">输出文件，不能与输入文件相同。</param>
+	/// <param name="delimiter">分隔符。</param>
+	/// <param name="options">连接选项。</param>
+	/// <param name="error">错误信息。</param>
+	/// <returns>是否完成连接。</returns>
+	bool ParallelHashJoin(const std::string& left_path, const std::string& right_path, const std::string& out_path, const std::string& delimiter,
+	                      const JoinOptions& options, std::error_code& error);
+}
@@ -0,0 +1,521 @@
+﻿#include "pch.h"
+#include <algorithm>
+#include <bit>
+#include <filesystem>
+#include <memory>
+#include "mio.hpp"
+#include "BufferedFileWriter.h"
+#include "ExternalSorter.h"
+#include "HashAggregator.h"
+#include "LineDiffer.h"
+#include "LineScanner.h"
+#include "ThreadPool.h"
+#include "TraceRecorder.h"
+
+using namespace file_helpers_cpp;
+
+namespace
+{
+	/// <summary>
+	/// 每个比较任务处理的字节数。
+	/// </summary>
+	constexpr size_t kDiffChunkSize = 8 * 1024 * 1024;
+
+	/// <summary>
+	/// 按键列对齐时分区数的上限。
+	/// </summary>
+	constexpr size_t kMaxPartitionCount = 1024;
+
+	/// <summary>
+	/// 表示不存在的行索引。
+	/// </summary>
+	constexpr uint32_t kNone = UINT32_MAX;
+
+	/// <summary>
+	/// 表示按键列对齐时的一行：行首偏移、键和整行的哈希值、行长度（不含换行符）以及配对的另一文件中的行索引。
+	/// </summary>
+	struct DiffLine
+	{
+		uint64_t offset;
+
+		uint64_t key_hash;
+
+		uint64_t line_hash;
+
+		uint32_t length;
+
+		uint32_t partner;
+	};
+
+	/// <summary>
+	/// 表示按键列对齐时的哈希槽：键的哈希值、尚未配对的第一行和同键的最后一行。last为kNone表示空槽。
+	/// </summary>
+	struct KeySlot
+	{
+		uint64_t hash = 0;
+
+		uint32_t head = kNone;
+
+		uint32_t last = kNone;
+	};
+
+	/// <summary>
+	/// 表示一个已映射的文件。
+	/// </summary>
+	struct MappedText
+	{
+		const char* data = nullptr;
+
+		size_t size = 0;
+
+		std::vector<std::pair<size_t, size_t>> chunks;
+
+		std::vector<size_t> starts;
+
+		size_t Total() const
+		{
+			return starts.back();
+		}
+	};
+
+	/// <summary>
+	/// 映射文件。空文件无法映射，视为成功且不映射。
+	/// </summary>
+	bool MapFile(const std::string& path, mio::mmap_source& mmap, std::error_code& error)
+	{
+		mmap = mio::make_mmap_source(path, error);
+		if (error)
+		{
+			std::error_code size_error;
+			if (std::filesystem::exists(path, size_error) && std::filesystem::file_size(path, size_error) == 0 && !size_error)
+			{
+				error.clear();
+				return true;
+			}
+			return false;
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// 从pos开始读取下一个非空行，去掉行尾的\r。没有更多非空行时返回false。
+	/// </summary>
+	bool NextNonEmptyLine(const char* data, size_t& pos, const size_t end, std::string_view& line)
+	{
+		while (pos < end)
+		{
+			const size_t line_end = FindLineEnd(data, pos, end);
+			line = std::string_view(data + pos, line_end - pos);
+			pos = line_end + 1;
+			if (!line.empty() && line.back() == '\r')
+			{
+				line.remove_suffix(1);
+			}
+			if (!line.empty())
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/// <summary>
+	/// 将文件切分为对齐到行首的块，并行统计各块的非空行数。starts[i]为第i块第一个非空行的行索引，最后一项为总行数。
+	/// </summary>
+	void ScanChunks(MappedText& text, const std::shared_ptr<ThreadPool>& pool, const size_t parallelism)
+	{
+		text.chunks.clear();
+		for (size_t begin = 0; begin < text.size;)
+		{
+			const size_t split = std::min(text.size, begin + kDiffChunkSize);
+			const size_t end = split == text.size || text.data[split - 1] == '\n' ? split : std::min(text.size, FindLineEnd(text.data, split, text.size) + 1);
+			text.chunks.emplace_back(begin, end);
+			begin = end;
+		}
+
+		std::vector<size_t> counts(text.chunks.size());
+		pool->ParallelFor(text.chunks.size(), static_cast<int>(parallelism), [&](const size_t i)
+		{
+			TraceSpan span("count", "DiffFiles", "bytes", static_cast<long long>(text.chunks[i].second - text.chunks[i].first));
+			counts[i] = CountNonEmptyRecords(text.data, text.chunks[i].first, text.chunks[i].second, text.size);
+		});
+
+		text.starts.assign(text.chunks.size() + 1, 0);
+		for (size_t i = 0; i < counts.size(); i++)
+		{
+			text.starts[i + 1] = text.starts[i] + counts[i];
+		}
+	}
+
+	/// <summary>
+	/// 返回第index个非空行的行首位置，先按块的起始行索引定位到块，再在块内跳过剩余的行。
+	/// </summary>
+	size_t LocateLine(const MappedText& text, const size_t index)
+	{
+		if (index >= text.Total())
+		{
+			return text.size;
+		}
+		const size_t chunk = static_cast<size_t>(std::upper_bound(text.starts.begin(), text.starts.end() - 1, index) - text.starts.begin()) - 1;
+		return SkipNonEmptyLines(text.data, text.chunks[chunk].first, text.size, index - text.starts[chunk]);
+	}
+
+	/// <summary>
+	/// 追加一行带标记的差异记录。
+	/// </summary>
+	void AppendMarked(std::string& out, const char mark, const std::string_view line)
+	{
+		out.push_back(mark);
+		out.push_back(' ');
+		out.append(line);
+		out.push_back('\n');
+	}
+
+	/// <summary>
+	/// 写入一行带标记的差异记录。
+	/// </summary>
+	bool WriteMarked(BufferedFileWriter& writer, const char mark, const std::string_view line, std::error_code& error)
+	{
+		const char prefix[2] = { mark, ' ' };
+		return writer.Write(prefix, sizeof(prefix), error) && writer.WriteLine(line, error);
+	}
+
+	/// <summary>
+	/// 追加一对修改的行并计数，内容相同时只计数。
+	/// </summary>
+	void AppendPair(std::string& out, const std::string_view old_line, const std::string_view new_line, DiffSummary& summary)
+	{
+		if (old_line == new_line)
+		{
+			summary.unchanged++;
+			return;
+		}
+		summary.changed++;
+		AppendMarked(out, '<', old_line);
+		AppendMarked(out, '>', new_line);
+	}
+
+	/// <summary>
+	/// 按位置对齐比较。旧文件的块分批并行比较，每块从新文件中对应行索引的位置开始读取，各块的结果按块顺序写入输出。
+	/// 新文件多出的行最后输出为新增的行。
+	/// </summary>
+	bool DiffByPosition(const MappedText& old_text, const MappedText& new_text, const std::shared_ptr<ThreadPool>& pool, const size_t parallelism,
+	                    BufferedFileWriter& writer, DiffSummary& summary, std::error_code& error)
+	{
+		std::vector<std::string> outputs(parallelism);
+		std::vector<DiffSummary> summaries(parallelism);
+		for (size_t first = 0; first < old_text.chunks.size(); first += parallelism)
+		{
+			const size_t chunk_count = std::min(parallelism, old_text.chunks.size() - first);
+			pool->ParallelFor(chunk_count, static_cast<int>(parallelism), [&](const size_t i)
+			{
+				const auto& chunk = old_text.chunks[first + i];
+				TraceSpan span("compare", "DiffFiles", "bytes", static_cast<long long>(chunk.second - chunk.first));
+				std::string& out = outputs[i];
+				DiffSummary& part = summaries[i];
+				out.clear();
+				part = DiffSummary();
+				size_t old_pos = chunk.first;
+				size_t new_pos = LocateLine(new_text, old_text.starts[first + i]);
+				std::string_view old_line;
+				std::string_view new_line;
+				while (NextNonEmptyLine(old_text.data, old_pos, chunk.second, old_line))
+				{
+					if (NextNonEmptyLine(new_text.data, new_pos, new_text.size, new_line))
+					{
+						AppendPair(out, old_line, new_line, part);
+					}
+					else
+					{
+						part.removed++;
+						AppendMarked(out, '-', old_line);
+					}
+				}
+			});
+
+			for (size_t i = 0; i < chunk_count; i++)
+			{
+				summary.changed += summaries[i].changed;
+				summary.unchanged += summaries[i].unchanged;
+				summary.removed += summaries[i].removed;
+				if (!writer.Write(outputs[i].data(), outputs[i].size(), error))
+				{
+					return false;
+				}
+			}
+		}
+
+		size_t new_pos = LocateLine(new_text, old_text.Total());
+		std::string_view new_line;
+		while (NextNonEmptyLine(new_text.data, new_pos, new_text.size, new_line))
+		{
+			summary.added++;
+			if (!WriteMarked(writer, '+', new_line, error))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// 返回行的键。缺少键列的行视为键为空。
+	/// </summary>
+	std::string_view KeyOf(const char* data, const DiffLine& line, const std::string& delimiter, const size_t key_column)
+	{
+		std::string_view key;
+		if (!FindField(std::string_view(data + line.offset, line.length), delimiter, key_column, key))
+		{
+			return std::string_view();
+		}
+		return key;
+	}
+
+	/// <summary>
+	/// 并行计算文件中每个非空行的键和整行的哈希值，各块写入按行索引预留的位置。
+	/// </summary>
+	bool HashLines(const MappedText& text, const std::string& delimiter, const size_t key_column, const std::shared_ptr<ThreadPool>& pool,
+	               const size_t parallelism, std::vector<DiffLine>& lines, std::error_code& error)
+	{
+		if (text.Total() >= kNone)
+		{
+			error = std::make_error_code(std::errc::value_too_large);
+			return false;
+		}
+		lines.resize(text.Total());
+		pool->ParallelFor(text.chunks.size(), static_cast<int>(parallelism), [&](const size_t i)
+		{
+			TraceSpan span("hash", "DiffFiles", "bytes", static_cast<long long>(text.chunks[i].second - text.chunks[i].first));
+			size_t pos = text.chunks[i].first;
+			size_t index = text.starts[i];
+			std::string_view line;
+			while (NextNonEmptyLine(text.data, pos, text.chunks[i].second, line))
+			{
+				DiffLine& entry = lines[index++];
+				entry.offset = static_cast<uint64_t>(line.data() - text.data);
+				entry.length = static_cast<uint32_t>(line.size());
+				entry.line_hash = HashKeyBytes(line);
+				std::string_view key;
+				entry.key_hash = HashKeyBytes(FindField(line, delimiter, key_column, key) ? key : std::string_view());
+				entry.partner = kNone;
+			}
+		});
+		return true;
+	}
+
+	/// <summary>
+	/// 按键哈希值的高位将行索引稳定地分到各分区，begins[p]为第p个分区在order中的起始位置。
+	/// </summary>
+	void BucketLines(const std::vector<DiffLine>& lines, const size_t partition_count, std::vector<uint32_t>& order, std::vector<size_t>& begins)
+	{
+		begins.assign(partition_count + 1, 0);
+		for (const auto& line : lines)
+		{
+			begins[(line.key_hash >> 32) & (partition_count - 1)]++;
+		}
+		size_t offset = 0;
+		for (size_t p = 0; p <= partition_count; p++)
+		{
+			const size_t count = begins[p];
+			begins[p] = offset;
+			offset += count;
+		}
+		std::vector<size_t> cursors(begins.begin(), begins.end() - 1);
+		order.resize(lines.size());
+		for (size_t i = 0; i < lines.size(); i++)
+		{
+			order[cursors[(lines[i].key_hash >> 32) & (partition_count - 1)]++] = static_cast<uint32_t>(i);
+		}
+	}
+
+	/// <summary>
+	/// 在一个分区内配对键相同的行：旧文件的行按键串成链表，新文件的行依次领取同键中尚未配对的第一行。
+	/// </summary>
+	void MatchPartition(const char* old_data, std::vector<DiffLine>& old_lines, const uint32_t* old_order, const size_t old_count,
+	                    const char* new_data, std::vector<DiffLine>& new_lines, const uint32_t* new_order, const size_t new_count,
+	                    const std::string& delimiter, const size_t key_column, std::vector<uint32_t>& next_old)
+	{
+		const size_t capacity = std::bit_ceil(std::max<size_t>(16, old_count * 2));
+		std::vector<KeySlot> slots(capacity);
+		const size_t mask = capacity - 1;
+		const auto probe = [&](const std::string_view key, const uint64_t hash) -> KeySlot&
+		{
+			for (size_t index = static_cast<size_t>(hash) & mask;; index = (index + 1) & mask)
+			{
+				KeySlot& slot = slots[index];
+				if (slot.last == kNone || (slot.hash == hash && KeyOf(old_data, old_lines[slot.last], delimiter, key_column) == key))
+				{
+					return slot;
+				}
+			}
+		};
+
+		for (size_t i = 0; i < old_count; i++)
+		{
+			const uint32_t row = old_order[i];
+			const uint64_t hash = old_lines[row].key_hash;
+			KeySlot& slot = probe(KeyOf(old_data, old_lines[row], delimiter, key_column), hash);
+			if (slot.last == kNone)
+			{
+				slot.hash = hash;
+				slot.head = row;
+			}
+			else
+			{
+				next_old[slot.last] = row;
+			}
+			slot.last = row;
+		}
+
+		if (old_count == 0)
+		{
+			return;
+		}
+		for (size_t i = 0; i < new_count; i++)
+		{
+			const uint32_t row = new_order[i];
+			KeySlot& slot = probe(KeyOf(new_data, new_lines[row], delimiter, key_column), new_lines[row].key_hash);
+			if (slot.last == kNone || slot.head == kNone)
+			{
+				continue;
+			}
+			const uint32_t partner = slot.head;
+			slot.head = next_old[partner];
+			new_lines[row].partner = partner;
+			old_lines[partner].partner = row;
+		}
+	}
+
+	/// <summary>
+	/// 按键列对齐比较。并行计算两个文件每行的哈希值，按键哈希值分区后并行配对，最后按文件顺序输出差异。
+	/// </summary>
+	bool DiffByKey(const MappedText& old_text, const MappedText& new_text, const std::string& delimiter, const size_t key_column,
+	               const std::shared_ptr<ThreadPool>& pool, const size_t parallelism, BufferedFileWriter& writer, DiffSummary& summary, std::error_code& error)
+	{
+		std::vector<DiffLine> old_lines;
+		std::vector<DiffLine> new_lines;
+		if (!HashLines(old_text, delimiter, key_column, pool, parallelism, old_lines, error)
+			|| !HashLines(new_text, delimiter, key_column, pool, parallelism, new_lines, error))
+		{
+			return false;
+		}
+
+		TraceSpan match_span("match", "DiffFiles", "lines", static_cast<long long>(old_lines.size() + new_lines.size()));
+		const size_t partition_count = parallelism == 1 ? 1 : std::min(kMaxPartitionCount, std::bit_ceil(parallelism * 8));
+		std::vector<uint32_t> old_order;
+		std::vector<uint32_t> new_order;
+		std::vector<size_t> old_begins;
+		std::vector<size_t> new_begins;
+		BucketLines(old_lines, partition_count, old_order, old_begins);
+		BucketLines(new_lines, partition_count, new_order, new_begins);
+		std::vector<uint32_t> next_old(old_lines.size(), kNone);
+		pool->ParallelFor(partition_count, static_cast<int>(parallelism), [&](const size_t p)
+		{
+			MatchPartition(old_text.data, old_lines, old_order.data() + old_begins[p], old_begins[p + 1] - old_begins[p],
+			               new_text.data, new_lines, new_order.data() + new_begins[p], new_begins[p + 1] - new_begins[p],
+			               delimiter, key_column, next_old);
+		});
+		old_order = std::vector<uint32_t>();
+		new_order = std::vector<uint32_t>();
+		next_old = std::vector<uint32_t>();
+		match_span.End();
+
+		TraceSpan write_span("write", "DiffFiles", "lines", static_cast<long long>(old_lines.size() + new_lines.size()));
+		for (const auto& entry : new_lines)
+		{
+			const std::string_view new_line(new_text.data + entry.offset, entry.length);
+			if (entry.partner == kNone)
+			{
+				summary.added++;
+				if (!WriteMarked(writer, '+', new_line, error))
+				{
+					return false;
+				}
+				continue;
+			}
+			const DiffLine& partner = old_lines[entry.partner];
+			const std::string_view old_line(old_text.data + partner.offset, partner.length);
+			if (partner.line_hash == entry.line_hash && old_line == new_line)
+			{
+				summary.unchanged++;
+				continue;
+			}
+			summary.changed++;
+			if (!WriteMarked(writer, '<', old_line, error) || !WriteMarked(writer, '>', new_line, error))
+			{
+				return false;
+			}
+		}
+		for (const auto& entry : old_lines)
+		{
+			if (entry.partner == kNone)
+			{
+				summary.removed++;
+				if (!WriteMarked(writer, '-', std::string_view(old_text.data + entry.offset, entry.length), error))
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+}
+
+bool file_helpers_cpp::ParallelDiffFiles(const std::string& old_path, const std::string& new_path, const std::string& out_path, const std::string& delimiter,
+                                         const DiffOptions& options, DiffSummary& out_summary, std::error_code& error)
+{
+	out_summary = DiffSummary();
+	if (options.key_column >= 0 && delimiter.empty())
+	{
+		error = std::make_error_code(std::errc::invalid_argument);
+		return false;
+	}
+	for (const auto& path : { old_path, new_path })
+	{
+		std::error_code equivalent_error;
+		if (std::filesystem::exists(out_path, equivalent_error) && std::filesystem::equivalent(path, out_path, equivalent_error))
+		{
+			error = std::make_error_code(std::errc::invalid_argument);
+			return false;
+		}
+	}
+
+	mio::mmap_source old_mmap;
+	mio::mmap_source new_mmap;
+	if (!MapFile(old_path, old_mmap, error) || !MapFile(new_path, new_mmap, error))
+	{
+		return false;
+	}
+	MappedText old_text;
+	MappedText new_text;
+	if (old_mmap.is_mapped())
+	{
+		old_text.data = old_mmap.data();
+		old_text.size = old_mmap.size();
+	}
+	if (new_mmap.is_mapped())
+	{
+		new_text.data = new_mmap.data();
+		new_text.size = new_mmap.size();
+	}
+
+	const std::shared_ptr<ThreadPool> pool = ThreadPool::Shared();
+	const size_t parallelism = static_cast<size_t>(pool->Parallelism(options.thread_count));
+	ScanChunks(old_text, pool, parallelism);
+	ScanChunks(new_text, pool, parallelism);
+
+	BufferedFileWriter writer;
+	if (!writer.Create(out_path, error))
+	{
+		return false;
+	}
+	const bool succeeded = options.key_column < 0
+		                       ? DiffByPosition(old_text, new_text, pool, parallelism, writer, out_summary, error)
+		                       : DiffByKey(old_text, new_text, delimiter, static_cast<size_t>(options.key_column), pool, parallelism, writer, out_summary, error);
+	if (!succeeded)
+	{
+		writer.Close(error);
+		return false;
+	}
+	return writer.Close(error);
+}
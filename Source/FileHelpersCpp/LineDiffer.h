@@ -0,0 +1,23 @@
+﻿#pragma once
+#include <string>
+#include <system_error>
+#include "DelimitedFileMMFEngine.h"
+
+namespace file_helpers_cpp
+{
+	/// <summary>
+	/// 映射两个文件并逐行比较，差异写入输出文件。
+	/// 按位置对齐时先并行统计各块的非空行数，定位旧文件每块对应的新文件位置，再并行逐字节比较各块，结果按块顺序写入。
+	/// 按键列对齐时并行计算每行的键哈希值和行哈希值（每行32字节），按键哈希值分区后并行配对键相同的行，最后按文件顺序输出差异。
+	/// </summary>
+	/// <param name="old_path">旧文件。</param>
+	/// <param name="new_path">新文件。</param>
+	/// <param name="out_path">输出文件，不能与输入文件相同。</param>
+	/// <param name="delimiter">分隔符。</param>
+	/// <param name="options">比较选项。</param>
+	/// <param name="out_summary">结果统计。</param>
+	/// <param name="error">错误信息。</param>
+	/// <returns>是否完成比较。</returns>
+	bool ParallelDiffFiles(const std::string& old_path, const std::string& new_path, const std::string& out_path, const std::string& delimiter,
+	                       const DiffOptions& options, DiffSummary& out_summary, std::error_code& error);
+}
@@ -0,0 +1,306 @@
+﻿#pragma once
+#include <cstdint>
+#include <cstring>
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define FILE_HELPERS_CPP_SSE2
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace file_helpers_cpp
+{
+	/// <summary>
+	/// 统计64位掩码中置位的个数。
+	/// </summary>
+	/// <param name="mask">掩码。</param>
+	/// <returns>置位的个数。</returns>
+	inline int PopCount64(const uint64_t mask)
+	{
+#ifdef _MSC_VER
+		// 拆成两个32位，兼容Win32平台。
+		return static_cast<int>(__popcnt(static_cast<unsigned int>(mask)) + __popcnt(static_cast<unsigned int>(mask >> 32)));
+#else
+		return __builtin_popcountll(mask);
+#endif
+	}
+
+	/// <summary>
+	/// 获取64位掩码中最低置位的索引。掩码不能为0。
+	/// </summary>
+	/// <param name="mask">掩码。</param>
+	/// <returns>最低置位的索引。</returns>
+	inline int LowestBitIndex64(const uint64_t mask)
+	{
+#ifdef _MSC_VER
+		unsigned long index = 0;
+		if (_BitScanForward(&index, static_cast<unsigned long>(mask)))
+		{
+			return static_cast<int>(index);
+		}
+		_BitScanForward(&index, static_cast<unsigned long>(mask >> 32));
+		return static_cast<int>(index) + 32;
+#else
+		return __builtin_ctzll(mask);
+#endif
+	}
+
+	/// <summary>
+	/// 查找从指定位置开始的行的结束位置（换行符的位置）。
+	/// </summary>
+	/// <param name="data">文本数据。</param>
+	/// <param name="pos">行的起始位置。</param>
+	/// <param name="size">文本数据的长度。</param>
+	/// <returns>换行符的位置。没有换行符时返回size。</returns>
+	inline size_t FindLineEnd(const char* data, const size_t pos, const size_t size)
+	{
+		if (pos >= size)
+		{
+			return size;
+		}
+		const void* newline = std::memchr(data + pos, '\n', size - pos);
+		return newline != nullptr ? static_cast<const char*>(newline) - data : size;
+	}
+
+#ifdef FILE_HELPERS_CPP_SSE2
+	/// <summary>
+	/// 用SIMD比较计算64字节块中等于指定字节的位置掩码。
+	/// </summary>
+	/// <param name="block">64字节块。</param>
+	/// <param name="value">要查找的字节。</param>
+	/// <returns>位置掩码，第i位对应块中第i个字节。</returns>
+	inline uint64_t ByteMask64(const char* block, const char value)
+	{
+		const __m128i pattern = _mm_set1_epi8(value);
+		uint64_t mask = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i * 16));
+			mask |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, pattern)))) << (i * 16);
+		}
+		return mask;
+	}
+
+	/// <summary>
+	/// 计算64字节块中非空行行尾换行符的位置掩码。
+	/// 空行（只包含换行符或\r\n的行）的换行符不计入。块之间的行首状态通过两个进位值传递，第一块之前应为行首状态（1和0）。
+	/// </summary>
+	/// <param name="block">64字节块。</param>
+	/// <param name="carry_line_start">块首字符是否为行首。返回时更新为下一块的值。</param>
+	/// <param name="carry_cr_at_start">上一块末尾是否为位于行首的\r。返回时更新为下一块的值。</param>
+	/// <returns>非空行行尾换行符的位置掩码。</returns>
+	inline uint64_t NonEmptyLineEndMask(const char* block, uint64_t& carry_line_start, uint64_t& carry_cr_at_start)
+	{
+		const uint64_t newline_mask = ByteMask64(block, '\n');
+		const uint64_t cr_mask = ByteMask64(block, '\r');
+
+		// 换行符所在行为空行：该换行符本身位于行首，或其前一个字符是位于行首的\r。
+		const uint64_t line_start = (newline_mask << 1) | carry_line_start;
+		const uint64_t cr_at_start = cr_mask & line_start;
+		const uint64_t empty_newlines = newline_mask & (line_start | (cr_at_start << 1) | carry_cr_at_start);
+		carry_line_start = newline_mask >> 63;
+		carry_cr_at_start = cr_at_start >> 63;
+		return newline_mask & ~empty_newlines;
+	}
+#endif
+
+	/// <summary>
+	/// 从行首位置开始向后跳过指定数量的非空行，返回跳过后所在的行首位置。
+	/// 空行（只包含换行符或\r\n的行）不计入数量，与引擎读取时的行索引一致。
+	/// 以64字节为一块统计换行符，只在最后一块中逐字节定位。
+	/// </summary>
+	/// <param name="data">文本数据。</param>
+	/// <param name="pos">起始行的行首位置。</param>
+	/// <param name="size">文本数据的长度。</param>
+	/// <param name="count">要跳过的非空行数。</param>
+	/// <returns>跳过后所在的行首位置。行数不足时返回size。</returns>
+	inline size_t SkipNonEmptyLines(const char* data, size_t pos, const size_t size, size_t count)
+	{
+		if (count == 0)
+		{
+			return pos;
+		}
+
+#ifdef FILE_HELPERS_CPP_SSE2
+		uint64_t carry_line_start = 1;
+		uint64_t carry_cr_at_start = 0;
+		while (pos + 64 <= size)
+		{
+			uint64_t line_ends = NonEmptyLineEndMask(data + pos, carry_line_start, carry_cr_at_start);
+			const int line_end_count = PopCount64(line_ends);
+			if (static_cast<size_t>(line_end_count) < count)
+			{
+				count -= line_end_count;
+				pos += 64;
+				continue;
+			}
+
+			// 目标行在本块内，清除前count-1个置位后取最低置位。
+			for (size_t i = 1; i < count; i++)
+			{
+				line_ends &= line_ends - 1;
+			}
+			return pos + LowestBitIndex64(line_ends) + 1;
+		}
+		if (pos < size && carry_line_start == 0)
+		{
+			// 剩余部分从行中间开始，先回到当前行的行首。
+			while (pos > 0 && data[pos - 1] != '\n')
+			{
+				pos--;
+			}
+		}
+#endif
+
+		size_t line_begin = pos;
+		while (pos < size)
+		{
+			const size_t line_end = FindLineEnd(data, pos, size);
+			const bool is_empty = line_end == line_begin || (line_end == line_begin + 1 && data[line_begin] == '\r');
+			pos = line_end + 1;
+			line_begin = pos;
+			if (line_end < size && !is_empty && --count == 0)
+			{
+				return pos;
+			}
+		}
+		return size;
+	}
+
+	/// <summary>
+	/// 统计区间内以换行符结尾的非空行数。区间起始位置必须是行首。
+	/// </summary>
+	/// <param name="data">文本数据。</param>
+	/// <param name="pos">区间的起始位置。</param>
+	/// <param name="end">区间的结束位置。</param>
+	/// <returns>非空行数。</returns>
+	inline size_t CountNonEmptyLines(const char* data, size_t pos, const size_t end)
+	{
+		size_t count = 0;
+#ifdef FILE_HELPERS_CPP_SSE2
+		uint64_t carry_line_start = 1;
+		uint64_t carry_cr_at_start = 0;
+		while (pos + 64 <= end)
+		{
+			count += PopCount64(NonEmptyLineEndMask(data + pos, carry_line_start, carry_cr_at_start));
+			pos += 64;
+		}
+		if (pos < end && carry_line_start == 0)
+		{
+			// 剩余部分从行中间开始，先回到当前行的行首。该行的换行符还未计入。
+			while (pos > 0 && data[pos - 1] != '\n')
+			{
+				pos--;
+			}
+		}
+#endif
+
+		size_t line_begin = pos;
+		while (pos < end)
+		{
+			const size_t line_end = FindLineEnd(data, pos, end);
+			if (line_end < end && !(line_end == line_begin || (line_end == line_begin + 1 && data[line_begin] == '\r')))
+			{
+				count++;
+			}
+			pos = line_end + 1;
+			line_begin = pos;
+		}
+		return count;
+	}
+
+	/// <summary>
+	/// 统计区间内的非空行数。区间结束于文本末尾时，没有换行符结尾的最后一行也计入，与引擎读取时的行数一致。
+	/// </summary>
+	/// <param name="data">文本数据。</param>
+	/// <param name="pos">区间的起始位置，必须是行首。</param>
+	/// <param name="end">区间的结束位置。</param>
+	/// <param name="size">文本数据的长度。</param>
+	/// <returns>非空行数。</returns>
+	inline size_t CountNonEmptyRecords(const char* data, const size_t pos, const size_t end, const size_t size)
+	{
+		size_t count = CountNonEmptyLines(data, pos, end);
+		if (end == size && end > pos && data[end - 1] != '\n')
+		{
+			size_t line_begin = end;
+			while (line_begin > pos && data[line_begin - 1] != '\n')
+			{
+				line_begin--;
+			}
+			if (!(end - line_begin == 1 && data[line_begin] == '\r'))
+			{
+				count++;
+			}
+		}
+		return count;
+	}
+
+	/// <summary>
+	/// 从指定位置开始向后跳过指定数量的行（包括空行），返回跳过后所在的行首位置。
+	/// </summary>
+	/// <param name="data">文本数据。</param>
+	/// <param name="pos">起始位置。</param>
+	/// <param name="size">文本数据的长度。</param>
+	/// <param name="count">要跳过的换行符数。</param>
+	/// <returns>第count个换行符之后的位置。换行符不足时返回size。</returns>
+	inline size_t SkipLines(const char* data, size_t pos, const size_t size, size_t count)
+	{
+		if (count == 0)
+		{
+			return pos;
+		}
+#ifdef FILE_HELPERS_CPP_SSE2
+		while (pos + 64 <= size)
+		{
+			uint64_t line_ends = ByteMask64(data + pos, '\n');
+			const int line_end_count = PopCount64(line_ends);
+			if (static_cast<size_t>(line_end_count) < count)
+			{
+				count -= line_end_count;
+				pos += 64;
+				continue;
+			}
+			for (size_t i = 1; i < count; i++)
+			{
+				line_ends &= line_ends - 1;
+			}
+			return pos + LowestBitIndex64(line_ends) + 1;
+		}
+#endif
+		while (pos < size)
+		{
+			const size_t line_end = FindLineEnd(data, pos, size);
+			pos = line_end + 1;
+			if (line_end < size && --count == 0)
+			{
+				return pos;
+			}
+		}
+		return size;
+	}
+
+	/// <summary>
+	/// 统计区间内的换行符数。
+	/// </summary>
+	/// <param name="data">文本数据。</param>
+	/// <param name="pos">区间的起始位置。</param>
+	/// <param name="end">区间的结束位置。</param>
+	/// <returns>换行符数。</returns>
+	inline size_t CountLineEnds(const char* data, size_t pos, const size_t end)
+	{
+		size_t count = 0;
+#ifdef FILE_HELPERS_CPP_SSE2
+		while (pos + 64 <= end)
+		{
+			count += PopCount64(ByteMask64(data + pos, '\n'));
+			pos += 64;
+		}
+#endif
+		for (; pos < end; pos++)
+		{
+			count += data[pos] == '\n';
+		}
+		return count;
+	}
+}
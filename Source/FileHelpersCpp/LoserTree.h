@@ -0,0 +1,82 @@
+﻿#pragma once
+#include <utility>
+#include <vector>
+
+namespace file_helpers_cpp
+{
+	/// <summary>
+	/// 用于k路归并的败者树。每次取出胜者后只需沿一条路径与log2(k)个败者比较。
+	/// 比较函数less(a, b)判断序号为a的来源的当前元素是否应排在序号为b的来源之前，已耗尽的来源应排在最后；
+	/// 相等时按序号比较可使归并稳定。
+	/// </summary>
+	template <typename Less>
+	class LoserTree
+	{
+	private:
+		Less less;
+
+		size_t source_count;
+
+		/// <summary>
+		/// tree[0]为胜者，tree[1..k-1]为各内部节点的败者。叶子节点k+i对应来源i。
+		/// </summary>
+		std::vector<size_t> tree;
+
+	public:
+		/// <summary>
+		/// 以各来源的当前元素建立败者树。
+		/// </summary>
+		/// <param name="source_count">来源数，至少为1。</param>
+		/// <param name="less">比较函数。</param>
+		LoserTree(const size_t source_count, Less less)
+			: less(std::move(less)), source_count(source_count), tree(source_count)
+		{
+			std::vector<size_t> winners(source_count * 2);
+			for (size_t i = 0; i < source_count; i++)
+			{
+				winners[source_count + i] = i;
+			}
+			for (size_t node = source_count - 1; node > 0; node--)
+			{
+				const size_t left = winners[node * 2];
+				const size_t right = winners[node * 2 + 1];
+				if (this->less(right, left))
+				{
+					winners[node] = right;
+					tree[node] = left;
+				}
+				else
+				{
+					winners[node] = left;
+					tree[node] = right;
+				}
+			}
+			tree[0] = source_count > 1 ? winners[1] : 0;
+		}
+
+		/// <summary>
+		/// 获取当前胜者的来源序号。
+		/// </summary>
+		/// <returns>来源序号。</returns>
+		size_t Winner() const
+		{
+			return tree[0];
+		}
+
+		/// <summary>
+		/// 胜者的来源前进到下一个元素后重新比赛。
+		/// </summary>
+		void ReplayWinner()
+		{
+			size_t winner = tree[0];
+			for (size_t node = (source_count + winner) / 2; node > 0; node /= 2)
+			{
+				if (less(tree[node], winner))
+				{
+					std::swap(tree[node], winner);
+				}
+			}
+			tree[0] = winner;
+		}
+	};
+}
@@ -0,0 +1,138 @@
+﻿#include "pch.h"
+#include <algorithm>
+#include <cstring>
+#include "MappedFileAppender.h"
+
+using namespace file_helpers_cpp;
+
+/// <summary>
+/// 析构函数。未关闭时释放保留的空间并关闭文件。
+/// </summary>
+MappedFileAppender::~MappedFileAppender()
+{
+	std::error_code error;
+	Close(error);
+}
+
+/// <summary>
+/// 打开文件，准备在文件末尾追加数据。文件不存在则创建文件。
+/// </summary>
+/// <param name="path">文件路径。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否成功打开文件。</returns>
+bool MappedFileAppender::Open(const std::string& path, std::error_code& error)
+{
+	if (!file.Open(path, error))
+	{
+		return false;
+	}
+
+	logical_size = file.Size(error);
+	if (logical_size < 0)
+	{
+		file.Close();
+		return false;
+	}
+	reserved_size = logical_size;
+	return true;
+}
+
+/// <summary>
+/// 保留的空间不足以容纳指定的字节数时，按几何级数以KeepSize方式保留磁盘空间。
+/// </summary>
+/// <param name="required_size">需要容纳的字节数。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否成功保留。</returns>
+bool MappedFileAppender::Reserve(const long long required_size, std::error_code& error)
+{
+	if (logical_size + required_size <= reserved_size)
+	{
+		return true;
+	}
+
+	// 按当前文件大小的一半几何扩展，限制在[kMinGrowSize, kMaxGrowSize]区间内。保留的空间不改变文件大小，文件系统不支持时忽略。
+	const long long grow_size = std::max(required_size, std::min(std::max(logical_size / 2, kMinGrowSize), kMaxGrowSize));
+	if (!file.PreAllocate(logical_size, grow_size, PreAllocateMode::KeepSize, error))
+	{
+		return false;
+	}
+	reserved_size = logical_size + grow_size;
+	return true;
+}
+
+/// <summary>
+/// 同步并解除最近一次追加的映射。
+/// </summary>
+/// <param name="error">错误信息。</param>
+/// <returns>是否成功同步。</returns>
+bool MappedFileAppender::ReleaseTail(std::error_code& error)
+{
+	if (!tail_mmap.is_mapped())
+	{
+		return true;
+	}
+	tail_mmap.sync(error);
+	tail_mmap.unmap();
+	return !error;
+}
+
+/// <summary>
+/// 向文件末尾追加数据。
+/// </summary>
+/// <param name="data">要追加的数据。</param>
+/// <param name="size">要追加的字节数。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否完成追加操作。</returns>
+bool MappedFileAppender::Append(const char* data, const size_t size, std::error_code& error)
+{
+	if (size == 0)
+	{
+		return true;
+	}
+	if (!ReleaseTail(error) || !Reserve(static_cast<long long>(size), error))
+	{
+		return false;
+	}
+
+	// 文件只扩展到追加后的长度，落在保留的空间内，不需要再分配磁盘空间。
+	const long long new_size = logical_size + static_cast<long long>(size);
+	if (!file.Resize(new_size, error))
+	{
+		return false;
+	}
+	tail_mmap.map(file.NativeHandle(), static_cast<size_t>(logical_size), size, error);
+	if (error)
+	{
+		// 映射失败时恢复原来的文件大小。
+		std::error_code resize_error;
+		file.Resize(logical_size, resize_error);
+		return false;
+	}
+
+	std::memcpy(tail_mmap.data(), data, size);
+	logical_size = new_size;
+	return true;
+}
+
+/// <summary>
+/// 同步并解除映射，释放超出文件大小的保留空间，然后关闭文件。
+/// </summary>
+/// <param name="error">错误信息。</param>
+/// <returns>是否成功关闭。</returns>
+bool MappedFileAppender::Close(std::error_code& error)
+{
+	if (!file.IsOpen())
+	{
+		return true;
+	}
+
+	ReleaseTail(error);
+	// 截断到文件大小，释放超出文件末尾的保留空间。
+	if (!error && reserved_size > logical_size)
+	{
+		file.Resize(logical_size, error);
+	}
+	reserved_size = logical_size;
+	file.Close();
+	return !error;
+}
@@ -0,0 +1,98 @@
+﻿#pragma once
+#include <string>
+#include <system_error>
+#include "mio.hpp"
+#include "NativeFile.h"
+
+namespace file_helpers_cpp
+{
+	/// <summary>
+	/// 基于内存映射文件向文件末尾追加数据的写入器。
+	/// 磁盘空间按几何级数以KeepSize方式保留，不改变文件大小；每次追加只将文件扩展到追加后的长度并映射新增的区域，
+	/// 进程在追加过程中退出时文件末尾最多留下一次追加的未写入部分，不会留下预分配的空字节。
+	/// </summary>
+	class MappedFileAppender
+	{
+	private:
+		/// <summary>
+		/// 每次保留磁盘空间的最小字节数。
+		/// </summary>
+		static constexpr long long kMinGrowSize = 64LL * 1024 * 1024;
+
+		/// <summary>
+		/// 每次保留磁盘空间的最大字节数。
+		/// </summary>
+		static constexpr long long kMaxGrowSize = 1024LL * 1024 * 1024;
+
+		/// <summary>
+		/// 追加的目标文件。
+		/// </summary>
+		NativeFile file;
+
+		/// <summary>
+		/// 最近一次追加映射的区域。
+		/// </summary>
+		mio::mmap_sink tail_mmap;
+
+		/// <summary>
+		/// 已写入数据的长度，即文件大小。
+		/// </summary>
+		long long logical_size = 0;
+
+		/// <summary>
+		/// 已保留磁盘空间的末尾偏移量，超出文件大小的部分不可见。
+		/// </summary>
+		long long reserved_size = 0;
+
+		/// <summary>
+		/// 保留的空间不足以容纳指定的字节数时，按几何级数以KeepSize方式保留磁盘空间。
+		/// </summary>
+		/// <param name="required_size">需要容纳的字节数。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否成功保留。</returns>
+		bool Reserve(long long required_size, std::error_code& error);
+
+		/// <summary>
+		/// 同步并解除最近一次追加的映射。
+		/// </summary>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否成功同步。</returns>
+		bool ReleaseTail(std::error_code& error);
+
+	public:
+		MappedFileAppender() = default;
+
+		/// <summary>
+		/// 析构函数。未关闭时释放保留的空间并关闭文件。
+		/// </summary>
+		~MappedFileAppender();
+
+		MappedFileAppender(const MappedFileAppender&) = delete;
+
+		MappedFileAppender& operator=(const MappedFileAppender&) = delete;
+
+		/// <summary>
+		/// 打开文件，准备在文件末尾追加数据。文件不存在则创建文件。
+		/// </summary>
+		/// <param name="path">文件路径。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否成功打开文件。</returns>
+		bool Open(const std::string& path, std::error_code& error);
+
+		/// <summary>
+		/// 向文件末尾追加数据。
+		/// </summary>
+		/// <param name="data">要追加的数据。</param>
+		/// <param name="size">要追加的字节数。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否完成追加操作。</returns>
+		bool Append(const char* data, size_t size, std::error_code& error);
+
+		/// <summary>
+		/// 同步并解除映射，释放超出文件大小的保留空间，然后关闭文件。
+		/// </summary>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否成功关闭。</returns>
+		bool Close(std::error_code& error);
+	};
+}
@@ -0,0 +1,94 @@
+﻿#include "pch.h"
+#include <algorithm>
+#include "LineScanner.h"
+#include "MappedLineReader.h"
+
+using namespace file_helpers_cpp;
+
+/// <summary>
+/// 从指定偏移量开始重新映射窗口。
+/// </summary>
+/// <param name="offset">窗口的起始偏移量。</param>
+/// <param name="length">窗口的字节数，超出文件末尾时截断。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否成功映射。</returns>
+bool MappedLineReader::MapWindow(const long long offset, const size_t length, std::error_code& error)
+{
+	window.unmap();
+	window_offset = offset;
+	position = 0;
+	const size_t mapped_length = static_cast<size_t>(std::min(static_cast<long long>(length), file_size - offset));
+	if (mapped_length == 0)
+	{
+		return true;
+	}
+	window.map(file.NativeHandle(), static_cast<size_t>(offset), mapped_length, error);
+	return !error;
+}
+
+/// <summary>
+/// 打开文件并映射第一个窗口。
+/// </summary>
+/// <param name="path">文件路径。</param>
+/// <param name="window_size">窗口的字节数。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否成功打开文件。</returns>
+bool MappedLineReader::Open(const std::string& path, const size_t window_size, std::error_code& error)
+{
+	if (!file.OpenRead(path, error))
+	{
+		return false;
+	}
+	file_size = file.Size(error);
+	if (file_size < 0)
+	{
+		return false;
+	}
+	this->window_size = std::max<size_t>(window_size, 4096);
+	return MapWindow(0, this->window_size, error);
+}
+
+/// <summary>
+/// 读取下一行。
+/// </summary>
+/// <param name="line">不含换行符的行，在下一次调用前有效。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否读取到一行。到达文件末尾或出错时返回false，出错时设置error。</returns>
+bool MappedLineReader::Next(std::string_view& line, std::error_code& error)
+{
+	while (true)
+	{
+		const size_t size = window.is_mapped() ? window.size() : 0;
+		const long long window_end = window_offset + static_cast<long long>(size);
+		if (position >= size && window_end >= file_size)
+		{
+			return false;
+		}
+
+		const size_t line_end = position < size ? FindLineEnd(window.data(), position, size) : size;
+		if (line_end < size || window_end >= file_size)
+		{
+			// 找到换行符，或者是文件的最后一行。
+			line = std::string_view(window.data() + position, line_end - position);
+			position = line_end + 1;
+			return true;
+		}
+
+		// 行跨越窗口末尾，从行首重新映射。行比窗口长时扩大一倍。
+		const size_t partial = size - position;
+		const size_t length = partial * 2 > window_size ? partial * 2 : window_size;
+		if (!MapWindow(window_offset + static_cast<long long>(position), length, error))
+		{
+			return false;
+		}
+	}
+}
+
+/// <summary>
+/// 解除映射并关闭文件。
+/// </summary>
+void MappedLineReader::Close()
+{
+	window.unmap();
+	file.Close();
+}
@@ -0,0 +1,76 @@
+﻿#pragma once
+#include <string>
+#include <string_view>
+#include <system_error>
+#include "mio.hpp"
+#include "NativeFile.h"
+
+namespace file_helpers_cpp
+{
+	/// <summary>
+	/// 通过滑动的内存映射窗口顺序读取文本行的读取器，任意时刻只映射文件的一个窗口，内存占用与文件大小无关。
+	/// 行跨越窗口末尾时从该行的行首重新映射，长于窗口的行会临时扩大窗口。
+	/// </summary>
+	class MappedLineReader
+	{
+	private:
+		NativeFile file;
+
+		mio::mmap_source window;
+
+		/// <summary>
+		/// 窗口的默认字节数。
+		/// </summary>
+		size_t window_size = 0;
+
+		/// <summary>
+		/// 窗口在文件中的起始偏移量。
+		/// </summary>
+		long long window_offset = 0;
+
+		/// <summary>
+		/// 下一行在窗口中的起始位置。
+		/// </summary>
+		size_t position = 0;
+
+		long long file_size = 0;
+
+		/// <summary>
+		/// 从指定偏移量开始重新映射窗口。
+		/// </summary>
+		/// <param name="offset">窗口的起始偏移量。</param>
+		/// <param name="length">窗口的字节数，超出文件末尾时截断。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否成功映射。</returns>
+		bool MapWindow(long long offset, size_t length, std::error_code& error);
+
+	public:
+		MappedLineReader() = default;
+
+		MappedLineReader(const MappedLineReader&) = delete;
+
+		MappedLineReader& operator=(const MappedLineReader&) = delete;
+
+		/// <summary>
+		/// 打开文件并映射第一个窗口。
+		/// </summary>
+		/// <param name="path">文件路径。</param>
+		/// <param name="window_size">窗口的字节数。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否成功打开文件。</returns>
+		bool Open(const std::string& path, size_t window_size, std::error_code& error);
+
+		/// <summary>
+		/// 读取下一行。
+		/// </summary>
+		/// <param name="line">不含换行符的行，在下一次调用前有效。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否读取到一行。到达文件末尾或出错时返回false，出错时设置error。</returns>
+		bool Next(std::string_view& line, std::error_code& error);
+
+		/// <summary>
+		/// 解除映射并关闭文件。
+		/// </summary>
+		void Close();
+	};
+}
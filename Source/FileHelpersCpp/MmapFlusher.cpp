@@ -0,0 +1,187 @@
+﻿#include "pch.h"
+#include <algorithm>
+#include <cerrno>
+#include <limits>
+#include "MmapFlusher.h"
+
+using namespace file_helpers_cpp;
+
+/// <summary>
+/// 有参构造函数。策略要求后台刷新时启动刷新线程。
+/// </summary>
+/// <param name="rw_mmap">被刷新的内存映射。</param>
+/// <param name="policy">刷新策略。</param>
+MmapFlusher::MmapFlusher(mio::mmap_sink& rw_mmap, const MmapFlushPolicy& policy)
+	: rw_mmap(rw_mmap), policy(policy), last_flush_time(std::chrono::steady_clock::now())
+{
+	if (policy.mode == MmapFlushMode::OnClose)
+	{
+		report_step = std::numeric_limits<size_t>::max();
+	}
+	else if (policy.mode == MmapFlushMode::Bytes && !policy.background)
+	{
+		report_step = std::max<size_t>(policy.flush_bytes, 1);
+	}
+	else
+	{
+		report_step = kReportStepBytes;
+	}
+
+	if (policy.background && policy.mode != MmapFlushMode::OnClose)
+	{
+		flush_thread = std::thread(&MmapFlusher::FlushLoop, this);
+	}
+}
+
+/// <summary>
+/// 析构函数。停止后台刷新线程。
+/// </summary>
+MmapFlusher::~MmapFlusher()
+{
+	if (flush_thread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(flush_mutex);
+			stop_requested = true;
+		}
+		flush_condition.notify_one();
+		flush_thread.join();
+	}
+}
+
+/// <summary>
+/// 写入方报告进度时判断是否需要刷新。
+/// </summary>
+/// <param name="size">已写入的长度。</param>
+void MmapFlusher::OnReport(const size_t size)
+{
+	reported_size = size;
+	if (flush_thread.joinable())
+	{
+		// 后台刷新时只发布进度并唤醒刷新线程，是否刷新由刷新线程判断，写入方不会被阻塞。
+		written_size.store(size, std::memory_order_release);
+		flush_condition.notify_one();
+		return;
+	}
+
+	if (ShouldFlush(size))
+	{
+		std::error_code error;
+		FlushRange(size, policy.async, error);
+		if (error && !first_error)
+		{
+			first_error = error;
+		}
+	}
+}
+
+/// <summary>
+/// 判断当前是否满足刷新条件。
+/// </summary>
+/// <param name="size">已写入的长度。</param>
+/// <returns>是否需要刷新。</returns>
+bool MmapFlusher::ShouldFlush(const size_t size) const
+{
+	switch (policy.mode)
+	{
+	case MmapFlushMode::Bytes:
+		return size - flushed_size >= policy.flush_bytes;
+	case MmapFlushMode::Interval:
+		return std::chrono::steady_clock::now() - last_flush_time >= std::chrono::milliseconds(policy.flush_interval_ms);
+	default:
+		return false;
+	}
+}
+
+/// <summary>
+/// 刷新[flushed_size, size)区间的脏数据。
+/// </summary>
+/// <param name="size">已写入的长度。</param>
+/// <param name="async">是否异步刷新。</param>
+/// <param name="error">错误信息。</param>
+void MmapFlusher::FlushRange(const size_t size, const bool async, std::error_code& error)
+{
+	last_flush_time = std::chrono::steady_clock::now();
+	if (size <= flushed_size)
+	{
+		return;
+	}
+
+	// 刷新的起始地址必须按页对齐。映射的起始地址本身是页对齐的。
+	const size_t page_size = mio::page_size();
+	const size_t mapping_offset = rw_mmap.mapping_offset();
+	const size_t aligned_begin = (mapping_offset + flushed_size) / page_size * page_size;
+	char* const flush_start = rw_mmap.data() - mapping_offset + aligned_begin;
+	const size_t flush_length = mapping_offset + size - aligned_begin;
+
+#ifdef _WIN32
+	// FlushViewOfFile只发起回写，同步刷新时还需等待文件缓冲区写入磁盘。
+	if (!FlushViewOfFile(flush_start, flush_length) || (!async && !FlushFileBuffers(rw_mmap.file_handle())))
+	{
+		error = std::error_code(GetLastError(), std::system_category());
+		return;
+	}
+#else
+	if (msync(flush_start, flush_length, async ? MS_ASYNC : MS_SYNC) != 0)
+	{
+		error = std::error_code(errno, std::system_category());
+		return;
+	}
+#endif
+	flushed_size = size;
+}
+
+/// <summary>
+/// 后台刷新线程的主循环。
+/// </summary>
+void MmapFlusher::FlushLoop()
+{
+	// 按字节数刷新时也定期醒来检查，避免错过写入方的通知。
+	const auto wait_time = std::chrono::milliseconds(policy.mode == MmapFlushMode::Interval ? std::max(policy.flush_interval_ms, 1) : 100);
+
+	std::unique_lock<std::mutex> lock(flush_mutex);
+	while (!stop_requested)
+	{
+		flush_condition.wait_for(lock, wait_time);
+		if (stop_requested)
+		{
+			break;
+		}
+
+		const size_t size = written_size.load(std::memory_order_acquire);
+		if (ShouldFlush(size))
+		{
+			lock.unlock();
+			std::error_code error;
+			FlushRange(size, policy.async, error);
+			if (error && !first_error)
+			{
+				first_error = error;
+			}
+			lock.lock();
+		}
+	}
+}
+
+/// <summary>
+/// 停止后台刷新线程，并同步刷新整个映射。
+/// </summary>
+/// <param name="error">错误信息。写入过程中的刷新失败时为第一次失败的错误。</param>
+void MmapFlusher::Finish(std::error_code& error)
+{
+	if (flush_thread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(flush_mutex);
+			stop_requested = true;
+		}
+		flush_condition.notify_one();
+		flush_thread.join();
+	}
+	rw_mmap.sync(error);
+	flushed_size = rw_mmap.size();
+	if (first_error)
+	{
+		error = first_error;
+	}
+}
@@ -0,0 +1,145 @@
+﻿#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include "mio.hpp"
+#include "FileMMFEngineBase.h"
+
+namespace file_helpers_cpp
+{
+	/// <summary>
+	/// 按刷新策略将内存映射写入的脏数据刷新到磁盘。写入方在顺序写入过程中报告已写入的长度，由刷新器决定何时刷新哪一段区间。
+	/// </summary>
+	class MmapFlusher
+	{
+	private:
+		/// <summary>
+		/// 按时间刷新或后台刷新时，写入方报告进度的粒度（字节）。
+		/// </summary>
+		static constexpr size_t kReportStepBytes = 1024 * 1024;
+
+		/// <summary>
+		/// 被刷新的内存映射。
+		/// </summary>
+		mio::mmap_sink& rw_mmap;
+
+		/// <summary>
+		/// 刷新策略。
+		/// </summary>
+		const MmapFlushPolicy policy;
+
+		/// <summary>
+		/// 写入方两次报告之间的最小字节数。
+		/// </summary>
+		size_t report_step;
+
+		/// <summary>
+		/// 写入方上一次报告时已写入的长度。
+		/// </summary>
+		size_t reported_size = 0;
+
+		/// <summary>
+		/// 已写入的长度。后台刷新时由刷新线程读取。
+		/// </summary>
+		std::atomic<size_t> written_size{0};
+
+		/// <summary>
+		/// 已刷新的长度。
+		/// </summary>
+		size_t flushed_size = 0;
+
+		/// <summary>
+		/// 上一次刷新的时间。
+		/// </summary>
+		std::chrono::steady_clock::time_point last_flush_time;
+
+		/// <summary>
+		/// 后台刷新线程。
+		/// </summary>
+		std::thread flush_thread;
+
+		/// <summary>
+		/// 后台刷新线程的同步对象。
+		/// </summary>
+		std::mutex flush_mutex;
+
+		/// <summary>
+		/// 唤醒后台刷新线程的条件变量。
+		/// </summary>
+		std::condition_variable flush_condition;
+
+		/// <summary>
+		/// 是否已请求停止后台刷新线程。
+		/// </summary>
+		bool stop_requested = false;
+
+		/// <summary>
+		/// 写入过程中第一次刷新失败的错误。后台刷新时由刷新线程写入，Finish在刷新线程退出后读取。
+		/// </summary>
+		std::error_code first_error;
+
+		/// <summary>
+		/// 写入方报告进度时判断是否需要刷新。
+		/// </summary>
+		/// <param name="size">已写入的长度。</param>
+		void OnReport(size_t size);
+
+		/// <summary>
+		/// 判断当前是否满足刷新条件。后台刷新时只在刷新线程中调用。
+		/// </summary>
+		/// <param name="size">已写入的长度。</param>
+		/// <returns>是否需要刷新。</returns>
+		bool ShouldFlush(size_t size) const;
+
+		/// <summary>
+		/// 刷新[flushed_size, size)区间的脏数据。
+		/// </summary>
+		/// <param name="size">已写入的长度。</param>
+		/// <param name="async">是否异步刷新。</param>
+		/// <param name="error">错误信息。</param>
+		void FlushRange(size_t size, bool async, std::error_code& error);
+
+		/// <summary>
+		/// 后台刷新线程的主循环。
+		/// </summary>
+		void FlushLoop();
+
+	public:
+		/// <summary>
+		/// 有参构造函数。策略要求后台刷新时启动刷新线程。
+		/// </summary>
+		/// <param name="rw_mmap">被刷新的内存映射。</param>
+		/// <param name="policy">刷新策略。</param>
+		MmapFlusher(mio::mmap_sink& rw_mmap, const MmapFlushPolicy& policy);
+
+		/// <summary>
+		/// 析构函数。停止后台刷新线程。
+		/// </summary>
+		~MmapFlusher();
+
+		MmapFlusher(const MmapFlusher&) = delete;
+
+		MmapFlusher& operator=(const MmapFlusher&) = delete;
+
+		/// <summary>
+		/// 报告已顺序写入的长度。未达到报告粒度时只做一次比较，可在每行写入后调用。
+		/// </summary>
+		/// <param name="size">从映射起始位置开始已写入的长度。</param>
+		void Advance(const size_t size)
+		{
+			if (size - reported_size >= report_step)
+			{
+				OnReport(size);
+			}
+		}
+
+		/// <summary>
+		/// 停止后台刷新线程，并同步刷新整个映射。
+		/// </summary>
+		/// <param name="error">错误信息。写入过程中的刷新失败时为第一次失败的错误。</param>
+		void Finish(std::error_code& error);
+	};
+}
@@ -0,0 +1,349 @@
+﻿#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <system_error>
+#include <vector>
+#include "DelimitedFileMMFEngine.h"
+#include "ThreadPool.h"
+#include "TraceRecorder.h"
+
+namespace file_helpers_cpp
+{
+	/// <summary>
+	/// 估算一个字段占用的内存字节数。
+	/// </summary>
+	inline size_t FieldMemoryBytes(const double&)
+	{
+		return sizeof(double);
+	}
+
+	/// <summary>
+	/// 估算一个字段占用的内存字节数。短字符串存放在对象内部，不计堆内存。
+	/// </summary>
+	inline size_t FieldMemoryBytes(const std::string& field)
+	{
+		return sizeof(std::string) + (field.capacity() >= sizeof(std::string) ? field.capacity() + 1 : 0);
+	}
+
+	/// <summary>
+	/// 估算读取结果占用的内存字节数。
+	/// </summary>
+	/// <param name="records">读取的记录。</param>
+	/// <returns>占用的内存字节数。</returns>
+	template <typename T>
+	size_t RecordsMemoryBytes(const std::vector<std::vector<T>>& records)
+	{
+		size_t bytes = records.capacity() * sizeof(std::vector<T>);
+		for (const auto& record : records)
+		{
+			bytes += (record.capacity() - record.size()) * sizeof(T);
+			for (const auto& field : record)
+			{
+				bytes += FieldMemoryBytes(field);
+			}
+		}
+		return bytes;
+	}
+
+	/// <summary>
+	/// 在共享线程池中并行读取多个文件，按内存上限限制在途文件数。调用线程负责提交读取任务和调用回调，等待期间帮助线程池执行任务。
+	/// 提交前按文件大小和已观察到的膨胀比例估算内存占用，读取完成后改按实际占用计算，回调返回后释放。
+	/// </summary>
+	template <typename T>
+	class MultiFileReader
+	{
+	public:
+		/// <summary>
+		/// 读取一个文件的函数，返回是否读取成功。可能被多个线程同时调用。
+		/// </summary>
+		using ReadFunction = std::function<bool(const std::string& path, std::vector<std::vector<T>>& records)>;
+
+		/// <summary>
+		/// 对一个文件读取结果的处理，返回false表示停止读取剩余的文件。
+		/// </summary>
+		using Callback = std::function<bool(size_t file_index, std::vector<std::vector<T>>& records, const std::error_code& error)>;
+
+	private:
+		/// <summary>
+		/// 未指定内存上限时的默认值。
+		/// </summary>
+		static constexpr size_t kDefaultMemoryBudget = 1024ull * 1024 * 1024;
+
+		/// <summary>
+		/// 尚未读取完任何文件时，估算读取结果占用内存与文件大小的比例。
+		/// </summary>
+		static constexpr double kInitialExpansion = 3.0;
+
+		/// <summary>
+		/// 表示一个文件的读取结果。
+		/// </summary>
+		struct Result
+		{
+			std::vector<std::vector<T>> records;
+
+			std::error_code error;
+
+			/// <summary>
+			/// 计入在途内存的字节数。
+			/// </summary>
+			size_t charged_bytes = 0;
+		};
+
+		const std::vector<std::string>& paths;
+
+		const ReadFunction& read;
+
+		std::shared_ptr<ThreadPool> pool;
+
+		/// <summary>
+		/// 同时读取的文件数上限。
+		/// </summary>
+		size_t thread_count;
+
+		/// <summary>
+		/// 在途文件占用内存的上限。
+		/// </summary>
+		size_t memory_budget;
+
+		/// <summary>
+		/// 是否按路径列表的顺序调用回调。
+		/// </summary>
+		bool ordered;
+
+		/// <summary>
+		/// 正在读取的文件数。
+		/// </summary>
+		size_t running_tasks = 0;
+
+		/// <summary>
+		/// 在途文件占用的内存字节数。
+		/// </summary>
+		size_t in_flight_bytes = 0;
+
+		/// <summary>
+		/// 已观察到的读取结果占用内存与文件大小的最大比例。
+		/// </summary>
+		double expansion = 0;
+
+		/// <summary>
+		/// 已读取、等待交给回调的结果。<文件索引，读取结果>
+		/// </summary>
+		std::map<size_t, Result> completed_results;
+
+		std::mutex mutex;
+
+		std::condition_variable condition;
+
+		/// <summary>
+		/// 估算读取一个文件的在途内存：读取期间的映射加上读取结果。
+		/// </summary>
+		/// <param name="file_size">文件大小。</param>
+		/// <returns>估算的字节数。</returns>
+		size_t EstimateBytes(const size_t file_size) const
+		{
+			const double ratio = expansion > 0 ? expansion : kInitialExpansion;
+			return file_size + static_cast<size_t>(static_cast<double>(file_size) * ratio);
+		}
+
+		/// <summary>
+		/// 读取任务：读取一个文件，按实际占用修正在途内存后放入结果表。
+		/// </summary>
+		/// <param name="file_index">文件索引。</param>
+		/// <param name="file_size">文件大小。</param>
+		/// <param name="estimated_bytes">提交时计入在途内存的字节数。</param>
+		void ReadFile(const size_t file_index, const size_t file_size, const size_t estimated_bytes)
+		{
+			Result result;
+			TraceSpan span("read", "MultiFileReader", "file", static_cast<long long>(file_index));
+			try
+			{
+				if (!read(paths[file_index], result.records))
+				{
+					result.error = std::make_error_code(std::errc::io_error);
+				}
+			}
+			catch (std::bad_alloc&)
+			{
+				result.error = std::make_error_code(std::errc::not_enough_memory);
+			}
+			catch (std::exception&)
+			{
+				result.error = std::make_error_code(std::errc::io_error);
+			}
+			if (result.error)
+			{
+				std::vector<std::vector<T>>().swap(result.records);
+			}
+			result.charged_bytes = RecordsMemoryBytes(result.records);
+			span.End();
+
+			// 在锁内通知，调用线程观察到所有任务完成后才可能销毁读取器。
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!result.error && file_size > 0)
+			{
+				expansion = std::max(expansion, static_cast<double>(result.charged_bytes) / static_cast<double>(file_size));
+			}
+			in_flight_bytes = in_flight_bytes - estimated_bytes + result.charged_bytes;
+			completed_results.emplace(file_index, std::move(result));
+			running_tasks--;
+			condition.notify_all();
+		}
+
+	public:
+		/// <summary>
+		/// 有参构造函数。
+		/// </summary>
+		/// <param name="paths">文件路径列表。</param>
+		/// <param name="read">读取一个文件的函数。</param>
+		/// <param name="options">批量读取的配置。</param>
+		MultiFileReader(const std::vector<std::string>& paths, const ReadFunction& read, const MultiFileReadOptions& options)
+			: paths(paths),
+			  read(read),
+			  pool(ThreadPool::Shared()),
+			  thread_count(static_cast<size_t>(pool->Parallelism(options.thread_count))),
+			  memory_budget(options.memory_budget > 0 ? options.memory_budget : kDefaultMemoryBudget),
+			  ordered(options.ordered)
+		{
+		}
+
+		MultiFileReader(const MultiFileReader&) = delete;
+
+		MultiFileReader& operator=(const MultiFileReader&) = delete;
+
+		/// <summary>
+		/// 读取所有文件并依次调用回调。
+		/// </summary>
+		/// <param name="callback">对每个文件读取结果的处理。</param>
+		/// <param name="error">错误信息。第一个读取失败的文件的错误，或回调在还有文件未处理时停止读取的operation_canceled。</param>
+		/// <returns>是否所有文件都已读取并交给回调处理。</returns>
+		bool Run(const Callback& callback, std::error_code& error)
+		{
+			const size_t file_count = paths.size();
+			size_t next_file = 0;
+			size_t delivered_count = 0;
+			bool stopped = false;
+
+			// 下一个要提交的文件的大小，提交前在锁外获取。
+			std::error_code next_error;
+			size_t next_size = 0;
+			const auto prepare_next = [&]
+			{
+				if (next_file < file_count)
+				{
+					next_error.clear();
+					const auto size = std::filesystem::file_size(paths[next_file], next_error);
+					next_size = next_error ? 0 : static_cast<size_t>(size);
+				}
+			};
+			prepare_next();
+
+			// 在途内存为0时总是允许提交，单个超过上限的文件也能读取。
+			const auto can_submit = [&]
+			{
+				return !stopped && next_file < file_count && running_tasks < thread_count &&
+					(in_flight_bytes == 0 || in_flight_bytes + EstimateBytes(next_size) <= memory_budget);
+			};
+			const auto next_result = [&]
+			{
+				return ordered ? completed_results.find(delivered_count) : completed_results.begin();
+			};
+
+			std::unique_lock<std::mutex> lock(mutex);
+			while (true)
+			{
+				// 调用回调，回调返回后释放该文件的在途内存。
+				const auto iter = next_result();
+				if (!stopped && iter != completed_results.end())
+				{
+					const size_t file_index = iter->first;
+					Result result = std::move(iter->second);
+					completed_results.erase(iter);
+					lock.unlock();
+
+					if (result.error && !error)
+					{
+						error = result.error;
+					}
+					bool keep_reading = false;
+					try
+					{
+						keep_reading = callback(file_index, result.records, result.error);
+					}
+					catch (std::exception&)
+					{
+					}
+					std::vector<std::vector<T>>().swap(result.records);
+
+					lock.lock();
+					in_flight_bytes -= result.charged_bytes;
+					delivered_count++;
+					if (!keep_reading)
+					{
+						stopped = true;
+					}
+					continue;
+				}
+
+				if (delivered_count == file_count || (stopped && running_tasks == 0))
+				{
+					break;
+				}
+
+				if (can_submit())
+				{
+					const size_t file_index = next_file++;
+					if (next_error || next_size == 0)
+					{
+						// 无法获取大小的文件和空文件不提交任务，直接作为结果。
+						Result result;
+						result.error = next_error;
+						completed_results.emplace(file_index, std::move(result));
+					}
+					else
+					{
+						const size_t file_size = next_size;
+						const size_t estimated_bytes = EstimateBytes(file_size);
+						in_flight_bytes += estimated_bytes;
+						running_tasks++;
+						pool->Submit([this, file_index, file_size, estimated_bytes] { ReadFile(file_index, file_size, estimated_bytes); });
+					}
+					lock.unlock();
+					prepare_next();
+					lock.lock();
+					continue;
+				}
+
+				// 等待期间先帮助线程池执行任务，没有可执行的任务时等待某个读取任务完成。
+				lock.unlock();
+				const bool helped = pool->RunPendingTask();
+				lock.lock();
+				if (!helped)
+				{
+					// 调用线程在此等待说明读取任务跟不上，或在途内存已达上限。
+					TraceSpan wait_span("wait", "MultiFileReader", "delivered", static_cast<long long>(delivered_count));
+					condition.wait(lock, [&]
+					{
+						return (stopped && running_tasks == 0) || (!stopped && next_result() != completed_results.end()) || can_submit();
+					});
+				}
+			}
+
+			// 停止后等待已提交的任务退出，任务引用了读取器的成员。
+			condition.wait(lock, [this] { return running_tasks == 0; });
+
+			// 回调在最后一个文件上返回false时所有文件都已处理，不算取消。
+			if (stopped && delivered_count < file_count && !error)
+			{
+				error = std::make_error_code(std::errc::operation_canceled);
+			}
+			return !error;
+		}
+	};
+}
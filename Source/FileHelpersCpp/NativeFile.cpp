@@ -0,0 +1,466 @@
+﻿#include "pch.h"
+#include <algorithm>
+#include "NativeFile.h"
+#ifdef _WIN32
+#include "StringConverter.h"
+#else
+#include <cerrno>
+#include <fcntl.h>
+#ifdef __linux__
+#include <linux/falloc.h>
+#endif
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace file_helpers_cpp;
+
+/// <summary>
+/// 析构函数。关闭仍处于打开状态的文件。
+/// </summary>
+NativeFile::~NativeFile()
+{
+	Close();
+}
+
+/// <summary>
+/// 以覆盖模式创建文件并打开，用于写入。如果目标文件已存在，则清空该文件。
+/// </summary>
+/// <param name="path">文件路径。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否成功打开文件。</returns>
+bool NativeFile::Create(const std::string& path, std::error_code& error)
+{
+	Close();
+#ifdef _WIN32
+	const std::wstring wstr_path = ToWString(path);
+	handle = CreateFile(wstr_path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (INVALID_HANDLE_VALUE == handle)
+	{
+		error = std::error_code(GetLastError(), std::system_category());
+		return false;
+	}
+#else
+	handle = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (handle < 0)
+	{
+		error = std::error_code(errno, std::system_category());
+		return false;
+	}
+#endif
+	return true;
+}
+
+/// <summary>
+/// 以读写模式打开文件，文件不存在则创建文件。不清空已有内容。
+/// </summary>
+/// <param name="path">文件路径。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否成功打开文件。</returns>
+bool NativeFile::Open(const std::string& path, std::error_code& error)
+{
+	Close();
+#ifdef _WIN32
+	const std::wstring wstr_path = ToWString(path);
+	handle = CreateFile(wstr_path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (INVALID_HANDLE_VALUE == handle)
+	{
+		error = std::error_code(GetLastError(), std::system_category());
+		return false;
+	}
+#else
+	handle = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+	if (handle < 0)
+	{
+		error = std::error_code(errno, std::system_category());
+		return false;
+	}
+#endif
+	return true;
+}
+
+/// <summary>
+/// 以只读模式打开已存在的文件。
+/// </summary>
+/// <param name="path">文件路径。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否成功打开文件。</returns>
+bool NativeFile::OpenRead(const std::string& path, std::error_code& error)
+{
+	Close();
+#ifdef _WIN32
+	const std::wstring wstr_path = ToWString(path);
+	handle = CreateFile(wstr_path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (INVALID_HANDLE_VALUE == handle)
+	{
+		error = std::error_code(GetLastError(), std::system_category());
+		return false;
+	}
+#else
+	handle = open(path.c_str(), O_RDONLY);
+	if (handle < 0)
+	{
+		error = std::error_code(errno, std::system_category());
+		return false;
+	}
+#endif
+	return true;
+}
+
+/// <summary>
+/// 从指定偏移量开始写入数据，不改变文件指针。
+/// </summary>
+/// <param name="offset">写入位置相对于文件开头的字节偏移量。</param>
+/// <param name="data">要写入的数据。</param>
+/// <param name="size">要写入的字节数。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否完成写入操作。</returns>
+bool NativeFile::WriteAt(long long offset, const char* data, size_t size, std::error_code& error) const
+{
+	while (size > 0)
+	{
+#ifdef _WIN32
+		// WriteFile单次最多写入DWORD大小，超大缓冲区分段写入。
+		const DWORD chunk_size = static_cast<DWORD>(size > 0x40000000 ? 0x40000000 : size);
+		OVERLAPPED overlapped = {0};
+		overlapped.Offset = static_cast<DWORD>(offset & 0xFFFFFFFF);
+		overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+		DWORD written = 0;
+		if (!WriteFile(handle, data, chunk_size, &written, &overlapped))
+		{
+			error = std::error_code(GetLastError(), std::system_category());
+			return false;
+		}
+#else
+		const ssize_t written = pwrite(handle, data, size, static_cast<off_t>(offset));
+		if (written < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			error = std::error_code(errno, std::system_category());
+			return false;
+		}
+#endif
+		data += written;
+		offset += written;
+		size -= written;
+	}
+	return true;
+}
+
+/// <summary>
+/// 从指定偏移量开始读取数据，不改变文件指针。
+/// </summary>
+/// <param name="offset">读取位置相对于文件开头的字节偏移量。</param>
+/// <param name="data">接收数据的缓冲区。</param>
+/// <param name="size">要读取的字节数。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>实际读取的字节数，到达文件末尾时小于size，失败时返回-1。</returns>
+long long NativeFile::ReadAt(long long offset, char* data, size_t size, std::error_code& error) const
+{
+	long long total_read = 0;
+	while (size > 0)
+	{
+#ifdef _WIN32
+		const DWORD chunk_size = static_cast<DWORD>(size > 0x40000000 ? 0x40000000 : size);
+		OVERLAPPED overlapped = {0};
+		overlapped.Offset = static_cast<DWORD>(offset & 0xFFFFFFFF);
+		overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+		DWORD read = 0;
+		if (!ReadFile(handle, data, chunk_size, &read, &overlapped))
+		{
+			if (GetLastError() == ERROR_HANDLE_EOF)
+			{
+				break;
+			}
+			error = std::error_code(GetLastError(), std::system_category());
+			return -1;
+		}
+#else
+		const ssize_t read = pread(handle, data, size, static_cast<off_t>(offset));
+		if (read < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			error = std::error_code(errno, std::system_category());
+			return -1;
+		}
+#endif
+		if (read == 0)
+		{
+			break;
+		}
+		data += read;
+		offset += read;
+		size -= read;
+		total_read += read;
+	}
+	return total_read;
+}
+
+/// <summary>
+/// 将另一个文件的指定区间复制到本文件的指定偏移量。
+/// </summary>
+/// <param name="source">源文件，需可读。</param>
+/// <param name="source_offset">源区间的起始偏移量。</param>
+/// <param name="offset">写入位置相对于本文件开头的字节偏移量。</param>
+/// <param name="length">要复制的字节数。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否完成复制操作。</returns>
+bool NativeFile::CopyRangeFrom(const NativeFile& source, long long source_offset, long long offset, long long length, std::error_code& error) const
+{
+#ifdef __linux__
+	while (length > 0)
+	{
+		loff_t in_offset = static_cast<loff_t>(source_offset);
+		loff_t out_offset = static_cast<loff_t>(offset);
+		const ssize_t copied = copy_file_range(source.handle, &in_offset, handle, &out_offset, static_cast<size_t>(length), 0);
+		if (copied < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			// 内核或文件系统不支持（如跨文件系统）时退化为分块读写。
+			if (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP)
+			{
+				break;
+			}
+			error = std::error_code(errno, std::system_category());
+			return false;
+		}
+		if (copied == 0)
+		{
+			// 源文件比预期的短。
+			error = std::make_error_code(std::errc::io_error);
+			return false;
+		}
+		source_offset += copied;
+		offset += copied;
+		length -= copied;
+	}
+	if (length == 0)
+	{
+		return true;
+	}
+#endif
+
+	std::string buffer(static_cast<size_t>(std::min<long long>(length, kCopyBufferSize)), '\0');
+	while (length > 0)
+	{
+		const size_t chunk_size = static_cast<size_t>(std::min<long long>(length, static_cast<long long>(buffer.size())));
+		const long long read = source.ReadAt(source_offset, &buffer[0], chunk_size, error);
+		if (read < 0)
+		{
+			return false;
+		}
+		if (read == 0)
+		{
+			error = std::make_error_code(std::errc::io_error);
+			return false;
+		}
+		if (!WriteAt(offset, buffer.data(), static_cast<size_t>(read), error))
+		{
+			return false;
+		}
+		source_offset += read;
+		offset += read;
+		length -= read;
+	}
+	return true;
+}
+
+/// <summary>
+/// 获取文件当前的大小。
+/// </summary>
+/// <param name="error">错误信息。</param>
+/// <returns>文件大小（字节），失败时返回-1。</returns>
+long long NativeFile::Size(std::error_code& error) const
+{
+#ifdef _WIN32
+	LARGE_INTEGER file_size = {0};
+	if (!GetFileSizeEx(handle, &file_size))
+	{
+		error = std::error_code(GetLastError(), std::system_category());
+		return -1;
+	}
+	return file_size.QuadPart;
+#else
+	struct stat file_stat;
+	if (fstat(handle, &file_stat) != 0)
+	{
+		error = std::error_code(errno, std::system_category());
+		return -1;
+	}
+	return file_stat.st_size;
+#endif
+}
+
+/// <summary>
+/// 将文件截断或扩展到指定大小。扩展的部分不分配磁盘空间（稀疏），读取时为0。
+/// </summary>
+/// <param name="size">新的文件大小。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否成功调整文件大小。</returns>
+bool NativeFile::Resize(const long long size, std::error_code& error) const
+{
+#ifdef _WIN32
+	FILE_END_OF_FILE_INFO end_of_file = {0};
+	end_of_file.EndOfFile.QuadPart = size;
+	if (!SetFileInformationByHandle(handle, FileEndOfFileInfo, &end_of_file, sizeof(end_of_file)))
+	{
+		error = std::error_code(GetLastError(), std::system_category());
+		return false;
+	}
+#else
+	if (ftruncate(handle, static_cast<off_t>(size)) != 0)
+	{
+		error = std::error_code(errno, std::system_category());
+		return false;
+	}
+#endif
+	return true;
+}
+
+/// <summary>
+/// 文件小于指定大小时将其扩展到该大小，否则不做任何操作。
+/// </summary>
+/// <param name="size">扩展后的文件大小。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否成功扩展。</returns>
+bool NativeFile::ExtendTo(const long long size, std::error_code& error) const
+{
+	const long long current_size = Size(error);
+	if (current_size < 0)
+	{
+		return false;
+	}
+	if (size <= current_size)
+	{
+		return true;
+	}
+	return Resize(size, error);
+}
+
+/// <summary>
+/// 为文件的指定区间预分配空间。不会截断文件，耗时与分配大小无关。
+/// </summary>
+/// <param name="offset">预分配区间的起始偏移量。</param>
+/// <param name="length">预分配区间的字节数。</param>
+/// <param name="mode">预分配空间的方式。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否成功预分配。</returns>
+bool NativeFile::PreAllocate(const long long offset, const long long length, const PreAllocateMode mode, std::error_code& error) const
+{
+	if (length <= 0)
+	{
+		return true;
+	}
+
+#ifdef _WIN32
+	if (mode == PreAllocateMode::KeepSize)
+	{
+		// 只设置分配大小，不改变文件末尾。注意NTFS在最后一个句柄关闭时会回收超出文件末尾的分配。
+		FILE_ALLOCATION_INFO allocation_info = {0};
+		allocation_info.AllocationSize.QuadPart = offset + length;
+		if (!SetFileInformationByHandle(handle, FileAllocationInfo, &allocation_info, sizeof(allocation_info)))
+		{
+			error = std::error_code(GetLastError(), std::system_category());
+			return false;
+		}
+		return true;
+	}
+	if (mode == PreAllocateMode::Sparse)
+	{
+		// 标记为稀疏文件后扩展的部分不占用磁盘空间。文件系统不支持时按普通方式扩展。
+		DWORD bytes_returned = 0;
+		DeviceIoControl(handle, FSCTL_SET_SPARSE, nullptr, 0, nullptr, 0, &bytes_returned, nullptr);
+	}
+	// NTFS上设置文件末尾即会分配磁盘空间，且不需要写入0。
+	return ExtendTo(offset + length, error);
+#elif defined(__linux__)
+	if (mode == PreAllocateMode::Sparse)
+	{
+		return ExtendTo(offset + length, error);
+	}
+
+	const int flags = mode == PreAllocateMode::KeepSize ? FALLOC_FL_KEEP_SIZE : 0;
+	if (fallocate(handle, flags, static_cast<off_t>(offset), static_cast<off_t>(length)) == 0)
+	{
+		return true;
+	}
+	if (errno != EOPNOTSUPP && errno != ENOSYS)
+	{
+		error = std::error_code(errno, std::system_category());
+		return false;
+	}
+	if (mode == PreAllocateMode::KeepSize)
+	{
+		// 保留空间只是优化提示，文件系统不支持时忽略。
+		return true;
+	}
+
+	// 文件系统不支持fallocate时由posix_fallocate模拟分配，其返回值即错误码。
+	const int result = posix_fallocate(handle, static_cast<off_t>(offset), static_cast<off_t>(length));
+	if (result != 0)
+	{
+		error = std::error_code(result, std::system_category());
+		return false;
+	}
+	return true;
+#else
+	if (mode == PreAllocateMode::KeepSize)
+	{
+		return true;
+	}
+	return ExtendTo(offset + length, error);
+#endif
+}
+
+/// <summary>
+/// 获取原生文件句柄，可用于内存映射。
+/// </summary>
+/// <returns>Windows上为HANDLE，其他平台为文件描述符。</returns>
+#ifdef _WIN32
+void* NativeFile::NativeHandle() const
+#else
+int NativeFile::NativeHandle() const
+#endif
+{
+	return handle;
+}
+
+/// <summary>
+/// 判断文件是否处于打开状态。
+/// </summary>
+/// <returns>是否处于打开状态。</returns>
+bool NativeFile::IsOpen() const
+{
+#ifdef _WIN32
+	return INVALID_HANDLE_VALUE != handle;
+#else
+	return handle >= 0;
+#endif
+}
+
+/// <summary>
+/// 关闭文件。
+/// </summary>
+void NativeFile::Close()
+{
+	if (!IsOpen())
+	{
+		return;
+	}
+#ifdef _WIN32
+	CloseHandle(handle);
+	handle = INVALID_HANDLE_VALUE;
+#else
+	close(handle);
+	handle = -1;
+#endif
+}
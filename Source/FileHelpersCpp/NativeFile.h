@@ -0,0 +1,154 @@
+﻿#pragma once
+#include <cstdint>
+#include <string>
+#include <system_error>
+#include "FileEngineBase.h"
+
+namespace file_helpers_cpp
+{
+	/// <summary>
+	/// 表示操作系统原生文件句柄的封装。支持按偏移量定位写入，多个线程可同时写入互不重叠的区间。
+	/// </summary>
+	class NativeFile
+	{
+	private:
+		/// <summary>
+		/// 分块复制时的缓冲区大小。
+		/// </summary>
+		static constexpr size_t kCopyBufferSize = 4 * 1024 * 1024;
+
+#ifdef _WIN32
+		/// <summary>
+		/// 文件句柄。
+		/// </summary>
+		void* handle = reinterpret_cast<void*>(static_cast<intptr_t>(-1));
+#else
+		/// <summary>
+		/// 文件描述符。
+		/// </summary>
+		int handle = -1;
+#endif
+
+		/// <summary>
+		/// 文件小于指定大小时将其扩展到该大小，否则不做任何操作。
+		/// </summary>
+		/// <param name="size">扩展后的文件大小。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否成功扩展。</returns>
+		bool ExtendTo(long long size, std::error_code& error) const;
+
+	public:
+		NativeFile() = default;
+
+		/// <summary>
+		/// 析构函数。关闭仍处于打开状态的文件。
+		/// </summary>
+		~NativeFile();
+
+		NativeFile(const NativeFile&) = delete;
+
+		NativeFile& operator=(const NativeFile&) = delete;
+
+		/// <summary>
+		/// 以覆盖模式创建文件并打开，用于写入。如果目标文件已存在，则清空该文件。
+		/// </summary>
+		/// <param name="path">文件路径。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否成功打开文件。</returns>
+		bool Create(const std::string& path, std::error_code& error);
+
+		/// <summary>
+		/// 以读写模式打开文件，文件不存在则创建文件。不清空已有内容。
+		/// </summary>
+		/// <param name="path">文件路径。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否成功打开文件。</returns>
+		bool Open(const std::string& path, std::error_code& error);
+
+		/// <summary>
+		/// 以只读模式打开已存在的文件。
+		/// </summary>
+		/// <param name="path">文件路径。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否成功打开文件。</returns>
+		bool OpenRead(const std::string& path, std::error_code& error);
+
+		/// <summary>
+		/// 从指定偏移量开始写入数据，不改变文件指针。
+		/// </summary>
+		/// <param name="offset">写入位置相对于文件开头的字节偏移量。</param>
+		/// <param name="data">要写入的数据。</param>
+		/// <param name="size">要写入的字节数。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否完成写入操作。</returns>
+		bool WriteAt(long long offset, const char* data, size_t size, std::error_code& error) const;
+
+		/// <summary>
+		/// 从指定偏移量开始读取数据，不改变文件指针。
+		/// </summary>
+		/// <param name="offset">读取位置相对于文件开头的字节偏移量。</param>
+		/// <param name="data">接收数据的缓冲区。</param>
+		/// <param name="size">要读取的字节数。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>实际读取的字节数，到达文件末尾时小于size，失败时返回-1。</returns>
+		long long ReadAt(long long offset, char* data, size_t size, std::error_code& error) const;
+
+		/// <summary>
+		/// 将另一个文件的指定区间复制到本文件的指定偏移量。Linux上使用copy_file_range在内核中复制（支持时共享数据块），
+		/// 不支持时退化为分块读写。
+		/// </summary>
+		/// <param name="source">源文件，需可读。</param>
+		/// <param name="source_offset">源区间的起始偏移量。</param>
+		/// <param name="offset">写入位置相对于本文件开头的字节偏移量。</param>
+		/// <param name="length">要复制的字节数。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否完成复制操作。</returns>
+		bool CopyRangeFrom(const NativeFile& source, long long source_offset, long long offset, long long length, std::error_code& error) const;
+
+		/// <summary>
+		/// 获取文件当前的大小。
+		/// </summary>
+		/// <param name="error">错误信息。</param>
+		/// <returns>文件大小（字节），失败时返回-1。</returns>
+		long long Size(std::error_code& error) const;
+
+		/// <summary>
+		/// 将文件截断或扩展到指定大小。扩展的部分不分配磁盘空间（稀疏），读取时为0。
+		/// </summary>
+		/// <param name="size">新的文件大小。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否成功调整文件大小。</returns>
+		bool Resize(long long size, std::error_code& error) const;
+
+		/// <summary>
+		/// 为文件的指定区间预分配空间。不会截断文件，耗时与分配大小无关。
+		/// </summary>
+		/// <param name="offset">预分配区间的起始偏移量。</param>
+		/// <param name="length">预分配区间的字节数。</param>
+		/// <param name="mode">预分配空间的方式。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否成功预分配。</returns>
+		bool PreAllocate(long long offset, long long length, PreAllocateMode mode, std::error_code& error) const;
+
+		/// <summary>
+		/// 获取原生文件句柄，可用于内存映射。
+		/// </summary>
+		/// <returns>Windows上为HANDLE，其他平台为文件描述符。</returns>
+#ifdef _WIN32
+		void* NativeHandle() const;
+#else
+		int NativeHandle() const;
+#endif
+
+		/// <summary>
+		/// 判断文件是否处于打开状态。
+		/// </summary>
+		/// <returns>是否处于打开状态。</returns>
+		bool IsOpen() const;
+
+		/// <summary>
+		/// 关闭文件。
+		/// </summary>
+		void Close();
+	};
+}
@@ -0,0 +1,93 @@
+﻿#pragma once
+#include <algorithm>
+#include <new>
+#include <string>
+#include <system_error>
+#include <vector>
+#include "NativeFile.h"
+#include "RecordFormatter.h"
+#include "ThreadPool.h"
+#include "TraceRecorder.h"
+
+namespace file_helpers_cpp
+{
+	/// <summary>
+	/// 创建一个新文件，以多线程并行格式化的方式写入二维向量的集合，然后关闭该文件。
+	/// 各任务在共享线程池中将各自的行区间格式化到私有缓冲区，对缓冲区大小做前缀和得到各区间在文件中的偏移量，再并行定位写入。
+	/// </summary>
+	/// <param name="path">要写入的文件。</param>
+	/// <param name="contents">要写入文件的二维向量。</param>
+	/// <param name="delimiter">分隔符。</param>
+	/// <param name="line_ending">换行符。</param>
+	/// <param name="thread_count">并行格式化的线程数。小于等于0表示使用线程池的默认并行度。</param>
+	/// <param name="error">错误信息。</param>
+	/// <returns>是否完成写入操作。</returns>
+	template <typename T>
+	bool ParallelWriteRecords(const std::string& path, const std::vector<std::vector<T>>& contents, const std::string& delimiter, const std::string& line_ending, int thread_count, std::error_code& error)
+	{
+		const std::shared_ptr<ThreadPool> pool = ThreadPool::Shared();
+		thread_count = pool->Parallelism(thread_count);
+
+		NativeFile file;
+		if (!file.Create(path, error))
+		{
+			return false;
+		}
+
+		std::vector<std::string> buffers(thread_count);
+		std::vector<std::error_code> errors(thread_count);
+		std::vector<long long> offsets(thread_count);
+
+		const size_t line_count = contents.size();
+		const size_t batch_rows = kRecordFormatChunkRows * thread_count;
+		long long file_offset = 0;
+
+		for (size_t batch_begin = 0; batch_begin < line_count; batch_begin += batch_rows)
+		{
+			// 各任务将各自负责的行区间格式化到私有缓冲区。
+			pool->ParallelFor(thread_count, thread_count, [&](const size_t i)
+			{
+				const size_t begin = std::min(batch_begin + i * kRecordFormatChunkRows, line_count);
+				const size_t end = std::min(begin + kRecordFormatChunkRows, line_count);
+				TraceSpan span("format", "ParallelWriteRecords", "rows", static_cast<long long>(end - begin));
+				try
+				{
+					FormatRecordRange(contents, begin, end, delimiter, line_ending, buffers[i]);
+				}
+				catch (std::bad_alloc&)
+				{
+					errors[i] = std::make_error_code(std::errc::not_enough_memory);
+				}
+			});
+
+			// 对缓冲区大小做前缀和，得到每个区间在文件中的偏移量。
+			for (int i = 0; i < thread_count; i++)
+			{
+				offsets[i] = file_offset;
+				file_offset += static_cast<long long>(buffers[i].size());
+			}
+
+			// 各区间互不重叠，并行定位写入。
+			pool->ParallelFor(thread_count, thread_count, [&](const size_t i)
+			{
+				if (!buffers[i].empty() && !errors[i])
+				{
+					TraceSpan span("write", "ParallelWriteRecords", "bytes", static_cast<long long>(buffers[i].size()));
+					file.WriteAt(offsets[i], buffers[i].data(), buffers[i].size(), errors[i]);
+				}
+			});
+
+			for (const auto& worker_error : errors)
+			{
+				if (worker_error)
+				{
+					error = worker_error;
+					return false;
+				}
+			}
+		}
+
+		file.Close();
+		return true;
+	}
+}
@@ -0,0 +1,102 @@
+﻿#pragma once
+#include <chrono>
+#include "FileEngineBase.h"
+
+namespace file_helpers_cpp
+{
+	/// <summary>
+	/// 跟踪扫描循环的进度。每处理一个数据块检查一次取消令牌并报告进度，块内只做一次比较。
+	/// </summary>
+	class ProgressTracker
+	{
+	public:
+		/// <summary>
+		/// 两次检查之间处理的字节数，即一个数据块的大小。
+		/// </summary>
+		static constexpr long long kCheckpointInterval = 1024 * 1024;
+
+	private:
+		const OperationControl& control;
+
+		long long total_bytes;
+
+		/// <summary>
+		/// 下一次检查时的已处理字节数。
+		/// </summary>
+		long long next_checkpoint = kCheckpointInterval;
+
+		std::chrono::steady_clock::time_point start_time;
+
+		/// <summary>
+		/// 检查取消令牌并报告进度。
+		/// </summary>
+		/// <returns>是否继续操作。</returns>
+		bool Report(const long long bytes_processed, const long long records_processed) const
+		{
+			if (control.cancellation.IsCancelled())
+			{
+				return false;
+			}
+			if (control.progress)
+			{
+				OperationProgress progress;
+				progress.bytes_processed = bytes_processed;
+				progress.total_bytes = total_bytes;
+				progress.records_processed = records_processed;
+				progress.elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+				progress.bytes_per_second = progress.elapsed_seconds > 0 ? static_cast<double>(bytes_processed) / progress.elapsed_seconds : 0;
+				control.progress(progress);
+			}
+			return true;
+		}
+
+	public:
+		/// <summary>
+		/// 有参构造函数。
+		/// </summary>
+		/// <param name="control">对操作的控制。</param>
+		/// <param name="total_bytes">要处理的总字节数，未知时为-1。</param>
+		ProgressTracker(const OperationControl& control, const long long total_bytes)
+			: control(control),
+			  total_bytes(total_bytes),
+			  start_time(std::chrono::steady_clock::now())
+		{
+		}
+
+		/// <summary>
+		/// 判断是否已请求取消。
+		/// </summary>
+		/// <returns>是否已请求取消。</returns>
+		bool IsCancelled() const
+		{
+			return control.cancellation.IsCancelled();
+		}
+
+		/// <summary>
+		/// 已处理的字节数跨过下一个数据块边界时检查取消令牌并报告进度。
+		/// </summary>
+		/// <param name="bytes_processed">已处理的字节数。</param>
+		/// <param name="records_processed">已处理的记录数。</param>
+		/// <returns>是否继续操作。</returns>
+		bool Checkpoint(const long long bytes_processed, const long long records_processed)
+		{
+			if (bytes_processed < next_checkpoint)
+			{
+				return true;
+			}
+			next_checkpoint = bytes_processed + kCheckpointInterval;
+			return Report(bytes_processed, records_processed);
+		}
+
+		/// <summary>
+		/// 操作完成时报告最终进度。
+		/// </summary>
+		/// <param name="bytes_processed">已处理的字节数。</param>
+		/// <param name="records_processed">已处理的记录数。</param>
+		/// <returns>是否继续操作。</returns>
+		bool Finish(const long long bytes_processed, const long long records_processed) const
+		{
+			return Report(bytes_processed, records_processed);
+		}
+	};
+}
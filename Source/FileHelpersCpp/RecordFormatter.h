@@ -0,0 +1,81 @@
+﻿#pragma once
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace file_helpers_cpp
+{
+	/// <summary>
+	/// 每次格式化到缓冲区的行数。分块格式化后写出，用于限制缓冲区占用的内存。
+	/// </summary>
+	constexpr size_t kRecordFormatChunkRows = 65536;
+
+	/// <summary>
+	/// 将double类型的字段值追加到缓冲区，格式与std::to_string一致。
+	/// </summary>
+	/// <param name="buffer">目标缓冲区。</param>
+	/// <param name="value">字段值。</param>
+	inline void AppendField(std::string& buffer, const double value)
+	{
+		// "%f"格式下double的最大长度约为317个字符。
+		char field_str[512];
+		const int length = std::snprintf(field_str, sizeof(field_str), "%f", value);
+		buffer.append(field_str, length);
+	}
+
+	/// <summary>
+	/// 将字符串类型的字段值追加到缓冲区。
+	/// </summary>
+	/// <param name="buffer">目标缓冲区。</param>
+	/// <param name="value">字段值。</param>
+	inline void AppendField(std::string& buffer, const std::string& value)
+	{
+		buffer.append(value);
+	}
+
+	/// <summary>
+	/// 将指定行区间的记录格式化到缓冲区。
+	/// </summary>
+	/// <param name="contents">要格式化的二维向量。</param>
+	/// <param name="begin">起始行索引（包含）。</param>
+	/// <param name="end">结束行索引（不包含）。</param>
+	/// <param name="delimiter">分隔符。</param>
+	/// <param name="line_ending">换行符。</param>
+	/// <param name="out_buffer">格式化后的文本。</param>
+	template <typename T>
+	void FormatRecordRange(const std::vector<std::vector<T>>& contents, const size_t begin, const size_t end, const std::string& delimiter, const std::string& line_ending, std::string& out_buffer)
+	{
+		out_buffer.clear();
+		for (size_t line_index = begin; line_index < end; line_index++)
+		{
+			const auto& line_vector = contents[line_index];
+			size_t field_index = 0;
+			for (const auto& field : line_vector)
+			{
+				field_index++;
+				AppendField(out_buffer, field);
+				if (field_index < line_vector.size())
+					out_buffer.append(delimiter);
+			}
+			out_buffer.append(line_ending);
+		}
+	}
+
+	/// <summary>
+	/// 将指定行区间的文本行格式化到缓冲区。
+	/// </summary>
+	/// <param name="lines">要格式化的文本行。</param>
+	/// <param name="begin">起始行索引（包含）。</param>
+	/// <param name="end">结束行索引（不包含）。</param>
+	/// <param name="line_ending">换行符。</param>
+	/// <param name="out_buffer">格式化后的文本。</param>
+	inline void FormatLineRange(const std::vector<std::string>& lines, const size_t begin, const size_t end, const std::string& line_ending, std::string& out_buffer)
+	{
+		out_buffer.clear();
+		for (size_t line_index = begin; line_index < end; line_index++)
+		{
+			out_buffer.append(lines[line_index]);
+			out_buffer.append(line_ending);
+		}
+	}
+}
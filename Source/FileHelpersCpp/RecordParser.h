@@ -0,0 +1,63 @@
+﻿#pragma once
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "StatsCollector.h"
+#include "StringUtils.h"
+
+namespace file_helpers_cpp
+{
+	/// <summary>
+	/// 将一行切分为字符串字段，存入结果向量。
+	/// </summary>
+	/// <param name="line">不含换行符的非空行。</param>
+	/// <param name="delimiter">分隔符。</param>
+	/// <param name="out_records">结果向量。</param>
+	/// <param name="collector">统计信息。</param>
+	template <bool kStats>
+	void ParseRecord(const std::string& line, const std::string& delimiter, std::vector<std::vector<std::string>>& out_records, StatsCollector<kStats>& collector)
+	{
+		std::vector<std::string> str_fields = Split(line, delimiter, true);
+		collector.Lap(EnginePhase::Tokenize);
+
+		collector.AddRecord(str_fields.size());
+		collector.AddFieldAllocations(str_fields);
+		const size_t capacity = out_records.capacity();
+		out_records.push_back(std::move(str_fields));
+		collector.AddAllocations(out_records.capacity() != capacity ? 1 : 0);
+		collector.Lap(EnginePhase::Store);
+	}
+
+	/// <summary>
+	/// 将一行切分为字段并转换为double，存入结果向量。字段按atof的规则转换，与SplitIntoDouble一致。
+	/// </summary>
+	/// <param name="line">不含换行符的非空行。</param>
+	/// <param name="delimiter">分隔符。</param>
+	/// <param name="out_records">结果向量。</param>
+	/// <param name="collector">统计信息。</param>
+	template <bool kStats>
+	void ParseRecord(const std::string& line, const std::string& delimiter, std::vector<std::vector<double>>& out_records, StatsCollector<kStats>& collector)
+	{
+		thread_local std::vector<std::string_view> field_views;
+		thread_local std::string field_text;
+		SplitViews(line, delimiter, field_views, true);
+		collector.Lap(EnginePhase::Tokenize);
+
+		std::vector<double> double_fields;
+		double_fields.reserve(field_views.size());
+		for (const auto& field : field_views)
+		{
+			field_text.assign(field.data(), field.size());
+			double_fields.push_back(atof(field_text.c_str()));
+		}
+		collector.Lap(EnginePhase::Convert);
+
+		collector.AddRecord(double_fields.size());
+		collector.AddFieldAllocations(double_fields);
+		const size_t capacity = out_records.capacity();
+		out_records.push_back(std::move(double_fields));
+		collector.AddAllocations(out_records.capacity() != capacity ? 1 : 0);
+		collector.Lap(EnginePhase::Store);
+	}
+}
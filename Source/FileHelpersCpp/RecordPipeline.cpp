@@ -0,0 +1,276 @@
+﻿#include "pch.h"
+#include <algorithm>
+#include <string_view>
+#include <vector>
+#include "RecordPipeline.h"
+#include "StringUtils.h"
+#include "TraceRecorder.h"
+
+using namespace file_helpers_cpp;
+
+/// <summary>
+/// 有参构造函数。
+/// </summary>
+/// <param name="delimiter">分隔符。</param>
+/// <param name="transform">对每行记录的转换。</param>
+/// <param name="thread_count">同时执行的转换任务数。小于等于0表示使用线程池的默认并行度。</param>
+RecordPipeline::RecordPipeline(const std::string& delimiter, const RecordTransform& transform, const int thread_count)
+	: delimiter(delimiter),
+	  transform(transform),
+	  pool(ThreadPool::Shared()),
+	  thread_count(static_cast<size_t>(pool->Parallelism(thread_count))),
+	  max_in_flight(2 * this->thread_count + 2)
+{
+}
+
+/// <summary>
+/// 记录错误并唤醒调用线程，使流水线尽快退出。
+/// </summary>
+/// <param name="error">错误信息。</param>
+void RecordPipeline::Fail(const std::error_code& error)
+{
+	{
+		std::lock_guard<std::mutex> lock(error_mutex);
+		if (!failed)
+		{
+			first_error = error;
+		}
+		failed = true;
+	}
+	{
+		std::lock_guard<std::mutex> lock(output_mutex);
+	}
+	output_condition.notify_all();
+}
+
+/// <summary>
+/// 映射从指定偏移量开始的下一个块，块在最后一个换行符处结束。
+/// </summary>
+/// <param name="offset">块的起始偏移量。</param>
+/// <param name="file_size">文件大小。</param>
+/// <param name="chunk">映射的块。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否成功映射。</returns>
+bool RecordPipeline::MapChunk(const long long offset, const long long file_size, Chunk& chunk, std::error_code& error)
+{
+	size_t length = static_cast<size_t>(std::min<long long>(kChunkSize, file_size - offset));
+	while (true)
+	{
+		chunk.mapping.map(read_file.NativeHandle(), static_cast<size_t>(offset), length, error);
+		if (error)
+		{
+			return false;
+		}
+
+		if (offset + static_cast<long long>(length) == file_size)
+		{
+			chunk.length = length;
+			return true;
+		}
+
+		// 块在最后一个换行符处结束，保证不切断行。
+		const size_t last_newline = std::string_view(chunk.mapping.data(), length).rfind('\n');
+		if (last_newline != std::string_view::npos)
+		{
+			chunk.length = last_newline + 1;
+			return true;
+		}
+
+		// 单行超过块大小时扩大映射窗口。
+		length = static_cast<size_t>(std::min<long long>(static_cast<long long>(length) * 2, file_size - offset));
+	}
+}
+
+/// <summary>
+/// 转换任务：逐行切分字段并调用转换，生成输出块。
+/// </summary>
+/// <param name="chunk">要转换的块。</param>
+void RecordPipeline::TransformChunk(Chunk& chunk)
+{
+	std::string buffer;
+	TraceSpan span("parse", "RecordPipeline", "sequence", static_cast<long long>(chunk.sequence));
+	if (!failed)
+	{
+		try
+		{
+			const std::string_view text(chunk.mapping.data(), chunk.length);
+			std::vector<std::string_view> fields;
+			buffer.reserve(chunk.length);
+
+			size_t line_begin = 0;
+			while (line_begin < text.size())
+			{
+				size_t line_end = text.find('\n', line_begin);
+				if (line_end == std::string_view::npos)
+				{
+					line_end = text.size();
+				}
+				std::string_view line = text.substr(line_begin, line_end - line_begin);
+				line_begin = line_end + 1;
+
+				if (!line.empty() && line.back() == '\r')
+				{
+					line.remove_suffix(1);
+				}
+				// 空行判断
+				if (line.empty())
+				{
+					continue;
+				}
+
+				SplitViews(line, delimiter, fields, true);
+				const size_t record_begin = buffer.size();
+				if (transform(fields, buffer))
+				{
+					buffer += '\n';
+				}
+				else
+				{
+					buffer.resize(record_begin);
+				}
+			}
+		}
+		catch (std::bad_alloc&)
+		{
+			Fail(std::make_error_code(std::errc::not_enough_memory));
+		}
+		catch (std::exception&)
+		{
+			// 转换抛出异常表示无法处理输入的记录。
+			Fail(std::make_error_code(std::errc::invalid_argument));
+		}
+	}
+	chunk.mapping.unmap();
+	span.End();
+
+	// 在锁内通知，调用线程观察到所有任务完成后才可能销毁流水线。
+	std::lock_guard<std::mutex> lock(output_mutex);
+	if (!failed)
+	{
+		completed_outputs.emplace(chunk.sequence, std::move(buffer));
+	}
+	running_tasks--;
+	output_condition.notify_all();
+}
+
+/// <summary>
+/// 运行流水线，读取文件、转换每行记录并写入新文件。调用线程负责读取和写出，等待期间帮助线程池执行任务。
+/// </summary>
+/// <param name="read_path">要读取的文件。</param>
+/// <param name="write_path">要写入的文件。如果目标文件已存在，则覆盖该文件。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否完成转换操作。</returns>
+bool RecordPipeline::Run(const std::string& read_path, const std::string& write_path, std::error_code& error)
+{
+	if (!read_file.OpenRead(read_path, error))
+	{
+		return false;
+	}
+	const long long file_size = read_file.Size(error);
+	if (file_size < 0)
+	{
+		return false;
+	}
+
+	NativeFile write_file;
+	if (!write_file.Create(write_path, error))
+	{
+		return false;
+	}
+
+	long long read_offset = 0;
+	size_t read_sequence = 0;
+	size_t write_sequence = 0;
+	long long write_offset = 0;
+
+	// 并行任务数和在途块数（限制乱序输出占用的内存）都未达上限时才读取下一块。
+	const auto can_submit = [&]
+	{
+		return read_offset < file_size && running_tasks < thread_count && read_sequence - write_sequence < max_in_flight;
+	};
+
+	std::unique_lock<std::mutex> lock(output_mutex);
+	while (!failed)
+	{
+		// 按块序号顺序写出，保证输出行序与输入一致。
+		const auto iter = completed_outputs.find(write_sequence);
+		if (iter != completed_outputs.end())
+		{
+			const std::string buffer = std::move(iter->second);
+			completed_outputs.erase(iter);
+			lock.unlock();
+
+			std::error_code write_error;
+			TraceSpan write_span("write", "RecordPipeline", "bytes", static_cast<long long>(buffer.size()));
+			if (!write_file.WriteAt(write_offset, buffer.data(), buffer.size(), write_error))
+			{
+				Fail(write_error);
+			}
+			write_span.End();
+			write_offset += static_cast<long long>(buffer.size());
+			write_sequence++;
+
+			lock.lock();
+			continue;
+		}
+
+		if (read_offset >= file_size && write_sequence == read_sequence)
+		{
+			break;
+		}
+
+		if (can_submit())
+		{
+			running_tasks++;
+			lock.unlock();
+
+			const auto chunk = std::make_shared<Chunk>();
+			std::error_code read_error;
+			TraceSpan scan_span("scan", "RecordPipeline", "sequence", static_cast<long long>(read_sequence));
+			const bool mapped = MapChunk(read_offset, file_size, *chunk, read_error);
+			scan_span.End();
+			if (mapped)
+			{
+				chunk->sequence = read_sequence++;
+				read_offset += static_cast<long long>(chunk->length);
+				pool->Submit([this, chunk] { TransformChunk(*chunk); });
+				lock.lock();
+			}
+			else
+			{
+				Fail(read_error);
+				lock.lock();
+				running_tasks--;
+			}
+			continue;
+		}
+
+		// 等待期间先帮助线程池执行任务，没有可执行的任务时等待某个转换任务完成。
+		lock.unlock();
+		const bool helped = pool->RunPendingTask();
+		lock.lock();
+		if (!helped)
+		{
+			// 调用线程在此等待说明转换任务跟不上，或在途块数已达上限。
+			TraceSpan wait_span("wait", "RecordPipeline", "sequence", static_cast<long long>(write_sequence));
+			output_condition.wait(lock, [&]
+			{
+				return failed || completed_outputs.count(write_sequence) > 0 || can_submit();
+			});
+		}
+	}
+
+	// 失败时等待已提交的任务退出，任务引用了流水线的成员。
+	output_condition.wait(lock, [this] { return running_tasks == 0; });
+	lock.unlock();
+
+	write_file.Close();
+	read_file.Close();
+
+	if (failed)
+	{
+		error = first_error;
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,158 @@
+﻿#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include "mio.hpp"
+#include "DelimitedFileMMFEngine.h"
+#include "NativeFile.h"
+#include "ThreadPool.h"
+
+namespace file_helpers_cpp
+{
+	/// <summary>
+	/// 表示文件到文件的流式转换流水线：调用线程分块映射文件并按原顺序写出，每个块的转换作为一个任务提交到共享线程池。
+	/// 内存占用只与并行度和块大小有关，与文件大小无关。
+	/// </summary>
+	class RecordPipeline
+	{
+	private:
+		/// <summary>
+		/// 每个读取块映射的字节数。块在最后一个换行符处结束，单行超过该长度时扩大映射窗口。
+		/// </summary>
+		static constexpr size_t kChunkSize = 8 * 1024 * 1024;
+
+		/// <summary>
+		/// 表示读取的一个块。
+		/// </summary>
+		struct Chunk
+		{
+			/// <summary>
+			/// 块序号，写出时按该序号恢复原顺序。
+			/// </summary>
+			size_t sequence = 0;
+
+			/// <summary>
+			/// 块所在区间的只读映射。
+			/// </summary>
+			mio::mmap_source mapping;
+
+			/// <summary>
+			/// 块的有效长度，从映射起始位置开始计算。
+			/// </summary>
+			size_t length = 0;
+		};
+
+		/// <summary>
+		/// 分隔符。
+		/// </summary>
+		const std::string& delimiter;
+
+		/// <summary>
+		/// 对每行记录的转换。
+		/// </summary>
+		const RecordTransform& transform;
+
+		/// <summary>
+		/// 共享线程池。
+		/// </summary>
+		std::shared_ptr<ThreadPool> pool;
+
+		/// <summary>
+		/// 同时执行的转换任务数上限。
+		/// </summary>
+		size_t thread_count;
+
+		/// <summary>
+		/// 允许同时在途（已读取但尚未写出）的块数上限。
+		/// </summary>
+		size_t max_in_flight;
+
+		/// <summary>
+		/// 已提交但尚未完成的转换任务数。
+		/// </summary>
+		size_t running_tasks = 0;
+
+		/// <summary>
+		/// 已完成转换、等待按序写出的输出块。<块序号，转换后的文本>
+		/// </summary>
+		std::map<size_t, std::string> completed_outputs;
+
+		/// <summary>
+		/// 转换任务状态的同步对象。
+		/// </summary>
+		std::mutex output_mutex;
+
+		/// <summary>
+		/// 转换任务完成或失败时的通知。
+		/// </summary>
+		std::condition_variable output_condition;
+
+		/// <summary>
+		/// 要读取的文件。
+		/// </summary>
+		NativeFile read_file;
+
+		/// <summary>
+		/// 流水线是否已失败。
+		/// </summary>
+		std::atomic<bool> failed{false};
+
+		/// <summary>
+		/// 第一个错误。
+		/// </summary>
+		std::error_code first_error;
+
+		/// <summary>
+		/// 错误信息的同步对象。
+		/// </summary>
+		std::mutex error_mutex;
+
+		/// <summary>
+		/// 映射从指定偏移量开始的下一个块，块在最后一个换行符处结束。
+		/// </summary>
+		/// <param name="offset">块的起始偏移量。</param>
+		/// <param name="file_size">文件大小。</param>
+		/// <param name="chunk">映射的块。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否成功映射。</returns>
+		bool MapChunk(long long offset, long long file_size, Chunk& chunk, std::error_code& error);
+
+		/// <summary>
+		/// 转换任务：逐行切分字段并调用转换，生成输出块。
+		/// </summary>
+		/// <param name="chunk">要转换的块。</param>
+		void TransformChunk(Chunk& chunk);
+
+		/// <summary>
+		/// 记录错误并唤醒调用线程，使流水线尽快退出。
+		/// </summary>
+		/// <param name="error">错误信息。</param>
+		void Fail(const std::error_code& error);
+
+	public:
+		/// <summary>
+		/// 有参构造函数。
+		/// </summary>
+		/// <param name="delimiter">分隔符。</param>
+		/// <param name="transform">对每行记录的转换。</param>
+		/// <param name="thread_count">同时执行的转换任务数。小于等于0表示使用线程池的默认并行度。</param>
+		RecordPipeline(const std::string& delimiter, const RecordTransform& transform, int thread_count);
+
+		RecordPipeline(const RecordPipeline&) = delete;
+
+		RecordPipeline& operator=(const RecordPipeline&) = delete;
+
+		/// <summary>
+		/// 运行流水线，读取文件、转换每行记录并写入新文件。调用线程负责读取和写出，等待期间帮助线程池执行任务。
+		/// </summary>
+		/// <param name="read_path">要读取的文件。</param>
+		/// <param name="write_path">要写入的文件。如果目标文件已存在，则覆盖该文件。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否完成转换操作。</returns>
+		bool Run(const std::string& read_path, const std::string& write_path, std::error_code& error);
+	};
+}
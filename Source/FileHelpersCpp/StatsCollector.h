@@ -0,0 +1,174 @@
+﻿#pragma once
+#include <chrono>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "FileEngineBase.h"
+#include "HardwareCounters.h"
+#ifdef _WIN32
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#elif defined(__linux__)
+#include <sys/resource.h>
+#endif
+
+namespace file_helpers_cpp
+{
+	/// <summary>
+	/// 读取当前的缺页次数。
+	/// </summary>
+	/// <param name="page_faults">缺页次数。</param>
+	/// <param name="major_page_faults">主缺页次数。</param>
+	inline void ReadPageFaults(long long& page_faults, long long& major_page_faults)
+	{
+		page_faults = 0;
+		major_page_faults = 0;
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		{
+			page_faults = static_cast<long long>(counters.PageFaultCount);
+		}
+#elif defined(__linux__)
+		rusage usage;
+		if (getrusage(RUSAGE_THREAD, &usage) == 0)
+		{
+			page_faults = static_cast<long long>(usage.ru_minflt + usage.ru_majflt);
+			major_page_faults = static_cast<long long>(usage.ru_majflt);
+		}
+#endif
+	}
+
+	/// <summary>
+	/// 收集一次引擎调用的统计信息。kEnabled为false的特化所有方法为空，扫描循环以模板参数实例化两份，不统计时没有额外开销。
+	/// </summary>
+	template <bool kEnabled>
+	class StatsCollector
+	{
+	public:
+		explicit StatsCollector(EngineStats*)
+		{
+		}
+
+		void Lap(EnginePhase)
+		{
+		}
+
+		void AddBytes(long long)
+		{
+		}
+
+		void AddRecord(size_t)
+		{
+		}
+
+		void AddAllocations(long long)
+		{
+		}
+
+		template <typename T>
+		void AddFieldAllocations(const std::vector<T>&)
+		{
+		}
+
+		void Finish()
+		{
+		}
+	};
+
+	/// <summary>
+	/// 收集一次引擎调用的统计信息。各阶段依次进行，每次Lap把距上一次Lap的耗时计入刚结束的阶段。
+	/// </summary>
+	template <>
+	class StatsCollector<true>
+	{
+	private:
+		EngineStats& stats;
+
+		std::chrono::steady_clock::time_point start_time;
+
+		std::chrono::steady_clock::time_point lap_time;
+
+		long long start_page_faults = 0;
+
+		long long start_major_page_faults = 0;
+
+		HardwareCounters& counters;
+
+	public:
+		/// <summary>
+		/// 清零统计信息，开始计时和硬件计数。
+		/// </summary>
+		/// <param name="stats">接收统计信息的对象。</param>
+		explicit StatsCollector(EngineStats* stats)
+			: stats(*stats), counters(HardwareCounters::ForCurrentThread())
+		{
+			this->stats = EngineStats();
+			ReadPageFaults(start_page_faults, start_major_page_faults);
+			start_time = std::chrono::steady_clock::now();
+			lap_time = start_time;
+			counters.Start();
+		}
+
+		/// <summary>
+		/// 结束一个阶段，把距上一次Lap的耗时计入该阶段。
+		/// </summary>
+		/// <param name="phase">刚结束的阶段。</param>
+		void Lap(const EnginePhase phase)
+		{
+			const auto now = std::chrono::steady_clock::now();
+			stats.phase_nanoseconds[static_cast<size_t>(phase)] += std::chrono::duration_cast<std::chrono::nanoseconds>(now - lap_time).count();
+			lap_time = now;
+		}
+
+		void AddBytes(const long long bytes)
+		{
+			stats.bytes += bytes;
+		}
+
+		/// <summary>
+		/// 记录一条记录及其字段数。
+		/// </summary>
+		void AddRecord(const size_t field_count)
+		{
+			stats.records++;
+			stats.fields += static_cast<long long>(field_count);
+		}
+
+		void AddAllocations(const long long allocations)
+		{
+			stats.allocations += allocations;
+		}
+
+		/// <summary>
+		/// 记录一条记录的分配：记录向量本身，以及超出短字符串容量的字段。
+		/// </summary>
+		template <typename T>
+		void AddFieldAllocations(const std::vector<T>& record)
+		{
+			stats.allocations += record.capacity() > 0 ? 1 : 0;
+			if constexpr (std::is_same_v<T, std::string>)
+			{
+				const size_t inline_capacity = std::string().capacity();
+				for (const auto& field : record)
+				{
+					stats.allocations += field.capacity() > inline_capacity ? 1 : 0;
+				}
+			}
+		}
+
+		/// <summary>
+		/// 结束统计，记录总耗时、缺页次数的增量和硬件计数。
+		/// </summary>
+		void Finish()
+		{
+			counters.Stop(stats);
+			stats.total_nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time).count();
+			long long page_faults = 0;
+			long long major_page_faults = 0;
+			ReadPageFaults(page_faults, major_page_faults);
+			stats.page_faults = page_faults - start_page_faults;
+			stats.major_page_faults = major_page_faults - start_major_page_faults;
+		}
+	};
+}
@@ -1,8 +1,13 @@
 ﻿#pragma once
-#include <atlconv.h>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <vector>
+#ifdef _WIN32
+#include <atlconv.h>
 #include <atlstr.h>
-#include <sstream>
+#endif
 
 using namespace std;
 
@@ -50,6 +55,7 @@ inline string ToString(long value)
 	return str;
 }
 
+#ifdef _WIN32
 /// <summary>
 /// 转换为字符串类型。
 /// </summary>
@@ -61,6 +67,7 @@ inline string ToString(const CString& value)
 	const auto* const str = T2A(value);
 	return str;
 }
+#endif
 
 /// <summary>
 /// 转换为字符串类型的泛型函数。
@@ -76,6 +83,7 @@ string ToString(const T& value)
 	return oss.str();
 }
 
+#ifdef _WIN32
 inline std::wstring ToWString(const std::string& str)
 {
 	//int len = MultiByteToWideChar(CP_UTF8, 0, str.c_str(), -1, nullptr, 0);
@@ -112,6 +120,7 @@ inline std::string ToString(const std::wstring& wstr)
 	std::string result(buffer.data(), char_count);
 	return result;
 }
+#endif
 
 /// <summary>
 /// 字符串格式化。
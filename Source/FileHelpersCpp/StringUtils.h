@@ -1,5 +1,6 @@
 ﻿#pragma once
 #include <string>
+#include <string_view>
 #include <sstream>
 #include <fstream>
 #include <vector>
@@ -83,6 +84,33 @@ static inline std::vector<double> SplitIntoDouble(const std::string& str, const
 	return tokens;
 }
 
+static inline void SplitViews(const std::string_view str, const std::string_view delim, std::vector<std::string_view>& out_tokens, const bool trim_empty = false)
+{
+	size_t last_pos = 0;
+	out_tokens.clear();
+
+	while (true)
+	{
+		size_t pos = str.find(delim, last_pos);
+		if (pos == std::string_view::npos)
+		{
+			pos = str.size();
+		}
+
+		const size_t len = pos - last_pos;
+		if (!trim_empty || len != 0)
+		{
+			out_tokens.push_back(str.substr(last_pos, len));
+		}
+
+		if (pos == str.size())
+		{
+			break;
+		}
+		last_pos = pos + delim.size();
+	}
+}
+
 static inline std::string Join(const std::vector<std::string>& tokens, const std::string& delim, const bool trim_empty = false)
 {
 	if (trim_empty)
@@ -0,0 +1,350 @@
+﻿#include "pch.h"
+#include <algorithm>
+#include <exception>
+#include "ThreadPool.h"
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace file_helpers_cpp;
+
+namespace
+{
+	/// <summary>
+	/// 当前线程所属的线程池，非工作线程为nullptr。
+	/// </summary>
+	thread_local const ThreadPool* current_pool = nullptr;
+
+	/// <summary>
+	/// 当前工作线程的序号。
+	/// </summary>
+	thread_local size_t current_worker = 0;
+
+	/// <summary>
+	/// 共享线程池的配置。
+	/// </summary>
+	ThreadPoolOptions shared_options;
+
+	/// <summary>
+	/// 共享的线程池。
+	/// </summary>
+	std::shared_ptr<ThreadPool> shared_pool;
+
+	std::mutex shared_pool_mutex;
+
+	/// <summary>
+	/// 释放共享的线程池。析构时要等待所有工作线程退出，最后一个使用者是该线程池自己的工作线程时（如在任务中调用Configure），改在新线程中析构，避免工作线程等待自己退出。
+	/// </summary>
+	/// <param name="pool">要释放的线程池。</param>
+	void DeleteSharedPool(const ThreadPool* pool)
+	{
+		if (current_pool != pool)
+		{
+			delete pool;
+			return;
+		}
+		std::thread([pool] { delete pool; }).detach();
+	}
+}
+
+/// <summary>
+/// 创建线程池并启动工作线程。
+/// </summary>
+/// <param name="options">线程池配置。</param>
+ThreadPool::ThreadPool(const ThreadPoolOptions& options)
+	: options(options)
+{
+	if (this->options.worker_count <= 0)
+	{
+		this->options.worker_count = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+	}
+
+	const size_t worker_count = static_cast<size_t>(this->options.worker_count);
+	queues.reserve(worker_count);
+	for (size_t i = 0; i < worker_count; i++)
+	{
+		queues.emplace_back(new WorkerQueue());
+	}
+	workers.reserve(worker_count);
+	for (size_t i = 0; i < worker_count; i++)
+	{
+		workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+		PinWorker(workers.back(), i);
+	}
+}
+
+/// <summary>
+/// 析构函数。执行完已提交的任务后停止所有工作线程。
+/// </summary>
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(wake_mutex);
+		stopping = true;
+	}
+	wake_condition.notify_all();
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+/// <summary>
+/// 获取引擎共享的线程池，首次调用时按当前配置创建。
+/// </summary>
+/// <returns>共享的线程池。</returns>
+std::shared_ptr<ThreadPool> ThreadPool::Shared()
+{
+	std::lock_guard<std::mutex> lock(shared_pool_mutex);
+	if (!shared_pool)
+	{
+		shared_pool = std::shared_ptr<ThreadPool>(new ThreadPool(shared_options), DeleteSharedPool);
+	}
+	return shared_pool;
+}
+
+/// <summary>
+/// 按新配置重新创建共享的线程池。原线程池在最后一个使用者释放后停止。可以在线程池的任务中调用。
+/// </summary>
+/// <param name="options">线程池配置。</param>
+void ThreadPool::Configure(const ThreadPoolOptions& options)
+{
+	std::shared_ptr<ThreadPool> old_pool;
+	{
+		std::lock_guard<std::mutex> lock(shared_pool_mutex);
+		shared_options = options;
+		old_pool.swap(shared_pool);
+	}
+	// 在锁外释放，等待原线程池的工作线程退出时不阻塞其他线程获取新线程池。
+	old_pool.reset();
+}
+
+/// <summary>
+/// 获取工作线程数。
+/// </summary>
+/// <returns>工作线程数。</returns>
+int ThreadPool::WorkerCount() const
+{
+	return options.worker_count;
+}
+
+/// <summary>
+/// 获取单次调用的实际并行度。
+/// </summary>
+/// <param name="requested">调用时指定的线程数。小于等于0表示使用配置的默认并行度。不超过配置的单次调用最大并行度。</param>
+/// <returns>实际并行度，至少为1。</returns>
+int ThreadPool::Parallelism(const int requested) const
+{
+	if (requested > 0)
+	{
+		return options.max_parallelism_per_call > 0 ? std::min(requested, options.max_parallelism_per_call) : requested;
+	}
+	if (options.max_parallelism_per_call > 0)
+	{
+		return options.max_parallelism_per_call;
+	}
+	return options.worker_count;
+}
+
+/// <summary>
+/// 从指定队列开始依次尝试取出一个任务。第一个队列从队尾取，其他队列从队首窃取。
+/// </summary>
+/// <param name="first_queue">首先尝试的队列序号。</param>
+/// <param name="task">取出的任务。</param>
+/// <returns>是否取到任务。</returns>
+bool ThreadPool::TryTake(const size_t first_queue, Task& task)
+{
+	for (size_t i = 0; i < queues.size(); i++)
+	{
+		WorkerQueue& queue = *queues[(first_queue + i) % queues.size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.tasks.empty())
+		{
+			continue;
+		}
+		if (i == 0)
+		{
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+		}
+		else
+		{
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+		}
+		pending_tasks--;
+		return true;
+	}
+	return false;
+}
+
+/// <summary>
+/// 工作线程的主循环。
+/// </summary>
+/// <param name="index">工作线程序号。</param>
+void ThreadPool::WorkerLoop(const size_t index)
+{
+	current_pool = this;
+	current_worker = index;
+
+	Task task;
+	while (true)
+	{
+		if (TryTake(index, task))
+		{
+			task();
+			task = nullptr;
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(wake_mutex);
+		wake_condition.wait(lock, [this] { return stopping || pending_tasks > 0; });
+		if (stopping && pending_tasks == 0)
+		{
+			return;
+		}
+	}
+}
+
+/// <summary>
+/// 按配置将工作线程绑定到CPU核心。
+/// </summary>
+/// <param name="worker">工作线程。</param>
+/// <param name="index">工作线程序号。</param>
+void ThreadPool::PinWorker(std::thread& worker, const size_t index) const
+{
+	if (!options.pin_workers)
+	{
+		return;
+	}
+	const int cpu_id = options.cpu_ids.empty() ? static_cast<int>(index) : options.cpu_ids[index % options.cpu_ids.size()];
+	if (cpu_id < 0)
+	{
+		return;
+	}
+
+	// 绑定失败（如核心编号超出范围）时工作线程不绑定，照常运行。
+#ifdef _WIN32
+	if (cpu_id < 64)
+	{
+		SetThreadAffinityMask(worker.native_handle(), static_cast<DWORD_PTR>(1) << cpu_id);
+	}
+#elif defined(__linux__)
+	if (cpu_id < CPU_SETSIZE)
+	{
+		cpu_set_t cpu_set;
+		CPU_ZERO(&cpu_set);
+		CPU_SET(cpu_id, &cpu_set);
+		pthread_setaffinity_np(worker.native_handle(), sizeof(cpu_set), &cpu_set);
+	}
+#endif
+}
+
+/// <summary>
+/// 提交一个任务。工作线程提交的任务放入自己的队列，其他线程提交的任务轮流放入各队列。
+/// </summary>
+/// <param name="task">要执行的任务。</param>
+void ThreadPool::Submit(Task task)
+{
+	const size_t queue_index = current_pool == this ? current_worker : next_queue++ % queues.size();
+	{
+		// 计数与入队在同一个队列锁内，TryTake出队后的减一不会早于这里的加一。
+		WorkerQueue& queue = *queues[queue_index];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.tasks.push_back(std::move(task));
+		pending_tasks++;
+	}
+	{
+		// 等待的线程在wake_mutex内检查计数后才进入等待，先获取一次锁再通知，通知不会丢失。
+		std::lock_guard<std::mutex> lock(wake_mutex);
+	}
+	wake_condition.notify_one();
+}
+
+/// <summary>
+/// 取出一个等待中的任务并在当前线程执行，用于等待期间帮助线程池推进。
+/// </summary>
+/// <returns>是否执行了任务。</returns>
+bool ThreadPool::RunPendingTask()
+{
+	Task task;
+	if (!TryTake(current_pool == this ? current_worker : 0, task))
+	{
+		return false;
+	}
+	task();
+	return true;
+}
+
+/// <summary>
+/// 并行执行task_count个任务，同时执行的任务数不超过max_parallelism。调用线程也领取任务序号执行，返回时所有任务已完成。
+/// </summary>
+/// <param name="task_count">任务数。</param>
+/// <param name="max_parallelism">本次调用的最大并行度。小于等于0表示使用配置的默认并行度。</param>
+/// <param name="body">以任务序号调用的任务体。</param>
+void ThreadPool::ParallelFor(const size_t task_count, const int max_parallelism, const std::function<void(size_t)>& body)
+{
+	if (task_count == 0)
+	{
+		return;
+	}
+
+	// 一次并行调用的共享状态。晚于调用返回才开始执行的执行者只读取序号后即退出，因此由shared_ptr持有。
+	struct LoopState
+	{
+		std::atomic<size_t> next_index{0};
+		size_t task_count = 0;
+		size_t completed_count = 0;
+		const std::function<void(size_t)>* body = nullptr;
+		std::exception_ptr first_exception;
+		std::mutex mutex;
+		std::condition_variable condition;
+	};
+
+	const auto state = std::make_shared<LoopState>();
+	state->task_count = task_count;
+	state->body = &body;
+
+	// 每个执行者不断领取下一个任务序号，直到领完为止。
+	const auto run = [state]
+	{
+		for (size_t index = state->next_index++; index < state->task_count; index = state->next_index++)
+		{
+			std::exception_ptr exception;
+			try
+			{
+				(*state->body)(index);
+			}
+			catch (...)
+			{
+				exception = std::current_exception();
+			}
+
+			std::lock_guard<std::mutex> lock(state->mutex);
+			if (exception && !state->first_exception)
+			{
+				state->first_exception = exception;
+			}
+			if (++state->completed_count == state->task_count)
+			{
+				state->condition.notify_all();
+			}
+		}
+	};
+
+	const size_t runner_count = std::min(task_count, static_cast<size_t>(Parallelism(max_parallelism)));
+	for (size_t i = 1; i < runner_count; i++)
+	{
+		Submit(run);
+	}
+	run();
+
+	// 调用线程领完任务后，等待其他执行者完成已领取的任务。这些任务都已在执行中，完成不依赖队列中的任务，嵌套调用不会死锁。
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->condition.wait(lock, [&state] { return state->completed_count == state->task_count; });
+	if (state->first_exception)
+	{
+		std::rethrow_exception(state->first_exception);
+	}
+}
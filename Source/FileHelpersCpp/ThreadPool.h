@@ -0,0 +1,151 @@
+﻿#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "FileEngineBase.h"
+
+namespace file_helpers_cpp
+{
+	/// <summary>
+	/// 引擎共享的工作窃取线程池。每个工作线程有自己的任务队列，从队尾取自己提交的任务，空闲时从其他队列的队首窃取任务。
+	/// ParallelFor的调用线程也领取任务序号，领完后只等待已在执行中的任务，嵌套的并行调用不会死锁。
+	/// </summary>
+	class ThreadPool
+	{
+	public:
+		using Task = std::function<void()>;
+
+	private:
+		/// <summary>
+		/// 一个工作线程的任务队列。
+		/// </summary>
+		struct WorkerQueue
+		{
+			std::mutex mutex;
+
+			std::deque<Task> tasks;
+		};
+
+		/// <summary>
+		/// 线程池配置。
+		/// </summary>
+		ThreadPoolOptions options;
+
+		/// <summary>
+		/// 各工作线程的任务队列。
+		/// </summary>
+		std::vector<std::unique_ptr<WorkerQueue>> queues;
+
+		/// <summary>
+		/// 工作线程。
+		/// </summary>
+		std::vector<std::thread> workers;
+
+		/// <summary>
+		/// 已提交但尚未被取出的任务数，与任务的入队和出队在同一个队列锁内更新。
+		/// </summary>
+		std::atomic<size_t> pending_tasks{0};
+
+		/// <summary>
+		/// 外部线程提交任务时轮流选择的队列序号。
+		/// </summary>
+		std::atomic<size_t> next_queue{0};
+
+		/// <summary>
+		/// 是否正在停止。
+		/// </summary>
+		bool stopping = false;
+
+		std::mutex wake_mutex;
+
+		std::condition_variable wake_condition;
+
+		/// <summary>
+		/// 从指定队列开始依次尝试取出一个任务。第一个队列从队尾取，其他队列从队首窃取。
+		/// </summary>
+		/// <param name="first_queue">首先尝试的队列序号。</param>
+		/// <param name="task">取出的任务。</param>
+		/// <returns>是否取到任务。</returns>
+		bool TryTake(size_t first_queue, Task& task);
+
+		/// <summary>
+		/// 工作线程的主循环。
+		/// </summary>
+		/// <param name="index">工作线程序号。</param>
+		void WorkerLoop(size_t index);
+
+		/// <summary>
+		/// 按配置将工作线程绑定到CPU核心。
+		/// </summary>
+		/// <param name="worker">工作线程。</param>
+		/// <param name="index">工作线程序号。</param>
+		void PinWorker(std::thread& worker, size_t index) const;
+
+	public:
+		/// <summary>
+		/// 创建线程池并启动工作线程。
+		/// </summary>
+		/// <param name="options">线程池配置。</param>
+		explicit ThreadPool(const ThreadPoolOptions& options);
+
+		/// <summary>
+		/// 析构函数。执行完已提交的任务后停止所有工作线程。
+		/// </summary>
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		/// <summary>
+		/// 获取引擎共享的线程池，首次调用时按当前配置创建。
+		/// </summary>
+		/// <returns>共享的线程池。调用期间持有该指针，重新配置不会影响正在进行的调用。</returns>
+		static std::shared_ptr<ThreadPool> Shared();
+
+		/// <summary>
+		/// 按新配置重新创建共享的线程池。可以在线程池的任务中调用。
+		/// </summary>
+		/// <param name="options">线程池配置。</param>
+		static void Configure(const ThreadPoolOptions& options);
+
+		/// <summary>
+		/// 获取工作线程数。
+		/// </summary>
+		/// <returns>工作线程数。</returns>
+		int WorkerCount() const;
+
+		/// <summary>
+		/// 获取单次调用的实际并行度。
+		/// </summary>
+		/// <param name="requested">调用时指定的线程数。小于等于0表示使用配置的默认并行度。不超过配置的单次调用最大并行度。</param>
+		/// <returns>实际并行度，至少为1。</returns>
+		int Parallelism(int requested) const;
+
+		/// <summary>
+		/// 提交一个任务。工作线程提交的任务放入自己的队列，其他线程提交的任务轮流放入各队列。
+		/// </summary>
+		/// <param name="task">要执行的任务。</param>
+		void Submit(Task task);
+
+		/// <summary>
+		/// 取出一个等待中的任务并在当前线程执行，用于等待期间帮助线程池推进。
+		/// </summary>
+		/// <returns>是否执行了任务。</returns>
+		bool RunPendingTask();
+
+		/// <summary>
+		/// 并行执行task_count个任务，同时执行的任务数不超过max_parallelism。调用线程也领取任务序号执行，领完后等待其他执行者完成已领取的任务，不执行队列中的其他任务。
+		/// 返回时所有任务已完成。任务抛出的第一个异常在调用线程重新抛出。
+		/// </summary>
+		/// <param name="task_count">任务数。</param>
+		/// <param name="max_parallelism">本次调用的最大并行度。小于等于0表示使用配置的默认并行度。</param>
+		/// <param name="body">以任务序号调用的任务体。</param>
+		void ParallelFor(size_t task_count, int max_parallelism, const std::function<void(size_t)>& body);
+	};
+}
@@ -0,0 +1,133 @@
+﻿#pragma once
+#include <atomic>
+#include <cstddef>
+#include <string>
+
+namespace file_helpers_cpp
+{
+	/// <summary>
+	/// 表示一个已结束的区间。
+	/// </summary>
+	struct TraceEvent
+	{
+		/// <summary>
+		/// 区间名称，必须是静态字符串。
+		/// </summary>
+		const char* name;
+
+		/// <summary>
+		/// 区间所属的组件，必须是静态字符串。
+		/// </summary>
+		const char* category;
+
+		/// <summary>
+		/// 开始时间，单位为纳秒，相对于跟踪开始的时间。
+		/// </summary>
+		long long begin_nanoseconds;
+
+		/// <summary>
+		/// 结束时间，单位为纳秒，相对于跟踪开始的时间。
+		/// </summary>
+		long long end_nanoseconds;
+
+		/// <summary>
+		/// 附加参数的名称，必须是静态字符串，为空时没有参数。
+		/// </summary>
+		const char* arg_name;
+
+		/// <summary>
+		/// 附加参数的值，例如块序号或字节数。
+		/// </summary>
+		long long arg_value;
+	};
+
+	/// <summary>
+	/// 记录所有线程的跟踪事件。每个线程第一次记录时分配自己的缓冲区并以无锁方式加入全局链表，
+	/// 之后只有该线程向缓冲区追加事件，发布事件时用release写入计数，读取方用acquire读取计数，整个过程不加锁。
+	/// 缓冲区在进程结束前不释放，新的跟踪由各线程在下一次记录时自行清空。
+	/// </summary>
+	class TraceRecorder
+	{
+	private:
+		static std::atomic<bool> enabled;
+
+	public:
+		/// <summary>
+		/// 获取是否正在跟踪。
+		/// </summary>
+		static bool Enabled()
+		{
+			return enabled.load(std::memory_order_relaxed);
+		}
+
+		/// <summary>
+		/// 获取相对于跟踪开始的当前时间。
+		/// </summary>
+		/// <returns>时间，单位为纳秒。</returns>
+		static long long Now();
+
+		/// <summary>
+		/// 记录当前线程上一个已结束的区间。
+		/// </summary>
+		/// <param name="event">区间。</param>
+		static void Record(const TraceEvent& event);
+
+		static void Start();
+
+		static void Stop();
+
+		static size_t EventCount();
+
+		static std::string ToChromeTraceJson();
+	};
+
+	/// <summary>
+	/// 在作用域内记录一个区间，析构时写入当前线程的缓冲区。构造时未在跟踪则什么也不做。
+	/// </summary>
+	class TraceSpan
+	{
+	private:
+		TraceEvent event;
+
+		bool active;
+
+	public:
+		/// <summary>
+		/// 开始一个区间。
+		/// </summary>
+		/// <param name="name">区间名称，必须是静态字符串。</param>
+		/// <param name="category">区间所属的组件，必须是静态字符串。</param>
+		/// <param name="arg_name">附加参数的名称，必须是静态字符串，为空时没有参数。</param>
+		/// <param name="arg_value">附加参数的值。</param>
+		TraceSpan(const char* name, const char* category, const char* arg_name = nullptr, const long long arg_value = 0)
+			: active(TraceRecorder::Enabled())
+		{
+			if (active)
+			{
+				event = { name, category, TraceRecorder::Now(), 0, arg_name, arg_value };
+			}
+		}
+
+		TraceSpan(const TraceSpan&) = delete;
+
+		TraceSpan& operator=(const TraceSpan&) = delete;
+
+		~TraceSpan()
+		{
+			End();
+		}
+
+		/// <summary>
+		/// 提前结束区间。重复调用时只有第一次有效。
+		/// </summary>
+		void End()
+		{
+			if (active)
+			{
+				active = false;
+				event.end_nanoseconds = TraceRecorder::Now();
+				TraceRecorder::Record(event);
+			}
+		}
+	};
+}
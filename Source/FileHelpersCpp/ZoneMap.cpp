@@ -0,0 +1,580 @@
+﻿#include "pch.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include "mio.hpp"
+#include "ColumnStatsScanner.h"
+#include "HashAggregator.h"
+#include "LineScanner.h"
+#include "StringUtils.h"
+#include "ThreadPool.h"
+#include "TraceRecorder.h"
+#include "ZoneMap.h"
+
+using namespace file_helpers_cpp;
+
+namespace
+{
+	/// <summary>
+	/// 旁路文件的标识和版本。
+	/// </summary>
+	constexpr char kZoneMapMagic[4] = { 'F', 'H', 'Z', 'M' };
+
+	constexpr uint32_t kZoneMapVersion = 2;
+
+	/// <summary>
+	/// 过滤读取时每个解析任务处理的字节数。
+	/// </summary>
+	constexpr size_t kFilterChunkSize = 8 * 1024 * 1024;
+
+	/// <summary>
+	/// 获取文件的修改时间。
+	/// </summary>
+	bool ReadFileTime(const std::string& path, int64_t& time, std::error_code& error)
+	{
+		const std::filesystem::file_time_type write_time = std::filesystem::last_write_time(path, error);
+		if (error)
+		{
+			return false;
+		}
+		time = static_cast<int64_t>(write_time.time_since_epoch().count());
+		return true;
+	}
+
+	uint64_t HashBlock(const char* data, const ZoneBlock& block)
+	{
+		return HashKeyBytes(std::string_view(data + block.begin, static_cast<size_t>(block.end - block.begin)));
+	}
+
+	/// <summary>
+	/// 判断一行是否满足所有范围条件。
+	/// </summary>
+	bool RowMatches(const std::vector<std::string_view>& fields, const std::vector<ColumnRange>& ranges)
+	{
+		for (const auto& range : ranges)
+		{
+			double value = 0;
+			if (range.column_index < 0 || static_cast<size_t>(range.column_index) >= fields.size()
+				|| !ParseNumericField(fields[range.column_index], value) || value < range.min || value > range.max)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void AppendRecord(const std::vector<std::string_view>& fields, std::string& field_text, std::vector<std::vector<double>>& out_records)
+	{
+		std::vector<double> record;
+		record.reserve(fields.size());
+		for (const auto& field : fields)
+		{
+			field_text.assign(field.data(), field.size());
+			record.push_back(atof(field_text.c_str()));
+		}
+		out_records.push_back(std::move(record));
+	}
+
+	void AppendRecord(const std::vector<std::string_view>& fields, std::string&, std::vector<std::vector<std::string>>& out_records)
+	{
+		std::vector<std::string> record;
+		record.reserve(fields.size());
+		for (const auto& field : fields)
+		{
+			record.emplace_back(field);
+		}
+		out_records.push_back(std::move(record));
+	}
+
+	template <typename T>
+	void WriteValue(std::ofstream& stream, const T& value)
+	{
+		stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	template <typename T>
+	bool ReadValue(std::ifstream& stream, T& value)
+	{
+		return static_cast<bool>(stream.read(reinterpret_cast<char*>(&value), sizeof(T)));
+	}
+}
+
+/// <summary>
+/// 判断块内是否可能存在满足所有范围条件的行。
+/// </summary>
+/// <param name="ranges">范围条件。</param>
+/// <returns>是否可能存在。</returns>
+bool ZoneBlock::MayMatch(const std::vector<ColumnRange>& ranges) const
+{
+	for (const auto& range : ranges)
+	{
+		const size_t column = static_cast<size_t>(range.column_index);
+		if (range.column_index < 0 || column >= counts.size() || counts[column] == 0)
+		{
+			return false;
+		}
+		if (maxs[column] < range.min || mins[column] > range.max)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/// <summary>
+/// 并行校验所有块的哈希值。
+/// </summary>
+bool ZoneMap::BlocksMatch(const char* data, const int thread_count) const
+{
+	const std::shared_ptr<ThreadPool> pool = ThreadPool::Shared();
+	std::vector<char> matched(blocks.size(), 0);
+	pool->ParallelFor(blocks.size(), pool->Parallelism(thread_count), [&](const size_t i)
+	{
+		TraceSpan span("verify", "ZoneMap", "bytes", static_cast<long long>(blocks[i].end - blocks[i].begin));
+		matched[i] = HashBlock(data, blocks[i]) == blocks[i].hash;
+	});
+	return std::all_of(matched.begin(), matched.end(), [](const char value) { return value != 0; });
+}
+
+/// <summary>
+/// 读取旁路文件。
+/// </summary>
+/// <param name="sidecar_path">旁路文件路径。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否读取成功。</returns>
+bool ZoneMap::Load(const std::string& sidecar_path, std::error_code& error)
+{
+	std::ifstream stream(sidecar_path, std::ios::binary);
+	if (!stream.is_open())
+	{
+		error = std::make_error_code(std::errc::no_such_file_or_directory);
+		return false;
+	}
+
+	char magic[4] = {};
+	uint32_t version = 0;
+	uint32_t delimiter_size = 0;
+	stream.read(magic, sizeof(magic));
+	if (!stream || std::memcmp(magic, kZoneMapMagic, sizeof(magic)) != 0 || !ReadValue(stream, version) || version != kZoneMapVersion
+		|| !ReadValue(stream, delimiter_size) || delimiter_size > 1024)
+	{
+		error = std::make_error_code(std::errc::illegal_byte_sequence);
+		return false;
+	}
+	delimiter.assign(delimiter_size, '\0');
+	stream.read(&delimiter[0], delimiter_size);
+
+	uint64_t block_count = 0;
+	if (!ReadValue(stream, block_size) || !ReadValue(stream, indexed_size) || !ReadValue(stream, file_size) || !ReadValue(stream, file_time)
+		|| !ReadValue(stream, block_count))
+	{
+		error = std::make_error_code(std::errc::illegal_byte_sequence);
+		return false;
+	}
+
+	blocks.clear();
+	for (uint64_t i = 0; i < block_count; i++)
+	{
+		ZoneBlock block;
+		uint32_t column_count = 0;
+		if (!ReadValue(stream, block.begin) || !ReadValue(stream, block.end) || !ReadValue(stream, block.row_count) || !ReadValue(stream, block.hash)
+			|| !ReadValue(stream, column_count))
+		{
+			error = std::make_error_code(std::errc::illegal_byte_sequence);
+			return false;
+		}
+		block.counts.resize(column_count);
+		block.mins.resize(column_count);
+		block.maxs.resize(column_count);
+		for (uint32_t column = 0; column < column_count; column++)
+		{
+			if (!ReadValue(stream, block.counts[column]) || !ReadValue(stream, block.mins[column]) || !ReadValue(stream, block.maxs[column]))
+			{
+				error = std::make_error_code(std::errc::illegal_byte_sequence);
+				return false;
+			}
+		}
+		blocks.push_back(std::move(block));
+	}
+	return true;
+}
+
+/// <summary>
+/// 写入旁路文件。先写入临时文件再替换。
+/// </summary>
+/// <param name="sidecar_path">旁路文件路径。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否写入成功。</returns>
+bool ZoneMap::Save(const std::string& sidecar_path, std::error_code& error) const
+{
+	const std::string temp_path = sidecar_path + ".tmp";
+	{
+		std::ofstream stream(temp_path, std::ios::binary | std::ios::trunc);
+		if (!stream.is_open())
+		{
+			error = std::make_error_code(std::errc::bad_file_descriptor);
+			return false;
+		}
+
+		stream.write(kZoneMapMagic, sizeof(kZoneMapMagic));
+		WriteValue(stream, kZoneMapVersion);
+		WriteValue(stream, static_cast<uint32_t>(delimiter.size()));
+		stream.write(delimiter.data(), static_cast<std::streamsize>(delimiter.size()));
+		WriteValue(stream, block_size);
+		WriteValue(stream, indexed_size);
+		WriteValue(stream, file_size);
+		WriteValue(stream, file_time);
+		WriteValue(stream, static_cast<uint64_t>(blocks.size()));
+		for (const auto& block : blocks)
+		{
+			WriteValue(stream, block.begin);
+			WriteValue(stream, block.end);
+			WriteValue(stream, block.row_count);
+			WriteValue(stream, block.hash);
+			WriteValue(stream, static_cast<uint32_t>(block.counts.size()));
+			for (size_t column = 0; column < block.counts.size(); column++)
+			{
+				WriteValue(stream, block.counts[column]);
+				WriteValue(stream, block.mins[column]);
+				WriteValue(stream, block.maxs[column]);
+			}
+		}
+		if (!stream)
+		{
+			error = std::make_error_code(std::errc::io_error);
+			return false;
+		}
+	}
+
+	std::filesystem::rename(temp_path, sidecar_path, error);
+	return !error;
+}
+
+/// <summary>
+/// 判断区域映射是否仍与文件内容一致。
+/// </summary>
+/// <param name="data">文件数据。</param>
+/// <param name="size">文件大小。</param>
+/// <param name="time">文件的修改时间。</param>
+/// <param name="delimiter">分隔符。</param>
+/// <param name="thread_count">校验块的哈希值时的线程数。小于等于0表示使用线程池的默认并行度。</param>
+/// <returns>是否一致。</returns>
+bool ZoneMap::Matches(const char* data, const uint64_t size, const int64_t time, const std::string& delimiter, const int thread_count) const
+{
+	if (this->delimiter != delimiter || indexed_size > size || block_size == 0)
+	{
+		return false;
+	}
+	if (size == file_size && time == file_time)
+	{
+		return true;
+	}
+	// 文件被修改过，只有所有块的内容都没有改变时（例如只在末尾追加）才仍然有效。
+	return BlocksMatch(data, thread_count);
+}
+
+/// <summary>
+/// 建立或增量更新区域映射。
+/// </summary>
+/// <param name="data">文件数据。</param>
+/// <param name="size">文件大小。</param>
+/// <param name="time">文件的修改时间。</param>
+/// <param name="delimiter">分隔符。</param>
+/// <param name="new_block_size">块大小，单位为字节。增量更新时沿用原块大小。</param>
+/// <param name="thread_count">线程数。小于等于0表示使用线程池的默认并行度。</param>
+void ZoneMap::Update(const char* data, const uint64_t size, const int64_t time, const std::string& delimiter, const uint64_t new_block_size, const int thread_count)
+{
+	if (Matches(data, size, time, delimiter, thread_count))
+	{
+		// 最后一个块不满时重新统计，追加的行并入该块。
+		if (!blocks.empty() && blocks.back().end - blocks.back().begin < block_size)
+		{
+			indexed_size = blocks.back().begin;
+			blocks.pop_back();
+		}
+	}
+	else
+	{
+		this->delimiter = delimiter;
+		block_size = new_block_size;
+		indexed_size = 0;
+		blocks.clear();
+	}
+
+	// 索引只覆盖到最后一个换行符。
+	uint64_t index_end = size;
+	while (index_end > indexed_size && data[index_end - 1] != '\n')
+	{
+		index_end--;
+	}
+
+	// 块在约block_size字节后的第一个换行符处结束。
+	const size_t first_new_block = blocks.size();
+	for (uint64_t begin = indexed_size; begin < index_end;)
+	{
+		const uint64_t split = std::min(index_end, begin + block_size);
+		const uint64_t end = split == index_end || data[split - 1] == '\n'
+			? split
+			: std::min(index_end, static_cast<uint64_t>(FindLineEnd(data, static_cast<size_t>(split), static_cast<size_t>(index_end))) + 1);
+		ZoneBlock block;
+		block.begin = begin;
+		block.end = end;
+		blocks.push_back(std::move(block));
+		begin = end;
+	}
+
+	const std::shared_ptr<ThreadPool> pool = ThreadPool::Shared();
+	pool->ParallelFor(blocks.size() - first_new_block, pool->Parallelism(thread_count), [&](const size_t i)
+	{
+		ZoneBlock& block = blocks[first_new_block + i];
+		TraceSpan span("scan", "ZoneMap", "bytes", static_cast<long long>(block.end - block.begin));
+		ColumnStatsAccumulator accumulator(delimiter);
+		accumulator.AddText(data, static_cast<size_t>(block.begin), static_cast<size_t>(block.end));
+		const TableStats stats = accumulator.Finish();
+		block.row_count = static_cast<uint64_t>(stats.row_count);
+		block.hash = HashBlock(data, block);
+		for (const auto& column : stats.columns)
+		{
+			block.counts.push_back(static_cast<uint64_t>(column.count));
+			block.mins.push_back(column.min);
+			block.maxs.push_back(column.max);
+		}
+	});
+
+	indexed_size = index_end;
+	file_size = size;
+	file_time = time;
+}
+
+/// <summary>
+/// 获取需要解析的字节范围：可能匹配的块，以及索引之后追加的部分。相邻的范围合并为一个。
+/// </summary>
+/// <param name="ranges">范围条件。</param>
+/// <param name="size">文件大小。</param>
+/// <returns>按偏移量升序排列的[begin, end)范围。</returns>
+std::vector<std::pair<uint64_t, uint64_t>> ZoneMap::CandidateRanges(const std::vector<ColumnRange>& ranges, const uint64_t size) const
+{
+	std::vector<std::pair<uint64_t, uint64_t>> candidates;
+	const auto add = [&candidates](const uint64_t begin, const uint64_t end)
+	{
+		if (begin >= end)
+		{
+			return;
+		}
+		if (!candidates.empty() && candidates.back().second == begin)
+		{
+			candidates.back().second = end;
+		}
+		else
+		{
+			candidates.emplace_back(begin, end);
+		}
+	};
+
+	for (const auto& block : blocks)
+	{
+		if (block.MayMatch(ranges))
+		{
+			add(block.begin, block.end);
+		}
+	}
+	add(indexed_size, size);
+	return candidates;
+}
+
+/// <summary>
+/// 映射文件，建立或增量更新其区域映射旁路文件。空文件写入不含任何块的旁路文件。
+/// </summary>
+/// <param name="path">文件路径。</param>
+/// <param name="delimiter">分隔符。</param>
+/// <param name="block_size">块大小，单位为字节。</param>
+/// <param name="thread_count">线程数。小于等于0表示使用线程池的默认并行度。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否完成建立。</returns>
+bool file_helpers_cpp::BuildZoneMapSidecar(const std::string& path, const std::string& delimiter, const uint64_t block_size, const int thread_count, std::error_code& error)
+{
+	if (delimiter.empty() || block_size == 0)
+	{
+		error = std::make_error_code(std::errc::invalid_argument);
+		return false;
+	}
+
+	// 先取修改时间再映射，映射后发生的修改会使修改时间不一致。
+	int64_t stamp_time = 0;
+	if (!ReadFileTime(path, stamp_time, error))
+	{
+		return false;
+	}
+	mio::mmap_source read_mmap = mio::make_mmap_source(path, error);
+	if (error)
+	{
+		// 空文件无法映射，按空内容建立。
+		std::error_code size_error;
+		if (!std::filesystem::exists(path, size_error) || std::filesystem::file_size(path, size_error) != 0 || size_error)
+		{
+			return false;
+		}
+		error.clear();
+	}
+
+	// 旁路文件不存在或损坏时从头建立。
+	ZoneMap zone_map;
+	const std::string sidecar_path = ZoneMap::SidecarPath(path);
+	std::error_code load_error;
+	if (!zone_map.Load(sidecar_path, load_error))
+	{
+		zone_map = ZoneMap();
+	}
+	zone_map.Update(read_mmap.is_mapped() ? read_mmap.data() : "", read_mmap.size(), stamp_time, delimiter, block_size, thread_count);
+	read_mmap.unmap();
+	return zone_map.Save(sidecar_path, error);
+}
+
+/// <summary>
+/// 删除文件的区域映射旁路文件。原地修改文件内容的操作在修改成功后调用，旁路文件不存在时什么也不做。
+/// </summary>
+/// <param name="path">文件路径。</param>
+void file_helpers_cpp::RemoveZoneMapSidecar(const std::string& path)
+{
+	std::error_code remove_error;
+	std::filesystem::remove(ZoneMap::SidecarPath(path), remove_error);
+}
+
+/// <summary>
+/// 读取满足所有范围条件的行。存在有效的旁路文件时只解析可能匹配的块，否则解析整个文件；候选范围划分为对齐到行首的子块在线程池中并行解析，
+/// 最后按文件顺序拼接。
+/// </summary>
+/// <param name="path">文件路径。</param>
+/// <param name="delimiter">分隔符。</param>
+/// <param name="ranges">范围条件，字段无法解析为数值的行不满足条件。</param>
+/// <param name="thread_count">线程数。小于等于0表示使用线程池的默认并行度。</param>
+/// <param name="out_records">满足条件的行，追加到向量末尾。</param>
+/// <param name="error">错误信息。</param>
+/// <returns>是否完成读取。</returns>
+template <typename T>
+bool file_helpers_cpp::ParallelReadFilteredRecords(const std::string& path, const std::string& delimiter, const std::vector<ColumnRange>& ranges, int thread_count,
+                                                   std::vector<std::vector<T>>& out_records, std::error_code& error)
+{
+	if (delimiter.empty())
+	{
+		error = std::make_error_code(std::errc::invalid_argument);
+		return false;
+	}
+	const std::shared_ptr<ThreadPool> pool = ThreadPool::Shared();
+	thread_count = pool->Parallelism(thread_count);
+
+	int64_t stamp_time = 0;
+	if (!ReadFileTime(path, stamp_time, error))
+	{
+		return false;
+	}
+	mio::mmap_source read_mmap = mio::make_mmap_source(path, error);
+	if (error)
+	{
+		// 空文件无法映射，没有满足条件的行。
+		std::error_code size_error;
+		if (std::filesystem::exists(path, size_error) && std::filesystem::file_size(path, size_error) == 0 && !size_error)
+		{
+			error.clear();
+			return true;
+		}
+		return false;
+	}
+	const char* data = read_mmap.data();
+	const size_t size = read_mmap.size();
+
+	// 旁路文件缺失、损坏或与文件不一致时解析整个文件。
+	std::vector<std::pair<uint64_t, uint64_t>> candidates;
+	ZoneMap zone_map;
+	std::error_code load_error;
+	if (zone_map.Load(ZoneMap::SidecarPath(path), load_error) && zone_map.Matches(data, size, stamp_time, delimiter, thread_count))
+	{
+		candidates = zone_map.CandidateRanges(ranges, size);
+	}
+	else
+	{
+		candidates.emplace_back(0, size);
+	}
+
+	// 候选范围的边界都在行首，再划分为对齐到行首的子块。
+	std::vector<std::pair<size_t, size_t>> chunks;
+	for (const auto& candidate : candidates)
+	{
+		size_t begin = static_cast<size_t>(candidate.first);
+		const size_t end = static_cast<size_t>(candidate.second);
+		while (begin < end)
+		{
+			const size_t split = std::min(end, begin + kFilterChunkSize);
+			const size_t chunk_end = split == end || data[split - 1] == '\n' ? split : std::min(end, FindLineEnd(data, split, end) + 1);
+			chunks.emplace_back(begin, chunk_end);
+			begin = chunk_end;
+		}
+	}
+
+	std::vector<std::vector<std::vector<T>>> chunk_records(chunks.size());
+	std::vector<std::error_code> errors(chunks.size());
+	pool->ParallelFor(chunks.size(), thread_count, [&](const size_t i)
+	{
+		TraceSpan span("parse", "ReadFiltered", "bytes", static_cast<long long>(chunks[i].second - chunks[i].first));
+		try
+		{
+			std::vector<std::string_view> fields;
+			std::string field_text;
+			size_t begin = chunks[i].first;
+			const size_t end = chunks[i].second;
+			while (begin < end)
+			{
+				const size_t line_end = FindLineEnd(data, begin, end);
+				std::string_view line(data + begin, line_end - begin);
+				begin = line_end + 1;
+				if (!line.empty() && line.back() == '\r')
+				{
+					line.remove_suffix(1);
+				}
+				if (line.empty())
+				{
+					continue;
+				}
+				SplitViews(line, delimiter, fields, true);
+				if (RowMatches(fields, ranges))
+				{
+					AppendRecord(fields, field_text, chunk_records[i]);
+				}
+			}
+		}
+		catch (std::bad_alloc&)
+		{
+			errors[i] = std::make_error_code(std::errc::not_enough_memory);
+		}
+	});
+	read_mmap.unmap();
+
+	for (const auto& worker_error : errors)
+	{
+		if (worker_error)
+		{
+			error = worker_error;
+			return false;
+		}
+	}
+
+	size_t record_count = 0;
+	for (const auto& records : chunk_records)
+	{
+		record_count += records.size();
+	}
+	out_records.reserve(out_records.size() + record_count);
+	for (auto& records : chunk_records)
+	{
+		std::move(records.begin(), records.end(), std::back_inserter(out_records));
+	}
+	return true;
+}
+
+template bool file_helpers_cpp::ParallelReadFilteredRecords(const std::string&, const std::string&, const std::vector<ColumnRange>&, int,
+                                                            std::vector<std::vector<double>>&, std::error_code&);
+
+template bool file_helpers_cpp::ParallelReadFilteredRecords(const std::string&, const std::string&, const std::vector<ColumnRange>&, int,
+                                                            std::vector<std::vector<std::string>>&, std::error_code&);
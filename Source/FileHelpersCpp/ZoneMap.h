@@ -0,0 +1,175 @@
+﻿#pragma once
+#include <cstdint>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+#include "DelimitedFileMMFEngine.h"
+
+namespace file_helpers_cpp
+{
+	/// <summary>
+	/// 表示区域映射中的一个块：块的字节范围、行数和各列有效数值的最小值、最大值。
+	/// </summary>
+	struct ZoneBlock
+	{
+		uint64_t begin = 0;
+
+		uint64_t end = 0;
+
+		uint64_t row_count = 0;
+
+		/// <summary>
+		/// 块内字节的哈希值，用于在文件时间戳变化后确认块的内容没有改变。
+		/// </summary>
+		uint64_t hash = 0;
+
+		/// <summary>
+		/// 各列有效数值的个数。为0时该列在块内没有数值，最小值和最大值无意义。
+		/// </summary>
+		std::vector<uint64_t> counts;
+
+		std::vector<double> mins;
+
+		std::vector<double> maxs;
+
+		/// <summary>
+		/// 判断块内是否可能存在满足所有范围条件的行。
+		/// </summary>
+		/// <param name="ranges">范围条件。</param>
+		/// <returns>是否可能存在。</returns>
+		bool MayMatch(const std::vector<ColumnRange>& ranges) const;
+	};
+
+	/// <summary>
+	/// 表示带分隔符文本文件的块级区域映射（zone map），保存在与文件同目录的旁路文件path.zonemap中。
+	/// 块在约block_size字节后的第一个换行符处结束，索引只覆盖到最后一个换行符，之后追加的内容由读取方作为候选块处理。
+	/// 旁路文件记录建立时文件的大小、修改时间和每个块的哈希值。大小和修改时间都不变时直接使用；否则并行校验所有块的哈希值，
+	/// 全部相同说明文件只在末尾追加，从最后一个不满的块开始增量更新，否则重建。
+	/// 旁路文件使用本机字节序。
+	/// </summary>
+	class ZoneMap
+	{
+	private:
+		std::string delimiter;
+
+		uint64_t block_size = 0;
+
+		/// <summary>
+		/// 索引覆盖的字节数，总是位于行首。
+		/// </summary>
+		uint64_t indexed_size = 0;
+
+		/// <summary>
+		/// 建立时文件的大小和修改时间。
+		/// </summary>
+		uint64_t file_size = 0;
+
+		int64_t file_time = 0;
+
+		std::vector<ZoneBlock> blocks;
+
+		/// <summary>
+		/// 并行校验所有块的哈希值。
+		/// </summary>
+		bool BlocksMatch(const char* data, int thread_count) const;
+
+	public:
+		/// <summary>
+		/// 获取文件对应的旁路文件路径。
+		/// </summary>
+		static std::string SidecarPath(const std::string& path)
+		{
+			return path + ".zonemap";
+		}
+
+		const std::vector<ZoneBlock>& Blocks() const
+		{
+			return blocks;
+		}
+
+		uint64_t IndexedSize() const
+		{
+			return indexed_size;
+		}
+
+		/// <summary>
+		/// 读取旁路文件。
+		/// </summary>
+		/// <param name="sidecar_path">旁路文件路径。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否读取成功。</returns>
+		bool Load(const std::string& sidecar_path, std::error_code& error);
+
+		/// <summary>
+		/// 写入旁路文件。先写入临时文件再替换，读取方不会看到写了一半的文件。
+		/// </summary>
+		/// <param name="sidecar_path">旁路文件路径。</param>
+		/// <param name="error">错误信息。</param>
+		/// <returns>是否写入成功。</returns>
+		bool Save(const std::string& sidecar_path, std::error_code& error) const;
+
+		/// <summary>
+		/// 判断区域映射是否仍与文件内容一致：分隔符相同，文件没有变小，并且文件的大小和修改时间不变或所有块的哈希值不变。
+		/// </summary>
+		/// <param name="data">文件数据。</param>
+		/// <param name="size">文件大小。</param>
+		/// <param name="time">文件的修改时间。</param>
+		/// <param name="delimiter">分隔符。</param>
+		/// <param name="thread_count">校验块的哈希值时的线程数。小于等于0表示使用线程池的默认并行度。</param>
+		/// <returns>是否一致。</returns>
+		bool Matches(const char* data, uint64_t size, int64_t time, const std::string& delimiter, int thread_count) const;
+
+		/// <summary>
+		/// 建立或增量更新区域映射。与文件一致时保留除最后一个不满的块以外的所有块，只索引之后的内容；否则从头重建。
+		/// 各块在共享线程池中并行统计。
+		/// </summary>
+		/// <param name="data">文件数据。</param>
+		/// <param name="size">文件大小。</param>
+		/// <param name="time">文件的修改时间。</param>
+		/// <param name="delimiter">分隔符。</param>
+		/// <param name="new_block_size">块大小，单位为字节。增量更新时沿用原块大小。</param>
+		/// <param name="thread_count">线程数。小于等于0表示使用线程池的默认并行度。</param>
+		void Update(const char* data, uint64_t size, int64_t time, const std::string& delimiter, uint64_t new_block_size, int thread_count);
+
+		/// <summary>
+		/// 获取需要解析的字节范围：可能匹配的块，以及索引之后追加的部分。相邻的范围合并为一个。
+		/// </summary>
+		/// <param name="ranges">范围条件。</param>
+		/// <param name="size">文件大小。</param>
+		/// <returns>按偏移量升序排列的[begin, end)范围。</returns>
+		std::vector<std::pair<uint64_t, uint64_t>> CandidateRanges(const std::vector<ColumnRange>& ranges, uint64_t size) const;
+	};
+
+	/// <summary>
+	/// 映射文件，建立或增量更新其区域映射旁路文件。空文件写入不含任何块的旁路文件。
+	/// </summary>
+	/// <param name="path">文件路径。</param>
+	/// <param name="delimiter">分隔符。</param>
+	/// <param name="block_size">块大小，单位为字节。</param>
+	/// <param name="thread_count">线程数。小于等于0表示使用线程池的默认并行度。</param>
+	/// <param name="error">错误信息。</param>
+	/// <returns>是否完成建立。</returns>
+	bool BuildZoneMapSidecar(const std::string& path, const std::string& delimiter, uint64_t block_size, int thread_count, std::error_code& error);
+
+	/// <summary>
+	/// 删除文件的区域映射旁路文件。原地修改文件内容的操作在修改成功后调用，旁路文件不存在时什么也不做。
+	/// </summary>
+	/// <param name="path">文件路径。</param>
+	void RemoveZoneMapSidecar(const std::string& path);
+
+	/// <summary>
+	/// 读取满足所有范围条件的行。存在有效的旁路文件时只解析可能匹配的块，否则解析整个文件；候选范围划分为对齐到行首的子块在线程池中并行解析，
+	/// 最后按文件顺序拼接。不会写入旁路文件。
+	/// </summary>
+	/// <param name="path">文件路径。</param>
+	/// <param name="delimiter">分隔符。</param>
+	/// <param name="ranges">范围条件，字段无法解析为数值的行不满足条件。</param>
+	/// <param name="thread_count">线程数。小于等于0表示使用线程池的默认并行度。</param>
+	/// <param name="out_records">满足条件的行，追加到向量末尾。</param>
+	/// <param name="error">错误信息。</param>
+	/// <returns>是否完成读取。</returns>
+	template <typename T>
+	bool ParallelReadFilteredRecords(const std::string& path, const std::string& delimiter, const std::vector<ColumnRange>& ranges, int thread_count,
+	                                 std::vector<std::vector<T>>& out_records, std::error_code& error);
+}
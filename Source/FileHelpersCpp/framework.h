@@ -1,5 +1,7 @@
 ﻿#pragma once
 
+#ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN             // 从 Windows 头文件中排除极少使用的内容
 // Windows 头文件
 #include <windows.h>
+#endif
@@ -183,6 +183,42 @@ inline auto ReadWriteStringVector(const std::string& readPath, const std::string
 	};
 }
 
+inline auto TransformStringVector(const std::string& readPath, const std::string& writePath, const DelimitedFileMmfEngine& dfm_engine)
+{
+	return[readPath, writePath, dfm_engine]
+	{
+		std::cout << "正在读取或写入文件..." << std::endl;
+		const auto t_start = std::chrono::system_clock::now();
+
+		// 与ReadWriteStringVector相同的列交换，但以流水线方式进行，不需要把整个文件读入内存。
+		const std::error_code error;
+		const bool result = dfm_engine.TransformFile(readPath, writePath, [](const std::vector<std::string_view>& fields, std::string& out_record)
+		{
+			if (fields.size() < 3)
+			{
+				return false;
+			}
+			out_record.append(fields[1]);
+			out_record.append(" ");
+			out_record.append(fields[0]);
+			out_record.append(" ");
+			out_record.append(fields[2]);
+			return true;
+		}, error);
+
+		if (!result)
+		{
+			std::string msg = error.message();
+		}
+
+		const auto t_end = std::chrono::system_clock::now();
+		const auto t_dt = get_time_interval(t_start, t_end);
+
+		const std::string output_str = StringFormat("流式转换点云耗时：%u.%us", t_dt.dt_sec, t_dt.dt_msec);
+		std::cout << output_str << std::endl;
+	};
+}
+
 inline auto ReadModifyStringVector(const std::string& modified_path, const DelimitedFileMmfEngine& dfm_engine)
 {
 	return[modified_path, dfm_engine]
@@ -227,7 +263,71 @@ inline auto ReadModifyStringVector(const std::string& modified_path, const Delim
 	};
 }
 
+inline auto EditLines(const std::string& edit_path)
+{
+	return[edit_path]
+	{
+		std::cout << "正在编辑文件..." << std::endl;
+		const auto t_start = std::chrono::system_clock::now();
 
+		// 删除和插入只记录在编辑日志中，提交时未修改的行整段复制到新文件。
+		const std::error_code error;
+		FileMmfEditSession session;
+		if (!session.Open(edit_path, error))
+		{
+			return;
+		}
+		for (size_t line_index = 0; line_index < 5000 && line_index + 2 < session.LineCount(); line_index += 2)
+		{
+			session.DeleteLines(line_index, 1, error);
+		}
+		session.InsertLines(0, { "0.000000 0.000000 0.000000", "1.000000 1.000000 1.000000" }, error);
+		const bool result = session.Commit(error);
+
+		if (!result)
+		{
+			std::string msg = error.message();
+		}
+
+		const auto t_end = std::chrono::system_clock::now();
+		const auto t_dt = get_time_interval(t_start, t_end);
+
+		const std::string output_str = StringFormat("编辑行耗时：%u.%us   编辑后行数：%u", t_dt.dt_sec, t_dt.dt_msec, session.LineCount());
+		std::cout << output_str << std::endl;
+	};
+}
+
+
+inline auto ReadFilesAsDouble(const std::vector<std::string>& readPaths, const DelimitedFileMmfEngine& dfm_engine)
+{
+	return[readPaths, dfm_engine]
+	{
+		std::cout << "正在批量读取文件..." << std::endl;
+		const auto t_start = std::chrono::system_clock::now();
+
+		// 多个文件在线程池中并行读取，在途文件占用的内存不超过256MB，回调在当前线程按路径顺序调用。
+		const std::error_code error;
+		MultiFileReadOptions options;
+		options.memory_budget = 256 * 1024 * 1024;
+		size_t line_count = 0;
+		const bool result = dfm_engine.ReadFilesAsDoubleVector(readPaths, [&line_count](size_t file_index, std::vector<std::vector<double>>& records, const std::error_code& file_error)
+		{
+			line_count += records.size();
+			return true;
+		}, error, options);
+
+		if (!result)
+		{
+			std::string msg = error.message();
+		}
+
+		const auto t_end = std::chrono::system_clock::now();
+		const auto t_dt = get_time_interval(t_start, t_end);
+
+		const std::string output_str = StringFormat("批量读取耗时：%u.%us   文件数：%u   总行数：%u", t_dt.dt_sec, t_dt.dt_msec, readPaths.size(), line_count);
+		std::cout << output_str << std::endl;
+	};
+}
 
 
 int main()
@@ -244,21 +344,16 @@ int main()
 	std::cout << "总行数：" << lineCount << std::endl;
 
 	//****************************************************************测试预分配****************************************************************
-	//string str_error;
-	//const long allocate_size = 1024000000;
-	//const auto r_start = std::chrono::system_clock::now();
-	//dfm_engine.PreAllocateFile(writePath, str_error, allocate_size);
-	////dfs_engine.AllocateFile(writePath, allocate_size);
-	//const auto r_end = std::chrono::system_clock::now();
-	//const auto r_dt = get_time_interval(r_start, r_end);
-	//const std::string output_str = StringFormat("预分配耗时：%u.%us   预分配大小：%u ", r_dt.dt_sec, r_dt.dt_msec, allocate_size);
-	//std::cout << output_str << std::endl;
+	// 各种预分配方式在不同大小下的耗时由Benchmark中的PreAllocateFile用例测量。
 	//****************************************************************测试预分配****************************************************************
 
 	//concurrency::create_task(ReadWriteAllLinesAsDouble(readPath, writePath, dfm_engine));
 
 	//concurrency::create_task(ReadModifyStringVector(readPath, dfm_engine));
 
+	//concurrency::create_task(EditLines(writePath));
+	//concurrency::create_task(ReadFilesAsDouble({ readPath, writePath }, dfm_engine));
+
 
 	const auto t1 = concurrency::create_task(ReadWriteAllLines(readPath, writePath, dfm_engine));
 	t1.then(ReadWriteAllLines(readPath, writePath, dfm_engine))
@@ -0,0 +1,1214 @@
+﻿// Tests.cpp : 库的回归测试。每个测试在临时目录中生成小文件并检查结果，任一测试失败时退出码为1。
+// Linux上在Source目录下直接编译库源文件：
+//   g++ -std=c++20 -O2 -D'__declspec(x)=' Tests/Tests.cpp FileHelpersCpp/*.cpp -lpthread -o file_helpers_tests
+
+#include <algorithm>
+#include <charconv>
+#include <coroutine>
+#include <exception>
+#include <filesystem>
+#include <future>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+#include "../FileHelpersCpp/DelimitedFileMMFEngine.h"
+#include "../FileHelpersCpp/DelimitedFileSteamEngine.h"
+#include "../FileHelpersCpp/FileEngineAsync.h"
+#include "../FileHelpersCpp/FileMMFEngineBase.h"
+#include "../FileHelpersCpp/MultiFileReader.h"
+#include "../FileHelpersCpp/RecordPipeline.h"
+#include "../FileHelpersCpp/ThreadPool.h"
+
+using namespace file_helpers_cpp;
+
+namespace
+{
+	/// <summary>
+	/// 表示一个测试：名称和测试函数。测试函数返回是否通过。
+	/// </summary>
+	struct TestCase
+	{
+		const char* name;
+
+		bool (*run)(const std::filesystem::path& directory);
+	};
+
+	void WriteText(const std::filesystem::path& path, const std::string& text)
+	{
+		std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+		stream << text;
+	}
+
+	std::string ReadText(const std::filesystem::path& path)
+	{
+		std::ifstream stream(path, std::ios::binary);
+		return std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+	}
+
+	/// <summary>
+	/// 检查条件，不满足时输出说明。
+	/// </summary>
+	bool Expect(const bool condition, const std::string& message)
+	{
+		if (!condition)
+		{
+			std::cerr << "    " << message << std::endl;
+		}
+		return condition;
+	}
+
+	/// <summary>
+	/// 多线程批量修改时，文件末尾没有换行符的最后一行的修改不能丢失，结果与单线程和按字典修改一致。
+	/// </summary>
+	bool ModifyUnterminatedLastLine(const std::filesystem::path& directory)
+	{
+		const std::filesystem::path path = directory / "unterminated.csv";
+		const DelimitedFileMmfEngine engine(",");
+		bool passed = true;
+		for (const std::string value : { "ccccccc", "cc", "ccccccccccc" })
+		{
+			for (const int thread_count : { 1, 2, 4 })
+			{
+				WriteText(path, "a\nbbbbbbb");
+				const bool succeeded = engine.BatchModifyFieldValues(path.string(), std::vector<FieldPatch>{ FieldPatch{ 1, 0, value } }, std::error_code(), thread_count);
+				const std::string label = "value " + value + ", thread_count " + std::to_string(thread_count);
+				passed &= Expect(succeeded, label + ": returned false");
+				passed &= Expect(ReadText(path) == "a\n" + value, label + ": got \"" + ReadText(path) + "\"");
+			}
+
+			WriteText(path, "a\nbbbbbbb");
+			engine.BatchModifyFieldValues(path.string(), std::map<int, std::map<int, std::string>>{ { 1, { { 0, value } } } }, std::error_code());
+			passed &= Expect(ReadText(path) == "a\n" + value, "map overload, value " + value + ": got \"" + ReadText(path) + "\"");
+		}
+		return passed;
+	}
+
+	/// <summary>
+	/// 立即开始执行的协程，结束时通过done通知等待方。
+	/// </summary>
+	struct BlockingCoroutine
+	{
+		struct promise_type
+		{
+			std::promise<void> done;
+
+			BlockingCoroutine get_return_object()
+			{
+				return { done.get_future() };
+			}
+
+			std::suspend_never initial_suspend() noexcept
+			{
+				return {};
+			}
+
+			std::suspend_never final_suspend() noexcept
+			{
+				return {};
+			}
+
+			void return_void()
+			{
+				done.set_value();
+			}
+
+			void unhandled_exception()
+			{
+				done.set_exception(std::current_exception());
+			}
+		};
+
+		std::future<void> done;
+	};
+
+	BlockingCoroutine WriteLinesAsync(const DelimitedFileMmfEngine& engine, const std::filesystem::path& path, bool& succeeded)
+	{
+		// 写入内容是临时对象，co_await时已经销毁，操作必须持有自己的副本。
+		auto operation = engine.WriteAllLinesAsync(path.string(), std::vector<std::string>{ "1 2", "3 4" });
+		succeeded = co_await operation;
+	}
+
+	/// <summary>
+	/// 异步写入的内容在co_await前销毁时，写入结果不受影响。
+	/// </summary>
+	bool WriteAsyncTemporaryContents(const std::filesystem::path& directory)
+	{
+		const std::filesystem::path path = directory / "async_write.txt";
+		const DelimitedFileMmfEngine engine(" ");
+		bool succeeded = false;
+		WriteLinesAsync(engine, path, succeeded).done.get();
+		bool passed = Expect(succeeded, "returned false");
+		passed &= Expect(ReadText(path) == "1 2\r\n3 4\r\n", "got \"" + ReadText(path) + "\"");
+		return passed;
+	}
+
+	/// <summary>
+	/// 读取被取消时返回false并通过error报告operation_canceled，调用方可以区分取消与失败。
+	/// </summary>
+	bool ReadCancelledReportsError(const std::filesystem::path& directory)
+	{
+		const std::filesystem::path path = directory / "cancelled.txt";
+		WriteText(path, "1 2\n3 4\n");
+		const DelimitedFileMmfEngine mmf_engine(" ");
+		const DelimitedFileSteamEngine stream_engine(" ");
+		OperationControl control;
+		control.cancellation.Cancel();
+
+		bool passed = true;
+		std::error_code error;
+		std::vector<std::vector<std::string>> string_records;
+		passed &= Expect(!mmf_engine.ReadFileAsStringVector(path.string(), string_records, error, control), "mmf string: returned true");
+		passed &= Expect(error == std::errc::operation_canceled, "mmf string: error " + error.message());
+
+		error.clear();
+		std::vector<std::vector<double>> double_records;
+		passed &= Expect(!stream_engine.ReadFileAsDoubleVector(path.string(), double_records, error, control), "stream double: returned true");
+		passed &= Expect(error == std::errc::operation_canceled, "stream double: error " + error.message());
+
+		error.clear();
+		double_records.clear();
+		passed &= Expect(mmf_engine.ReadFileAsDoubleVector(path.string(), double_records, error, OperationControl()), "mmf double: returned false");
+		passed &= Expect(!error && double_records.size() == 2, "mmf double: error " + error.message());
+
+		error.clear();
+		passed &= Expect(!mmf_engine.ReadFileAsStringVector((directory / "missing.txt").string(), string_records, error, OperationControl()), "missing file: returned true");
+		passed &= Expect(error && error != std::errc::operation_canceled, "missing file: error " + error.message());
+		return passed;
+	}
+
+	/// <summary>
+	/// 后台提交期间仍能读取编辑后的内容，提交期间发起的编辑在提交完成后执行，不会被新文件覆盖。
+	/// </summary>
+	bool CommitAsyncKeepsLaterEdits(const std::filesystem::path& directory)
+	{
+		const std::filesystem::path path = directory / "edit_session.txt";
+		std::string text;
+		for (int i = 0; i < 100000; i++)
+		{
+			text += std::to_string(i) + "\n";
+		}
+		WriteText(path, text);
+
+		FileMmfEditSession session;
+		bool passed = Expect(session.Open(path.string(), std::error_code()), "open: returned false");
+		session.DeleteLines(0, 2, std::error_code());
+		session.InsertLines(0, { "head" }, std::error_code());
+		const std::shared_future<bool> commit = session.CommitAsync();
+
+		std::vector<std::string> lines;
+		passed &= Expect(session.ReadLines(0, 2, lines, std::error_code()), "read during commit: returned false");
+		passed &= Expect(lines == std::vector<std::string>{ "head", "2" }, "read during commit: got \"" + (lines.empty() ? std::string() : lines[0]) + "\"");
+
+		// 等待后台提交完成后在新文件上执行。
+		session.InsertLines(session.LineCount(), { "tail" }, std::error_code());
+		passed &= Expect(commit.get(), "commit: returned false");
+		passed &= Expect(session.IsModified(), "edit after commit: lost");
+		passed &= Expect(ReadText(path) == "head\n" + text.substr(4), "commit: unexpected file content");
+
+		passed &= Expect(session.Commit(std::error_code()), "second commit: returned false");
+		passed &= Expect(ReadText(path) == "head\n" + text.substr(4) + "tail\n", "second commit: unexpected file content");
+		session.Close();
+		return passed;
+	}
+
+	/// <summary>
+	/// 按引擎的换行符拼接追加后的文件内容。
+	/// </summary>
+	std::string JoinLines(const std::vector<std::string>& lines, const std::string& line_ending)
+	{
+		std::string text;
+		for (const auto& line : lines)
+		{
+			text += line + line_ending;
+		}
+		return text;
+	}
+
+	/// <summary>
+	/// 检查一个引擎的三个追加方法：目标文件不存在时创建文件，存在时只在末尾追加，关闭后不留下预分配的空字节。
+	/// </summary>
+	bool CheckAppends(const FileEngineBase& engine, const std::string& name, const std::string& line_ending, const std::filesystem::path& directory)
+	{
+		const std::filesystem::path path = directory / ("append_" + name + ".txt");
+		const std::vector<std::vector<std::string>> string_records = { { "a", "b" }, { "c", "d" } };
+		const std::vector<std::vector<double>> double_records = { { 1.5, 2 } };
+		const std::string string_text = JoinLines({ "a,b", "c,d" }, line_ending);
+		const std::string double_text = JoinLines({ "1.500000,2.000000" }, line_ending);
+		const std::string lines_text = JoinLines({ "e", "f" }, line_ending);
+		bool passed = true;
+		for (const bool exists : { false, true })
+		{
+			const std::string existing = exists ? "head" + line_ending : std::string();
+			const std::string label = name + (exists ? ", existing file" : ", missing file");
+
+			std::filesystem::remove(path);
+			if (exists)
+			{
+				WriteText(path, existing);
+			}
+			passed &= Expect(engine.AppendStringVector(path.string(), string_records, std::error_code()), label + ": AppendStringVector returned false");
+			passed &= Expect(ReadText(path) == existing + string_text, label + ": AppendStringVector got \"" + ReadText(path) + "\"");
+
+			std::filesystem::remove(path);
+			if (exists)
+			{
+				WriteText(path, existing);
+			}
+			passed &= Expect(engine.AppendDoubleVector(path.string(), double_records, std::error_code()), label + ": AppendDoubleVector returned false");
+			passed &= Expect(ReadText(path) == existing + double_text, label + ": AppendDoubleVector got \"" + ReadText(path) + "\"");
+
+			// 连续追加时后一次追加接在前一次之后。
+			passed &= Expect(engine.AppendAllLines(path.string(), { "e", "f" }, std::error_code()), label + ": AppendAllLines returned false");
+			passed &= Expect(ReadText(path) == existing + double_text + lines_text, label + ": AppendAllLines got \"" + ReadText(path) + "\"");
+		}
+
+		// 无法打开的文件返回false。
+		const std::string missing_directory = (directory / "missing" / "append.txt").string();
+		passed &= Expect(!engine.AppendAllLines(missing_directory, { "e" }, std::error_code()), name + ": AppendAllLines to a missing directory returned true");
+		passed &= Expect(!engine.AppendStringVector(missing_directory, string_records, std::error_code()), name + ": AppendStringVector to a missing directory returned true");
+		passed &= Expect(!engine.AppendDoubleVector(missing_directory, double_records, std::error_code()), name + ": AppendDoubleVector to a missing directory returned true");
+		return passed;
+	}
+
+	/// <summary>
+	/// 内存映射引擎追加时使用\r\n，流引擎使用\n。
+	/// </summary>
+	bool AppendToExistingAndMissingFiles(const std::filesystem::path& directory)
+	{
+		const DelimitedFileMmfEngine mmf_engine(",");
+		const DelimitedFileSteamEngine stream_engine(",");
+		bool passed = CheckAppends(mmf_engine, "mmf", "\r\n", directory);
+		passed &= CheckAppends(stream_engine, "stream", "\n", directory);
+		return passed;
+	}
+
+	/// <summary>
+	/// 在共享线程池的任务中重新配置线程池，该任务释放原线程池的最后一个引用时不能等待自己退出。
+	/// </summary>
+	bool ConfigureFromPoolTask(const std::filesystem::path&)
+	{
+		std::shared_ptr<ThreadPool> pool = ThreadPool::Shared();
+		std::promise<void> release;
+		std::promise<void> configured;
+		pool->Submit([released = release.get_future().share(), &configured]
+		{
+			released.wait();
+			ThreadPoolOptions options;
+			options.worker_count = 2;
+			FileEngineBase::ConfigureThreadPool(options);
+			configured.set_value();
+		});
+		pool.reset();
+		release.set_value();
+		configured.get_future().wait();
+
+		std::atomic<size_t> sum{0};
+		ThreadPool::Shared()->ParallelFor(100, 0, [&sum](const size_t index) { sum += index; });
+		bool passed = Expect(ThreadPool::Shared()->WorkerCount() == 2, "new pool has " + std::to_string(ThreadPool::Shared()->WorkerCount()) + " workers");
+		passed &= Expect(sum == 4950, "ParallelFor on the new pool summed " + std::to_string(sum.load()));
+		FileEngineBase::ConfigureThreadPool(ThreadPoolOptions{});
+		return passed;
+	}
+
+	/// <summary>
+	/// 各刷新策略在写入过程中刷新后，写入返回成功且内容完整。
+	/// </summary>
+	bool WriteWithFlushPolicies(const std::filesystem::path& directory)
+	{
+		const std::filesystem::path path = directory / "flush.txt";
+		std::vector<std::string> lines(200000, "0123456789abcdef");
+		std::string expected;
+		for (const auto& line : lines)
+		{
+			expected += line + "\r\n";
+		}
+
+		bool passed = true;
+		for (const bool background : { false, true })
+		{
+			for (const MmapFlushMode mode : { MmapFlushMode::Bytes, MmapFlushMode::Interval, MmapFlushMode::OnClose })
+			{
+				DelimitedFileMmfEngine engine(",");
+				MmapFlushPolicy policy;
+				policy.mode = mode;
+				policy.flush_bytes = 64 * 1024;
+				policy.flush_interval_ms = 1;
+				policy.background = background;
+				engine.SetFlushPolicy(policy);
+
+				const std::string label = "mode " + std::to_string(static_cast<int>(mode)) + (background ? ", background" : "");
+				passed &= Expect(engine.WriteAllLines(path.string(), lines, std::error_code()), label + ": WriteAllLines returned false");
+				passed &= Expect(ReadText(path) == expected, label + ": file contents differ");
+			}
+		}
+		return passed;
+	}
+
+	/// <summary>
+	/// 转换抛出异常时流水线报告invalid_argument，而不是取消。
+	/// </summary>
+	bool TransformExceptionReportsError(const std::filesystem::path& directory)
+	{
+		const std::filesystem::path read_path = directory / "transform_in.csv";
+		const std::filesystem::path write_path = directory / "transform_out.csv";
+		WriteText(read_path, "1,a\n2,b\nbad,c\n");
+		const std::string delimiter = ",";
+		const RecordTransform transform = [](const std::vector<std::string_view>& fields, std::string& out_record)
+		{
+			out_record += std::to_string(std::stoi(std::string(fields[0])) * 2);
+			return true;
+		};
+
+		RecordPipeline pipeline(delimiter, transform, 2);
+		std::error_code error;
+		const bool succeeded = pipeline.Run(read_path.string(), write_path.string(), error);
+		bool passed = Expect(!succeeded, "Run returned true");
+		passed &= Expect(error == std::errc::invalid_argument, "error is " + error.message());
+
+		const DelimitedFileMmfEngine engine(",");
+		passed &= Expect(!engine.TransformFile(read_path.string(), write_path.string(), transform, std::error_code()), "TransformFile returned true");
+		return passed;
+	}
+
+	/// <summary>
+	/// 并行读取多个文件时按路径顺序交给回调，内容与逐个读取一致。回调在最后一个文件上返回false不算取消，还有文件未处理时才报告取消。
+	/// </summary>
+	bool ReadFilesInOrderAndStop(const std::filesystem::path& directory)
+	{
+		std::vector<std::string> paths;
+		std::vector<std::vector<std::vector<std::string>>> expected;
+		for (int i = 0; i < 5; i++)
+		{
+			paths.push_back((directory / ("multi_" + std::to_string(i) + ".csv")).string());
+			std::string text;
+			expected.emplace_back();
+			for (int j = 0; j <= i * 100; j++)
+			{
+				text += std::to_string(i) + "," + std::to_string(j) + "\n";
+				expected.back().push_back({ std::to_string(i), std::to_string(j) });
+			}
+			WriteText(paths.back(), text);
+		}
+
+		const DelimitedFileMmfEngine engine(",");
+		bool passed = true;
+		for (const size_t memory_budget : { static_cast<size_t>(1), static_cast<size_t>(0) })
+		{
+			MultiFileReadOptions options;
+			options.memory_budget = memory_budget;
+			options.thread_count = 4;
+			std::vector<size_t> delivered;
+			const bool succeeded = engine.ReadFilesAsStringVector(paths, [&](const size_t file_index, std::vector<std::vector<std::string>>& records, const std::error_code&)
+			{
+				delivered.push_back(file_index);
+				passed &= Expect(records == expected[file_index], "file " + std::to_string(file_index) + " records differ");
+				return true;
+			}, std::error_code(), options);
+			passed &= Expect(succeeded, "memory_budget " + std::to_string(memory_budget) + ": returned false");
+			passed &= Expect(delivered == std::vector<size_t>{ 0, 1, 2, 3, 4 }, "memory_budget " + std::to_string(memory_budget) + ": files delivered out of order");
+		}
+
+		const MultiFileReader<std::string>::ReadFunction read = [&engine](const std::string& path, std::vector<std::vector<std::string>>& records)
+		{
+			return engine.ReadFileAsStringVector(path, records, std::error_code());
+		};
+		for (const size_t stop_index : { static_cast<size_t>(4), static_cast<size_t>(1) })
+		{
+			MultiFileReader<std::string> reader(paths, read, MultiFileReadOptions());
+			std::error_code error;
+			const bool succeeded = reader.Run([stop_index](const size_t file_index, std::vector<std::vector<std::string>>&, const std::error_code&)
+			{
+				return file_index != stop_index;
+			}, error);
+			const bool last = stop_index + 1 == paths.size();
+			passed &= Expect(succeeded == last, "stop at " + std::to_string(stop_index) + ": returned " + (succeeded ? "true" : "false"));
+			passed &= Expect(last ? !error : error == std::errc::operation_canceled, "stop at " + std::to_string(stop_index) + ": error is " + error.message());
+		}
+		return passed;
+	}
+
+	/// <summary>
+	/// 检查一列的统计信息。
+	/// </summary>
+	bool ExpectColumn(const ColumnStats& stats, const long long count, const long long invalid_count, const double min, const double max, const double sum, const std::string& label)
+	{
+		return Expect(stats.count == count && stats.invalid_count == invalid_count && stats.min == min && stats.max == max && stats.sum == sum,
+			label + ": count " + std::to_string(stats.count) + ", invalid " + std::to_string(stats.invalid_count) + ", min " + std::to_string(stats.min) +
+			", max " + std::to_string(stats.max) + ", sum " + std::to_string(stats.sum));
+	}
+
+	/// <summary>
+	/// 列统计忽略\r和空行，统计没有换行符的最后一行。跨越多个块的文件并行统计的结果与流引擎一致。
+	/// </summary>
+	bool ColumnStatsMatchReference(const std::filesystem::path& directory)
+	{
+		const std::filesystem::path path = directory / "stats.csv";
+		const DelimitedFileMmfEngine mmf_engine(",");
+		const DelimitedFileSteamEngine stream_engine(",");
+		bool passed = true;
+
+		WriteText(path, "1,a\r\n\r\n3,4\r\n-5,2.5");
+		for (const int thread_count : { 1, 4 })
+		{
+			TableStats stats;
+			const std::string label = "thread_count " + std::to_string(thread_count);
+			passed &= Expect(mmf_engine.ComputeColumnStats(path.string(), stats, std::error_code(), thread_count), label + ": returned false");
+			passed &= Expect(stats.row_count == 3 && stats.columns.size() == 2, label + ": " + std::to_string(stats.row_count) + " rows, " + std::to_string(stats.columns.size()) + " columns");
+			if (stats.columns.size() == 2)
+			{
+				passed &= ExpectColumn(stats.columns[0], 3, 0, -5, 3, -1, label + ", column 0");
+				passed &= ExpectColumn(stats.columns[1], 2, 1, 2.5, 4, 6.5, label + ", column 1");
+			}
+		}
+
+		// 约14MB，超过一个统计块。
+		std::string text;
+		const long long row_count = 1000000;
+		for (long long i = 0; i < row_count; i++)
+		{
+			text += std::to_string(i) + "," + std::to_string(i % 1000 - 500) + "\n";
+		}
+		WriteText(path, text);
+		TableStats parallel_stats;
+		TableStats stream_stats;
+		passed &= Expect(mmf_engine.ComputeColumnStats(path.string(), parallel_stats, std::error_code(), 4), "large file: mmf returned false");
+		passed &= Expect(stream_engine.ComputeColumnStats(path.string(), stream_stats, std::error_code()), "large file: stream returned false");
+		passed &= Expect(parallel_stats.row_count == row_count && stream_stats.row_count == row_count, "large file: row counts differ");
+		if (parallel_stats.columns.size() == 2 && stream_stats.columns.size() == 2)
+		{
+			passed &= ExpectColumn(parallel_stats.columns[0], row_count, 0, 0, row_count - 1, static_cast<double>(row_count * (row_count - 1) / 2), "large file, column 0");
+			for (size_t i = 0; i < 2; i++)
+			{
+				const ColumnStats& expected = stream_stats.columns[i];
+				passed &= ExpectColumn(parallel_stats.columns[i], expected.count, expected.invalid_count, expected.min, expected.max, expected.sum, "large file, column " + std::to_string(i) + " against stream");
+			}
+		}
+		else
+		{
+			passed &= Expect(false, "large file: column counts differ");
+		}
+		return passed;
+	}
+
+	/// <summary>
+	/// 按范围条件筛选时，无论有没有旁路文件、文件是否在建立后追加过，结果都与逐行筛选一致。空文件也能建立旁路文件，
+	/// 原地修改成功后删除旁路文件。
+	/// </summary>
+	bool ZoneMapFilterAndInvalidate(const std::filesystem::path& directory)
+	{
+		const std::filesystem::path path = directory / "zonemap.csv";
+		const std::string sidecar_path = path.string() + ".zonemap";
+		const DelimitedFileMmfEngine engine(",");
+		const std::vector<ColumnRange> ranges = { { 0, 5000, 5400 }, { 1, 0, 300 } };
+
+		std::string text;
+		std::vector<std::vector<std::string>> expected;
+		const auto add_rows = [&](const int first, const int last)
+		{
+			for (int i = first; i < last; i++)
+			{
+				const int value = i * 7 % 1000;
+				text += std::to_string(i) + "," + std::to_string(value) + (i % 2 == 0 ? "\r\n" : "\n");
+				if (i % 1000 == 0)
+				{
+					text += "\n";
+				}
+				if (i >= 5000 && i <= 5400 && value <= 300)
+				{
+					expected.push_back({ std::to_string(i), std::to_string(value) });
+				}
+			}
+		};
+		add_rows(0, 5200);
+		WriteText(path, text + "x,1\n5200,");
+
+		bool passed = true;
+		const auto check_filter = [&](const std::string& label)
+		{
+			std::vector<std::vector<std::string>> records;
+			passed &= Expect(engine.ReadFilteredAsStringVector(path.string(), ranges, records, std::error_code(), 4), label + ": returned false");
+			passed &= Expect(records == expected, label + ": got " + std::to_string(records.size()) + " records, expected " + std::to_string(expected.size()));
+		};
+		check_filter("without sidecar");
+		passed &= Expect(engine.BuildZoneMap(path.string(), std::error_code(), 4096, 4), "BuildZoneMap returned false");
+		passed &= Expect(std::filesystem::exists(sidecar_path), "BuildZoneMap wrote no sidecar");
+		check_filter("with sidecar");
+
+		// 补全最后一行后追加，索引之后的内容仍被解析。
+		text += "x,1\n";
+		add_rows(5200, 6000);
+		WriteText(path, text);
+		check_filter("after append");
+		passed &= Expect(engine.BuildZoneMap(path.string(), std::error_code(), 4096, 4), "incremental BuildZoneMap returned false");
+		check_filter("after incremental update");
+
+		passed &= Expect(engine.BatchModifyFieldValues(path.string(), std::vector<FieldPatch>{ FieldPatch{ 0, 1, "1" } }, std::error_code(), 4), "BatchModifyFieldValues returned false");
+		passed &= Expect(!std::filesystem::exists(sidecar_path), "BatchModifyFieldValues kept the sidecar");
+		engine.BuildZoneMap(path.string(), std::error_code(), 4096, 4);
+		passed &= Expect(engine.BatchModifyFieldValues(path.string(), std::map<int, std::map<int, std::string>>{ { 0, { { 1, "22" } } } }, std::error_code()), "map overload returned false");
+		passed &= Expect(!std::filesystem::exists(sidecar_path), "map overload kept the sidecar");
+		engine.BuildZoneMap(path.string(), std::error_code(), 4096, 4);
+		{
+			FileMmfEditSession session;
+			passed &= Expect(session.Open(path.string(), std::error_code()), "edit session: open returned false");
+			session.InsertLines(0, { "head" }, std::error_code());
+			passed &= Expect(session.Commit(std::error_code()), "edit session: commit returned false");
+			session.Close();
+		}
+		passed &= Expect(!std::filesystem::exists(sidecar_path), "edit session commit kept the sidecar");
+
+		WriteText(path, "");
+		std::filesystem::remove(sidecar_path);
+		passed &= Expect(engine.BuildZoneMap(path.string(), std::error_code()), "empty file: BuildZoneMap returned false");
+		passed &= Expect(std::filesystem::exists(sidecar_path), "empty file: no sidecar");
+		expected.clear();
+		check_filter("empty file");
+		return passed;
+	}
+
+	/// <summary>
+	/// 多线程并行格式化写入的文件与单线程写入的逐字节一致，包括跨越多个批次和空字段。
+	/// </summary>
+	bool ParallelWriteMatchesSerial(const std::filesystem::path& directory)
+	{
+		const std::filesystem::path serial_path = directory / "serial.csv";
+		const std::filesystem::path parallel_path = directory / "parallel.csv";
+		const DelimitedFileMmfEngine engine(",");
+
+		std::vector<std::vector<std::string>> string_records;
+		std::vector<std::vector<double>> double_records;
+		for (int i = 0; i < 200001; i++)
+		{
+			string_records.push_back({ std::to_string(i), i % 3 == 0 ? std::string() : "v" + std::to_string(i % 97) });
+			double_records.push_back({ i * 0.25, -static_cast<double>(i % 1000) / 3 });
+		}
+
+		bool passed = Expect(engine.WriteAllStringVector(serial_path.string(), string_records, std::error_code()), "serial string write returned false");
+		const std::string serial_strings = ReadText(serial_path);
+		passed &= Expect(engine.WriteAllDoubleVector(serial_path.string(), double_records, std::error_code()), "serial double write returned false");
+		const std::string serial_doubles = ReadText(serial_path);
+
+		for (const int thread_count : { 1, 2, 7 })
+		{
+			const std::string label = "thread_count " + std::to_string(thread_count);
+			passed &= Expect(engine.WriteAllStringVector(parallel_path.string(), string_records, std::error_code(), thread_count), label + ": string write returned false");
+			passed &= Expect(ReadText(parallel_path) == serial_strings, label + ": string output differs from the serial writer");
+			passed &= Expect(engine.WriteAllDoubleVector(parallel_path.string(), double_records, std::error_code(), thread_count), label + ": double write returned false");
+			passed &= Expect(ReadText(parallel_path) == serial_doubles, label + ": double output differs from the serial writer");
+		}
+		return passed;
+	}
+
+	/// <summary>
+	/// 按修改生成新值，参数为行索引、字段索引和原值。
+	/// </summary>
+	using PatchValue = std::string (*)(int line_index, int field_index, const std::string& old_value);
+
+	/// <summary>
+	/// 在混合\r\n和\n、含空行且最后一行没有换行符的文件上批量修改字段，按行和按字典修改的结果都与逐行替换的参考结果一致。
+	/// </summary>
+	bool CheckFieldPatches(const std::filesystem::path& directory, const std::string& name, const PatchValue make_value)
+	{
+		const std::filesystem::path path = directory / ("patch_" + name + ".csv");
+		const int line_count = 3000;
+		std::vector<std::vector<std::string>> rows;
+		std::vector<std::string> endings;
+		std::string original;
+		for (int i = 0; i < line_count; i++)
+		{
+			rows.push_back({ "k" + std::to_string(i), std::to_string(i * 31 % 1000), "tail" + std::to_string(i % 7) });
+			endings.push_back(i == line_count - 1 ? "" : i % 2 == 0 ? "\r\n" : "\n");
+			original += rows[i][0] + "," + rows[i][1] + "," + rows[i][2] + endings[i];
+			if (i % 37 == 0 && i != line_count - 1)
+			{
+				original += "\n";
+				endings[i] += "\n";
+			}
+		}
+
+		// 修改第一行、最后一行和中间的部分行，每行修改一到两个字段。
+		std::vector<FieldPatch> patches;
+		std::map<int, std::map<int, std::string>> patch_map;
+		for (int i = 0; i < line_count; i++)
+		{
+			if (i != 0 && i != line_count - 1 && i % 11 != 0)
+			{
+				continue;
+			}
+			for (const int field_index : { 1, 2 })
+			{
+				if (field_index == 2 && i % 3 != 0)
+				{
+					continue;
+				}
+				const std::string value = make_value(i, field_index, rows[i][field_index]);
+				patches.push_back(FieldPatch{ i, field_index, value });
+				patch_map[i][field_index] = value;
+				rows[i][field_index] = value;
+			}
+		}
+		std::string expected;
+		for (int i = 0; i < line_count; i++)
+		{
+			expected += rows[i][0] + "," + rows[i][1] + "," + rows[i][2] + endings[i];
+		}
+
+		const DelimitedFileMmfEngine engine(",");
+		bool passed = true;
+		for (const int thread_count : { 1, 3, 8 })
+		{
+			WriteText(path, original);
+			const std::string label = name + ", thread_count " + std::to_string(thread_count);
+			passed &= Expect(engine.BatchModifyFieldValues(path.string(), patches, std::error_code(), thread_count), label + ": returned false");
+			passed &= Expect(ReadText(path) == expected, label + ": file differs from the reference");
+		}
+		WriteText(path, original);
+		passed &= Expect(engine.BatchModifyFieldValues(path.string(), patch_map, std::error_code()), name + ", map overload: returned false");
+		passed &= Expect(ReadText(path) == expected, name + ", map overload: file differs from the reference");
+		return passed;
+	}
+
+	/// <summary>
+	/// 按行索引直接定位目标行，长度不变的修改只改写目标字段。
+	/// </summary>
+	bool PatchSameLengthFields(const std::filesystem::path& directory)
+	{
+		return CheckFieldPatches(directory, "same_length", [](const int, const int, const std::string& old_value)
+		{
+			return std::string(old_value.size(), 'x');
+		});
+	}
+
+	/// <summary>
+	/// 长度变化的修改：变长、变短和长度不变的修改混合，包括最后一行。
+	/// </summary>
+	bool PatchVariableLengthFields(const std::filesystem::path& directory)
+	{
+		return CheckFieldPatches(directory, "variable_length", [](const int line_index, const int field_index, const std::string& old_value)
+		{
+			switch ((line_index + field_index) % 4)
+			{
+			case 0:
+				return old_value + "_longer_value";
+			case 1:
+				return old_value.substr(0, 1);
+			case 2:
+				return std::string(old_value.size(), 'y');
+			default:
+				return std::string("z");
+			}
+		});
+	}
+
+	/// <summary>
+	/// 按\n拆分文本，跳过空行，保留行内的\r。
+	/// </summary>
+	std::vector<std::string> NonEmptyLines(const std::string& text)
+	{
+		std::vector<std::string> lines;
+		size_t begin = 0;
+		while (begin < text.size())
+		{
+			size_t end = text.find('\n', begin);
+			if (end == std::string::npos)
+			{
+				end = text.size();
+			}
+			if (end > begin)
+			{
+				lines.push_back(text.substr(begin, end - begin));
+			}
+			begin = end + 1;
+		}
+		return lines;
+	}
+
+	/// <summary>
+	/// 获取以逗号分隔的第column个字段，连续的逗号视为一个，缺失时为空串。
+	/// </summary>
+	std::string KeyField(const std::string& line, const int column)
+	{
+		int index = 0;
+		size_t begin = 0;
+		while (begin <= line.size())
+		{
+			size_t end = line.find(',', begin);
+			if (end == std::string::npos)
+			{
+				end = line.size();
+			}
+			if (end > begin)
+			{
+				if (index++ == column)
+				{
+					return line.substr(begin, end - begin);
+				}
+			}
+			begin = end + 1;
+		}
+		return std::string();
+	}
+
+	/// <summary>
+	/// 按排序选项稳定排序各行，作为排序和归并的参考结果，每行以\n结尾。
+	/// </summary>
+	std::string SortReference(std::vector<std::string> lines, const SortOptions& options)
+	{
+		const auto parse = [&options](const std::string& line, double& value)
+		{
+			const std::string key = KeyField(line, options.key_column);
+			const auto result = std::from_chars(key.data(), key.data() + key.size(), value);
+			return !key.empty() && result.ec == std::errc() && result.ptr == key.data() + key.size();
+		};
+		std::stable_sort(lines.begin(), lines.end(), [&](const std::string& left, const std::string& right)
+		{
+			if (!options.numeric_key)
+			{
+				const std::string left_key = KeyField(left, options.key_column);
+				const std::string right_key = KeyField(right, options.key_column);
+				return options.descending ? right_key < left_key : left_key < right_key;
+			}
+			double left_value = 0;
+			double right_value = 0;
+			const bool left_valid = parse(left, left_value);
+			const bool right_valid = parse(right, right_value);
+			if (left_valid != right_valid)
+			{
+				return left_valid;
+			}
+			if (!left_valid)
+			{
+				return false;
+			}
+			return options.descending ? right_value < left_value : left_value < right_value;
+		});
+		std::string text;
+		for (const auto& line : lines)
+		{
+			text += line + "\n";
+		}
+		return text;
+	}
+
+	/// <summary>
+	/// 生成用于排序的文本：数值键有大量重复，混有无法解析的键、\r\n和空行，最后一行没有换行符。
+	/// </summary>
+	std::string SortInput(const int line_count)
+	{
+		std::string text;
+		for (int i = 0; i < line_count; i++)
+		{
+			const std::string key = i % 53 == 0 ? "n/a" : std::to_string(i * 7919 % 2003 - 1000);
+			text += key + ",row" + std::to_string(i) + "," + std::to_string(i % 10);
+			if (i != line_count - 1)
+			{
+				text += i % 3 == 0 ? "\r\n" : "\n";
+			}
+			if (i % 97 == 0)
+			{
+				text += "\n";
+			}
+		}
+		return text;
+	}
+
+	/// <summary>
+	/// 外部排序的结果与稳定排序的参考结果一致：数值键和字节键、升序和降序，内存预算足够和需要分段归并时，两种引擎相同。
+	/// </summary>
+	bool SortFileMatchesReference(const std::filesystem::path& directory)
+	{
+		const std::filesystem::path path = directory / "sort_in.csv";
+		const std::filesystem::path out_path = directory / "sort_out.csv";
+		const std::string text = SortInput(40000);
+		WriteText(path, text);
+		const std::vector<std::string> lines = NonEmptyLines(text);
+
+		const DelimitedFileMmfEngine mmf_engine(",");
+		const DelimitedFileSteamEngine stream_engine(",");
+		bool passed = true;
+		for (const bool numeric_key : { true, false })
+		{
+			for (const bool descending : { false, true })
+			{
+				for (const long long memory_budget : { 0LL, 64LL * 1024 })
+				{
+					SortOptions options;
+					options.numeric_key = numeric_key;
+					options.descending = descending;
+					options.memory_budget = memory_budget;
+					options.thread_count = 4;
+					const std::string expected = SortReference(lines, options);
+					const std::string label = std::string(numeric_key ? "numeric" : "bytes") + (descending ? ", descending" : ", ascending") + (memory_budget > 0 ? ", external" : "");
+
+					passed &= Expect(mmf_engine.SortFile(path.string(), out_path.string(), options, std::error_code()), label + ", mmf: returned false");
+					passed &= Expect(ReadText(out_path) == expected, label + ", mmf: output differs from the reference");
+					passed &= Expect(stream_engine.SortFile(path.string(), out_path.string(), options, std::error_code()), label + ", stream: returned false");
+					passed &= Expect(ReadText(out_path) == expected, label + ", stream: output differs from the reference");
+				}
+			}
+		}
+		return passed;
+	}
+
+	/// <summary>
+	/// 归并多个已排序的文件，结果与合并后稳定排序的参考结果一致：键相等时按文件顺序输出，跳过空行，保留\r，最后一行可以没有换行符。
+	/// </summary>
+	bool MergeSortedFilesMatchesReference(const std::filesystem::path& directory)
+	{
+		const std::filesystem::path out_path = directory / "merge_out.csv";
+		const DelimitedFileMmfEngine engine(",");
+		bool passed = true;
+		for (const bool descending : { false, true })
+		{
+			SortOptions options;
+			options.descending = descending;
+			// 从排好序的行中按序号间隔抽取出各个文件，各文件仍有序，部分行同时出现在两个文件中，第三个文件为空。
+			const std::vector<std::string> sorted_lines = NonEmptyLines(SortReference(NonEmptyLines(SortInput(20000)), options));
+			std::vector<std::string> texts(4);
+			std::vector<std::string> all_lines;
+			for (size_t file = 0; file < texts.size(); file++)
+			{
+				for (size_t i = file; i < sorted_lines.size() && file != 2; i += 3 + (file == 3 ? 2 : 0))
+				{
+					const std::string& line = sorted_lines[i];
+					texts[file] += line + (i % 5 == 0 ? "\n\n" : "\n");
+					all_lines.push_back(line);
+				}
+			}
+			// 第一个文件的最后一行没有换行符。
+			texts[0].pop_back();
+			if (!texts[0].empty() && texts[0].back() == '\n')
+			{
+				texts[0].pop_back();
+			}
+
+			std::vector<std::string> paths;
+			for (size_t file = 0; file < texts.size(); file++)
+			{
+				paths.push_back((directory / ("merge_" + std::to_string(file) + ".csv")).string());
+				WriteText(paths.back(), texts[file]);
+			}
+			const std::string label = descending ? "descending" : "ascending";
+			passed &= Expect(engine.MergeSortedFiles(paths, out_path.string(), options, std::error_code()), label + ": returned false");
+			passed &= Expect(ReadText(out_path) == SortReference(all_lines, options), label + ": output differs from the reference");
+		}
+		return passed;
+	}
+
+	/// <summary>
+	/// 分组汇总的结果与按std::map逐行统计的参考结果一致：缺少键列的行不计入，缺失或无法解析的值按0计入，内存预算很小时溢出到临时文件后归并。
+	/// </summary>
+	bool GroupByMatchesReference(const std::filesystem::path& directory)
+	{
+		const std::filesystem::path path = directory / "group_in.csv";
+		const std::filesystem::path out_path = directory / "group_out.csv";
+		std::string text;
+		std::map<std::string, std::pair<long long, std::vector<double>>> groups;
+		for (int i = 0; i < 50000; i++)
+		{
+			const std::string key = "k" + std::to_string(i * 7919 % 3001);
+			const int value = i % 17 - 8;
+			std::string line = key + "," + std::to_string(value);
+			std::vector<double> sums = { static_cast<double>(value), 0 };
+			if (i % 5 == 0)
+			{
+				line += ",bad";
+			}
+			else if (i % 5 != 1)
+			{
+				line += "," + std::to_string(i % 3);
+				sums[1] = i % 3;
+			}
+			text += (i % 41 == 0 ? "\n" : "") + line + (i % 2 == 0 ? "\r\n" : "\n");
+
+			auto& group = groups[key];
+			group.first++;
+			group.second.resize(2);
+			group.second[0] += sums[0];
+			group.second[1] += sums[1];
+		}
+		// 没有任何字段的行缺少键列，最后一行没有值列也没有换行符。
+		text += ",,\r\nlonely";
+		groups["lonely"] = { 1, { 0, 0 } };
+		WriteText(path, text);
+
+		std::string expected;
+		for (const auto& [key, group] : groups)
+		{
+			expected += key + "," + std::to_string(group.first);
+			for (const double sum : group.second)
+			{
+				char buffer[64];
+				const auto result = std::to_chars(buffer, buffer + sizeof(buffer), sum);
+				expected += "," + std::string(buffer, result.ptr);
+			}
+			expected += "\n";
+		}
+
+		const DelimitedFileMmfEngine engine(",");
+		bool passed = true;
+		for (const long long memory_budget : { 0LL, 16LL * 1024 })
+		{
+			GroupByOptions options;
+			options.value_columns = { 1, 2 };
+			options.memory_budget = memory_budget;
+			options.thread_count = 4;
+			const std::string label = memory_budget > 0 ? "spilled" : "in memory";
+			passed &= Expect(engine.GroupBy(path.string(), out_path.string(), options, std::error_code()), label + ": returned false");
+			passed &= Expect(ReadText(out_path) == expected, label + ": output differs from the reference");
+		}
+		return passed;
+	}
+
+	/// <summary>
+	/// 去掉行尾的\r后按\n拆分的非空行。
+	/// </summary>
+	std::vector<std::string> TrimmedLines(const std::string& text)
+	{
+		std::vector<std::string> lines = NonEmptyLines(text);
+		for (auto& line : lines)
+		{
+			if (!line.empty() && line.back() == '\r')
+			{
+				line.pop_back();
+			}
+		}
+		return lines;
+	}
+
+	/// <summary>
+	/// 连接的结果与嵌套循环的参考结果作为多重集合一致：内连接和左外连接，两侧都有重复的键，内存预算很小时分区连接。
+	/// </summary>
+	bool JoinFilesMatchesReference(const std::filesystem::path& directory)
+	{
+		const std::filesystem::path left_path = directory / "join_left.csv";
+		const std::filesystem::path right_path = directory / "join_right.csv";
+		const std::filesystem::path out_path = directory / "join_out.csv";
+		std::string left_text;
+		std::string right_text;
+		for (int i = 0; i < 6000; i++)
+		{
+			left_text += "L" + std::to_string(i) + "," + std::to_string(i * 13 % 2500) + (i % 2 == 0 ? "\r\n" : "\n") + (i % 101 == 0 ? "\n" : "");
+		}
+		for (int i = 0; i < 3000; i++)
+		{
+			right_text += std::to_string(i * 7 % 1800) + ",R" + std::to_string(i) + ",x" + std::to_string(i % 4) + (i % 3 == 0 ? "\r\n" : "\n");
+		}
+		left_text += "last,17";
+		right_text += "17,Rlast,y";
+		WriteText(left_path, left_text);
+		WriteText(right_path, right_text);
+
+		const std::vector<std::string> left_lines = TrimmedLines(left_text);
+		const std::vector<std::string> right_lines = TrimmedLines(right_text);
+		std::multimap<std::string, std::string> right_by_key;
+		for (const auto& line : right_lines)
+		{
+			right_by_key.emplace(KeyField(line, 0), "," + KeyField(line, 1) + "," + KeyField(line, 2));
+		}
+
+		const DelimitedFileMmfEngine engine(",");
+		bool passed = true;
+		for (const bool keep_unmatched_left : { false, true })
+		{
+			std::vector<std::string> expected;
+			for (const auto& line : left_lines)
+			{
+				const auto [first, last] = right_by_key.equal_range(KeyField(line, 1));
+				for (auto iter = first; iter != last; ++iter)
+				{
+					expected.push_back(line + iter->second);
+				}
+				if (first == last && keep_unmatched_left)
+				{
+					expected.push_back(line);
+				}
+			}
+			std::sort(expected.begin(), expected.end());
+
+			for (const long long memory_budget : { 0LL, 32LL * 1024 })
+			{
+				JoinOptions options;
+				options.left_key_column = 1;
+				options.right_key_column = 0;
+				options.keep_unmatched_left = keep_unmatched_left;
+				options.memory_budget = memory_budget;
+				options.thread_count = 4;
+				const std::string label = std::string(keep_unmatched_left ? "left outer" : "inner") + (memory_budget > 0 ? ", partitioned" : "");
+				passed &= Expect(engine.JoinFiles(left_path.string(), right_path.string(), out_path.string(), options, std::error_code()), label + ": returned false");
+				std::vector<std::string> joined = NonEmptyLines(ReadText(out_path));
+				std::sort(joined.begin(), joined.end());
+				passed &= Expect(joined == expected, label + ": got " + std::to_string(joined.size()) + " rows, expected " + std::to_string(expected.size()));
+			}
+		}
+		return passed;
+	}
+
+	/// <summary>
+	/// 按位置或键列对齐比较两个文件的参考实现。
+	/// </summary>
+	std::string DiffReference(const std::vector<std::string>& old_lines, const std::vector<std::string>& new_lines, const int key_column, DiffSummary& summary)
+	{
+		std::string text;
+		summary = DiffSummary();
+		const auto compare = [&](const std::string& old_line, const std::string& new_line)
+		{
+			if (old_line == new_line)
+			{
+				summary.unchanged++;
+				return;
+			}
+			text += "< " + old_line + "\n> " + new_line + "\n";
+			summary.changed++;
+		};
+		if (key_column < 0)
+		{
+			for (size_t i = 0; i < std::max(old_lines.size(), new_lines.size()); i++)
+			{
+				if (i >= old_lines.size())
+				{
+					text += "+ " + new_lines[i] + "\n";
+					summary.added++;
+				}
+				else if (i >= new_lines.size())
+				{
+					text += "- " + old_lines[i] + "\n";
+					summary.removed++;
+				}
+				else
+				{
+					compare(old_lines[i], new_lines[i]);
+				}
+			}
+			return text;
+		}
+
+		// 键相同的行按出现顺序配对。
+		std::map<std::string, std::vector<size_t>> old_by_key;
+		for (size_t i = old_lines.size(); i-- > 0;)
+		{
+			old_by_key[KeyField(old_lines[i], key_column)].push_back(i);
+		}
+		std::vector<bool> matched(old_lines.size());
+		for (const auto& new_line : new_lines)
+		{
+			auto& candidates = old_by_key[KeyField(new_line, key_column)];
+			if (candidates.empty())
+			{
+				text += "+ " + new_line + "\n";
+				summary.added++;
+				continue;
+			}
+			matched[candidates.back()] = true;
+			compare(old_lines[candidates.back()], new_line);
+			candidates.pop_back();
+		}
+		for (size_t i = 0; i < old_lines.size(); i++)
+		{
+			if (!matched[i])
+			{
+				text += "- " + old_lines[i] + "\n";
+				summary.removed++;
+			}
+		}
+		return text;
+	}
+
+	/// <summary>
+	/// 比较的输出和统计与参考实现一致：按位置和按键列对齐，新文件更长或更短，重复的键，\r\n、空行和没有换行符的最后一行。
+	/// </summary>
+	bool DiffFilesMatchesReference(const std::filesystem::path& directory)
+	{
+		const std::filesystem::path old_path = directory / "diff_old.csv";
+		const std::filesystem::path new_path = directory / "diff_new.csv";
+		const std::filesystem::path out_path = directory / "diff_out.csv";
+		const DelimitedFileMmfEngine engine(",");
+		bool passed = true;
+		for (const int new_count : { 30000, 27000 })
+		{
+			std::string old_text;
+			std::string new_text;
+			for (int i = 0; i < 28000; i++)
+			{
+				// 键有少量重复。
+				old_text += "id" + std::to_string(i % 25000) + ",v" + std::to_string(i % 11) + (i % 2 == 0 ? "\r\n" : "\n") + (i % 89 == 0 ? "\n" : "");
+			}
+			for (int i = 0; i < new_count; i++)
+			{
+				// 删除部分键，修改部分值，插入一行使之后的行错位。
+				if (i % 500 == 7)
+				{
+					continue;
+				}
+				const int key = i < 14000 ? i : i + 1;
+				new_text += "id" + std::to_string(key % 25000) + ",v" + std::to_string(i % 313 == 0 ? 99 : key % 11) + "\n" + (i == 14000 ? "inserted,row\n" : "");
+			}
+			old_text.pop_back();
+			new_text.pop_back();
+			WriteText(old_path, old_text);
+			WriteText(new_path, new_text);
+
+			for (const int key_column : { -1, 0 })
+			{
+				DiffSummary expected_summary;
+				const std::string expected = DiffReference(TrimmedLines(old_text), TrimmedLines(new_text), key_column, expected_summary);
+				DiffOptions options;
+				options.key_column = key_column;
+				options.thread_count = 4;
+				DiffSummary summary;
+				const std::string label = "new_count " + std::to_string(new_count) + (key_column < 0 ? ", by position" : ", by key");
+				passed &= Expect(engine.DiffFiles(old_path.string(), new_path.string(), out_path.string(), options, summary, std::error_code()), label + ": returned false");
+				passed &= Expect(ReadText(out_path) == expected, label + ": output differs from the reference");
+				passed &= Expect(summary.added == expected_summary.added && summary.removed == expected_summary.removed && summary.changed == expected_summary.changed &&
+					summary.unchanged == expected_summary.unchanged, label + ": summary " + std::to_string(summary.added) + "/" + std::to_string(summary.removed) + "/" +
+					std::to_string(summary.changed) + "/" + std::to_string(summary.unchanged) + ", expected " + std::to_string(expected_summary.added) + "/" +
+					std::to_string(expected_summary.removed) + "/" + std::to_string(expected_summary.changed) + "/" + std::to_string(expected_summary.unchanged));
+			}
+		}
+		return passed;
+	}
+
+	const std::vector<TestCase> kTestCases = {
+		{ "ModifyUnterminatedLastLine", ModifyUnterminatedLastLine },
+		{ "WriteAsyncTemporaryContents", WriteAsyncTemporaryContents },
+		{ "ReadCancelledReportsError", ReadCancelledReportsError },
+		{ "CommitAsyncKeepsLaterEdits", CommitAsyncKeepsLaterEdits },
+		{ "AppendToExistingAndMissingFiles", AppendToExistingAndMissingFiles },
+		{ "ConfigureFromPoolTask", ConfigureFromPoolTask },
+		{ "WriteWithFlushPolicies", WriteWithFlushPolicies },
+		{ "TransformExceptionReportsError", TransformExceptionReportsError },
+		{ "ReadFilesInOrderAndStop", ReadFilesInOrderAndStop },
+		{ "ColumnStatsMatchReference", ColumnStatsMatchReference },
+		{ "ZoneMapFilterAndInvalidate", ZoneMapFilterAndInvalidate },
+		{ "ParallelWriteMatchesSerial", ParallelWriteMatchesSerial },
+		{ "PatchSameLengthFields", PatchSameLengthFields },
+		{ "PatchVariableLengthFields", PatchVariableLengthFields },
+		{ "SortFileMatchesReference", SortFileMatchesReference },
+		{ "MergeSortedFilesMatchesReference", MergeSortedFilesMatchesReference },
+		{ "GroupByMatchesReference", GroupByMatchesReference },
+		{ "JoinFilesMatchesReference", JoinFilesMatchesReference },
+		{ "DiffFilesMatchesReference", DiffFilesMatchesReference },
+	};
+}
+
+int main()
+{
+	const std::filesystem::path directory = std::filesystem::temp_directory_path() / "file_helpers_tests";
+	std::filesystem::create_directories(directory);
+
+	int failed = 0;
+	for (const auto& test_case : kTestCases)
+	{
+		const bool passed = test_case.run(directory);
+		std::cout << (passed ? "[PASS] " : "[FAIL] ") << test_case.name << std::endl;
+		failed += passed ? 0 : 1;
+	}
+
+	std::error_code remove_error;
+	std::filesystem::remove_all(directory, remove_error);
+	std::cout << kTestCases.size() - failed << "/" << kTestCases.size() << " passed" << std::endl;
+	return failed == 0 ? 0 : 1;
+}